@@ -0,0 +1,198 @@
+#!/bin/sh
+
+# Headless command line tools, no Win32 or OpenGL.
+# Usage: build_linux.sh [target], builds every target when none is given.
+
+target_output=$1
+
+mkdir -p build/linux
+cd build/linux || exit 1
+
+preprocessor="-DCHESS_BUILD_DEBUG=0 -DNDEBUG"
+include_dirs="../../external"
+compiler_opts="-std=c++17 -O2 -g -I$include_dirs $preprocessor"
+
+# Perft benchmark
+build_perft() {
+    echo "Building perft"
+    g++ $compiler_opts ../../src/linux_perft.cpp -o perft -lpthread
+}
+
+# Lazy SMP search benchmark
+build_bench() {
+    echo "Building bench"
+    g++ $compiler_opts ../../src/linux_bench.cpp -o bench -lpthread
+}
+
+# Network evaluation micro-benchmark
+build_eval() {
+    echo "Building eval"
+    g++ $compiler_opts ../../src/linux_eval.cpp -o eval
+}
+
+# Polyglot book builder
+build_book() {
+    echo "Building book"
+    g++ $compiler_opts ../../src/linux_book.cpp -o book
+}
+
+# Endgame bitbase generator
+build_bitbase() {
+    echo "Building bitbase"
+    g++ $compiler_opts ../../src/linux_bitbase.cpp -o bitbase -lpthread
+}
+
+# Headless UCI engine
+build_uci() {
+    echo "Building uci"
+    g++ $compiler_opts ../../src/linux_uci.cpp -o uci -lpthread
+}
+
+# External UCI engine adapter benchmark
+build_extengine() {
+    echo "Building extengine"
+    g++ $compiler_opts ../../src/linux_extengine.cpp -o extengine -lpthread
+}
+
+# Self-play match runner
+build_match() {
+    echo "Building match"
+    g++ $compiler_opts ../../src/linux_match.cpp -o match -lpthread
+}
+
+# Proof-number mate solver
+build_solve() {
+    echo "Building solve"
+    g++ $compiler_opts ../../src/linux_solve.cpp -o solve -lpthread
+}
+
+# PGN import benchmark
+build_pgn() {
+    echo "Building pgn"
+    g++ $compiler_opts ../../src/linux_pgn.cpp -o pgn
+}
+
+# Parallel PGN ingestion
+build_ingest() {
+    echo "Building ingest"
+    g++ $compiler_opts ../../src/linux_ingest.cpp -o ingest -lpthread
+}
+
+# Game archive load benchmark and PGN round trip check
+build_archive() {
+    echo "Building archive"
+    g++ $compiler_opts ../../src/linux_archive.cpp -o archive
+}
+
+# Opening explorer index builder and lookup benchmark
+build_explorer() {
+    echo "Building explorer"
+    g++ $compiler_opts ../../src/linux_explorer.cpp -o explorer
+}
+
+# Per-frame board query benchmark, live board against FEN parsing
+build_frame() {
+    echo "Building frame"
+    g++ $compiler_opts ../../src/linux_frame.cpp -o frame
+}
+
+# Allocation test of the piece drag path
+build_alloc() {
+    echo "Building alloc"
+    g++ $compiler_opts ../../src/linux_alloc.cpp -o alloc
+}
+
+# Single-cell move generation checks and benchmark
+build_movegen() {
+    echo "Building movegen"
+    g++ $compiler_opts ../../src/linux_movegen.cpp -o movegen
+}
+
+# Frame time test of the game thread during a search
+build_frametime() {
+    echo "Building frametime"
+    g++ $compiler_opts ../../src/linux_frametime.cpp -o frametime
+}
+
+case "$target_output" in
+"")
+    build_perft
+    build_bench
+    build_eval
+    build_book
+    build_bitbase
+    build_uci
+    build_extengine
+    build_match
+    build_solve
+    build_pgn
+    build_ingest
+    build_archive
+    build_explorer
+    build_frame
+    build_alloc
+    build_movegen
+    build_frametime
+    ;;
+perft)
+    build_perft
+    ;;
+bench)
+    build_bench
+    ;;
+eval)
+    build_eval
+    ;;
+book)
+    build_book
+    ;;
+bitbase)
+    build_bitbase
+    ;;
+uci)
+    build_uci
+    ;;
+extengine)
+    build_extengine
+    ;;
+match)
+    build_match
+    ;;
+solve)
+    build_solve
+    ;;
+pgn)
+    build_pgn
+    ;;
+ingest)
+    build_ingest
+    ;;
+archive)
+    build_archive
+    ;;
+explorer)
+    build_explorer
+    ;;
+frame)
+    ;;
+alloc)
+    ;;
+frametime)
+    ;;
+frame)
+    build_frame
+    ;;
+alloc)
+    build_alloc
+    ;;
+movegen)
+    build_movegen
+    ;;
+frametime)
+    build_frametime
+    ;;
+*)
+    echo "Unknown target: $target_output"
+    exit 1
+    ;;
+esac
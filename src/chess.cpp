@@ -2,6 +2,17 @@
 #include "chess_asset.cpp"
 #include "chess_camera.cpp"
 #include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.cpp"
+#include "chess_book.cpp"
+#include "chess_external_engine.cpp"
+#include "chess_mate_solver.cpp"
+#include "chess_pgn.cpp"
+#include "chess_archive.cpp"
+#include "chess_explorer.cpp"
+
+#include <time.h>
 
 #define COLOR_WHITE        Vec4{ 1.0f, 1.0f, 1.0f, 1.0f }
 #define COLOR_BLACK        Vec4{ 0.0f, 0.0f, 0.0f, 1.0f }
@@ -20,6 +31,7 @@
 #define UI_COLOR_ICON_HOVER   COLOR_BLACK
 
 chess_internal Mat4x4 GetPieceModel(GameMemory* memory, u32 cellIndex);
+chess_internal u32    GetPieceMeshIndex(Piece piece);
 chess_internal void   DrawBoardCell(GameMemory* memory, u32 cellIndex, Vec4 color, const Rect* textureRect, Vec3 scale);
 chess_internal void   DragSelectedPiece(GameMemory* memory, f32 x, f32 y);
 chess_internal void   BeginPieceDrag(GameMemory* memory, u32 cellIndex);
@@ -32,12 +44,69 @@ chess_internal bool   UIButton(GameMemory* memory, const char* text, Rect rect);
 chess_internal bool   UIButton(GameMemory* memory, Rect rect, Rect textureRect);
 chess_internal bool UISelector(GameMemory* memory, Rect rect, const char* label, const char** options, u32 optionCount,
                                u32* selectedOptionIndex);
+chess_internal bool UISlider(GameMemory* memory, Rect rect, u32 maxValue, u32* value, bool* isDragging);
 chess_internal void SetCursorType(GameMemory* memory, u32 type);
 chess_internal void RestartGame(GameMemory* memory);
 chess_internal GameInputController* GetPlayerController(GameMemory* memory);
 chess_internal void                 DrawScene(GameMemory* memory);
 chess_internal void                 SetVsync(GameMemory* memory, bool enabled);
 chess_internal void                 DrawCursor(GameMemory* memory);
+chess_internal void                 GameSnapshotPush(GameMemory* memory);
+chess_internal GameSnapshot*        GameSnapshotPop(GameMemory* memory);
+chess_internal void                 GameSnapshotRestore(GameMemory* memory, const GameSnapshot* snapshot);
+chess_internal void                 GameSnapshotSave(GameMemory* memory);
+chess_internal void                 GameSnapshotLoad(GameMemory* memory);
+chess_internal bool                 ComputerIsTurn(GameMemory* memory);
+chess_internal void                 ComputerMoveDo(GameMemory* memory, u16 data);
+chess_internal void                 SearchUpdate(GameMemory* memory);
+chess_internal void                 DrawAnalysis(GameMemory* memory);
+chess_internal void                 DrawGameList(GameMemory* memory);
+
+// Board logic knows nothing about assets, piece meshes are resolved here
+chess_internal u32 GetPieceMeshIndex(Piece piece)
+{
+    u32 result;
+
+    switch (piece.type)
+    {
+    case PIECE_TYPE_PAWN:
+    {
+        result = MESH_PAWN;
+        break;
+    }
+    case PIECE_TYPE_BISHOP:
+    {
+        result = MESH_BISHOP;
+        break;
+    }
+    case PIECE_TYPE_KNIGHT:
+    {
+        result = MESH_KNIGHT;
+        break;
+    }
+    case PIECE_TYPE_ROOK:
+    {
+        result = MESH_ROOK;
+        break;
+    }
+    case PIECE_TYPE_KING:
+    {
+        result = MESH_KING;
+        break;
+    }
+    case PIECE_TYPE_QUEEN:
+    {
+        result = MESH_QUEEN;
+        break;
+    }
+    default:
+    {
+        CHESS_ASSERT(0);
+    }
+    }
+
+    return result;
+}
 
 chess_internal Mat4x4 GetPieceModel(GameMemory* memory, u32 cellIndex)
 {
@@ -205,44 +274,35 @@ chess_internal inline void EndPieceDrag(GameMemory* memory)
     u32 targetCell = GetDraggingPieceTargetCell(memory);
     u32 fromCell   = state->pieceDragState.piece.cellIndex;
 
-    u32   moveCount;
-    Move* movelist = BoardGetPieceMoveList(board, fromCell, &moveCount);
-    if (moveCount > 0)
+    if (BoardGetPieceTargets(board, fromCell))
     {
-        bool validMove = false;
-        for (u32 moveIndex = 0; moveIndex < moveCount; moveIndex++)
+        Move* move = BoardMoveFind(board, fromCell, targetCell);
+        char uci[UCI_STR_MAX_LENGTH];
+        if (move)
         {
-            Move* move = &movelist[moveIndex];
-            if (move->to == targetCell)
-            {
-                BoardMoveDo(board, move);
-                platform.Log("Board fen: %s", board->deltas.peek().fen.c_str());
-
-                switch (move->type)
-                {
-                case MOVE_TYPE_CHECK:
-                {
-                    PlaySound(memory, GAME_SOUND_CHECK);
-                    break;
-                }
-                default:
-                {
-                    PlaySound(memory, GAME_SOUND_MOVE);
-                    break;
-                }
-                }
+            BoardMoveGetUci(move, uci);
+        }
+        if (move && BoardMoveDo(board, move))
+        {
+            char fen[FEN_STR_MAX_LENGTH];
+            BoardGetFen(board, fen);
+            platform.Log("Board move: %s, fen: %s", uci, fen);
 
-                validMove = true;
-                break;
+            // Move list belongs to the previous position, the check state is read from the new one
+            if (BoardInCheck(board))
+            {
+                PlaySound(memory, GAME_SOUND_CHECK);
+            }
+            else
+            {
+                PlaySound(memory, GAME_SOUND_MOVE);
             }
         }
-
-        if (!validMove)
+        else
         {
             PlaySound(memory, GAME_SOUND_ILLEGAL);
         }
     }
-    FreePieceMoveList(movelist);
 
     state->pieceDragState.isDragging    = false;
     state->pieceDragState.worldPosition = Vec3{ -1.0f };
@@ -280,29 +340,12 @@ chess_internal u32 GetDraggingPieceTargetCell(GameMemory* memory)
     f32  cellWidth = (gridScale.x / 8.0f) * 2.0f;
     f32  cellDepth = (gridScale.z / 8.0f) * 2.0f;
 
-    u32 targetCellIndex;
-    for (u32 row = 0; row < 8; row++)
-    {
-        f32 rowMinZ = gridScale.z - (cellDepth * (f32)row);
-        f32 rowMaxZ = rowMinZ - cellDepth;
-
-        if (draggingPiecePosition.z <= rowMinZ && draggingPiecePosition.z >= rowMaxZ)
-        {
-            for (u32 col = 0; col < 8; col++)
-            {
-                f32 colMinX = -gridScale.x + (cellWidth * f32(col));
-                f32 colMaxX = colMinX + cellWidth;
-
-                if (draggingPiecePosition.x >= colMinX && draggingPiecePosition.x <= colMaxX)
-                {
-                    return CELL_INDEX(row, col);
-                }
-            }
-        }
-    }
+    // Rows start at +z and grow towards -z, columns start at -x and grow towards +x.
+    // Dragged position is already clamped to the grid bounds, clamp again for the far edges.
+    f32 row = Clamp(floorf((gridScale.z - draggingPiecePosition.z) / cellDepth), 0.0f, 7.0f);
+    f32 col = Clamp(floorf((draggingPiecePosition.x + gridScale.x) / cellWidth), 0.0f, 7.0f);
 
-    CHESS_ASSERT(0);
-    return 0;
+    return CELL_INDEX((u32)row, (u32)col);
 }
 
 chess_internal inline void PlaySound(GameMemory* memory, u32 soundIndex)
@@ -420,119 +463,1251 @@ chess_internal bool UISelector(GameMemory* memory, Rect rect, const char* label,
     f32  cursorX          = (f32)controller->cursorX;
     f32  cursorY          = (f32)controller->cursorY;
 
-    f32 iconBtnWidth  = textureArrowRight.w;
-    f32 iconBtnHeight = textureArrowRight.h;
-    CHESS_ASSERT(iconBtnWidth == textureArrowLeft.w);
-    CHESS_ASSERT(iconBtnHeight == textureArrowLeft.h);
+    f32 iconBtnWidth  = textureArrowRight.w;
+    f32 iconBtnHeight = textureArrowRight.h;
+    CHESS_ASSERT(iconBtnWidth == textureArrowLeft.w);
+    CHESS_ASSERT(iconBtnHeight == textureArrowLeft.h);
+
+    Vec4 textColor = UI_COLOR_TEXT;
+    Vec4 iconColor = UI_COLOR_ICON;
+
+    // Selector
+    if (PointInRect(rect, { cursorX, cursorY }))
+    {
+        draw.Rect(rect, UI_COLOR_WIDGET_HOVER);
+        textColor = UI_COLOR_TEXT_HOVER;
+        iconColor = UI_COLOR_ICON_HOVER;
+    }
+
+    // Label
+    {
+        Vec2 textSize        = draw.TextGetSize(label);
+        f32  textAreaCenterY = rect.y + (rect.h / 2.0f);
+
+        f32 x = (f32)(int)rect.x;
+        f32 y = (f32)(int)(textAreaCenterY + (textSize.h / 2.0f));
+
+        draw.Text(label, x, y, textColor);
+    }
+
+    Rect leftArrowRect;
+    leftArrowRect.x = rect.x + (rect.w / 2.0f);
+    leftArrowRect.y = rect.y;
+    leftArrowRect.w = iconBtnWidth;
+    leftArrowRect.h = rect.h;
+
+    Rect rightArrowRect;
+    rightArrowRect.x = (rect.x + rect.w) - iconBtnWidth;
+    rightArrowRect.y = rect.y;
+    rightArrowRect.w = iconBtnWidth;
+    rightArrowRect.h = rect.h;
+
+    // Previous option
+    if (*selectedOptionIndex > 0 && optionCount > 0)
+    {
+        if (PointInRect(leftArrowRect, { cursorX, cursorY }))
+        {
+            SetCursorType(memory, CURSOR_TYPE_FINGER);
+            if (actionBtnPressed)
+            {
+                (*selectedOptionIndex)--;
+                pressed = true;
+            }
+        }
+
+        draw.RectTexture(leftArrowRect, textureArrowLeft, btnTexture, iconColor);
+    }
+    // Next option
+    if (*selectedOptionIndex < optionCount - 1)
+    {
+        if (PointInRect(rightArrowRect, { cursorX, cursorY }))
+        {
+            SetCursorType(memory, CURSOR_TYPE_FINGER);
+            if (actionBtnPressed)
+            {
+                (*selectedOptionIndex)++;
+                pressed = true;
+            }
+        }
+
+        draw.RectTexture(rightArrowRect, textureArrowRight, btnTexture, iconColor);
+    }
+
+    // Text area covers space between right and left icons
+    Rect textArea;
+    textArea.x = leftArrowRect.x + iconBtnWidth;
+    textArea.y = rect.y;
+    textArea.w = rect.w / 2.0f - (iconBtnWidth * 2.0f);
+    textArea.h = rect.h;
+
+    const char* option = options[*selectedOptionIndex];
+
+    Vec2 textSize        = draw.TextGetSize(option);
+    f32  textAreaCenterX = textArea.x + (textArea.w / 2.0f);
+    f32  textAreaCenterY = textArea.y + (textArea.h / 2.0f);
+    f32  textX           = (f32)(int)(textAreaCenterX - (textSize.w / 2.0f));
+    f32  textY           = (f32)(int)(textAreaCenterY + (textSize.h / 2.0f));
+
+    draw.Text(option, textX, textY, textColor);
+
+    return pressed;
+}
+
+// Value from 0 to maxValue along the width of rect. A press on it starts a drag that follows the cursor, even off the
+// rect, until the action button is released. True when the value changed.
+chess_internal bool UISlider(GameMemory* memory, Rect rect, u32 maxValue, u32* value, bool* isDragging)
+{
+    CHESS_ASSERT(memory);
+    CHESS_ASSERT(value);
+    CHESS_ASSERT(isDragging);
+    CHESS_ASSERT(*value <= maxValue);
+
+    GameInputController* controller = GetPlayerController(memory);
+    DrawAPI              draw       = memory->draw;
+
+    f32  cursorX = (f32)controller->cursorX;
+    f32  cursorY = (f32)controller->cursorY;
+    bool isHover = PointInRect(rect, { cursorX, cursorY });
+
+    if (isHover && ButtonIsPressed(controller->buttonAction))
+    {
+        *isDragging = true;
+    }
+    if (!ButtonIsDown(controller->buttonAction))
+    {
+        *isDragging = false;
+    }
+
+    bool changed = false;
+    if (*isDragging && maxValue > 0)
+    {
+        f32 t        = Clamp((cursorX - rect.x) / rect.w, 0.0f, 1.0f);
+        u32 newValue = (u32)(t * maxValue + 0.5f);
+        changed      = newValue != *value;
+        *value       = newValue;
+    }
+    if (isHover || *isDragging)
+    {
+        SetCursorType(memory, CURSOR_TYPE_FINGER);
+    }
+
+    // Track, the part up to the value and the handle
+    f32  trackH  = 8.0f;
+    f32  handleW = 12.0f;
+    f32  valueX  = rect.x + (maxValue > 0 ? rect.w * (f32)*value / (f32)maxValue : 0.0f);
+    Vec4 color   = isHover || *isDragging ? UI_COLOR_TEXT_HOVER : UI_COLOR_TEXT;
+
+    Rect trackRect;
+    trackRect.x = rect.x;
+    trackRect.y = rect.y + (rect.h - trackH) / 2.0f;
+    trackRect.w = rect.w;
+    trackRect.h = trackH;
+
+    Rect valueRect = trackRect;
+    valueRect.w    = valueX - rect.x;
+
+    Rect handleRect;
+    handleRect.x = valueX - handleW / 2.0f;
+    handleRect.y = rect.y;
+    handleRect.w = handleW;
+    handleRect.h = rect.h;
+
+    if (isHover || *isDragging)
+    {
+        draw.Rect(rect, UI_COLOR_WIDGET_HOVER);
+    }
+    draw.Rect(trackRect, Vec4{ 0.0f, 0.0f, 0.0f, 0.7f });
+    draw.Rect(valueRect, COLOR_PURPLE);
+    draw.Rect(handleRect, color);
+
+    return changed;
+}
+
+chess_internal inline void SetCursorType(GameMemory* memory, u32 type)
+{
+    CHESS_ASSERT(memory);
+    CHESS_ASSERT(type >= 0 && type < CURSOR_TYPE_COUNT);
+
+    GameState* state = (GameState*)memory->permanentStorage;
+
+    constexpr Rect rects[3] = {
+        textureCursorPointer, // Pointer
+        textureCursorFinger,  // Finger
+        textureCursorPick,    // Pick
+    };
+
+    state->cursorTexture = rects[type];
+}
+
+chess_internal inline void RestartGame(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state = (GameState*)memory->permanentStorage;
+    BoardReset(&state->board, DEFAULT_FEN_STRING);
+    state->gameState = GAME_STATE_PLAY;
+    state->gameId    = ++state->lastGameId;
+}
+
+// Maps PGN_PATH again every time, so the file can be replaced while the game runs. Nothing is read until the
+// game list asks for its first page.
+chess_internal void GamesOpen(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI platform = memory->platform;
+    GameState*  state    = (GameState*)memory->permanentStorage;
+
+    if (state->pgnFile.content)
+    {
+        platform.FileUnmap(&state->pgnFile);
+    }
+    state->pgnFile = platform.FileMap(PGN_PATH);
+    PgnOpen(&state->pgn, state->pgnFile.content, state->pgnFile.contentSize);
+    state->pgnListFirst  = 0;
+    state->isArchiveList = false;
+
+    if (!state->pgnFile.content)
+    {
+        platform.Log("GAME no games at '%s'", PGN_PATH);
+        return;
+    }
+    platform.Log("GAME games '%s' mapped, %llu bytes", PGN_PATH, state->pgnFile.contentSize);
+    state->gameState = GAME_STATE_GAMES;
+}
+
+// The archive is read in place, opening it only checks the header
+chess_internal void GamesOpenArchive(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI platform = memory->platform;
+    GameState*  state    = (GameState*)memory->permanentStorage;
+
+    // The io queue replaces the file under the mapping
+    if (state->archiveJob->mailbox.load(std::memory_order_acquire) != GAME_ARCHIVE_MAILBOX_IDLE)
+    {
+        platform.Log("GAME archive '%s' is being written", GAME_ARCHIVE_PATH);
+        return;
+    }
+
+    if (state->archiveFile.content)
+    {
+        platform.FileUnmap(&state->archiveFile);
+    }
+    state->archiveFile = platform.FileMap(GAME_ARCHIVE_PATH);
+    if (!ArchiveOpen(&state->archive, state->archiveFile.content, state->archiveFile.contentSize))
+    {
+        platform.Log("GAME no game archive at '%s'", GAME_ARCHIVE_PATH);
+        return;
+    }
+    platform.Log("GAME archive '%s' mapped, %llu games", GAME_ARCHIVE_PATH, state->archive.gameCount);
+
+    state->pgnListFirst  = 0;
+    state->isArchiveList = true;
+    state->gameState     = GAME_STATE_GAMES;
+}
+
+struct GameArchiveBuffer
+{
+    u8* base;
+    u64 capacity;
+    u64 size;
+};
+
+chess_internal ARCHIVE_WRITE(GameArchiveWrite)
+{
+    GameArchiveBuffer* buffer = (GameArchiveBuffer*)context;
+    if (offset + size > buffer->capacity)
+    {
+        return false;
+    }
+
+    memcpy(buffer->base + offset, data, size);
+    buffer->size = offset + size > buffer->size ? offset + size : buffer->size;
+    return true;
+}
+
+// Rewrites GAME_ARCHIVE_PATH with the game of the job added, in the encoding the archive already uses
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(GameArchiveSaveWork)
+{
+    GameArchiveJob* job      = (GameArchiveJob*)data;
+    PlatformAPI     platform = job->platform;
+
+    MemoryArena       arena = job->arena;
+    GameArchiveBuffer buffer;
+    buffer.base     = (u8*)ArenaPushSize(&arena, GAME_ARCHIVE_FILE_SIZE);
+    buffer.capacity = GAME_ARCHIVE_FILE_SIZE;
+    buffer.size     = 0;
+
+    FileMapResult file = platform.FileMap(GAME_ARCHIVE_PATH);
+    ArchiveReader archive;
+    bool          isArchive = ArchiveOpen(&archive, file.content, file.contentSize);
+    u32           encoding  = isArchive ? archive.header->encoding : (u32)ARCHIVE_ENCODING_MOVE16;
+
+    ArchiveWriter writer;
+    ArchiveWriterInit(&writer, &arena, encoding, GAME_ARCHIVE_MAX_GAMES, GAME_ARCHIVE_MAX_STRINGS,
+                      GAME_ARCHIVE_STRING_SIZE, GameArchiveWrite, &buffer);
+    for (u64 i = 0; isArchive && i < archive.gameCount; i++)
+    {
+        ArchiveWriterCopyGame(&writer, &archive, i);
+    }
+    if (file.content)
+    {
+        platform.FileUnmap(&file);
+    }
+
+    const char* tags[ARCHIVE_TAG_COUNT] = {};
+    tags[ARCHIVE_TAG_EVENT]             = "Casual game";
+    tags[ARCHIVE_TAG_DATE]              = job->date;
+    tags[ARCHIVE_TAG_WHITE]             = job->white;
+    tags[ARCHIVE_TAG_BLACK]             = job->black;
+    tags[ARCHIVE_TAG_FEN]               = job->fen[0] ? job->fen : 0;
+    ArchiveWriterAddGame(&writer, job->moves[encoding], job->moveSizes[encoding], job->plyCount, tags, job->result);
+
+    job->isWritten = ArchiveWriterFinish(&writer) &&
+                     platform.FileWriteEntire(GAME_ARCHIVE_PATH, buffer.base, buffer.size);
+    job->gameCount = writer.gameCount;
+    job->fileSize  = buffer.size;
+    job->mailbox.store(GAME_ARCHIVE_MAILBOX_DONE, std::memory_order_release);
+}
+
+// Logs the outcome of the last save once its entry is done
+chess_internal void GameArchiveUpdate(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI     platform = memory->platform;
+    GameState*      state    = (GameState*)memory->permanentStorage;
+    GameArchiveJob* job      = state->archiveJob;
+
+    if (job->mailbox.load(std::memory_order_acquire) != GAME_ARCHIVE_MAILBOX_DONE)
+    {
+        return;
+    }
+
+    if (job->isWritten)
+    {
+        platform.Log("GAME game %llu added to '%s', %llu bytes", job->gameCount, GAME_ARCHIVE_PATH, job->fileSize);
+    }
+    else
+    {
+        platform.Log("GAME unable to add the game to '%s'", GAME_ARCHIVE_PATH);
+    }
+    job->mailbox.store(GAME_ARCHIVE_MAILBOX_IDLE, std::memory_order_release);
+}
+
+// Copies the finished game into the job and hands it to the io queue, the file is only touched by the entry
+chess_internal void GameArchiveSave(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*      state   = (GameState*)memory->permanentStorage;
+    BoardHistory*   history = &state->board.history;
+    GameArchiveJob* job     = state->archiveJob;
+
+    // Only a game finished while the previous one is still being written waits here
+    while (job->mailbox.load(std::memory_order_acquire) == GAME_ARCHIVE_MAILBOX_WRITING)
+    {
+        std::this_thread::yield();
+    }
+    GameArchiveUpdate(memory);
+
+    // The game list maps the same file, which the entry replaces
+    if (state->archiveFile.content)
+    {
+        memory->platform.FileUnmap(&state->archiveFile);
+        ArchiveOpen(&state->archive, 0, 0);
+    }
+
+    job->platform = memory->platform;
+    job->arena    = job->storage;
+    job->plyCount = history->length;
+    for (u32 encoding = ARCHIVE_ENCODING_MOVE16; encoding <= ARCHIVE_ENCODING_INDEX8; encoding++)
+    {
+        job->moves[encoding]     = (u8*)ArenaPushSize(&job->arena, history->length * ArchiveGetMoveSize(encoding));
+        job->moveSizes[encoding] = ArchiveEncodeMoves(&state->board, encoding, job->moves[encoding]);
+    }
+
+    BoardPosition root;
+    root.Restore(history->keyframes[0], history->rootHalfMoves, history->rootPlies);
+    std::string fen = root.getFen();
+    snprintf(job->fen, sizeof(job->fen), "%s", fen != chess::constants::STARTPOS ? fen.c_str() : "");
+
+    time_t now = time(0);
+    strftime(job->date, sizeof(job->date), "%Y.%m.%d", localtime(&now));
+    strcpy(job->white, state->opponent == GAME_OPPONENT_COMPUTER_WHITE ? "Computer" : "Player");
+    strcpy(job->black, state->opponent == GAME_OPPONENT_COMPUTER_BLACK ? "Computer" : "Player");
+
+    u32 boardResult = BoardGetGameResult(&state->board);
+    job->result     = boardResult == BOARD_GAME_RESULT_WIN    ? ARCHIVE_RESULT_WHITE
+                      : boardResult == BOARD_GAME_RESULT_LOSE ? ARCHIVE_RESULT_BLACK
+                      : boardResult == BOARD_GAME_RESULT_DRAW ? ARCHIVE_RESULT_DRAW
+                                                              : ARCHIVE_RESULT_UNKNOWN;
+
+    job->mailbox.store(GAME_ARCHIVE_MAILBOX_WRITING, std::memory_order_release);
+    memory->platform.WorkQueueAddEntry(memory->ioQueue, GameArchiveSaveWork, job);
+}
+
+chess_internal inline GameSnapshot* GameSnapshotGet(GameSnapshotRing* ring, u32 index)
+{
+    CHESS_ASSERT(index < ring->count);
+    return (GameSnapshot*)(ring->base + ring->offsets[(ring->first + index) % GAME_SNAPSHOT_MAX]);
+}
+
+chess_internal inline void GameSnapshotEvictOldest(GameSnapshotRing* ring)
+{
+    ring->first = (ring->first + 1) % GAME_SNAPSHOT_MAX;
+    ring->count--;
+}
+
+// Records are written back to back and wrap at the end of the storage, the oldest ones are evicted while they overlap
+// the space the new record needs, so the ring is always ordered from ring->first to the write offset.
+chess_internal void GameSnapshotPush(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*        state = (GameState*)memory->permanentStorage;
+    GameSnapshotRing* ring  = state->snapshots;
+    Board*            board = &state->board;
+
+    f64 startTicks = memory->platform.TimerGetTicks();
+
+    u32 historySize = BoardHistorySnapshotSize(board->history.count);
+    u64 size        = (sizeof(GameSnapshot) + historySize + 15) & ~15ull;
+    CHESS_ASSERT(size <= ring->capacity);
+
+    u64 offset = ring->writeOffset;
+    if (offset + size > ring->capacity)
+    {
+        // Records left in the skipped tail are the oldest ones
+        while (ring->count && ring->offsets[ring->first] >= offset)
+        {
+            GameSnapshotEvictOldest(ring);
+        }
+        offset = 0;
+    }
+    while (ring->count)
+    {
+        GameSnapshot* oldest       = GameSnapshotGet(ring, 0);
+        u64           oldestOffset = ring->offsets[ring->first];
+        bool          overlaps     = oldestOffset < offset + size && offset < oldestOffset + oldest->size;
+        if (!overlaps && ring->count < GAME_SNAPSHOT_MAX)
+        {
+            break;
+        }
+        GameSnapshotEvictOldest(ring);
+    }
+
+    GameSnapshot* snapshot = (GameSnapshot*)(ring->base + offset);
+    snapshot->magic        = GAME_SNAPSHOT_MAGIC;
+    snapshot->stateSize    = sizeof(GameState);
+    snapshot->size         = (u32)(sizeof(GameSnapshot) + historySize);
+    snapshot->historyCount = board->history.count;
+    memcpy(&snapshot->state, state, sizeof(GameState));
+    BoardHistorySnapshot(board, snapshot + 1);
+
+    ring->offsets[(ring->first + ring->count) % GAME_SNAPSHOT_MAX] = (u32)offset;
+    ring->count++;
+    ring->writeOffset = offset + size;
+
+    ring->pushMicroseconds = (memory->platform.TimerGetTicks() - startTicks) * 1000000.0;
+}
+
+// Removes the newest snapshot and returns it, the last one is kept so rewind stops at the oldest frame
+chess_internal GameSnapshot* GameSnapshotPop(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*        state = (GameState*)memory->permanentStorage;
+    GameSnapshotRing* ring  = state->snapshots;
+
+    GameSnapshot* result = 0;
+    if (ring->count)
+    {
+        result = GameSnapshotGet(ring, ring->count - 1);
+        if (ring->count > 1)
+        {
+            ring->count--;
+            ring->writeOffset = (u8*)result - ring->base;
+        }
+    }
+
+    return result;
+}
+
+chess_internal void GameSnapshotRestore(GameMemory* memory, const GameSnapshot* snapshot)
+{
+    CHESS_ASSERT(memory);
+    CHESS_ASSERT(snapshot);
+    CHESS_ASSERT(snapshot->magic == GAME_SNAPSHOT_MAGIC && snapshot->stateSize == sizeof(GameState));
+
+    GameState* state = (GameState*)memory->permanentStorage;
+
+    GameState restored;
+    memcpy(&restored, &snapshot->state, sizeof(GameState));
+
+    // Session state belongs to this run of the game, not to the snapshot
+    restored.isInitialized             = state->isInitialized;
+    restored.permanentArena            = state->permanentArena;
+    restored.assets                    = state->assets;
+    restored.camera2D                  = state->camera2D;
+    restored.cursorTexture             = state->cursorTexture;
+    restored.snapshots                 = state->snapshots;
+    restored.engine                    = state->engine;
+    restored.book                      = state->book;
+    restored.bitbases                  = state->bitbases;
+    restored.externalEngine            = state->externalEngine;
+    restored.mateSolver                = state->mateSolver;
+    restored.solveResult               = state->solveResult;
+    restored.solveKey                  = state->solveKey;
+    restored.isSolvePending            = state->isSolvePending;
+    restored.pgnFile                   = state->pgnFile;
+    restored.pgn                       = state->pgn;
+    restored.pgnListFirst              = state->pgnListFirst;
+    restored.archiveFile               = state->archiveFile;
+    restored.archive                   = state->archive;
+    restored.isArchiveList             = state->isArchiveList;
+    restored.archiveJob                = state->archiveJob;
+    restored.lastGameId                = state->lastGameId;
+    restored.archivedGameId            = state->archivedGameId;
+    restored.explorerFile              = state->explorerFile;
+    restored.explorer                  = state->explorer;
+    restored.opponent                  = state->opponent;
+    restored.vsyncEnabled              = state->vsyncEnabled;
+    restored.fullscreenEnabled         = state->fullscreenEnabled;
+    restored.soundEnabled              = state->soundEnabled;
+    restored.showPiecesMovesEnabled    = state->showPiecesMovesEnabled;
+    restored.gamepadSensitivity        = state->gamepadSensitivity;
+    restored.board.position            = state->board.position;
+    restored.board.history.entries     = state->board.history.entries;
+    restored.board.history.keys        = state->board.history.keys;
+    restored.board.history.keyframes   = state->board.history.keyframes;
+    restored.board.history.maxPlies    = state->board.history.maxPlies;
+    restored.pieceDragState.isDragging = false;
+    restored.isTimelineDragging        = false;
+
+    memcpy(state, &restored, sizeof(GameState));
+    BoardHistoryRestore(&state->board, snapshot + 1, snapshot->historyCount);
+}
+
+chess_internal void GameSnapshotSave(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*        state = (GameState*)memory->permanentStorage;
+    GameSnapshotRing* ring  = state->snapshots;
+
+    if (ring->count)
+    {
+        GameSnapshot* snapshot = GameSnapshotGet(ring, ring->count - 1);
+        if (memory->platform.FileWriteEntire(GAME_SNAPSHOT_SAVE_FILE, snapshot, snapshot->size))
+        {
+            memory->platform.Log("GAME saved to '%s'", GAME_SNAPSHOT_SAVE_FILE);
+        }
+    }
+}
+
+// Fields of a saved GameState that GameSnapshotRestore keeps, checked in place in the file buffer.
+// The board position and info are rebuilt by the history replay, the pointers are replaced by the live ones.
+chess_internal bool GameSnapshotStateIsValid(const GameState* saved, u32 historyCount)
+{
+    const Camera3D* camera = &saved->camera3D;
+
+    // The length may run past the count after an undo, only the plies up to the count are saved
+    bool isValid = saved->gameState <= GAME_STATE_GAMES && saved->board.history.count == historyCount;
+    isValid = isValid && isfinite(camera->fov) && isfinite(camera->pitch) && isfinite(camera->yaw);
+    for (u32 i = 0; isValid && i < 3; i++)
+    {
+        isValid = isfinite(camera->target.e[i]) && isfinite(camera->position.e[i]) && isfinite(camera->up.e[i]);
+    }
+
+    return isValid;
+}
+
+// The file is untrusted. The header and the size are checked before anything past them is read, then the saved
+// state fields and the history replay, and the live state is only written once all of it passed.
+chess_internal void GameSnapshotLoad(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*        state = (GameState*)memory->permanentStorage;
+    GameSnapshotRing* ring  = state->snapshots;
+
+    FileReadResult file     = memory->platform.FileReadEntire(GAME_SNAPSHOT_SAVE_FILE);
+    GameSnapshot*  snapshot = (GameSnapshot*)file.content;
+
+    bool isValid = file.contentSize >= sizeof(GameSnapshot) && snapshot->magic == GAME_SNAPSHOT_MAGIC &&
+                   snapshot->stateSize == sizeof(GameState) && snapshot->size == file.contentSize &&
+                   snapshot->historyCount < state->board.history.maxPlies &&
+                   snapshot->size == sizeof(GameSnapshot) + BoardHistorySnapshotSize(snapshot->historyCount);
+    isValid = isValid && GameSnapshotStateIsValid(&snapshot->state, snapshot->historyCount) &&
+              BoardHistoryIsValid(snapshot + 1, snapshot->historyCount, snapshot->state.board.history.rootPlies,
+                                  snapshot->state.board.history.rootHalfMoves);
+    if (isValid)
+    {
+        GameSnapshotRestore(memory, snapshot);
+        state->gameId = 0;
+
+        // Rewinding past a load would jump to another game
+        ring->first       = 0;
+        ring->count       = 0;
+        ring->writeOffset = 0;
+        GameSnapshotPush(memory);
+
+        memory->platform.Log("GAME loaded from '%s'", GAME_SNAPSHOT_SAVE_FILE);
+    }
+    else if (file.content)
+    {
+        memory->platform.Log("GAME invalid save file '%s'", GAME_SNAPSHOT_SAVE_FILE);
+    }
+
+    memory->platform.FileFreeMemory(file.content);
+}
+
+// Computer moves only while the game is being played, a result for a position the board already left is discarded
+chess_internal bool ComputerIsTurn(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state = (GameState*)memory->permanentStorage;
+    Board*     board = &state->board;
+
+    u32 computerColor = state->opponent == GAME_OPPONENT_COMPUTER_WHITE ? PIECE_COLOR_WHITE : PIECE_COLOR_BLACK;
+
+    return state->opponent != GAME_OPPONENT_HUMAN && state->gameState == GAME_STATE_PLAY &&
+           BoardGetTurn(board) == computerColor && BoardGetGameResult(board) == BOARD_GAME_RESULT_NONE;
+}
+
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(EngineSearchWork)
+{
+    EngineSearch((EngineThread*)data);
+}
+
+chess_internal void SearchStart(GameMemory* memory, EngineLimits limits)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state  = (GameState*)memory->permanentStorage;
+    Engine*    engine = state->engine;
+
+    if (EngineStart(engine, &state->board, limits, engine->threadCount))
+    {
+        for (u32 i = 0; i < engine->threadCount; i++)
+        {
+            memory->platform.WorkQueueAddEntry(memory->workQueue, EngineSearchWork, &engine->threads[i]);
+        }
+    }
+}
+
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(BitbaseSliceWork)
+{
+    BitbaseRunSlice((BitbaseSlice*)data);
+}
+
+// One queue entry per slice, the main thread helps until the pass is done
+chess_internal BITBASE_RUN_SLICES(BitbaseRunSlicesOnQueue)
+{
+    GameMemory* memory = (GameMemory*)context;
+
+    for (u32 i = 0; i < generator->sliceCount; i++)
+    {
+        memory->platform.WorkQueueAddEntry(memory->workQueue, BitbaseSliceWork, &generator->slices[i]);
+    }
+    memory->platform.WorkQueueCompleteAll(memory->workQueue);
+}
+
+chess_internal void ComputerMoveDo(GameMemory* memory, u16 data)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state = (GameState*)memory->permanentStorage;
+    Board*     board = &state->board;
+
+    for (u32 i = 0; i < board->info.moveCount; i++)
+    {
+        Move* move = &board->info.moves[i];
+        if (move->data == data)
+        {
+            if (BoardMoveDo(board, move))
+            {
+                PlaySound(memory, BoardInCheck(board) ? GAME_SOUND_CHECK : GAME_SOUND_MOVE);
+            }
+            break;
+        }
+    }
+}
+
+// The whole game from its initial position, so the engine sees repetitions. The current position alone when the
+// moves do not fit the command.
+chess_internal void ExternalSearchStart(GameMemory* memory, const char* limits)
+{
+    CHESS_ASSERT(memory);
+
+    GameState*      state    = (GameState*)memory->permanentStorage;
+    Board*          board    = &state->board;
+    BoardHistory*   history  = &board->history;
+    ExternalEngine* external = state->externalEngine;
+
+    BoardPosition root;
+    root.Restore(history->keyframes[0], history->rootHalfMoves, history->rootPlies);
+
+    char command[EXTERNAL_ENGINE_LINE_MAX * 3];
+    u32  length = sprintf(command, "position fen %s moves", root.getFen().c_str());
+    for (u32 ply = 0; ply < history->count && length + UCI_STR_MAX_LENGTH + 1 < sizeof(command); ply++)
+    {
+        std::string uci = chess::uci::moveToUci(chess::Move(history->entries[ply].move));
+        length += sprintf(command + length, " %s", uci.c_str());
+    }
+    if (length + UCI_STR_MAX_LENGTH + 1 >= sizeof(command))
+    {
+        sprintf(command, "position fen %s", board->position->getFen().c_str());
+    }
+
+    external->isSearching = ExternalEngineSend(external, memory, "%s\ngo %s\n", command, limits);
+    external->isInfinite  = strcmp(limits, "infinite") == 0;
+    external->isStopSent  = false;
+    external->searchKey   = board->position->hash();
+    external->info        = {};
+}
+
+// Same rules as the engine search, only through UCI. The ring is drained every frame, info lines only keep the last
+// one for the analysis panel.
+chess_internal void ExternalSearchUpdate(GameMemory* memory, bool isTurn, bool isAnalysis)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI     platform = memory->platform;
+    GameState*      state    = (GameState*)memory->permanentStorage;
+    Board*          board    = &state->board;
+    ExternalEngine* external = state->externalEngine;
+
+    ExternalEngineUpdate(external, memory);
+
+    ExternalEngineMessage message;
+    while (ExternalEnginePoll(external, &message))
+    {
+        if (message.type == EXTERNAL_ENGINE_MESSAGE_ID_NAME)
+        {
+            u32 length = (u32)strlen(message.text);
+            if (length >= sizeof(external->name))
+            {
+                length = sizeof(external->name) - 1;
+            }
+            memcpy(external->name, message.text, length);
+            external->name[length] = '\0';
+            platform.Log("GAME external engine '%s'", external->name);
+        }
+        else if (message.type == EXTERNAL_ENGINE_MESSAGE_INFO && external->isSearching)
+        {
+            external->info = message;
+        }
+        else if (message.type == EXTERNAL_ENGINE_MESSAGE_BESTMOVE && external->isSearching)
+        {
+            external->isSearching = false;
+            if (!external->isInfinite && isTurn && external->searchKey == board->position->hash())
+            {
+                platform.Log("Computer move (%s): %s", external->name, message.text);
+                ComputerMoveDo(memory, chess::uci::uciToMove(*board->position, message.text).move());
+                isTurn = ComputerIsTurn(memory);
+            }
+        }
+    }
+
+    if (external->isSearching)
+    {
+        bool isWanted = external->isInfinite ? isAnalysis : isTurn;
+        if ((!isWanted || external->searchKey != board->position->hash()) && !external->isStopSent)
+        {
+            external->isStopSent = ExternalEngineSend(external, memory, "stop\n");
+        }
+    }
+    else if (isTurn)
+    {
+        ExternalSearchStart(memory, "movetime 1000");
+    }
+    else if (isAnalysis)
+    {
+        ExternalSearchStart(memory, "infinite");
+    }
+}
+
+// One search at a time on every worker: the computer move on its turn, or the infinite analysis in
+// GAME_STATE_ANALYZE. The frame only starts it, stops it and reads the mailbox.
+chess_internal void SearchUpdate(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI platform = memory->platform;
+    GameState*  state    = (GameState*)memory->permanentStorage;
+    Board*      board    = &state->board;
+    Engine*     engine   = state->engine;
+
+    bool isTurn     = ComputerIsTurn(memory);
+    bool isAnalysis = state->gameState == GAME_STATE_ANALYZE && BoardGetGameResult(board) == BOARD_GAME_RESULT_NONE;
+
+    // The mate solver has the workers to itself, a timeline drag would restart the search every frame
+    isAnalysis = isAnalysis && !state->isSolvePending && !MateSolverIsSearching(state->mateSolver) &&
+                 !state->isTimelineDragging;
+
+    // Book moves are played without searching
+    u16 bookMove = chess::Move::NO_MOVE;
+    if (isTurn && !EngineIsSearching(engine))
+    {
+        bookMove = BookPickMove(&state->book, *board->position, (u32)(platform.TimerGetTicks() * 1000000.0));
+        if (bookMove != chess::Move::NO_MOVE)
+        {
+            platform.Log("Computer book move: %s", chess::uci::moveToUci(chess::Move(bookMove)).c_str());
+            ComputerMoveDo(memory, bookMove);
+            isTurn = ComputerIsTurn(memory);
+        }
+    }
+
+    // An engine that exits hands over to the built-in one
+    if (state->externalEngine && state->externalEngine->isClosed.load(std::memory_order_relaxed))
+    {
+        platform.Log("GAME external engine closed, back to the built-in engine");
+        ExternalEngineStop(state->externalEngine, memory);
+        state->externalEngine = 0;
+    }
+    if (state->externalEngine)
+    {
+        ExternalSearchUpdate(memory, isTurn, isAnalysis);
+        return;
+    }
+
+    EngineResult result;
+    if (EnginePollResult(engine, &result) && isTurn && result.key == board->position->hash())
+    {
+        platform.Log("Computer move: %s, depth %u, score %d, nodes %llu, %.2fs",
+                     chess::uci::moveToUci(chess::Move(result.move)).c_str(), result.depth, result.score,
+                     result.nodes, result.seconds);
+        ComputerMoveDo(memory, result.move);
+        isTurn = ComputerIsTurn(memory);
+    }
+
+    if (EngineIsSearching(engine))
+    {
+        bool isInfinite = !engine->limits.depth && !engine->limits.nodes && !engine->limits.seconds;
+        bool isWanted   = isInfinite ? isAnalysis : isTurn;
+        if (!isWanted || engine->rootKey != board->position->hash())
+        {
+            EngineStop(engine);
+        }
+    }
+    else if (isTurn)
+    {
+        SearchStart(memory, { ENGINE_DEFAULT_DEPTH, ENGINE_DEFAULT_NODES, ENGINE_DEFAULT_SECONDS });
+    }
+    else if (isAnalysis)
+    {
+        SearchStart(memory, { 0, 0, 0.0 });
+    }
+}
+
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(MateSolverRunWork)
+{
+    MateSolverRun((MateSolver*)data);
+}
+
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(ExplorerQueryWork)
+{
+    ExplorerQueryRun((Explorer*)data);
+}
+
+// Explorer moves of the analyzed position. A lookup on a cold index reads the disk, so it runs on the io queue and
+// the answer is drawn from the cache once polled. One query at a time, a position left meanwhile is asked next frame.
+chess_internal void ExplorerUpdate(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state    = (GameState*)memory->permanentStorage;
+    Explorer*  explorer = state->explorer;
+
+    ExplorerPollResult(explorer);
+    if (state->gameState != GAME_STATE_ANALYZE || explorer->entryCount == 0)
+    {
+        return;
+    }
+
+    const chess::Board& position = *state->board.position;
+    if (!ExplorerGetPosition(explorer, position.hash()) && ExplorerQueryStart(explorer, position))
+    {
+        memory->platform.WorkQueueAddEntry(memory->ioQueue, ExplorerQueryWork, explorer);
+    }
+}
+
+// F6 in GAME_STATE_ANALYZE proves a forced mate for the side to move. The built-in analysis stops first and resumes
+// when the solve is done, the solver runs alone on one worker. Leaving the position or the mode stops it.
+chess_internal void SolveUpdate(GameMemory* memory, bool isRequested)
+{
+    CHESS_ASSERT(memory);
+
+    PlatformAPI platform = memory->platform;
+    GameState*  state    = (GameState*)memory->permanentStorage;
+    Board*      board    = &state->board;
+    MateSolver* solver   = state->mateSolver;
+
+    u64  key        = board->position->hash();
+    bool isAnalysis = state->gameState == GAME_STATE_ANALYZE && BoardGetGameResult(board) == BOARD_GAME_RESULT_NONE;
+
+    MateSolverResult result;
+    if (MateSolverPollResult(solver, &result))
+    {
+        const char* outcome = result.type == MATE_SOLVER_RESULT_MATE      ? "mate"
+                              : result.type == MATE_SOLVER_RESULT_NO_MATE ? "no mate"
+                                                                          : "stopped";
+        platform.Log("GAME solve: %s %u, nodes %llu, %.2fs, %.2f Mnps, table %.1f MB used", outcome, result.mateIn,
+                     result.nodes, result.seconds,
+                     result.seconds > 0.0 ? result.nodes / result.seconds / 1000000.0 : 0.0,
+                     solver->usedEntries * sizeof(MateSolverEntry) / (1024.0 * 1024.0));
+        state->solveResult = result;
+    }
+
+    // F6 again gives up, the solve has no node limit
+    bool isSearching = MateSolverIsSearching(solver);
+    if (isRequested && isAnalysis && !isSearching)
+    {
+        state->isSolvePending = true;
+        state->solveKey       = key;
+    }
+    if ((isRequested && isSearching) || !isAnalysis || key != state->solveKey)
+    {
+        state->isSolvePending = false;
+        if (MateSolverIsSearching(solver))
+        {
+            MateSolverStop(solver);
+        }
+    }
+
+    // SearchUpdate stops the analysis, its workers are free once the engine leaves the searching state
+    if (state->isSolvePending && !EngineIsSearching(state->engine))
+    {
+        MateSolverClear(solver);
+        if (MateSolverStart(solver, *board->position, MATE_SOLVER_MAX_MATE, 0))
+        {
+            platform.WorkQueueAddEntry(memory->workQueue, MateSolverRunWork, solver);
+            state->isSolvePending = false;
+        }
+    }
+}
+
+// Same lines as the engine analysis from the last info the external engine sent
+chess_internal void DrawExternalAnalysis(GameMemory* memory, f32 x, f32 y)
+{
+    GameState*             state = (GameState*)memory->permanentStorage;
+    DrawAPI                draw  = memory->draw;
+    ExternalEngineMessage* info  = &state->externalEngine->info;
+    const char*            name  = state->externalEngine->name[0] ? state->externalEngine->name : "External";
+
+    char buffer[256];
+    if (!state->externalEngine->isSearching || info->depth == 0)
+    {
+        sprintf(buffer, "%s: waiting for the first iteration", name);
+        draw.Text(buffer, x, y, UI_COLOR_TEXT);
+        return;
+    }
+
+    s32 score = BoardGetTurn(&state->board) == PIECE_COLOR_WHITE ? info->score : -info->score;
+    if (info->isMate)
+    {
+        sprintf(buffer, "Depth %u  Mate %d  %.20s", info->depth, score, name);
+    }
+    else
+    {
+        sprintf(buffer, "Depth %u  Score %+.2f  %.20s", info->depth, score / 100.0f, name);
+    }
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+
+    y += 30.0f;
+    sprintf(buffer, "Nodes %.2fM  %.2f Mnps", info->nodes / 1000000.0, info->nps / 1000000.0);
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+
+    y += 30.0f;
+    sprintf(buffer, "Line %.42s", info->text);
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+}
+
+// Most played continuations of the position in the explorer index, with their games and white, draw and black scores
+chess_internal void DrawExplorer(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
+
+    GameState* state    = (GameState*)memory->permanentStorage;
+    DrawAPI    draw     = memory->draw;
+    Explorer*  explorer = state->explorer;
+    if (explorer->entryCount == 0)
+    {
+        return;
+    }
+
+    Vec2U windowDimension = memory->platform.WindowGetDimension();
+
+    f32 margin = 20.0f;
+    f32 w      = 460.0f;
+    f32 h      = 220.0f;
+    f32 x      = (windowDimension.w - w) - margin;
+    f32 y      = margin + 190.0f + margin;
+    draw.Rect({ x, y, w, h }, Vec4{ 0.0f, 0.0f, 0.0f, 0.7f });
 
-    Vec4 textColor = UI_COLOR_TEXT;
-    Vec4 iconColor = UI_COLOR_ICON;
+    x += margin;
+    y += 30.0f;
 
-    // Selector
-    if (PointInRect(rect, { cursorX, cursorY }))
+    char                    buffer[256];
+    const ExplorerPosition* result = ExplorerGetPosition(explorer, state->board.position->hash());
+    if (!result)
     {
-        draw.Rect(rect, UI_COLOR_WIDGET_HOVER);
-        textColor = UI_COLOR_TEXT_HOVER;
-        iconColor = UI_COLOR_ICON_HOVER;
+        draw.Text("Explorer: looking up", x, y, UI_COLOR_TEXT);
+        return;
     }
-
-    // Label
+    if (result->moveCount == 0 || result->games == 0)
     {
-        Vec2 textSize        = draw.TextGetSize(label);
-        f32  textAreaCenterY = rect.y + (rect.h / 2.0f);
+        draw.Text("Explorer: position not in the games", x, y, UI_COLOR_TEXT);
+        return;
+    }
 
-        f32 x = (f32)(int)rect.x;
-        f32 y = (f32)(int)(textAreaCenterY + (textSize.h / 2.0f));
+    sprintf(buffer, "Explorer: %llu games, %.2f ms", (unsigned long long)result->games, result->seconds * 1000.0);
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
 
-        draw.Text(label, x, y, textColor);
+    // Moves were checked against the position and their SAN formatted by the query, a move with no games shows 0%
+    for (u32 i = 0; i < result->moveCount && i < 5; i++)
+    {
+        const ExplorerMove* move  = &result->moves[i];
+        u64                 games = (u64)move->white + move->draws + move->black;
+        u64                 share = games ? games : 1;
+        sprintf(buffer, "%-7s %8llu %3u%%  %3u%% %3u%% %3u%%", move->san, (unsigned long long)games,
+                (u32)(games * 100 / result->games), (u32)(move->white * 100 / share), (u32)(move->draws * 100 / share),
+                (u32)(move->black * 100 / share));
+        draw.Text(buffer, x, y + 30.0f * (i + 1), UI_COLOR_TEXT);
     }
+}
 
-    Rect leftArrowRect;
-    leftArrowRect.x = rect.x + (rect.w / 2.0f);
-    leftArrowRect.y = rect.y;
-    leftArrowRect.w = iconBtnWidth;
-    leftArrowRect.h = rect.h;
+// Best line, depth and speed of the running analysis
+chess_internal void DrawAnalysis(GameMemory* memory)
+{
+    CHESS_ASSERT(memory);
 
-    Rect rightArrowRect;
-    rightArrowRect.x = (rect.x + rect.w) - iconBtnWidth;
-    rightArrowRect.y = rect.y;
-    rightArrowRect.w = iconBtnWidth;
-    rightArrowRect.h = rect.h;
+    GameState* state  = (GameState*)memory->permanentStorage;
+    DrawAPI    draw   = memory->draw;
+    Engine*    engine = state->engine;
 
-    // Previous option
-    if (*selectedOptionIndex > 0 && optionCount > 0)
+    Vec2U windowDimension = memory->platform.WindowGetDimension();
+
+    f32 margin = 20.0f;
+    f32 w      = 460.0f;
+    f32 h      = 190.0f;
+    f32 x      = (windowDimension.w - w) - margin;
+    f32 y      = margin;
+    draw.Rect({ x, y, w, h }, Vec4{ 0.0f, 0.0f, 0.0f, 0.7f });
+
+    x += margin;
+    y += 30.0f;
+
+    char buffer[256];
+
+    // Book moves of the position with their share of the weight, straight from the mapped file
+    BookMove bookMoves[BOOK_MAX_MOVES];
+    u32      bookMoveCount = BookGetMoves(&state->book, *state->board.position, bookMoves, BOOK_MAX_MOVES);
+    if (bookMoveCount > 0)
     {
-        if (PointInRect(leftArrowRect, { cursorX, cursorY }))
+        u32 totalWeight = 0;
+        for (u32 i = 0; i < bookMoveCount; i++)
         {
-            SetCursorType(memory, CURSOR_TYPE_FINGER);
-            if (actionBtnPressed)
-            {
-                (*selectedOptionIndex)--;
-                pressed = true;
-            }
+            totalWeight += bookMoves[i].weight;
         }
 
-        draw.RectTexture(leftArrowRect, textureArrowLeft, btnTexture, iconColor);
+        u32 length = sprintf(buffer, "Book");
+        for (u32 i = 0; i < bookMoveCount && length + UCI_STR_MAX_LENGTH + 6 < 48; i++)
+        {
+            std::string uci     = chess::uci::moveToUci(chess::Move(bookMoves[i].move));
+            u32         percent = totalWeight ? bookMoves[i].weight * 100 / totalWeight : 0;
+            length += sprintf(buffer + length, " %s %u%%", uci.c_str(), percent);
+        }
+        draw.Text(buffer, x, y + 90.0f, UI_COLOR_TEXT);
     }
-    // Next option
-    if (*selectedOptionIndex < optionCount - 1)
+    else
     {
-        if (PointInRect(rightArrowRect, { cursorX, cursorY }))
+        // Only shown, the game itself goes on until mate or one of the regular draws
+        u32 ending = BitbaseGetGameResult(state->bitbases, &state->board);
+        if (ending != BOARD_GAME_RESULT_NONE)
         {
-            SetCursorType(memory, CURSOR_TYPE_FINGER);
-            if (actionBtnPressed)
+            const char* outcome = ending == BOARD_GAME_RESULT_DRAW  ? "draw"
+                                  : ending == BOARD_GAME_RESULT_WIN ? "white wins"
+                                                                    : "black wins";
+            sprintf(buffer, "Bitbase: %s", outcome);
+            draw.Text(buffer, x, y + 90.0f, UI_COLOR_TEXT);
+        }
+    }
+
+    // Mate solver progress, or its last result while the position is the solved one
+    MateSolver*       solver = state->mateSolver;
+    MateSolverResult* solve  = &state->solveResult;
+    if (state->isSolvePending || MateSolverIsSearching(solver))
+    {
+        u32 mateIn = solver->provenMateIn.load(std::memory_order_relaxed);
+        u32 length = sprintf(buffer, "Solve: %.2fM nodes", MateSolverGetNodes(solver) / 1000000.0);
+        if (mateIn)
+        {
+            sprintf(buffer + length, ", mate in %u, shortening", mateIn);
+        }
+        draw.Text(buffer, x, y + 120.0f, UI_COLOR_TEXT);
+    }
+    else if (solve->key == state->board.position->hash())
+    {
+        if (solve->type == MATE_SOLVER_RESULT_MATE)
+        {
+            u32 length = sprintf(buffer, "Mate in %u%s", solve->mateIn, solve->isShortest ? "" : "?");
+            for (u32 i = 0; i < solve->lineLength && length + UCI_STR_MAX_LENGTH < 48; i++)
             {
-                (*selectedOptionIndex)++;
-                pressed = true;
+                length += sprintf(buffer + length, " %s", chess::uci::moveToUci(chess::Move(solve->line[i])).c_str());
             }
         }
+        else if (solve->type == MATE_SOLVER_RESULT_NO_MATE)
+        {
+            sprintf(buffer, "Solve: no mate in %u", MATE_SOLVER_MAX_MATE);
+        }
+        else
+        {
+            sprintf(buffer, "Solve: stopped after %.2fM nodes", solve->nodes / 1000000.0);
+        }
+        draw.Text(buffer, x, y + 120.0f, UI_COLOR_TEXT);
+    }
 
-        draw.RectTexture(rightArrowRect, textureArrowRight, btnTexture, iconColor);
+    if (state->externalEngine)
+    {
+        DrawExternalAnalysis(memory, x, y);
+        return;
     }
 
-    // Text area covers space between right and left icons
-    Rect textArea;
-    textArea.x = leftArrowRect.x + iconBtnWidth;
-    textArea.y = rect.y;
-    textArea.w = rect.w / 2.0f - (iconBtnWidth * 2.0f);
-    textArea.h = rect.h;
+    // The last line is kept while the main search thread publishes a new one
+    static EngineInfo info;
+    EngineGetInfo(engine, &info);
+    if (!EngineIsSearching(engine) || info.key != engine->rootKey || info.depth == 0)
+    {
+        draw.Text("Analysis: waiting for the first iteration", x, y, UI_COLOR_TEXT);
+        return;
+    }
 
-    const char* option = options[*selectedOptionIndex];
+    // Scores are shown from white's point of view
+    s32 score = BoardGetTurn(&state->board) == PIECE_COLOR_WHITE ? info.score : -info.score;
+    if (EngineIsMateScore(score))
+    {
+        s32 plies = ENGINE_SCORE_MATE - (score > 0 ? score : -score);
+        sprintf(buffer, "Depth %u  Mate %s%d  Threads %u", info.depth, score > 0 ? "" : "-", (plies + 1) / 2,
+                engine->activeThreadCount);
+    }
+    else
+    {
+        sprintf(buffer, "Depth %u  Score %+.2f  Threads %u", info.depth, score / 100.0f, engine->activeThreadCount);
+    }
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+
+    y += 30.0f;
+    u64 nodes   = EngineGetNodes(engine);
+    f64 seconds = info.seconds > 0.0 ? info.seconds : 1.0;
+    sprintf(buffer, "Nodes %.2fM  %.2f Mnps", nodes / 1000000.0, info.nodes / seconds / 1000000.0);
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+
+    // Best line, as many moves as fit the panel
+    y += 30.0f;
+    u32 length = sprintf(buffer, "Line");
+    for (u32 i = 0; i < info.pvLength && length + UCI_STR_MAX_LENGTH < 48; i++)
+    {
+        length += sprintf(buffer + length, " %s", chess::uci::moveToUci(chess::Move(info.pv[i])).c_str());
+    }
+    draw.Text(buffer, x, y, UI_COLOR_TEXT);
+}
 
-    Vec2 textSize        = draw.TextGetSize(option);
-    f32  textAreaCenterX = textArea.x + (textArea.w / 2.0f);
-    f32  textAreaCenterY = textArea.y + (textArea.h / 2.0f);
-    f32  textX           = (f32)(int)(textAreaCenterX - (textSize.w / 2.0f));
-    f32  textY           = (f32)(int)(textAreaCenterY + (textSize.h / 2.0f));
+// Game list row of the PGN file or the archive, false past the last game
+chess_internal bool GamesReadTags(GameState* state, u32 gameIndex, PgnTags* tags)
+{
+    if (!state->isArchiveList)
+    {
+        return PgnReadTags(&state->pgn, gameIndex, tags);
+    }
+    if (gameIndex >= state->archive.gameCount)
+    {
+        return false;
+    }
 
-    draw.Text(option, textX, textY, textColor);
+    const char* results[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    u32         result    = state->archive.games[gameIndex].result;
+    snprintf(tags->white, PGN_TAG_MAX_LENGTH, "%s", ArchiveGetTag(&state->archive, gameIndex, ARCHIVE_TAG_WHITE));
+    snprintf(tags->black, PGN_TAG_MAX_LENGTH, "%s", ArchiveGetTag(&state->archive, gameIndex, ARCHIVE_TAG_BLACK));
+    snprintf(tags->result, PGN_TAG_MAX_LENGTH, "%s", results[result < ARRAY_COUNT(results) ? result : 0]);
+    snprintf(tags->date, PGN_TAG_MAX_LENGTH, "%s", ArchiveGetTag(&state->archive, gameIndex, ARCHIVE_TAG_DATE));
 
-    return pressed;
+    return true;
 }
 
-chess_internal inline void SetCursorType(GameMemory* memory, u32 type)
+// One page of the opened PGN file or archive, tags are read from the mapped file for the visible rows only. A picked
+// game is loaded on the board and opened in Analyze mode, positioned on its first move.
+chess_internal void DrawGameList(GameMemory* memory)
 {
     CHESS_ASSERT(memory);
-    CHESS_ASSERT(type >= 0 && type < CURSOR_TYPE_COUNT);
 
-    GameState* state = (GameState*)memory->permanentStorage;
+    GameState* state     = (GameState*)memory->permanentStorage;
+    DrawAPI    draw      = memory->draw;
+    PgnFile*   pgn       = &state->pgn;
+    u32        gameCount = state->isArchiveList ? (u32)state->archive.gameCount : pgn->gameCount;
 
-    constexpr Rect rects[3] = {
-        textureCursorPointer, // Pointer
-        textureCursorFinger,  // Finger
-        textureCursorPick,    // Pick
-    };
+    Vec2U windowDimension = memory->platform.WindowGetDimension();
 
-    state->cursorTexture = rects[type];
-}
+    f32 rowCount        = (f32)GAME_LIST_ROWS + 1.0f;
+    f32 containerWidth  = windowDimension.w * 0.75f;
+    f32 margin          = 20.0f;
+    f32 rowH            = 35.0f;
+    f32 rowW            = containerWidth - (margin * 2.0f);
+    f32 containerHeight = margin + (margin * 0.5f + rowH) * rowCount + margin;
+    f32 x               = (f32)(int)((windowDimension.w - containerWidth) / 2.0f);
+    f32 y               = (f32)(int)((windowDimension.h - containerHeight) / 2.0f);
 
-chess_internal inline void RestartGame(GameMemory* memory)
-{
-    CHESS_ASSERT(memory);
+    char buffer[256];
+    if (state->isArchiveList || pgn->isIndexed)
+    {
+        sprintf(buffer, "GAMES  %u", gameCount);
+    }
+    else
+    {
+        sprintf(buffer, "GAMES  %u so far, %.0f%% indexed", pgn->gameCount,
+                pgn->scanOffset * 100.0 / (pgn->contentSize ? pgn->contentSize : 1));
+    }
+    draw.Text(buffer, x, y - 15.0f, COLOR_WHITE);
+    draw.Rect({ x, y, containerWidth, containerHeight }, Vec4{ 0.0f, 0.0f, 0.0f, 0.7f });
 
-    GameState* state = (GameState*)memory->permanentStorage;
-    state->board     = BoardCreate(DEFAULT_FEN_STRING);
-    state->gameState = GAME_STATE_PLAY;
+    Rect rowRect{ x + margin, y + margin, rowW, rowH };
+    for (u32 i = 0; i < GAME_LIST_ROWS; i++)
+    {
+        u32     gameIndex = state->pgnListFirst + i;
+        PgnTags tags;
+        if (!GamesReadTags(state, gameIndex, &tags))
+        {
+            break;
+        }
+
+        sprintf(buffer, "%u. %s - %s  %s  %s", gameIndex + 1, tags.white, tags.black, tags.result, tags.date);
+        if (UIButton(memory, buffer, rowRect))
+        {
+            u32 plies = state->isArchiveList ? ArchiveLoadGame(&state->archive, gameIndex, &state->board)
+                                             : PgnLoadGame(pgn, gameIndex, &state->board);
+            memory->platform.Log("GAME game %u loaded, %u plies", gameIndex + 1, plies);
+            state->gameState = GAME_STATE_ANALYZE;
+            state->gameId    = 0;
+        }
+        rowRect.y += rowH + margin * 0.5f;
+    }
+
+    // Paging, the index catches up with the next page on its own
+    Rect pageRect{ x + margin, y + containerHeight - margin - rowH, 150.0f, rowH };
+    if (state->pgnListFirst > 0 && UIButton(memory, "Previous", pageRect))
+    {
+        state->pgnListFirst -= state->pgnListFirst > GAME_LIST_ROWS ? GAME_LIST_ROWS : state->pgnListFirst;
+    }
+    pageRect.x = x + containerWidth - margin - pageRect.w;
+    if (state->pgnListFirst + GAME_LIST_ROWS < gameCount && UIButton(memory, "Next", pageRect))
+    {
+        state->pgnListFirst += GAME_LIST_ROWS;
+    }
 }
 
 // Get current player controller
@@ -616,7 +1791,7 @@ chess_internal void DrawScene(GameMemory* memory)
 
                 if (piece.type != PIECE_TYPE_NONE)
                 {
-                    Mesh*    pieceMesh = &assets->meshes[piece.meshIndex];
+                    Mesh*    pieceMesh = &assets->meshes[GetPieceMeshIndex(piece)];
                     Material material  = piece.color == PIECE_COLOR_WHITE ? whiteMaterial : blackMaterial;
 
                     u32 dragIndex = state->pieceDragState.piece.cellIndex;
@@ -633,7 +1808,7 @@ chess_internal void DrawScene(GameMemory* memory)
                             model         = model * rotate;
                         }
 
-                        Mesh* pieceMesh = &assets->meshes[draggingPiece.meshIndex];
+                        Mesh* pieceMesh = &assets->meshes[GetPieceMeshIndex(draggingPiece)];
                         draw.Mesh(pieceMesh, model, -1, material);
                     }
                     else
@@ -691,6 +1866,22 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     Mat4x4 lightProj = Orthographic(-0.6f, 0.6f, -0.6f, 0.6f, 0.1f, 5.0f);
     Mat4x4 lightView = LookAt({ -1.2f, 1.15f, 1.2f }, { 0.0f }, { 0.0f, 1.0f, 0.0f });
 
+    // ----------------------------------------------------------------------------
+    // Reload
+    // Static storage is reset every time the game code is loaded
+    static bool gameCodeLoaded = false;
+    if (!gameCodeLoaded)
+    {
+        gameCodeLoaded = true;
+        if (state->isInitialized)
+        {
+            BoardReload(board);
+            EngineReload(state->engine);
+            MateSolverReload(state->mateSolver);
+        }
+    }
+    // ----------------------------------------------------------------------------
+
     // ----------------------------------------------------------------------------
     // Init
     if (!state->isInitialized)
@@ -708,6 +1899,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         state->fullscreenEnabled = true;
 #endif
         state->gamepadSensitivity = 1;
+        state->opponent           = GAME_OPPONENT_HUMAN;
 
         SetCursorType(memory, CURSOR_TYPE_POINTER);
         LoadGameAssets(memory);
@@ -723,7 +1915,120 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         Vec2U windowDimension = platform.WindowGetDimension();
         *camera2D             = Camera2DInit(windowDimension.w, windowDimension.h);
 
-        state->board = BoardCreate(DEFAULT_FEN_STRING);
+        // Rest of the permanent storage after GameState
+        ArenaInit(&state->permanentArena, (u8*)memory->permanentStorage + sizeof(GameState),
+                  memory->permanentStorageSize - sizeof(GameState));
+
+        BoardInit(board, DEFAULT_FEN_STRING, &state->permanentArena, BOARD_HISTORY_MAX_PLIES);
+
+        state->snapshots           = ARENA_PUSH_ARRAY(&state->permanentArena, GameSnapshotRing, 1);
+        state->snapshots->capacity = GAME_SNAPSHOT_STORAGE_SIZE;
+        state->snapshots->base     = (u8*)ArenaPushSize(&state->permanentArena, GAME_SNAPSHOT_STORAGE_SIZE);
+
+        // Lazy SMP runs one search thread per platform worker
+        u32 searchThreads = memory->workQueueThreadCount;
+        if (searchThreads == 0)
+        {
+            searchThreads = 1;
+        }
+        if (searchThreads > ENGINE_MAX_THREADS)
+        {
+            searchThreads = ENGINE_MAX_THREADS;
+        }
+        state->engine         = EngineCreate(&state->permanentArena, searchThreads, ENGINE_HASH_SIZE);
+        state->engine->cancel = &memory->cancelWork;
+
+        state->mateSolver         = MateSolverCreate(&state->permanentArena, MATE_SOLVER_TABLE_SIZE);
+        state->mateSolver->cancel = &memory->cancelWork;
+
+        PgnInit(&state->pgn, &state->permanentArena);
+        state->archiveJob = new (ArenaPushSize(&state->permanentArena, sizeof(GameArchiveJob), alignof(GameArchiveJob)))
+            GameArchiveJob();
+        ArenaInit(&state->archiveJob->storage, ArenaPushSize(&state->permanentArena, GAME_ARCHIVE_STORAGE_SIZE),
+                  GAME_ARCHIVE_STORAGE_SIZE);
+
+        // Mapped for the whole session, a missing book is an empty one
+        FileMapResult bookFile = platform.FileMap(BOOK_PATH);
+        BookInit(&state->book, bookFile.content, bookFile.contentSize);
+        platform.Log("GAME book '%s', %llu entries", BOOK_PATH, state->book.entryCount);
+
+        // Same for the explorer index, only the pages lookups touch are read
+        state->explorerFile = platform.FileMap(EXPLORER_PATH);
+        state->explorer     = ExplorerCreate(&state->permanentArena);
+        ExplorerOpen(state->explorer, state->explorerFile.content, state->explorerFile.contentSize);
+        platform.Log("GAME explorer '%s', %llu positions", EXPLORER_PATH,
+                     state->explorer->header ? state->explorer->header->positionCount : 0ULL);
+
+        // The piece-square tables keep evaluating when the network is missing or invalid
+        FileReadResult networkFile = platform.FileReadEntire(NNUE_NETWORK_PATH);
+        NnueNetwork*   network     = ARENA_PUSH_ARRAY(&state->permanentArena, NnueNetwork, 1);
+        if (NnueLoad(network, &state->permanentArena, networkFile.content, networkFile.contentSize))
+        {
+            state->engine->network = network;
+            platform.Log("GAME network loaded, %u hidden, %s kernel", network->hiddenSize,
+                         NnueGetKernelName(network->kernel));
+        }
+        else
+        {
+            platform.Log("GAME no valid network at '%s'", NNUE_NETWORK_PATH);
+        }
+        if (networkFile.contentSize > 0)
+        {
+            platform.FileFreeMemory(networkFile.content);
+        }
+
+        // Generated once on the work queue, later runs load the cache
+        state->bitbases = ARENA_PUSH_ARRAY(&state->permanentArena, Bitbases, 1);
+        BitbaseInit(state->bitbases, &state->permanentArena);
+        FileReadResult bitbaseFile = platform.FileReadEntire(BITBASE_CACHE_FILE);
+        if (BitbaseLoad(state->bitbases, bitbaseFile.content, bitbaseFile.contentSize))
+        {
+            platform.Log("GAME bitbases loaded from '%s'", BITBASE_CACHE_FILE);
+        }
+        else
+        {
+            u32 sliceCount = memory->workQueueThreadCount + 1;
+            if (sliceCount > BITBASE_MAX_SLICES)
+            {
+                sliceCount = BITBASE_MAX_SLICES;
+            }
+            BitbaseGenerator* generator = BitbaseGeneratorCreate(state->bitbases, &state->permanentArena, sliceCount);
+
+            f64 start = platform.TimerGetTicks();
+            BitbaseGenerate(generator, BitbaseRunSlicesOnQueue, memory);
+            platform.Log("GAME bitbases generated in %.3fs on %u slices, %llu bytes", platform.TimerGetTicks() - start,
+                         sliceCount, (u64)sizeof(BitbaseTables));
+
+            if (!platform.FileWriteEntire(BITBASE_CACHE_FILE, state->bitbases->tables, sizeof(BitbaseTables)))
+            {
+                platform.Log("GAME unable to write '%s'", BITBASE_CACHE_FILE);
+            }
+        }
+        if (bitbaseFile.contentSize > 0)
+        {
+            platform.FileFreeMemory(bitbaseFile.content);
+        }
+        state->engine->bitbases = state->bitbases;
+
+        // Optional, the first line of the file is the command line of a UCI engine
+        FileReadResult engineFile = platform.FileReadEntire(EXTERNAL_ENGINE_PATH);
+        if (engineFile.contentSize > 0)
+        {
+            const char* content = (const char*)engineFile.content;
+            char        commandLine[EXTERNAL_ENGINE_LINE_MAX];
+            u32         length = 0;
+            while (length < engineFile.contentSize && length < sizeof(commandLine) - 1 && content[length] != '\n' &&
+                   content[length] != '\r')
+            {
+                length++;
+            }
+            memcpy(commandLine, content, length);
+            commandLine[length] = '\0';
+            platform.FileFreeMemory(engineFile.content);
+
+            state->externalEngine = ExternalEngineStart(&state->permanentArena, memory, commandLine);
+            platform.Log("GAME external engine '%s' %s", commandLine, state->externalEngine ? "started" : "failed");
+        }
 
         // Lightning
         // Scene lights are static, so the lighting setup is performed once during initialization.
@@ -783,18 +2088,18 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         EndPieceDrag(memory);
     }
 
-    if (state->gameState == GAME_STATE_PLAY)
+    if (state->gameState == GAME_STATE_PLAY || state->gameState == GAME_STATE_ANALYZE)
     {
         u32 cellIndex =
             draw.GetObjectAtPixel(playerController->cursorX, windowDimension.h - playerController->cursorY - 1);
         if (cellIndex >= 0 && cellIndex <= 64)
         {
             Piece targetPiece = BoardGetPiece(board, cellIndex);
-            if (targetPiece.color == turnColor)
+            if (targetPiece.color == turnColor && !ComputerIsTurn(memory))
             {
                 SetCursorType(memory, CURSOR_TYPE_FINGER);
 
-                if (!IsDragging(memory) && ButtonIsDown(playerController->buttonAction))
+                if (!IsDragging(memory) && !state->isTimelineDragging && ButtonIsDown(playerController->buttonAction))
                 {
                     BeginPieceDrag(memory, cellIndex);
                 }
@@ -811,10 +2116,43 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
     {
         state->gameStarted = true;
     }
+    if (state->gameStarted && ButtonIsPressed(keyboardController->buttonSave))
+    {
+        GameSnapshotSave(memory);
+    }
+    if (ButtonIsPressed(keyboardController->buttonLoad))
+    {
+        GameSnapshotLoad(memory);
+    }
+    // Rewind one frame per frame while held, otherwise record the frame
+    if (state->gameState == GAME_STATE_PLAY || state->gameState == GAME_STATE_END)
+    {
+        if (ButtonIsDown(keyboardController->buttonRewind))
+        {
+            GameSnapshot* snapshot = GameSnapshotPop(memory);
+            if (snapshot)
+            {
+                GameSnapshotRestore(memory, snapshot);
+            }
+        }
+        else if (state->gameState == GAME_STATE_PLAY)
+        {
+            GameSnapshotPush(memory);
+        }
+    }
+    // The game list is usable at once, the rest of the file is indexed a budget per frame
+    if (state->pgn.content && !state->pgn.isIndexed)
+    {
+        PgnIndexStep(&state->pgn, PGN_INDEX_FRAME_BUDGET);
+    }
+    ExplorerUpdate(memory);
+    GameArchiveUpdate(memory);
+    SolveUpdate(memory, ButtonIsPressed(keyboardController->buttonSolve));
+    SearchUpdate(memory);
     if (ButtonIsPressed(keyboardController->buttonStart))
     {
-        // Switch gameplay to menu
-        if (state->gameState == GAME_STATE_PLAY)
+        // Switch gameplay or analysis to menu
+        if (state->gameState == GAME_STATE_PLAY || state->gameState == GAME_STATE_ANALYZE)
         {
             state->gameState = GAME_STATE_MENU;
         }
@@ -831,11 +2169,26 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         {
             state->gameState = GAME_STATE_MENU;
         }
+        // Switch game list to settings
+        else if (state->gameState == GAME_STATE_GAMES)
+        {
+            state->gameState = GAME_STATE_SETTINGS;
+        }
     }
-    if (boardResult != BOARD_GAME_RESULT_NONE && state->gameState != GAME_STATE_END)
+    // Analysis can look at finished positions. Only a game played to its end in this session is archived, once,
+    // a rewind into it or a finished position left through the menu ends it again without adding it twice.
+    if (boardResult != BOARD_GAME_RESULT_NONE && state->gameState != GAME_STATE_END &&
+        state->gameState != GAME_STATE_ANALYZE)
     {
+        bool isPlayed = state->gameState == GAME_STATE_PLAY && state->gameId > state->archivedGameId;
+
         platform.Log("Game has terminated");
         state->gameState = GAME_STATE_END;
+        if (isPlayed)
+        {
+            state->archivedGameId = state->gameId;
+            GameArchiveSave(memory);
+        }
     }
     //  ---------------------------------------------------------------------------
 
@@ -851,6 +2204,10 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         sprintf(frameTimeBuffer, "Frame time %.2fms", 1000.0f * delta);
         draw.Text(frameTimeBuffer, 0, 30, COLOR_WHITE);
 
+        char snapshotBuffer[48];
+        sprintf(snapshotBuffer, "Snapshot %.1fus (%u)", state->snapshots->pushMicroseconds, state->snapshots->count);
+        draw.Text(snapshotBuffer, 0, 60, COLOR_WHITE);
+
         draw.End2D();
 #endif
 
@@ -860,7 +2217,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         {
             draw.Begin2D(camera2D);
 
-            u32  btnCount    = 3;
+            u32  btnCount    = 4;
             bool gameStarted = BoardMoveCanUndo(board);
             if (gameStarted)
             {
@@ -880,6 +2237,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 if (UIButton(memory, "New game", btnRect))
                 {
                     state->gameState = GAME_STATE_PLAY;
+                    state->gameId    = ++state->lastGameId;
                 }
             }
             else
@@ -896,6 +2254,12 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 }
             }
 
+            btnRect.y += btnRect.h + margin;
+            if (UIButton(memory, "Analyze", btnRect))
+            {
+                state->gameState = GAME_STATE_ANALYZE;
+            }
+
             btnRect.y += btnRect.h + margin;
             if (UIButton(memory, "Settings", btnRect))
             {
@@ -917,7 +2281,7 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
         {
             draw.Begin2D(camera2D);
 
-            f32 optionCount = 5.0f;
+            f32 optionCount = 8.0f;
 
             f32 containerWidth  = windowDimension.w * 0.75f;
             f32 margin          = 28.0f;
@@ -1011,6 +2375,18 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 }
             }
 
+            // Opponent
+            {
+                selectorRect.y += selectorH + margin;
+
+                static const char* options[3]     = { "Human", "Computer black", "Computer white" };
+                static u32         selectedOption = state->opponent;
+                if (UISelector(memory, selectorRect, "Opponent", options, ARRAY_COUNT(options), &selectedOption))
+                {
+                    state->opponent = selectedOption;
+                }
+            }
+
             // Gamepad sensitivity
             {
                 selectorRect.y += selectorH + margin;
@@ -1030,17 +2406,50 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                 }
             }
 
+            // Games
+            {
+                selectorRect.y += selectorH + margin;
+
+                if (UIButton(memory, "Open games (data/games.pgn)", selectorRect))
+                {
+                    GamesOpen(memory);
+                }
+
+                selectorRect.y += selectorH + margin;
+                if (UIButton(memory, "Open finished games (" GAME_ARCHIVE_PATH ")", selectorRect))
+                {
+                    GamesOpenArchive(memory);
+                }
+            }
+
+            DrawCursor(memory);
+
+            draw.End2D();
+            break;
+        }
+        case GAME_STATE_GAMES:
+        {
+            draw.Begin2D(camera2D);
+
+            DrawGameList(memory);
             DrawCursor(memory);
 
             draw.End2D();
             break;
         }
         case GAME_STATE_PLAY:
+        case GAME_STATE_ANALYZE:
         {
             // 2D
             {
                 draw.Begin2D(camera2D);
 
+                if (state->gameState == GAME_STATE_ANALYZE)
+                {
+                    DrawAnalysis(memory);
+                    DrawExplorer(memory);
+                }
+
                 f32  margin = 20.0f;
                 Rect btnRect;
                 btnRect.w = 84.0f;
@@ -1053,9 +2462,51 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                     if (UIButton(memory, btnRect, textureArrowUndo))
                     {
                         BoardMoveUndo(board);
+                        // Against the computer undo goes back to the previous move of the player
+                        if (ComputerIsTurn(memory) && BoardMoveCanUndo(board))
+                        {
+                            BoardMoveUndo(board);
+                        }
+                    }
+                }
+
+                // Steps forward through the moves undone or the rest of a loaded game
+                if (BoardMoveCanRedo(board))
+                {
+                    Rect redoRect = btnRect;
+                    redoRect.x += btnRect.w + margin;
+                    if (UIButton(memory, redoRect, textureArrowRight))
+                    {
+                        BoardSeek(board, board->history.count + 1);
                     }
                 }
 
+                // Replay timeline over the whole history, a seek replays at most BOARD_HISTORY_KEYFRAME_INTERVAL
+                // plies from the closest keyframe so dragging over a long game keeps the frame rate
+                BoardHistory* history = &board->history;
+                if (state->gameState == GAME_STATE_ANALYZE && history->length > 0)
+                {
+                    Rect timelineRect;
+                    timelineRect.x = btnRect.x + (btnRect.w + margin) * 2.0f;
+                    timelineRect.y = btnRect.y + btnRect.h / 2.0f;
+                    timelineRect.w = (windowDimension.w - timelineRect.x) - margin;
+                    timelineRect.h = btnRect.h / 2.0f;
+
+                    u32 ply = history->count;
+                    if (UISlider(memory, timelineRect, history->length, &ply, &state->isTimelineDragging))
+                    {
+                        BoardSeek(board, ply);
+                    }
+
+                    char buffer[64];
+                    sprintf(buffer, "Ply %u / %u", ply, history->length);
+                    draw.Text(buffer, timelineRect.x, timelineRect.y - 10.0f, UI_COLOR_TEXT);
+                }
+                else
+                {
+                    state->isTimelineDragging = false;
+                }
+
                 DrawCursor(memory);
                 draw.End2D();
             }
@@ -1101,38 +2552,29 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender)
                             DrawBoardCell(memory, origin, COLOR_PURPLE_LIGHT);
 
                             // Draw legal movements
-                            u32   dragIndex = state->pieceDragState.piece.cellIndex;
-                            u32   moveCount;
-                            Move* movelist = BoardGetPieceMoveList(board, dragIndex, &moveCount);
-                            if (moveCount > 0)
+                            u32 dragIndex  = state->pieceDragState.piece.cellIndex;
+                            u32 targetCell = GetDraggingPieceTargetCell(memory);
+                            u64 targets    = BoardGetPieceTargets(board, dragIndex);
+                            while (targets)
                             {
-                                for (u32 i = 0; i < moveCount; i++)
-                                {
-                                    Move* move = &movelist[i];
-                                    u32   row  = move->to / 8;
-                                    u32   col  = move->to % 8;
+                                u32 cellIndex = CellBitboardPop(&targets);
 
-                                    Piece targetPiece = BoardGetPiece(board, move->to);
-
-                                    if (move->type == MOVE_TYPE_CAPTURE ||
-                                        (move->type == MOVE_TYPE_CHECK && targetPiece.type != PIECE_TYPE_NONE))
+                                if (BoardMoveIsCapture(board, cellIndex))
+                                {
+                                    DrawBoardCell(memory, cellIndex, COLOR_MAGENTA, &textureCircleOutlined,
+                                                  Vec3{ 0.75f });
+                                }
+                                else
+                                {
+                                    Vec3 scale{ 0.35f, 1.0f, 0.35f };
+                                    if (targetCell == cellIndex)
                                     {
-                                        DrawBoardCell(memory, move->to, COLOR_MAGENTA, &textureCircleOutlined,
-                                                      Vec3{ 0.75f });
+                                        scale = { 0.45f, 1.0f, 0.45f };
                                     }
-                                    else
-                                    {
-                                        Vec3 scale{ 0.35f, 1.0f, 0.35f };
-                                        if (GetDraggingPieceTargetCell(memory) == move->to)
-                                        {
-                                            scale = { 0.45f, 1.0f, 0.45f };
-                                        }
 
-                                        DrawBoardCell(memory, move->to, COLOR_PURPLE, &textureCircleOutlined, scale);
-                                    }
+                                    DrawBoardCell(memory, cellIndex, COLOR_PURPLE, &textureCircleOutlined, scale);
                                 }
                             }
-                            FreePieceMoveList(movelist);
                         }
                     }
                 }
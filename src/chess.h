@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 #include "chess_types.h"
 #include "chess_camera.h"
 #include "chess_draw_api.h"
@@ -7,13 +9,29 @@
 #include "chess_asset.h"
 #include "chess_math.h"
 #include "chess_game_logic.h"
+#include "chess_engine.h"
+#include "chess_book.h"
+#include "chess_external_engine.h"
+#include "chess_mate_solver.h"
+#include "chess_pgn.h"
+#include "chess_archive.h"
+#include "chess_explorer.h"
 
 enum
 {
     GAME_STATE_MENU,
     GAME_STATE_SETTINGS,
     GAME_STATE_PLAY,
-    GAME_STATE_END
+    GAME_STATE_ANALYZE,
+    GAME_STATE_END,
+    GAME_STATE_GAMES // Game list of the opened PGN file or game archive
+};
+
+enum
+{
+    GAME_OPPONENT_HUMAN,
+    GAME_OPPONENT_COMPUTER_BLACK,
+    GAME_OPPONENT_COMPUTER_WHITE
 };
 
 enum
@@ -32,21 +50,119 @@ struct PieceDragState
     Piece piece;
 };
 
+#define GAME_LIST_ROWS 10 // Games per page of the game list
+
+// Finished games archive. Every finished game rewrites the whole archive on the io queue, the games already in it
+// are copied as they are from the mapped file into GAME_ARCHIVE_FILE_SIZE bytes along with the new one.
+#define GAME_ARCHIVE_PATH         "chess_games.carc"
+#define GAME_ARCHIVE_MAX_GAMES    16384
+#define GAME_ARCHIVE_MAX_STRINGS  16384
+#define GAME_ARCHIVE_STRING_SIZE  MEGABYTES(1)
+#define GAME_ARCHIVE_FILE_SIZE    MEGABYTES(8)
+#define GAME_ARCHIVE_STORAGE_SIZE MEGABYTES(16) // File, writer tables and the moves of the new game in both encodings
+
+// Mailbox between the game thread and the io queue entry rewriting the archive
+// IDLE -> WRITING by the game once the job holds a finished game, WRITING -> DONE by the entry,
+// DONE -> IDLE by the game once the outcome is logged
+enum
+{
+    GAME_ARCHIVE_MAILBOX_IDLE,
+    GAME_ARCHIVE_MAILBOX_WRITING,
+    GAME_ARCHIVE_MAILBOX_DONE
+};
+
+// Rewind and save states
+// A snapshot record is a GameSnapshot header followed by the board history prefix, pushing one is two memcpys into
+// the ring and restoring one replays at most BOARD_HISTORY_KEYFRAME_INTERVAL plies from the closest keyframe.
+#define GAME_SNAPSHOT_MAGIC        0x50414E53 // "SNAP"
+#define GAME_SNAPSHOT_MAX          4096
+#define GAME_SNAPSHOT_STORAGE_SIZE MEGABYTES(32)
+#define GAME_SNAPSHOT_SAVE_FILE    "chess_save.bin"
+
+struct GameSnapshotRing
+{
+    u8* base;
+    u64 capacity;
+    u64 writeOffset;
+    u32 offsets[GAME_SNAPSHOT_MAX];
+    u32 first;
+    u32 count;
+    f64 pushMicroseconds;
+};
+
+// Copy of a finished game for the io queue entry, the board can change while the file is written.
+// The moves are kept in both encodings, the entry uses the one of the archive on disk.
+struct GameArchiveJob
+{
+    PlatformAPI      platform;
+    MemoryArena      storage;      // GAME_ARCHIVE_STORAGE_SIZE bytes, reused by every save
+    MemoryArena      arena;        // What is left of storage once the moves are copied in
+    u8*              moves[2];     // Indexed by ARCHIVE_ENCODING_*
+    u64              moveSizes[2];
+    u32              plyCount;
+    u32              result;       // ARCHIVE_RESULT_*
+    char             date[16];
+    char             white[16];
+    char             black[16];
+    char             fen[FEN_STR_MAX_LENGTH]; // Empty when the game starts from the initial position
+    bool             isWritten;
+    u64              gameCount;    // Games in the archive once written
+    u64              fileSize;
+    std::atomic<u32> mailbox;
+};
+
 struct GameState
 {
     bool           isInitialized;
+    MemoryArena    permanentArena;
     Assets         assets;
     Camera3D       camera3D;
     Camera2D       camera2D;
     Board          board;
     PieceDragState pieceDragState;
+    bool           isTimelineDragging; // Replay timeline held, pieces are not picked and analysis waits meanwhile
     u32            gameState;
     Rect           cursorTexture;
     bool           gameStarted;
+    u32            gameId; // Game played on this board, 0 for a game loaded from a save, a PGN file or the archive
+    // Session, kept on restore
+    GameSnapshotRing* snapshots;
+    Engine*           engine;
+    Book              book;
+    Bitbases*         bitbases;
+    ExternalEngine*   externalEngine; // Replaces the engine when EXTERNAL_ENGINE_PATH names one
+    MateSolver*       mateSolver;
+    MateSolverResult  solveResult;    // Last finished solve, shown while its key is the current position
+    u64               solveKey;       // Position of the requested or running solve
+    bool              isSolvePending; // Requested, waits for the analysis search to stop
+    FileMapResult     pgnFile;
+    PgnFile           pgn;
+    u32               pgnListFirst;  // First game shown by the game list
+    FileMapResult     archiveFile;
+    ArchiveReader     archive;
+    bool              isArchiveList; // The game list shows the archive instead of the PGN file
+    GameArchiveJob*   archiveJob;
+    u32               lastGameId;     // Games started this session
+    u32               archivedGameId; // Last game added to the archive, a game rewound past its end is added once
+    FileMapResult     explorerFile;
+    Explorer*         explorer;
     // Settings
     bool vsyncEnabled;
     bool fullscreenEnabled;
     bool soundEnabled;
     bool showPiecesMovesEnabled;
     u32  gamepadSensitivity;
-};
\ No newline at end of file
+    u32  opponent;
+};
+
+// GameState is copied with memcpy on snapshot, restore and save, it must stay plain data
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must be trivially copyable");
+
+struct GameSnapshot
+{
+    u32       magic;
+    u32       stateSize;
+    u32       size; // Header plus history bytes
+    u32       historyCount;
+    GameState state;
+};
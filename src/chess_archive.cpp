@@ -0,0 +1,354 @@
+#include "chess_archive.h"
+
+chess_internal inline u64 ArchiveHashString(const char* string, u64 length)
+{
+    // FNV-1a
+    u64 hash = 0xCBF29CE484222325ULL;
+    for (u64 i = 0; i < length; i++)
+    {
+        hash = (hash ^ (u8)string[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+chess_internal inline u64 ArchiveGetMoveSize(u32 encoding)
+{
+    return encoding == ARCHIVE_ENCODING_MOVE16 ? sizeof(u16) : 1;
+}
+
+// Tables are reserved once from the arena, the move data goes straight to 'write'
+void ArchiveWriterInit(ArchiveWriter* writer, MemoryArena* arena, u32 encoding, u64 maxGames, u64 maxStrings,
+                       u64 maxStringSize, ArchiveWriteFunc* write, void* context)
+{
+    CHESS_ASSERT(writer);
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(write);
+    CHESS_ASSERT(maxStrings > 0 && maxStrings < 0xFFFFFFFF);
+    CHESS_ASSERT(maxStringSize >= 2 && maxStringSize <= 0xFFFFFFFF);
+
+    u64 slotCount = 1;
+    while (slotCount < maxStrings * ARCHIVE_HASH_SLOTS)
+    {
+        slotCount <<= 1;
+    }
+
+    writer->encoding      = encoding;
+    writer->write         = write;
+    writer->context       = context;
+    writer->isValid       = true;
+    writer->offset        = sizeof(ArchiveHeader);
+    writer->plyCount      = 0;
+    writer->games         = ARENA_PUSH_ARRAY(arena, ArchiveGame, maxGames);
+    writer->gameCount     = 0;
+    writer->maxGames      = maxGames;
+    writer->stringOffsets = ARENA_PUSH_ARRAY(arena, u32, maxStrings + 1);
+    writer->strings       = ARENA_PUSH_ARRAY(arena, char, maxStringSize);
+    writer->maxStrings    = maxStrings;
+    writer->maxStringSize = maxStringSize;
+    writer->slots         = ARENA_PUSH_ARRAY(arena, u32, slotCount);
+    writer->slotMask      = slotCount - 1;
+    memset(writer->slots, 0, sizeof(u32) * slotCount);
+
+    // ARCHIVE_NO_TAG
+    writer->strings[0]       = '?';
+    writer->strings[1]       = '\0';
+    writer->stringOffsets[0] = 0;
+    writer->stringOffsets[1] = 2;
+    writer->stringCount      = 1;
+    writer->stringSize       = 2;
+}
+
+// Dictionary index of the string, added the first time it is seen. Missing, empty and "?" tags are ARCHIVE_NO_TAG.
+chess_internal u32 ArchiveWriterIntern(ArchiveWriter* writer, const char* string)
+{
+    if (!string || string[0] == '\0' || (string[0] == '?' && string[1] == '\0'))
+    {
+        return ARCHIVE_NO_TAG;
+    }
+
+    u64 length = strlen(string);
+    u64 slot   = ArchiveHashString(string, length) & writer->slotMask;
+    for (; writer->slots[slot]; slot = (slot + 1) & writer->slotMask)
+    {
+        u32 index = writer->slots[slot] - 1;
+        u32 start = writer->stringOffsets[index];
+        if (writer->stringOffsets[index + 1] - start == length + 1 &&
+            memcmp(writer->strings + start, string, length) == 0)
+        {
+            return index;
+        }
+    }
+
+    if (writer->stringCount == writer->maxStrings || writer->stringSize + length + 1 > writer->maxStringSize)
+    {
+        writer->isValid = false;
+        return ARCHIVE_NO_TAG;
+    }
+
+    u32 index = (u32)writer->stringCount++;
+    memcpy(writer->strings + writer->stringSize, string, length + 1);
+    writer->stringSize += length + 1;
+    writer->stringOffsets[index + 1] = (u32)writer->stringSize;
+    writer->slots[slot]              = index + 1;
+
+    return index;
+}
+
+// Every ply of the history line from its initial position, count and length alike. 'buffer' must hold two bytes per
+// ply. INDEX8 replays the line on a copy of the initial position, the board itself is not touched.
+u64 ArchiveEncodeMoves(Board* board, u32 encoding, u8* buffer)
+{
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(buffer);
+
+    BoardHistory* history = &board->history;
+    if (encoding == ARCHIVE_ENCODING_MOVE16)
+    {
+        for (u32 ply = 0; ply < history->length; ply++)
+        {
+            memcpy(buffer + ply * sizeof(u16), &history->entries[ply].move, sizeof(u16));
+        }
+        return history->length * sizeof(u16);
+    }
+
+    BoardPosition position;
+    position.Restore(history->keyframes[0], history->rootHalfMoves, history->rootPlies);
+    for (u32 ply = 0; ply < history->length; ply++)
+    {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, position);
+        CHESS_ASSERT(moves.size() <= ARCHIVE_INDEX8_MOVES);
+
+        chess::Move move  = chess::Move(history->entries[ply].move);
+        int         index = 0;
+        while (index < moves.size() && moves[index].move() != move.move())
+        {
+            index++;
+        }
+        CHESS_ASSERT(index < moves.size());
+
+        buffer[ply] = (u8)index;
+        position.makeMove(move);
+    }
+    return history->length;
+}
+
+// 'moves' is the output of ArchiveEncodeMoves in the writer encoding, 'tags' holds ARCHIVE_TAG_COUNT strings or
+// null ones. False once the archive is full or a write failed, every later call fails too.
+bool ArchiveWriterAddGame(ArchiveWriter* writer, const u8* moves, u64 moveSize, u32 plyCount, const char* const* tags,
+                          u32 result)
+{
+    CHESS_ASSERT(writer);
+    CHESS_ASSERT(moveSize == plyCount * ArchiveGetMoveSize(writer->encoding));
+
+    if (!writer->isValid || writer->gameCount == writer->maxGames)
+    {
+        writer->isValid = false;
+        return false;
+    }
+
+    ArchiveGame* game = &writer->games[writer->gameCount];
+    memset(game, 0, sizeof(ArchiveGame));
+    game->moveOffset = writer->offset;
+    game->plyCount   = plyCount;
+    game->result     = (u8)result;
+    for (u32 i = 0; i < ARCHIVE_TAG_COUNT; i++)
+    {
+        game->tags[i] = ArchiveWriterIntern(writer, tags ? tags[i] : 0);
+    }
+
+    if (!writer->isValid || (moveSize && !writer->write(writer->context, writer->offset, moves, moveSize)))
+    {
+        writer->isValid = false;
+        return false;
+    }
+
+    writer->offset += moveSize;
+    writer->plyCount += plyCount;
+    writer->gameCount++;
+
+    return true;
+}
+
+// Moves of an archive game as they are, tags through the dictionary of the writer. Both must use the same encoding.
+bool ArchiveWriterCopyGame(ArchiveWriter* writer, const ArchiveReader* reader, u64 gameIndex)
+{
+    CHESS_ASSERT(writer);
+    CHESS_ASSERT(reader);
+    CHESS_ASSERT(gameIndex < reader->gameCount);
+    CHESS_ASSERT(writer->encoding == reader->header->encoding);
+
+    const ArchiveGame* game     = &reader->games[gameIndex];
+    u64                moveSize = ArchiveGetMoveSize(writer->encoding);
+    if (game->moveOffset > reader->header->gamesOffset ||
+        (reader->header->gamesOffset - game->moveOffset) / moveSize < game->plyCount)
+    {
+        return false;
+    }
+
+    const char* tags[ARCHIVE_TAG_COUNT];
+    for (u32 i = 0; i < ARCHIVE_TAG_COUNT; i++)
+    {
+        tags[i] = ArchiveGetTag(reader, gameIndex, i);
+    }
+
+    return ArchiveWriterAddGame(writer, reader->content + game->moveOffset, game->plyCount * moveSize, game->plyCount,
+                                tags, game->result);
+}
+
+// Game table and dictionary after the moves, the header last so a partial file never opens
+bool ArchiveWriterFinish(ArchiveWriter* writer)
+{
+    CHESS_ASSERT(writer);
+
+    if (!writer->isValid)
+    {
+        return false;
+    }
+
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic         = ARCHIVE_MAGIC;
+    header.version       = ARCHIVE_VERSION;
+    header.encoding      = (u16)writer->encoding;
+    header.gameCount     = writer->gameCount;
+    header.plyCount      = writer->plyCount;
+    header.gamesOffset   = (writer->offset + 7) & ~7ULL;
+    header.stringsOffset = header.gamesOffset + sizeof(ArchiveGame) * writer->gameCount;
+    header.stringCount   = writer->stringCount;
+    header.fileSize      = header.stringsOffset + sizeof(u32) * (writer->stringCount + 1) + writer->stringSize;
+
+    u64 padding = 0;
+    writer->isValid =
+        writer->write(writer->context, writer->offset, &padding, header.gamesOffset - writer->offset) &&
+        writer->write(writer->context, header.gamesOffset, writer->games, sizeof(ArchiveGame) * writer->gameCount) &&
+        writer->write(writer->context, header.stringsOffset, writer->stringOffsets,
+                      sizeof(u32) * (writer->stringCount + 1)) &&
+        writer->write(writer->context, header.stringsOffset + sizeof(u32) * (writer->stringCount + 1),
+                      writer->strings, writer->stringSize) &&
+        writer->write(writer->context, 0, &header, sizeof(header));
+
+    return writer->isValid;
+}
+
+// Nothing is copied, the reader points into 'content' and every table is bounds checked once here: each string
+// offset has to land inside the string block, whose last byte is a terminator, so ArchiveGetTag reads unchecked
+bool ArchiveOpen(ArchiveReader* reader, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(reader);
+
+    memset(reader, 0, sizeof(ArchiveReader));
+    const ArchiveHeader* header = (const ArchiveHeader*)content;
+    if (!content || contentSize < sizeof(ArchiveHeader) || header->magic != ARCHIVE_MAGIC ||
+        header->version != ARCHIVE_VERSION || header->encoding > ARCHIVE_ENCODING_INDEX8 ||
+        header->fileSize > contentSize || header->gamesOffset % 8 != 0 || header->stringCount == 0 ||
+        header->stringCount >= header->fileSize / sizeof(u32) ||
+        header->gamesOffset > header->stringsOffset ||
+        (header->stringsOffset - header->gamesOffset) / sizeof(ArchiveGame) != header->gameCount ||
+        header->stringsOffset + sizeof(u32) * (header->stringCount + 1) > header->fileSize)
+    {
+        return false;
+    }
+
+    reader->content       = (const u8*)content;
+    reader->header        = header;
+    reader->games         = (const ArchiveGame*)(reader->content + header->gamesOffset);
+    reader->stringOffsets = (const u32*)(reader->content + header->stringsOffset);
+    reader->strings       = (const char*)(reader->stringOffsets + header->stringCount + 1);
+    reader->gameCount     = header->gameCount;
+
+    u64  stringSize = header->fileSize - header->stringsOffset - sizeof(u32) * (header->stringCount + 1);
+    bool isValid    = stringSize > 0 && reader->stringOffsets[header->stringCount] == stringSize &&
+                   reader->strings[stringSize - 1] == '\0';
+    for (u64 i = 0; isValid && i < header->stringCount; i++)
+    {
+        isValid = reader->stringOffsets[i] < stringSize;
+    }
+    if (!isValid)
+    {
+        memset(reader, 0, sizeof(ArchiveReader));
+        return false;
+    }
+
+    return true;
+}
+
+// Null terminated string inside the mapped file, "?" for a missing tag
+const char* ArchiveGetTag(const ArchiveReader* reader, u64 gameIndex, u32 tag)
+{
+    CHESS_ASSERT(reader);
+    CHESS_ASSERT(gameIndex < reader->gameCount);
+    CHESS_ASSERT(tag < ARCHIVE_TAG_COUNT);
+
+    u32 index = reader->games[gameIndex].tags[tag];
+    index     = index < reader->header->stringCount ? index : ARCHIVE_NO_TAG;
+
+    return reader->strings + reader->stringOffsets[index];
+}
+
+// Same contract as PgnLoadGame: the board is left on the initial position of the game with every move ready to step
+// through. Moves are read in place, an INDEX8 game keeps the moves before a damaged one. Returns the plies loaded.
+u32 ArchiveLoadGame(const ArchiveReader* reader, u64 gameIndex, Board* board)
+{
+    CHESS_ASSERT(reader);
+    CHESS_ASSERT(board);
+
+    if (gameIndex >= reader->gameCount)
+    {
+        return 0;
+    }
+
+    const ArchiveGame* game     = &reader->games[gameIndex];
+    u32                encoding = reader->header->encoding;
+    u64                moveSize = ArchiveGetMoveSize(encoding);
+    u32                maxPlies = board->history.maxPlies;
+    u32                plyCount = game->plyCount < maxPlies ? game->plyCount : maxPlies - 1;
+    if (game->moveOffset > reader->header->gamesOffset ||
+        (reader->header->gamesOffset - game->moveOffset) / moveSize < plyCount)
+    {
+        plyCount = 0;
+    }
+
+    const char* fen = chess::constants::STARTPOS;
+    if (game->tags[ARCHIVE_TAG_FEN] != ARCHIVE_NO_TAG)
+    {
+        fen = ArchiveGetTag(reader, gameIndex, ARCHIVE_TAG_FEN);
+    }
+    // A refused FEN leaves the board on the initial position, without moves
+    if (!BoardReset(board, fen))
+    {
+        plyCount = 0;
+    }
+
+    const u8* moves = reader->content + game->moveOffset;
+    for (u32 ply = 0; ply < plyCount; ply++)
+    {
+        chess::Move move;
+        if (encoding == ARCHIVE_ENCODING_MOVE16)
+        {
+            u16 data;
+            memcpy(&data, moves + ply * sizeof(u16), sizeof(u16));
+            move = chess::Move(data);
+        }
+        else
+        {
+            chess::Movelist legalMoves;
+            chess::movegen::legalmoves(legalMoves, *board->position);
+            if ((int)moves[ply] >= legalMoves.size())
+            {
+                break;
+            }
+            move = legalMoves[moves[ply]];
+        }
+
+        if (!BoardHistoryAppend(board, move))
+        {
+            break;
+        }
+    }
+
+    u32 plies = board->history.count;
+    BoardSeek(board, 0);
+
+    return plies;
+}
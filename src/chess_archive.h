@@ -0,0 +1,112 @@
+#pragma once
+
+#include "chess_game_logic.h"
+
+// Native archive of finished games, read in place from a mapped file.
+// Layout: ArchiveHeader, the move data of every game back to back, the ArchiveGame table, then the tag dictionary
+// as u32 offsets followed by null terminated strings. Games refer to tags by dictionary index, so a player name is
+// stored once whatever the number of games. Moves are u16 chess::Move values, or with ARCHIVE_ENCODING_INDEX8 the
+// index of the move in the chess::movegen::legalmoves list of its position, one byte per move.
+
+#define ARCHIVE_MAGIC        0x43524143 // "CARC"
+#define ARCHIVE_VERSION      1
+#define ARCHIVE_NO_TAG       0 // Dictionary entry 0 is always "?"
+#define ARCHIVE_HASH_SLOTS   2 // Dictionary hash slots per string, at least
+#define ARCHIVE_INDEX8_MOVES 256
+
+enum
+{
+    ARCHIVE_ENCODING_MOVE16,
+    ARCHIVE_ENCODING_INDEX8
+};
+
+enum
+{
+    ARCHIVE_TAG_EVENT,
+    ARCHIVE_TAG_SITE,
+    ARCHIVE_TAG_DATE,
+    ARCHIVE_TAG_ROUND,
+    ARCHIVE_TAG_WHITE,
+    ARCHIVE_TAG_BLACK,
+    ARCHIVE_TAG_FEN, // Only set when the game does not start from the initial position
+    ARCHIVE_TAG_COUNT
+};
+
+enum
+{
+    ARCHIVE_RESULT_UNKNOWN,
+    ARCHIVE_RESULT_WHITE,
+    ARCHIVE_RESULT_BLACK,
+    ARCHIVE_RESULT_DRAW
+};
+
+struct ArchiveHeader
+{
+    u32 magic;
+    u16 version;
+    u16 encoding;
+    u64 gameCount;
+    u64 plyCount;
+    u64 gamesOffset;
+    u64 stringsOffset; // stringCount + 1 u32 offsets relative to the first string, then the strings
+    u64 stringCount;
+    u64 fileSize;
+};
+
+struct ArchiveGame
+{
+    u64 moveOffset;
+    u32 plyCount;
+    u32 tags[ARCHIVE_TAG_COUNT];
+    u8  result;
+    u8  reserved[3];
+};
+
+// Every byte goes through 'write' at increasing offsets for the moves, the tables and the header come last
+#define ARCHIVE_WRITE(name) bool name(void* context, u64 offset, const void* data, u64 size)
+typedef ARCHIVE_WRITE(ArchiveWriteFunc);
+
+struct ArchiveWriter
+{
+    u32               encoding;
+    ArchiveWriteFunc* write;
+    void*             context;
+    bool              isValid; // Cleared by the first failed write or full table
+
+    u64          offset; // Next move byte
+    u64          plyCount;
+    ArchiveGame* games;
+    u64          gameCount;
+    u64          maxGames;
+
+    // Dictionary, open addressing on the string hash, slots hold index + 1
+    u32*  stringOffsets;
+    char* strings;
+    u64   stringCount;
+    u64   maxStrings;
+    u64   stringSize;
+    u64   maxStringSize;
+    u32*  slots;
+    u64   slotMask;
+};
+
+struct ArchiveReader
+{
+    const u8*            content;
+    const ArchiveHeader* header;
+    const ArchiveGame*   games;
+    const u32*           stringOffsets;
+    const char*          strings;
+    u64                  gameCount;
+};
+
+void        ArchiveWriterInit(ArchiveWriter* writer, MemoryArena* arena, u32 encoding, u64 maxGames, u64 maxStrings,
+                              u64 maxStringSize, ArchiveWriteFunc* write, void* context);
+u64         ArchiveEncodeMoves(Board* board, u32 encoding, u8* buffer);
+bool        ArchiveWriterAddGame(ArchiveWriter* writer, const u8* moves, u64 moveSize, u32 plyCount,
+                                 const char* const* tags, u32 result);
+bool        ArchiveWriterCopyGame(ArchiveWriter* writer, const ArchiveReader* reader, u64 gameIndex);
+bool        ArchiveWriterFinish(ArchiveWriter* writer);
+bool        ArchiveOpen(ArchiveReader* reader, const void* content, u64 contentSize);
+const char* ArchiveGetTag(const ArchiveReader* reader, u64 gameIndex, u32 tag);
+u32         ArchiveLoadGame(const ArchiveReader* reader, u64 gameIndex, Board* board);
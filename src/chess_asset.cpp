@@ -107,6 +107,7 @@ chess_internal void ExtractMeshDataFromGLTF(GameMemory* memory)
     memory->platform.Log("GAME loading gltf model ...");
     FileReadResult binFile  = memory->platform.FileReadEntire("../data/chess_set_v2.bin");
     FileReadResult jsonFile = memory->platform.FileReadEntire("../data/chess_set_v2.gltf");
+    CHESS_ASSERT(binFile.content && jsonFile.content);
 
     // clang-format off
     u32 nodes[] = {
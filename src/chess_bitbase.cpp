@@ -0,0 +1,362 @@
+#include "chess_bitbase.h"
+
+// Generation states, packed to one bit per position once a table is done
+enum
+{
+    BITBASE_STATE_UNKNOWN,
+    BITBASE_STATE_WIN,
+    BITBASE_STATE_DRAW,
+    BITBASE_STATE_INVALID
+};
+
+chess_internal inline u64 BitbaseCellBit(u32 cell)
+{
+    return 1ull << cell;
+}
+
+// Mirrors to files a-d for the strong king, the endings have no castling so the board is symmetric
+chess_internal inline u32 BitbaseGetIndex(u32 weakToMove, u32 strongKing, u32 piece, u32 weakKing)
+{
+    if ((strongKing & 7) > 3)
+    {
+        strongKing ^= 7;
+        piece ^= 7;
+        weakKing ^= 7;
+    }
+    u32 strongKingIndex = (strongKing >> 3) * 4 + (strongKing & 7);
+
+    return ((weakToMove * 32 + strongKingIndex) * 64 + piece) * 64 + weakKing;
+}
+
+chess_internal inline bool BitbaseIsWin(const BitbaseTables* tables, u32 ending, u32 index)
+{
+    return (tables->wins[ending][index >> 6] >> (index & 63)) & 1;
+}
+
+// Cells attacked by the strong piece with the given occupancy
+chess_internal inline u64 BitbasePieceAttacks(u32 ending, u32 piece, u64 occupied)
+{
+    chess::Square   cell      = chess::Square((s32)piece);
+    chess::Bitboard _occupied = chess::Bitboard(occupied);
+
+    switch (ending)
+    {
+    case BITBASE_KQK:
+        return chess::attacks::queen(cell, _occupied).getBits();
+    case BITBASE_KRK:
+        return chess::attacks::rook(cell, _occupied).getBits();
+    default:
+        return chess::attacks::pawn(chess::Color::WHITE, cell).getBits();
+    }
+}
+
+chess_internal inline u64 BitbaseKingAttacks(u32 cell)
+{
+    return chess::attacks::king(chess::Square((s32)cell)).getBits();
+}
+
+chess_internal u8 BitbaseClassify(BitbaseGenerator* generator, u32 index)
+{
+    u32                  ending     = generator->ending;
+    std::atomic<u8>*     results    = generator->results;
+    const BitbaseTables* tables     = generator->bitbases->tables;
+    u32                  weakKing   = index & 63;
+    u32                  piece      = (index >> 6) & 63;
+    u32                  strongKing = (((index >> 12) & 31) >> 2) * 8 + ((index >> 12) & 3);
+    u32                  weakToMove = index >> 17;
+
+    u64  occupied = BitbaseCellBit(strongKing) | BitbaseCellBit(piece) | BitbaseCellBit(weakKing);
+    bool isValid  = strongKing != piece && strongKing != weakKing && piece != weakKing &&
+                   !(BitbaseKingAttacks(strongKing) & BitbaseCellBit(weakKing)) &&
+                   (ending != BITBASE_KPK || (piece >= 8 && piece < 56));
+    bool inCheck = isValid && (BitbasePieceAttacks(ending, piece, occupied) & BitbaseCellBit(weakKing));
+    if (!isValid || (inCheck && !weakToMove))
+    {
+        return BITBASE_STATE_INVALID;
+    }
+
+    bool isUnknown = false;
+    bool hasMoves  = false;
+
+    if (!weakToMove)
+    {
+        // Any winning move wins, every move drawing is a draw
+        u64 kingTargets = BitbaseKingAttacks(strongKing) & ~BitbaseCellBit(piece) & ~BitbaseKingAttacks(weakKing);
+        while (kingTargets)
+        {
+            u32 target = CellBitboardPop(&kingTargets);
+
+            u8 child = results[BitbaseGetIndex(1, target, piece, weakKing)].load(std::memory_order_relaxed);
+            if (child == BITBASE_STATE_WIN)
+            {
+                return BITBASE_STATE_WIN;
+            }
+            isUnknown = isUnknown || child == BITBASE_STATE_UNKNOWN;
+            hasMoves  = true;
+        }
+
+        u64 pieceTargets = 0;
+        if (ending == BITBASE_KPK)
+        {
+            u32 push = piece + 8;
+            if (!(occupied & BitbaseCellBit(push)))
+            {
+                if (push >= 56)
+                {
+                    // Queen or rook promotion, the other two never win what these do not
+                    hasMoves = true;
+                    if (BitbaseIsWin(tables, BITBASE_KQK, BitbaseGetIndex(1, strongKing, push, weakKing)) ||
+                        BitbaseIsWin(tables, BITBASE_KRK, BitbaseGetIndex(1, strongKing, push, weakKing)))
+                    {
+                        return BITBASE_STATE_WIN;
+                    }
+                }
+                else
+                {
+                    pieceTargets |= BitbaseCellBit(push);
+                    if (piece < 16 && !(occupied & BitbaseCellBit(push + 8)))
+                    {
+                        pieceTargets |= BitbaseCellBit(push + 8);
+                    }
+                }
+            }
+        }
+        else
+        {
+            pieceTargets = BitbasePieceAttacks(ending, piece, occupied) & ~occupied;
+        }
+
+        while (pieceTargets)
+        {
+            u32 target = CellBitboardPop(&pieceTargets);
+
+            u8 child = results[BitbaseGetIndex(1, strongKing, target, weakKing)].load(std::memory_order_relaxed);
+            if (child == BITBASE_STATE_WIN)
+            {
+                return BITBASE_STATE_WIN;
+            }
+            isUnknown = isUnknown || child == BITBASE_STATE_UNKNOWN;
+            hasMoves  = true;
+        }
+
+        if (!hasMoves)
+        {
+            return BITBASE_STATE_DRAW;
+        }
+        return isUnknown ? BITBASE_STATE_UNKNOWN : BITBASE_STATE_DRAW;
+    }
+
+    // Weak side: any drawing move draws, every move losing is a win. Sliders see through the weak king so it can
+    // not step back along the checking ray.
+    u64 attacked =
+        BitbaseKingAttacks(strongKing) | BitbasePieceAttacks(ending, piece, occupied & ~BitbaseCellBit(weakKing));
+    u64 kingTargets = BitbaseKingAttacks(weakKing) & ~attacked;
+    while (kingTargets)
+    {
+        u32 target = CellBitboardPop(&kingTargets);
+
+        // Undefended piece, king against king
+        if (target == piece)
+        {
+            return BITBASE_STATE_DRAW;
+        }
+
+        u8 child = results[BitbaseGetIndex(0, strongKing, piece, target)].load(std::memory_order_relaxed);
+        if (child == BITBASE_STATE_DRAW)
+        {
+            return BITBASE_STATE_DRAW;
+        }
+        isUnknown = isUnknown || child == BITBASE_STATE_UNKNOWN;
+        hasMoves  = true;
+    }
+
+    if (!hasMoves)
+    {
+        return inCheck ? BITBASE_STATE_WIN : BITBASE_STATE_DRAW;
+    }
+    return isUnknown ? BITBASE_STATE_UNKNOWN : BITBASE_STATE_WIN;
+}
+
+void BitbaseInit(Bitbases* bitbases, MemoryArena* arena)
+{
+    CHESS_ASSERT(bitbases);
+    CHESS_ASSERT(arena);
+
+    bitbases->tables          = ARENA_PUSH_ARRAY(arena, BitbaseTables, 1);
+    bitbases->tables->magic   = BITBASE_MAGIC;
+    bitbases->tables->version = BITBASE_VERSION;
+    bitbases->isReady         = false;
+}
+
+// Returns false when the content is not a cache written by this version
+bool BitbaseLoad(Bitbases* bitbases, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(bitbases && bitbases->tables);
+
+    const BitbaseTables* tables = (const BitbaseTables*)content;
+    bool result = content && contentSize == sizeof(BitbaseTables) && tables->magic == BITBASE_MAGIC &&
+                  tables->version == BITBASE_VERSION;
+    if (result)
+    {
+        memcpy(bitbases->tables, content, sizeof(BitbaseTables));
+        bitbases->isReady = true;
+    }
+
+    return result;
+}
+
+BitbaseGenerator* BitbaseGeneratorCreate(Bitbases* bitbases, MemoryArena* arena, u32 sliceCount)
+{
+    CHESS_ASSERT(bitbases && bitbases->tables);
+    CHESS_ASSERT(sliceCount > 0 && sliceCount <= BITBASE_MAX_SLICES);
+
+    BitbaseGenerator* result = new (ArenaPushSize(arena, sizeof(BitbaseGenerator), alignof(BitbaseGenerator)))
+        BitbaseGenerator();
+    result->bitbases   = bitbases;
+    result->sliceCount = sliceCount;
+    result->results    = ARENA_PUSH_ARRAY(arena, std::atomic<u8>, BITBASE_POSITIONS);
+    for (u32 i = 0; i < sliceCount; i++)
+    {
+        result->slices[i].generator  = result;
+        result->slices[i].sliceIndex = i;
+    }
+
+    return result;
+}
+
+// Every table is iterated until a pass changes nothing, positions still unknown then can not be forced: draws.
+// Without RunSlices the slices of a pass run one after the other on the calling thread.
+void BitbaseGenerate(BitbaseGenerator* generator, BitbaseRunSlicesFunc* RunSlices, void* context)
+{
+    CHESS_ASSERT(generator);
+
+    BitbaseTables* tables = generator->bitbases->tables;
+
+    for (u32 ending = 0; ending < BITBASE_COUNT; ending++)
+    {
+        generator->ending = ending;
+        for (u32 i = 0; i < BITBASE_POSITIONS; i++)
+        {
+            generator->results[i].store(BITBASE_STATE_UNKNOWN, std::memory_order_relaxed);
+        }
+
+        do
+        {
+            generator->changed.store(0, std::memory_order_relaxed);
+            if (RunSlices)
+            {
+                RunSlices(context, generator);
+            }
+            else
+            {
+                for (u32 i = 0; i < generator->sliceCount; i++)
+                {
+                    BitbaseRunSlice(&generator->slices[i]);
+                }
+            }
+        } while (generator->changed.load(std::memory_order_acquire) > 0);
+
+        memset(tables->wins[ending], 0, sizeof(tables->wins[ending]));
+        for (u32 i = 0; i < BITBASE_POSITIONS; i++)
+        {
+            if (generator->results[i].load(std::memory_order_relaxed) == BITBASE_STATE_WIN)
+            {
+                tables->wins[ending][i >> 6] |= 1ull << (i & 63);
+            }
+        }
+    }
+
+    generator->bitbases->isReady = true;
+}
+
+// Slices interleave blocks of 64 positions, so every slice gets a share of both sides to move
+void BitbaseRunSlice(BitbaseSlice* slice)
+{
+    CHESS_ASSERT(slice);
+
+    BitbaseGenerator* generator = slice->generator;
+
+    u32 changed = 0;
+    for (u32 block = slice->sliceIndex; block < BITBASE_POSITIONS / 64; block += generator->sliceCount)
+    {
+        for (u32 index = block * 64; index < block * 64 + 64; index++)
+        {
+            if (generator->results[index].load(std::memory_order_relaxed) == BITBASE_STATE_UNKNOWN)
+            {
+                u8 result = BitbaseClassify(generator, index);
+                if (result != BITBASE_STATE_UNKNOWN)
+                {
+                    generator->results[index].store(result, std::memory_order_relaxed);
+                    changed++;
+                }
+            }
+        }
+    }
+
+    generator->changed.fetch_add(changed, std::memory_order_release);
+}
+
+// O(1), BITBASE_RESULT_UNKNOWN for any other material or before the tables are ready
+u32 BitbaseProbe(const Bitbases* bitbases, const chess::Board& position)
+{
+    if (!bitbases || !bitbases->isReady || position.occ().count() != 3)
+    {
+        return BITBASE_RESULT_UNKNOWN;
+    }
+
+    chess::Bitboard _pieces = position.occ() & ~position.pieces(chess::PieceType::KING);
+    chess::Square   piece   = chess::Square((s32)_pieces.lsb());
+
+    chess::PieceType type = position.at<chess::PieceType>(piece);
+    u32              ending;
+    if (type == chess::PieceType::QUEEN)
+    {
+        ending = BITBASE_KQK;
+    }
+    else if (type == chess::PieceType::ROOK)
+    {
+        ending = BITBASE_KRK;
+    }
+    else if (type == chess::PieceType::PAWN)
+    {
+        ending = BITBASE_KPK;
+    }
+    else
+    {
+        return BITBASE_RESULT_UNKNOWN;
+    }
+
+    // Black as the strong side is mirrored vertically
+    chess::Color strong     = position.at(piece).color();
+    u32          flip       = strong == chess::Color::WHITE ? 0 : 56;
+    u32          strongKing = (u32)position.kingSq(strong).index() ^ flip;
+    u32          weakKing   = (u32)position.kingSq(~strong).index() ^ flip;
+    u32          weakToMove = position.sideToMove() != strong;
+
+    if (!BitbaseIsWin(bitbases->tables, ending,
+                      BitbaseGetIndex(weakToMove, strongKing, (u32)piece.index() ^ flip, weakKing)))
+    {
+        return BITBASE_RESULT_DRAW;
+    }
+
+    return weakToMove ? BITBASE_RESULT_LOSS : BITBASE_RESULT_WIN;
+}
+
+// Theoretical outcome in BoardGetGameResult terms, BOARD_GAME_RESULT_NONE when the ending is not covered
+u32 BitbaseGetGameResult(const Bitbases* bitbases, Board* board)
+{
+    CHESS_ASSERT(board);
+
+    u32 result = BitbaseProbe(bitbases, *board->position);
+    if (result == BITBASE_RESULT_UNKNOWN)
+    {
+        return BOARD_GAME_RESULT_NONE;
+    }
+    if (result == BITBASE_RESULT_DRAW)
+    {
+        return BOARD_GAME_RESULT_DRAW;
+    }
+
+    bool whiteWins = (result == BITBASE_RESULT_WIN) == (board->position->sideToMove() == chess::Color::WHITE);
+    return whiteWins ? BOARD_GAME_RESULT_WIN : BOARD_GAME_RESULT_LOSE;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+
+#include "chess_game_logic.h"
+
+// Endgame bitbases for king and pawn, rook or queen against king, built by retrograde analysis
+// Positions are seen with the strong side as white and its king on files a-d, one bit per position tells whether
+// the strong side wins. The strong side can never lose these endings, a clear bit is a draw.
+// Index: side to move (0 strong, 1 weak), strong king (rank * 4 + file), piece cell, weak king cell.
+
+#define BITBASE_POSITIONS  (2 * 32 * 64 * 64)
+#define BITBASE_WORDS      (BITBASE_POSITIONS / 64)
+#define BITBASE_MAX_SLICES 64
+#define BITBASE_MAGIC      0x42544942 // "BITB"
+#define BITBASE_VERSION    1
+#define BITBASE_CACHE_FILE "chess_bitbases.bin"
+
+// Generation order, pawn promotions probe the queen and rook tables
+enum
+{
+    BITBASE_KQK,
+    BITBASE_KRK,
+    BITBASE_KPK,
+    BITBASE_COUNT
+};
+
+// Side to move point of view
+enum
+{
+    BITBASE_RESULT_UNKNOWN,
+    BITBASE_RESULT_WIN,
+    BITBASE_RESULT_DRAW,
+    BITBASE_RESULT_LOSS
+};
+
+// Written to BITBASE_CACHE_FILE as is
+struct BitbaseTables
+{
+    u32 magic;
+    u32 version;
+    u64 wins[BITBASE_COUNT][BITBASE_WORDS];
+};
+
+struct Bitbases
+{
+    BitbaseTables* tables;
+    bool           isReady;
+};
+
+struct BitbaseGenerator;
+
+struct BitbaseSlice
+{
+    BitbaseGenerator* generator;
+    u32               sliceIndex;
+};
+
+// One pass classifies every unknown position of the current table from its children, the table is done when a
+// pass changes nothing. Slices of a pass can run in parallel, results are only ever set once.
+struct BitbaseGenerator
+{
+    Bitbases*        bitbases;
+    u32              ending;
+    u32              sliceCount;
+    BitbaseSlice     slices[BITBASE_MAX_SLICES];
+    std::atomic<u32> changed;
+    std::atomic<u8>* results;
+};
+
+// Runs BitbaseRunSlice on every slice of the generator and returns once all of them are done
+#define BITBASE_RUN_SLICES(name) void name(void* context, BitbaseGenerator* generator)
+typedef BITBASE_RUN_SLICES(BitbaseRunSlicesFunc);
+
+void              BitbaseInit(Bitbases* bitbases, MemoryArena* arena);
+bool              BitbaseLoad(Bitbases* bitbases, const void* content, u64 contentSize);
+BitbaseGenerator* BitbaseGeneratorCreate(Bitbases* bitbases, MemoryArena* arena, u32 sliceCount);
+void              BitbaseGenerate(BitbaseGenerator* generator, BitbaseRunSlicesFunc* RunSlices, void* context);
+void              BitbaseRunSlice(BitbaseSlice* slice);
+u32               BitbaseProbe(const Bitbases* bitbases, const chess::Board& position);
+u32               BitbaseGetGameResult(const Bitbases* bitbases, Board* board);
@@ -0,0 +1,150 @@
+#include "chess_book.h"
+
+chess_internal inline u64 BookReadU64(const u8* bytes)
+{
+    u64 result = 0;
+    for (u32 i = 0; i < 8; i++)
+    {
+        result = (result << 8) | bytes[i];
+    }
+
+    return result;
+}
+
+chess_internal inline u16 BookReadU16(const u8* bytes)
+{
+    return (u16)((bytes[0] << 8) | bytes[1]);
+}
+
+// A trailing partial entry is ignored, an empty or missing file is an empty book
+void BookInit(Book* book, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(book);
+
+    book->entries    = (const u8*)content;
+    book->entryCount = content ? contentSize / BOOK_ENTRY_SIZE : 0;
+}
+
+// to file 0-2, to rank 3-5, from file 6-8, from rank 9-11, promotion 12-14 (knight 1 to queen 4)
+// Castling is king takes rook, like chess::Move
+u16 BookEncodeMove(chess::Move move)
+{
+    u16 result = (u16)(move.to().index() | (move.from().index() << 6));
+    if (move.typeOf() == chess::Move::PROMOTION)
+    {
+        result |= (u16)((s32)move.promotionType() << 12);
+    }
+
+    return result;
+}
+
+void BookWriteEntry(u8* entry, u64 key, u16 move, u16 weight)
+{
+    for (u32 i = 0; i < 8; i++)
+    {
+        entry[i] = (u8)(key >> (56 - 8 * i));
+    }
+    entry[8]  = (u8)(move >> 8);
+    entry[9]  = (u8)move;
+    entry[10] = (u8)(weight >> 8);
+    entry[11] = (u8)weight;
+    memset(entry + 12, 0, 4);
+}
+
+// Book moves of the position sorted by weight, moves that are not legal here (key collisions) are skipped
+// Binary search for the first entry of the key, so the cost is O(log n) page touches on the mapped file
+u32 BookGetMoves(const Book* book, const chess::Board& position, BookMove* moves, u32 maxMoves)
+{
+    CHESS_ASSERT(book);
+    CHESS_ASSERT(moves);
+
+    u64 key   = position.hash();
+    u64 first = 0;
+    u64 last  = book->entryCount;
+    while (first < last)
+    {
+        u64 middle = first + (last - first) / 2;
+        if (BookReadU64(book->entries + middle * BOOK_ENTRY_SIZE) < key)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    chess::Movelist legalMoves;
+    bool            isGenerated = false;
+
+    u32 result = 0;
+    for (u64 i = first; i < book->entryCount && result < maxMoves; i++)
+    {
+        const u8* entry = book->entries + i * BOOK_ENTRY_SIZE;
+        if (BookReadU64(entry) != key)
+        {
+            break;
+        }
+
+        u16 data   = BookReadU16(entry + 8);
+        u16 weight = BookReadU16(entry + 10);
+
+        if (!isGenerated)
+        {
+            chess::movegen::legalmoves(legalMoves, position);
+            isGenerated = true;
+        }
+        for (const chess::Move& move : legalMoves)
+        {
+            if (BookEncodeMove(move) == data)
+            {
+                moves[result].move   = move.move();
+                moves[result].weight = weight;
+                result++;
+                break;
+            }
+        }
+    }
+
+    for (u32 i = 1; i < result; i++)
+    {
+        BookMove _move = moves[i];
+        u32      j     = i;
+        for (; j > 0 && moves[j - 1].weight < _move.weight; j--)
+        {
+            moves[j] = moves[j - 1];
+        }
+        moves[j] = _move;
+    }
+
+    return result;
+}
+
+// Weighted random book move, 0 when the position is out of book
+u16 BookPickMove(const Book* book, const chess::Board& position, u32 random)
+{
+    BookMove moves[BOOK_MAX_MOVES];
+    u32      moveCount = BookGetMoves(book, position, moves, BOOK_MAX_MOVES);
+
+    u32 totalWeight = 0;
+    for (u32 i = 0; i < moveCount; i++)
+    {
+        totalWeight += moves[i].weight;
+    }
+    if (totalWeight == 0)
+    {
+        return moveCount ? moves[0].move : chess::Move::NO_MOVE;
+    }
+
+    u32 pick = random % totalWeight;
+    for (u32 i = 0; i < moveCount; i++)
+    {
+        if (pick < moves[i].weight)
+        {
+            return moves[i].move;
+        }
+        pick -= moves[i].weight;
+    }
+
+    return chess::Move::NO_MOVE;
+}
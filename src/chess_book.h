@@ -0,0 +1,29 @@
+#pragma once
+
+#include "chess_game_logic.h"
+
+// Polyglot opening book, read in place from a mapped file
+// Entries are 16 big endian bytes sorted by key: key u64, move u16, weight u16, learn u32. chess::Board hashes with
+// the Polyglot random numbers, so its Zobrist key is the book key.
+
+#define BOOK_PATH       "../data/book.bin"
+#define BOOK_ENTRY_SIZE 16
+#define BOOK_MAX_MOVES  32
+
+struct BookMove
+{
+    u16 move; // chess::Move encoding
+    u16 weight;
+};
+
+struct Book
+{
+    const u8* entries;
+    u64       entryCount;
+};
+
+void BookInit(Book* book, const void* content, u64 contentSize);
+u16  BookEncodeMove(chess::Move move);
+void BookWriteEntry(u8* entry, u64 key, u16 move, u16 weight);
+u32  BookGetMoves(const Book* book, const chess::Board& position, BookMove* moves, u32 maxMoves);
+u16  BookPickMove(const Book* book, const chess::Board& position, u32 random);
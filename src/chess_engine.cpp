@@ -0,0 +1,777 @@
+#include "chess_engine.h"
+
+#include <chrono>
+#include <thread>
+
+// Material and piece-square tables, from white's point of view with a8 first, indexed by PieceType
+// clang-format off
+chess_internal const s32 engineMaterial[6] = { 100, 320, 330, 500, 900, 0 };
+
+chess_internal const s32 enginePieceSquare[6][64] = {
+    // Pawn
+    {
+         0,  0,  0,  0,  0,  0,  0,  0,
+        50, 50, 50, 50, 50, 50, 50, 50,
+        10, 10, 20, 30, 30, 20, 10, 10,
+         5,  5, 10, 25, 25, 10,  5,  5,
+         0,  0,  0, 20, 20,  0,  0,  0,
+         5, -5,-10,  0,  0,-10, -5,  5,
+         5, 10, 10,-20,-20, 10, 10,  5,
+         0,  0,  0,  0,  0,  0,  0,  0,
+    },
+    // Knight
+    {
+        -50,-40,-30,-30,-30,-30,-40,-50,
+        -40,-20,  0,  0,  0,  0,-20,-40,
+        -30,  0, 10, 15, 15, 10,  0,-30,
+        -30,  5, 15, 20, 20, 15,  5,-30,
+        -30,  0, 15, 20, 20, 15,  0,-30,
+        -30,  5, 10, 15, 15, 10,  5,-30,
+        -40,-20,  0,  5,  5,  0,-20,-40,
+        -50,-40,-30,-30,-30,-30,-40,-50,
+    },
+    // Bishop
+    {
+        -20,-10,-10,-10,-10,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5, 10, 10,  5,  0,-10,
+        -10,  5,  5, 10, 10,  5,  5,-10,
+        -10,  0, 10, 10, 10, 10,  0,-10,
+        -10, 10, 10, 10, 10, 10, 10,-10,
+        -10,  5,  0,  0,  0,  0,  5,-10,
+        -20,-10,-10,-10,-10,-10,-10,-20,
+    },
+    // Rook
+    {
+         0,  0,  0,  0,  0,  0,  0,  0,
+         5, 10, 10, 10, 10, 10, 10,  5,
+        -5,  0,  0,  0,  0,  0,  0, -5,
+        -5,  0,  0,  0,  0,  0,  0, -5,
+        -5,  0,  0,  0,  0,  0,  0, -5,
+        -5,  0,  0,  0,  0,  0,  0, -5,
+        -5,  0,  0,  0,  0,  0,  0, -5,
+         0,  0,  0,  5,  5,  0,  0,  0,
+    },
+    // Queen
+    {
+        -20,-10,-10, -5, -5,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5,  5,  5,  5,  0,-10,
+         -5,  0,  5,  5,  5,  5,  0, -5,
+          0,  0,  5,  5,  5,  5,  0, -5,
+        -10,  5,  5,  5,  5,  5,  0,-10,
+        -10,  0,  5,  0,  0,  0,  0,-10,
+        -20,-10,-10, -5, -5,-10,-10,-20,
+    },
+    // King
+    {
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -20,-30,-30,-40,-40,-30,-30,-20,
+        -10,-20,-20,-20,-20,-20,-20,-10,
+         20, 20,  0,  0,  0,  0, 20, 20,
+         20, 30, 10,  0,  0, 10, 30, 20,
+    },
+};
+// clang-format on
+
+chess_internal inline f64 EngineGetSeconds()
+{
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Threads and the hash table are carved from the arena, the hash size is rounded down to a power of two entries
+Engine* EngineCreate(MemoryArena* arena, u32 threadCount, u64 hashSize)
+{
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(threadCount > 0 && threadCount <= ENGINE_MAX_THREADS);
+
+    Engine* result = new (ArenaPushSize(arena, sizeof(Engine), alignof(Engine))) Engine();
+    result->mailbox.store(ENGINE_MAILBOX_IDLE);
+    result->threadCount = threadCount;
+    result->threads     = ARENA_PUSH_ARRAY(arena, EngineThread, threadCount);
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        EngineThread* thread = new (&result->threads[i]) EngineThread();
+        thread->engine       = result;
+        thread->threadIndex  = i;
+    }
+
+    u64 entryCount = 1;
+    while (entryCount * 2 * sizeof(EngineHashEntry) <= hashSize)
+    {
+        entryCount *= 2;
+    }
+    result->hash.entries = (EngineHashEntry*)ArenaPushSize(arena, entryCount * sizeof(EngineHashEntry), 64);
+    result->hash.mask    = entryCount - 1;
+
+    return result;
+}
+
+// Same as BoardReload, the position vtables point into the previous game code
+void EngineReload(Engine* engine)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(!EngineIsSearching(engine));
+
+    for (u32 i = 0; i < engine->threadCount; i++)
+    {
+        chess::Board _position = std::move(engine->threads[i].position);
+        new (&engine->threads[i].position) chess::Board(std::move(_position));
+    }
+}
+
+void EngineClearHash(Engine* engine)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(!EngineIsSearching(engine));
+
+    memset((void*)engine->hash.entries, 0, (engine->hash.mask + 1) * sizeof(EngineHashEntry));
+}
+
+// Copies the position to every search thread so the game can keep changing its board while the search runs
+// The caller then runs EngineSearch once for every thread index below threadCount, index 0 is the main thread
+// Returns false when a search is still running or its result was not polled yet
+bool EngineStart(Engine* engine, Board* board, EngineLimits limits, u32 threadCount)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(threadCount > 0 && threadCount <= engine->threadCount);
+
+    if (engine->mailbox.load(std::memory_order_acquire) != ENGINE_MAILBOX_IDLE)
+    {
+        return false;
+    }
+
+    // Repetitions can only reach back to the last irreversible move
+    BoardHistory* history   = &board->history;
+    u32           reachable = board->position->halfMoveClock();
+    if (reachable > history->count)
+    {
+        reachable = history->count;
+    }
+    if (reachable > ENGINE_KEYS_MAX - ENGINE_MAX_PLY)
+    {
+        reachable = ENGINE_KEYS_MAX - ENGINE_MAX_PLY;
+    }
+
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        EngineThread* thread = &engine->threads[i];
+        thread->position     = *board->position;
+        memcpy(thread->keys, &history->keys[history->count - reachable], reachable * sizeof(u64));
+        thread->keys[reachable] = board->position->hash();
+        thread->keyCount        = reachable + 1;
+        thread->publishedNodes.store(0, std::memory_order_relaxed);
+    }
+
+    engine->limits            = limits;
+    engine->rootKey           = board->position->hash();
+    engine->startSeconds      = EngineGetSeconds();
+    engine->activeThreadCount = threadCount;
+    engine->runningThreads.store(threadCount, std::memory_order_relaxed);
+    engine->infoSequence.store(0, std::memory_order_relaxed);
+    memset(&engine->info, 0, sizeof(engine->info));
+    engine->stop.store(false, std::memory_order_relaxed);
+    engine->mailbox.store(ENGINE_MAILBOX_SEARCHING, std::memory_order_release);
+
+    return true;
+}
+
+void EngineStop(Engine* engine)
+{
+    CHESS_ASSERT(engine);
+    engine->stop.store(true, std::memory_order_relaxed);
+}
+
+bool EngineIsSearching(Engine* engine)
+{
+    CHESS_ASSERT(engine);
+    return engine->mailbox.load(std::memory_order_acquire) == ENGINE_MAILBOX_SEARCHING;
+}
+
+// Non-blocking, true once per search when its result is available
+bool EnginePollResult(Engine* engine, EngineResult* result)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(result);
+
+    bool isReady = engine->mailbox.load(std::memory_order_acquire) == ENGINE_MAILBOX_READY;
+    if (isReady)
+    {
+        *result = engine->result;
+        engine->mailbox.store(ENGINE_MAILBOX_IDLE, std::memory_order_release);
+    }
+
+    return isReady;
+}
+
+// Non-blocking, false when nothing was published yet or the main search thread was writing
+bool EngineGetInfo(Engine* engine, EngineInfo* info)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(info);
+
+    u32 sequence = engine->infoSequence.load(std::memory_order_acquire);
+    if (sequence == 0 || (sequence & 1))
+    {
+        return false;
+    }
+
+    memcpy(info, &engine->info, sizeof(EngineInfo));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return engine->infoSequence.load(std::memory_order_relaxed) == sequence;
+}
+
+// Nodes of every search thread, lags behind by up to ENGINE_CHECK_INTERVAL nodes per thread
+u64 EngineGetNodes(Engine* engine)
+{
+    CHESS_ASSERT(engine);
+
+    u64 result = 0;
+    for (u32 i = 0; i < engine->activeThreadCount; i++)
+    {
+        result += engine->threads[i].publishedNodes.load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+bool EngineIsMateScore(s32 score)
+{
+    return score >= ENGINE_SCORE_MATE - ENGINE_MAX_PLY || score <= -ENGINE_SCORE_MATE + ENGINE_MAX_PLY;
+}
+
+// Side to move point of view, in centipawns
+s32 EngineEvaluate(const chess::Board& position)
+{
+    s32 score[2] = { 0, 0 };
+
+    for (u32 color = 0; color < 2; color++)
+    {
+        // Tables are written from white's side, white squares are mirrored vertically
+        u32 flip = chess::Color((chess::Color::underlying)color) == chess::Color::WHITE ? 56 : 0;
+        for (u32 type = 0; type < 6; type++)
+        {
+            chess::Bitboard _pieces = position.pieces(chess::PieceType((chess::PieceType::underlying)type),
+                                                      chess::Color((chess::Color::underlying)color));
+            while (_pieces)
+            {
+                u32 cell = _pieces.pop();
+                score[color] += engineMaterial[type] + enginePieceSquare[type][cell ^ flip];
+            }
+        }
+    }
+
+    u32 us = (u32)position.sideToMove();
+    return score[us] - score[us ^ 1];
+}
+
+// ----------------------------------------------------------------------------
+// Hash table
+// Mate scores are stored relative to the node so they stay valid when reached through another path
+chess_internal inline bool EngineHashProbe(EngineHashTable* hash, u64 key, u32 ply, u16* move, s32* score,
+                                           u32* depth, u32* bound)
+{
+    EngineHashEntry* entry = &hash->entries[key & hash->mask];
+
+    u64 check = entry->check.load(std::memory_order_relaxed);
+    u64 data  = entry->data.load(std::memory_order_relaxed);
+
+    bool result = (check ^ data) == key;
+    if (result)
+    {
+        *move  = (u16)data;
+        *score = (s16)(data >> 16);
+        *depth = (u32)(data >> 32) & 0xFF;
+        *bound = (u32)(data >> 40) & 0xFF;
+
+        if (*score >= ENGINE_SCORE_MATE - ENGINE_MAX_PLY)
+        {
+            *score -= (s32)ply;
+        }
+        else if (*score <= -ENGINE_SCORE_MATE + ENGINE_MAX_PLY)
+        {
+            *score += (s32)ply;
+        }
+    }
+
+    return result;
+}
+
+// Always replaces, except a deeper entry of the same position
+chess_internal inline void EngineHashStore(EngineHashTable* hash, u64 key, u32 ply, u16 move, s32 score, u32 depth,
+                                           u32 bound)
+{
+    EngineHashEntry* entry = &hash->entries[key & hash->mask];
+
+    u64 check = entry->check.load(std::memory_order_relaxed);
+    u64 data  = entry->data.load(std::memory_order_relaxed);
+    if ((check ^ data) == key && ((data >> 32) & 0xFF) > depth)
+    {
+        return;
+    }
+
+    if (score >= ENGINE_SCORE_MATE - ENGINE_MAX_PLY)
+    {
+        score += (s32)ply;
+    }
+    else if (score <= -ENGINE_SCORE_MATE + ENGINE_MAX_PLY)
+    {
+        score -= (s32)ply;
+    }
+
+    data = (u64)move | ((u64)(u16)(s16)score << 16) | ((u64)depth << 32) | ((u64)bound << 40);
+    entry->check.store(key ^ data, std::memory_order_relaxed);
+    entry->data.store(data, std::memory_order_relaxed);
+}
+// ----------------------------------------------------------------------------
+
+// Only the main thread applies the limits, helpers run until it raises the stop flag
+chess_internal inline bool EngineShouldStop(EngineThread* thread)
+{
+    if (!thread->stopped && (thread->nodes % ENGINE_CHECK_INTERVAL) == 0)
+    {
+        Engine*       engine = thread->engine;
+        EngineLimits* limits = &engine->limits;
+
+        thread->publishedNodes.store(thread->nodes, std::memory_order_relaxed);
+
+        bool cancelled = engine->stop.load(std::memory_order_relaxed) ||
+                         (engine->cancel && engine->cancel->load(std::memory_order_relaxed));
+        if (thread->threadIndex == 0)
+        {
+            bool nodesSpent  = limits->nodes && thread->nodes >= limits->nodes;
+            bool secondsLeft = !limits->seconds || EngineGetSeconds() - engine->startSeconds < limits->seconds;
+            cancelled        = cancelled || nodesSpent || !secondsLeft;
+        }
+
+        thread->stopped = cancelled;
+    }
+
+    return thread->stopped;
+}
+
+// Repetitions of the current position since the last irreversible move, the first one is scored as a draw
+chess_internal inline bool EngineIsDraw(EngineThread* thread)
+{
+    chess::Board& position = thread->position;
+    if (position.isHalfMoveDraw())
+    {
+        return true;
+    }
+
+    u64 key      = thread->keys[thread->keyCount - 1];
+    s32 firstPly = (s32)thread->keyCount - 1 - (s32)position.halfMoveClock();
+    for (s32 ply = (s32)thread->keyCount - 3; ply >= 0 && ply >= firstPly; ply -= 2)
+    {
+        if (thread->keys[ply] == key)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Known win of a three piece ending from the side to move point of view. The winning side still needs a gradient
+// towards mate or promotion: weak king to the edge, kings close together and the pawn forward, below a queen.
+chess_internal s32 EngineGetBitbaseScore(const chess::Board& position, u32 result)
+{
+    chess::Color strong     = result == BITBASE_RESULT_WIN ? position.sideToMove() : ~position.sideToMove();
+    s32          strongKing = position.kingSq(strong).index();
+    s32          weakKing   = position.kingSq(~strong).index();
+
+    s32 weakFile   = weakKing & 7;
+    s32 weakRank   = weakKing >> 3;
+    s32 fileApart  = (strongKing & 7) - weakFile;
+    s32 rankApart  = (strongKing >> 3) - weakRank;
+    s32 edge       = (weakFile < 4 ? 3 - weakFile : weakFile - 4) + (weakRank < 4 ? 3 - weakRank : weakRank - 4);
+    s32 kingsApart = (fileApart < 0 ? -fileApart : fileApart) + (rankApart < 0 ? -rankApart : rankApart);
+    s32 bonus      = 10 * edge + 4 * (14 - kingsApart);
+
+    chess::Bitboard pawns = position.pieces(chess::PieceType::PAWN, strong);
+    if (pawns)
+    {
+        s32 rank = pawns.lsb() >> 3;
+        bonus += 20 * (strong == chess::Color::WHITE ? rank : 7 - rank);
+    }
+    else
+    {
+        bonus += 200;
+    }
+
+    return result == BITBASE_RESULT_WIN ? ENGINE_SCORE_KNOWN_WIN + bonus : -ENGINE_SCORE_KNOWN_WIN - bonus;
+}
+
+chess_internal inline void EngineMoveDo(EngineThread* thread, chess::Move move)
+{
+    NnueNetwork* network = thread->engine->network;
+    if (network)
+    {
+        NnueAccumulator* accumulator = &thread->accumulators[thread->accumulatorIndex++];
+        NnueUpdate(network, accumulator + 1, accumulator, thread->position, move);
+    }
+    thread->position.makeMove(move);
+    thread->keys[thread->keyCount++] = thread->position.hash();
+}
+
+chess_internal inline void EngineMoveUndo(EngineThread* thread, chess::Move move)
+{
+    thread->keyCount--;
+    if (thread->engine->network)
+    {
+        thread->accumulatorIndex--;
+    }
+    thread->position.unmakeMove(move);
+}
+
+// Hint move first, then captures by most valuable victim / least valuable attacker, then killers
+chess_internal void EngineScoreMoves(EngineThread* thread, chess::Movelist& moves, u16 hint, u32 ply)
+{
+    chess::Board& position = thread->position;
+
+    for (chess::Move& move : moves)
+    {
+        s32 score = 0;
+        if (move.move() == hint)
+        {
+            score = 30000;
+        }
+        else if (position.isCapture(move))
+        {
+            u32 victim   = move.typeOf() == chess::Move::ENPASSANT ? (u32)chess::PieceType::PAWN
+                                                                   : (u32)position.at<chess::PieceType>(move.to());
+            u32 attacker = position.at<chess::PieceType>(move.from());
+            score        = 10000 + engineMaterial[victim] * 8 - (s32)attacker;
+        }
+        else if (move.move() == thread->killers[ply][0])
+        {
+            score = 9000;
+        }
+        else if (move.move() == thread->killers[ply][1])
+        {
+            score = 8000;
+        }
+        if (move.typeOf() == chess::Move::PROMOTION)
+        {
+            score += engineMaterial[move.promotionType()];
+        }
+        move.setScore((s16)score);
+    }
+}
+
+// Selection sort step, moves are usually cut off before the list is fully sorted
+chess_internal inline chess::Move EnginePickMove(chess::Movelist& moves, s32 index)
+{
+    s32 best = index;
+    for (s32 i = index + 1; i < moves.size(); i++)
+    {
+        if (moves[i].score() > moves[best].score())
+        {
+            best = i;
+        }
+    }
+    chess::Move _move = moves[best];
+    moves[best]       = moves[index];
+    moves[index]      = _move;
+
+    return _move;
+}
+
+chess_internal inline s32 EngineEvaluateNode(EngineThread* thread)
+{
+    u32 result = BitbaseProbe(thread->engine->bitbases, thread->position);
+    if (result == BITBASE_RESULT_WIN || result == BITBASE_RESULT_LOSS)
+    {
+        return EngineGetBitbaseScore(thread->position, result);
+    }
+
+    NnueNetwork* network = thread->engine->network;
+    if (network)
+    {
+        return NnueEvaluate(network, &thread->accumulators[thread->accumulatorIndex], thread->position.sideToMove());
+    }
+
+    return EngineEvaluate(thread->position);
+}
+
+chess_internal s32 EngineQuiescence(EngineThread* thread, s32 alpha, s32 beta, u32 ply)
+{
+    thread->nodes++;
+    if (EngineShouldStop(thread))
+    {
+        return 0;
+    }
+
+    s32 standPat = EngineEvaluateNode(thread);
+    if (standPat >= beta || ply >= ENGINE_MAX_PLY - 1)
+    {
+        return standPat;
+    }
+    if (standPat > alpha)
+    {
+        alpha = standPat;
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves<chess::movegen::MoveGenType::CAPTURE>(moves, thread->position);
+    EngineScoreMoves(thread, moves, chess::Move::NO_MOVE, ply);
+
+    s32 best = standPat;
+    for (s32 i = 0; i < moves.size(); i++)
+    {
+        chess::Move move = EnginePickMove(moves, i);
+
+        EngineMoveDo(thread, move);
+        s32 score = -EngineQuiescence(thread, -beta, -alpha, ply + 1);
+        EngineMoveUndo(thread, move);
+
+        if (thread->stopped)
+        {
+            return 0;
+        }
+        if (score > best)
+        {
+            best = score;
+            if (score >= beta)
+            {
+                break;
+            }
+            if (score > alpha)
+            {
+                alpha = score;
+            }
+        }
+    }
+
+    return best;
+}
+
+chess_internal s32 EngineAlphaBeta(EngineThread* thread, s32 alpha, s32 beta, s32 depth, u32 ply)
+{
+    chess::Board& position = thread->position;
+    Engine*       engine   = thread->engine;
+
+    thread->pvLength[ply] = 0;
+
+    if (ply > 0 && EngineIsDraw(thread))
+    {
+        return 0;
+    }
+
+    // Drawn endings cut the tree below the root, won ones are still searched for the mate or the promotion
+    if (ply > 0 && BitbaseProbe(engine->bitbases, position) == BITBASE_RESULT_DRAW)
+    {
+        return 0;
+    }
+
+    bool inCheck = position.inCheck();
+    if (inCheck)
+    {
+        depth++;
+    }
+    if (depth <= 0 || ply >= ENGINE_MAX_PLY - 1)
+    {
+        return EngineQuiescence(thread, alpha, beta, ply);
+    }
+
+    thread->nodes++;
+    if (EngineShouldStop(thread))
+    {
+        return 0;
+    }
+
+    // Entries written by any thread cut the tree, the root always searches to keep its line
+    u64 key       = position.hash();
+    u16 hashMove  = chess::Move::NO_MOVE;
+    s32 hashScore = 0;
+    u32 hashDepth = 0;
+    u32 hashBound = ENGINE_BOUND_NONE;
+    if (EngineHashProbe(&engine->hash, key, ply, &hashMove, &hashScore, &hashDepth, &hashBound) && ply > 0 &&
+        hashDepth >= (u32)depth)
+    {
+        bool isCut = hashBound == ENGINE_BOUND_EXACT || (hashBound == ENGINE_BOUND_LOWER && hashScore >= beta) ||
+                     (hashBound == ENGINE_BOUND_UPPER && hashScore <= alpha);
+        if (isCut)
+        {
+            return hashScore;
+        }
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, position);
+    if (moves.empty())
+    {
+        return inCheck ? -ENGINE_SCORE_MATE + (s32)ply : 0;
+    }
+
+    // Hash move first, then the line of the previous iteration
+    u16 hint = hashMove;
+    if (hint == chess::Move::NO_MOVE && ply < thread->hintLength)
+    {
+        hint = thread->hints[ply];
+    }
+    EngineScoreMoves(thread, moves, hint, ply);
+
+    s32 alphaOriginal = alpha;
+    s32 best          = -ENGINE_SCORE_INFINITE;
+    u16 bestMove      = chess::Move::NO_MOVE;
+    for (s32 i = 0; i < moves.size(); i++)
+    {
+        chess::Move move = EnginePickMove(moves, i);
+
+        EngineMoveDo(thread, move);
+        s32 score = -EngineAlphaBeta(thread, -beta, -alpha, depth - 1, ply + 1);
+        EngineMoveUndo(thread, move);
+
+        if (thread->stopped)
+        {
+            return 0;
+        }
+        if (score > best)
+        {
+            best     = score;
+            bestMove = move.move();
+
+            thread->pv[ply][0] = move.move();
+            memcpy(&thread->pv[ply][1], thread->pv[ply + 1], thread->pvLength[ply + 1] * sizeof(u16));
+            thread->pvLength[ply] = thread->pvLength[ply + 1] + 1;
+
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    if (!position.isCapture(move) && thread->killers[ply][0] != move.move())
+                    {
+                        thread->killers[ply][1] = thread->killers[ply][0];
+                        thread->killers[ply][0] = move.move();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    u32 bound = best >= beta ? ENGINE_BOUND_LOWER : best > alphaOriginal ? ENGINE_BOUND_EXACT : ENGINE_BOUND_UPPER;
+    EngineHashStore(&engine->hash, key, ply, bestMove, best, (u32)depth, bound);
+
+    return best;
+}
+
+chess_internal void EnginePublishInfo(EngineThread* thread, u32 depth, s32 score)
+{
+    Engine*     engine = thread->engine;
+    EngineInfo* info   = &engine->info;
+
+    u32 sequence = engine->infoSequence.load(std::memory_order_relaxed);
+    engine->infoSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    info->key      = engine->rootKey;
+    info->depth    = depth;
+    info->score    = score;
+    info->nodes    = EngineGetNodes(engine);
+    info->seconds  = EngineGetSeconds() - engine->startSeconds;
+    info->pvLength = thread->pvLength[0];
+    memcpy(info->pv, thread->pv[0], thread->pvLength[0] * sizeof(u16));
+
+    engine->infoSequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Runs one Lazy SMP thread until a limit is reached or EngineStop is called, the last thread to return posts the
+// result of the main thread. The best move of the last completed iteration is kept, an interrupted one is discarded.
+void EngineSearch(EngineThread* thread)
+{
+    CHESS_ASSERT(thread);
+
+    Engine*       engine = thread->engine;
+    EngineLimits  limits = engine->limits;
+    EngineResult* result = &engine->result;
+    bool          isMain = thread->threadIndex == 0;
+    u32           depth  = limits.depth && limits.depth < ENGINE_MAX_PLY ? limits.depth : ENGINE_MAX_PLY - 1;
+
+    CHESS_ASSERT(engine->mailbox.load(std::memory_order_acquire) == ENGINE_MAILBOX_SEARCHING);
+
+    thread->nodes      = 0;
+    thread->stopped    = false;
+    thread->hintLength = 0;
+    memset(thread->killers, 0, sizeof(thread->killers));
+
+    thread->accumulatorIndex = 0;
+    if (engine->network)
+    {
+        NnueRefresh(engine->network, &thread->accumulators[0], thread->position);
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, thread->position);
+    if (isMain)
+    {
+        // Any legal move beats no move when the first iteration does not finish
+        memset(result, 0, sizeof(*result));
+        result->key  = engine->rootKey;
+        result->move = moves.empty() ? chess::Move::NO_MOVE : moves[0].move();
+    }
+
+    // Helpers with an odd index start one ply deeper, so threads spread over two depths from the beginning
+    u32 firstIteration = isMain ? 1 : 1 + (thread->threadIndex & 1);
+    for (u32 iteration = firstIteration; iteration <= depth && !moves.empty(); iteration++)
+    {
+        s32 score = EngineAlphaBeta(thread, -ENGINE_SCORE_INFINITE, ENGINE_SCORE_INFINITE, (s32)iteration, 0);
+        if (thread->stopped)
+        {
+            break;
+        }
+
+        thread->hintLength = thread->pvLength[0];
+        memcpy(thread->hints, thread->pv[0], thread->hintLength * sizeof(u16));
+
+        if (isMain)
+        {
+            result->move  = thread->pv[0][0];
+            result->score = score;
+            result->depth = iteration;
+            EnginePublishInfo(thread, iteration, score);
+
+            // A forced mate does not get shorter by searching deeper, neither does a single reply
+            // Without limits the search only ends on EngineStop
+            bool isInfinite = !limits.depth && !limits.nodes && !limits.seconds;
+            if (!isInfinite && (EngineIsMateScore(score) || moves.size() == 1))
+            {
+                break;
+            }
+            // Next iteration takes longer than every previous one together
+            if (limits.seconds && EngineGetSeconds() - engine->startSeconds > limits.seconds * 0.5)
+            {
+                break;
+            }
+        }
+    }
+
+    thread->publishedNodes.store(thread->nodes, std::memory_order_relaxed);
+
+    if (isMain)
+    {
+        // An infinite search that ran out of plies waits for EngineStop like any other
+        bool isInfinite = !limits.depth && !limits.nodes && !limits.seconds;
+        while (isInfinite && !engine->stop.load(std::memory_order_relaxed) &&
+               !(engine->cancel && engine->cancel->load(std::memory_order_relaxed)))
+        {
+            std::this_thread::yield();
+        }
+
+        engine->stop.store(true, std::memory_order_relaxed);
+        result->seconds = EngineGetSeconds() - engine->startSeconds;
+    }
+
+    if (engine->runningThreads.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        engine->result.nodes = EngineGetNodes(engine);
+        engine->mailbox.store(ENGINE_MAILBOX_READY, std::memory_order_release);
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+
+#include "chess_game_logic.h"
+#include "chess_nnue.h"
+#include "chess_bitbase.h"
+
+#define ENGINE_MAX_PLY         64
+#define ENGINE_MAX_THREADS     64
+#define ENGINE_KEYS_MAX        (ENGINE_MAX_PLY + 128)
+#define ENGINE_SCORE_INFINITE  32000
+#define ENGINE_SCORE_MATE      31000
+#define ENGINE_SCORE_KNOWN_WIN 20000 // Bitbase wins, below every mate score
+#define ENGINE_CHECK_INTERVAL  2048
+#define ENGINE_HASH_SIZE       MEGABYTES(64)
+
+// Default budget of the computer opponent, the first limit reached stops the search
+#define ENGINE_DEFAULT_DEPTH   ENGINE_MAX_PLY
+#define ENGINE_DEFAULT_NODES   0
+#define ENGINE_DEFAULT_SECONDS 1.0
+
+// Mailbox between the game thread and the threads running the search
+// IDLE -> SEARCHING by the game on EngineStart, SEARCHING -> READY by the last search thread to finish,
+// READY -> IDLE by the game on EnginePollResult
+enum
+{
+    ENGINE_MAILBOX_IDLE,
+    ENGINE_MAILBOX_SEARCHING,
+    ENGINE_MAILBOX_READY
+};
+
+enum
+{
+    ENGINE_BOUND_NONE,
+    ENGINE_BOUND_EXACT,
+    ENGINE_BOUND_LOWER,
+    ENGINE_BOUND_UPPER
+};
+
+// Zero means no limit, a search without any limit runs until EngineStop
+struct EngineLimits
+{
+    u32 depth;
+    u64 nodes;
+    f64 seconds;
+};
+
+struct EngineResult
+{
+    u16 move; // chess::Move encoding, 0 when the root has no legal moves
+    s32 score;
+    u32 depth;
+    u64 nodes;
+    f64 seconds;
+    u64 key; // Root position, results for a position the game already left are discarded
+};
+
+// Published by the main search thread after every completed iteration
+struct EngineInfo
+{
+    u64 key; // Root position
+    u32 depth;
+    s32 score; // Side to move point of view
+    u64 nodes;
+    f64 seconds;
+    u16 pv[ENGINE_MAX_PLY];
+    u32 pvLength;
+};
+
+// Lockless entry shared by every search thread: 'check' is key ^ data, a torn write reads as a miss
+// data packs the move in bits 0-15, the score in 16-31, the depth in 32-39 and the bound in 40-47
+struct EngineHashEntry
+{
+    std::atomic<u64> check;
+    std::atomic<u64> data;
+};
+
+struct EngineHashTable
+{
+    EngineHashEntry* entries;
+    u64              mask;
+};
+
+struct Engine;
+
+// Lazy SMP: every thread searches the same root on its own position copy, they only share the hash table
+struct alignas(64) EngineThread
+{
+    Engine*      engine;
+    u32          threadIndex;
+    chess::Board position;
+
+    // Positions since the last irreversible move followed by the search path, for repetition detection
+    u64 keys[ENGINE_KEYS_MAX];
+    u32 keyCount;
+
+    u64              nodes;
+    std::atomic<u64> publishedNodes; // Copy of nodes every ENGINE_CHECK_INTERVAL, read by the game thread
+    bool             stopped;
+
+    u16 pv[ENGINE_MAX_PLY][ENGINE_MAX_PLY];
+    u32 pvLength[ENGINE_MAX_PLY];
+    u16 hints[ENGINE_MAX_PLY]; // Principal variation of the previous iteration
+    u32 hintLength;
+    u16 killers[ENGINE_MAX_PLY][2];
+
+    // One entry per ply of the search path, only used with a network
+    NnueAccumulator accumulators[ENGINE_MAX_PLY + 1];
+    u32             accumulatorIndex;
+};
+
+// Iterative deepening alpha-beta over chess::movegen
+// The game only touches the mailbox, the stop flag and the info block while a search runs
+struct Engine
+{
+    EngineThread*   threads;
+    u32             threadCount;
+    u32             activeThreadCount;
+    EngineHashTable hash;
+    NnueNetwork*    network;  // Optional, the piece-square tables evaluate when null
+    Bitbases*       bitbases; // Optional, three piece endings are searched when null
+
+    // Written by EngineStart, safe to read from the game thread
+    EngineLimits limits;
+    u64          rootKey;
+    f64          startSeconds;
+
+    // Optional, checked together with stop, the game points it at GameMemory::cancelWork
+    const std::atomic<bool>* cancel;
+
+    std::atomic<bool> stop;
+    std::atomic<u32>  mailbox;
+    std::atomic<u32>  runningThreads;
+    EngineResult      result;
+
+    // Sequence lock, odd while the main search thread writes info
+    std::atomic<u32> infoSequence;
+    EngineInfo       info;
+};
+
+Engine* EngineCreate(MemoryArena* arena, u32 threadCount, u64 hashSize);
+void    EngineReload(Engine* engine);
+void    EngineClearHash(Engine* engine);
+bool    EngineStart(Engine* engine, Board* board, EngineLimits limits, u32 threadCount);
+void    EngineStop(Engine* engine);
+bool    EngineIsSearching(Engine* engine);
+bool    EnginePollResult(Engine* engine, EngineResult* result);
+bool    EngineGetInfo(Engine* engine, EngineInfo* info);
+u64     EngineGetNodes(Engine* engine);
+void    EngineSearch(EngineThread* thread);
+bool    EngineIsMateScore(s32 score);
+s32     EngineEvaluate(const chess::Board& position);
@@ -0,0 +1,216 @@
+#include "chess_explorer.h"
+
+#include <chrono>
+
+chess_internal inline f64 ExplorerGetSeconds()
+{
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+chess_internal inline u64 ExplorerMoveGames(const ExplorerMove* move)
+{
+    return (u64)move->white + move->draws + move->black;
+}
+
+Explorer* ExplorerCreate(MemoryArena* arena)
+{
+    CHESS_ASSERT(arena);
+
+    Explorer* result = new (ArenaPushSize(arena, sizeof(Explorer), alignof(Explorer))) Explorer();
+    result->mailbox.store(EXPLORER_MAILBOX_IDLE);
+    ExplorerOpen(result, 0, 0);
+
+    return result;
+}
+
+// Nothing is read but the header and the last bucket, a missing or damaged file is an empty index.
+// The cache belongs to the previous file, so it is cleared. No query may be running.
+bool ExplorerOpen(Explorer* explorer, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(explorer);
+    CHESS_ASSERT(!ExplorerIsQuerying(explorer));
+
+    explorer->content    = 0;
+    explorer->header     = 0;
+    explorer->buckets    = 0;
+    explorer->entries    = 0;
+    explorer->entryCount = 0;
+    for (u32 i = 0; i < EXPLORER_CACHE_SIZE; i++)
+    {
+        explorer->cache[i].isValid = false;
+    }
+
+    const ExplorerHeader* header = (const ExplorerHeader*)content;
+    if (!content || contentSize < sizeof(ExplorerHeader) || header->magic != EXPLORER_MAGIC ||
+        header->version != EXPLORER_VERSION || header->bucketBits > EXPLORER_MAX_BUCKET_BITS ||
+        header->entriesOffset < sizeof(ExplorerHeader) + sizeof(u64) * ((1ULL << header->bucketBits) + 1) ||
+        header->entriesOffset % 8 != 0 || header->entriesOffset > contentSize ||
+        (contentSize - header->entriesOffset) / sizeof(ExplorerEntry) < header->entryCount)
+    {
+        return false;
+    }
+
+    const u64* buckets = (const u64*)(header + 1);
+    if (buckets[1ULL << header->bucketBits] != header->entryCount)
+    {
+        return false;
+    }
+
+    explorer->content    = (const u8*)content;
+    explorer->header     = header;
+    explorer->buckets    = buckets;
+    explorer->entries    = (const ExplorerEntry*)(explorer->content + header->entriesOffset);
+    explorer->entryCount = header->entryCount;
+
+    return true;
+}
+
+// Moves of the position sorted by games played, the most played maxMoves of them. Blocks on the mapped file, the
+// game runs it on the io queue through ExplorerQueryRun.
+u32 ExplorerLookup(const Explorer* explorer, u64 key, ExplorerMove* moves, u32 maxMoves, u64* games)
+{
+    CHESS_ASSERT(explorer);
+    CHESS_ASSERT(moves);
+    CHESS_ASSERT(maxMoves > 0);
+
+    u64 totalGames = 0;
+    u32 result     = 0;
+    if (explorer->entryCount)
+    {
+        u64 bucket = explorer->header->bucketBits ? key >> (64 - explorer->header->bucketBits) : 0;
+        u64 first  = explorer->buckets[bucket];
+        u64 last   = explorer->buckets[bucket + 1];
+        last       = last < explorer->entryCount ? last : explorer->entryCount;
+        while (first < last)
+        {
+            u64 middle = first + (last - first) / 2;
+            if (explorer->entries[middle].key < key)
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+
+        for (u64 i = first; i < explorer->entryCount && explorer->entries[i].key == key; i++)
+        {
+            const ExplorerEntry* entry     = &explorer->entries[i];
+            u64                  moveGames = (u64)entry->white + entry->draws + entry->black;
+            totalGames += moveGames;
+
+            // Insertion into the kept moves, the least played one falls off when they are full
+            if (result == maxMoves && ExplorerMoveGames(&moves[maxMoves - 1]) >= moveGames)
+            {
+                continue;
+            }
+            u32 j = result < maxMoves ? result++ : maxMoves - 1;
+            for (; j > 0 && ExplorerMoveGames(&moves[j - 1]) < moveGames; j--)
+            {
+                moves[j] = moves[j - 1];
+            }
+            moves[j].move  = entry->move;
+            moves[j].white = entry->white;
+            moves[j].draws = entry->draws;
+            moves[j].black = entry->black;
+        }
+    }
+
+    if (games)
+    {
+        *games = totalGames;
+    }
+
+    return result;
+}
+
+// Null until the position has been answered, a position that is not in the index is answered with no moves
+const ExplorerPosition* ExplorerGetPosition(const Explorer* explorer, u64 key)
+{
+    CHESS_ASSERT(explorer);
+
+    const ExplorerPosition* position = &explorer->cache[key & (EXPLORER_CACHE_SIZE - 1)];
+    return position->isValid && position->key == key ? position : 0;
+}
+
+// One query at a time, false while the previous one is running or not polled yet
+bool ExplorerQueryStart(Explorer* explorer, const chess::Board& position)
+{
+    CHESS_ASSERT(explorer);
+
+    if (explorer->mailbox.load(std::memory_order_acquire) != EXPLORER_MAILBOX_IDLE)
+    {
+        return false;
+    }
+
+    explorer->queryKey      = position.hash();
+    explorer->queryPosition = chess::Board::Compact::encode(position);
+    explorer->mailbox.store(EXPLORER_MAILBOX_QUERYING, std::memory_order_release);
+
+    return true;
+}
+
+void ExplorerQueryRun(Explorer* explorer)
+{
+    CHESS_ASSERT(explorer);
+    CHESS_ASSERT(ExplorerIsQuerying(explorer));
+
+    ExplorerPosition* result = &explorer->result;
+    u64               key    = explorer->queryKey;
+    f64               start  = ExplorerGetSeconds();
+
+    result->key       = key;
+    result->moveCount = ExplorerLookup(explorer, key, result->moves, EXPLORER_MAX_MOVES, &result->games);
+
+    BoardPosition position;
+    position.Restore(explorer->queryPosition, 0, 0);
+
+    chess::Movelist legalMoves;
+    chess::movegen::legalmoves(legalMoves, position);
+
+    u32 moveCount = 0;
+    for (u32 i = 0; i < result->moveCount; i++)
+    {
+        ExplorerMove move  = result->moves[i];
+        bool         legal = false;
+        for (s32 j = 0; j < legalMoves.size() && !legal; j++)
+        {
+            legal = legalMoves[j].move() == move.move;
+        }
+        if (!legal)
+        {
+            continue;
+        }
+
+        std::string san = chess::uci::moveToSan(position, chess::Move(move.move));
+        snprintf(move.san, EXPLORER_SAN_MAX_LENGTH, "%s", san.c_str());
+        result->moves[moveCount++] = move;
+    }
+    result->moveCount = moveCount;
+    result->isValid   = true;
+    result->seconds   = ExplorerGetSeconds() - start;
+
+    explorer->mailbox.store(EXPLORER_MAILBOX_READY, std::memory_order_release);
+}
+
+bool ExplorerIsQuerying(Explorer* explorer)
+{
+    CHESS_ASSERT(explorer);
+    return explorer->mailbox.load(std::memory_order_acquire) == EXPLORER_MAILBOX_QUERYING;
+}
+
+// Non-blocking, moves a finished query into the cache. True once per query.
+bool ExplorerPollResult(Explorer* explorer)
+{
+    CHESS_ASSERT(explorer);
+
+    bool isReady = explorer->mailbox.load(std::memory_order_acquire) == EXPLORER_MAILBOX_READY;
+    if (isReady)
+    {
+        explorer->cache[explorer->result.key & (EXPLORER_CACHE_SIZE - 1)] = explorer->result;
+        explorer->mailbox.store(EXPLORER_MAILBOX_IDLE, std::memory_order_release);
+    }
+
+    return isReady;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+
+#include "chess_game_logic.h"
+
+// Opening explorer index, read in place from a mapped file
+// ExplorerHeader, a bucket table, then ExplorerEntry records sorted by (key, move). Keys are chess::Board::hash()
+// and each record holds the results of every game in which the move was played from that position. The top
+// bucketBits of a key pick its bucket, buckets[b] is the first entry of bucket b, so a lookup reads one bucket
+// table slot and binary searches a few dozen entries, a page or two of the file whatever its size.
+
+#define EXPLORER_PATH            "../data/explorer.bin"
+#define EXPLORER_MAGIC           0x4C505845 // "EXPL"
+#define EXPLORER_VERSION         1
+#define EXPLORER_BUCKET_ENTRIES  32 // Entries per bucket the builder aims for
+#define EXPLORER_MAX_BUCKET_BITS 22
+#define EXPLORER_MAX_MOVES       16  // Most played moves kept per position
+#define EXPLORER_CACHE_SIZE      256 // Positions, power of two
+#define EXPLORER_SAN_MAX_LENGTH  12  // "Qa1xb2+" with room to spare, null terminated
+
+// Same protocol as the mate solver mailbox, IDLE -> QUERYING on ExplorerQueryStart, QUERYING -> READY when
+// ExplorerQueryRun returns, READY -> IDLE on ExplorerPollResult
+enum
+{
+    EXPLORER_MAILBOX_IDLE,
+    EXPLORER_MAILBOX_QUERYING,
+    EXPLORER_MAILBOX_READY
+};
+
+struct ExplorerHeader
+{
+    u32 magic;
+    u16 version;
+    u16 bucketBits;
+    u64 entryCount;
+    u64 positionCount;
+    u64 gameCount;
+    u64 entriesOffset;
+};
+
+struct ExplorerEntry
+{
+    u64 key;
+    u16 move; // chess::Move encoding
+    u16 reserved;
+    u32 white; // Games won by white
+    u32 draws;
+    u32 black;
+};
+
+struct ExplorerMove
+{
+    u16  move; // chess::Move encoding
+    u32  white;
+    u32  draws;
+    u32  black;
+    char san[EXPLORER_SAN_MAX_LENGTH]; // Only filled by ExplorerQueryRun
+};
+
+// Moves of one position sorted by games played. A query keeps only the moves legal in the queried position, a key
+// collision would show moves of another one, and formats their SAN once so drawing reads them as they are.
+struct ExplorerPosition
+{
+    u64          key;
+    u32          moveCount;
+    bool         isValid;
+    ExplorerMove moves[EXPLORER_MAX_MOVES];
+    u64          games;
+    f64          seconds; // Spent by the lookup
+};
+
+struct Explorer
+{
+    const u8*             content;
+    const ExplorerHeader* header;
+    const u64*            buckets;
+    const ExplorerEntry*  entries;
+    u64                   entryCount;
+
+    // Answered positions, direct mapped on the key
+    ExplorerPosition cache[EXPLORER_CACHE_SIZE];
+
+    std::atomic<u32>   mailbox;
+    u64                queryKey;
+    chess::PackedBoard queryPosition;
+    ExplorerPosition   result;
+};
+
+Explorer*               ExplorerCreate(MemoryArena* arena);
+bool                    ExplorerOpen(Explorer* explorer, const void* content, u64 contentSize);
+u32                     ExplorerLookup(const Explorer* explorer, u64 key, ExplorerMove* moves, u32 maxMoves,
+                                       u64* games);
+const ExplorerPosition* ExplorerGetPosition(const Explorer* explorer, u64 key);
+bool                    ExplorerQueryStart(Explorer* explorer, const chess::Board& position);
+void                    ExplorerQueryRun(Explorer* explorer);
+bool                    ExplorerIsQuerying(Explorer* explorer);
+bool                    ExplorerPollResult(Explorer* explorer);
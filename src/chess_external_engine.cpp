@@ -0,0 +1,326 @@
+#include "chess_external_engine.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <thread>
+
+// Next whitespace separated token of the line, 0 at the end
+chess_internal const char* ExternalEngineNextToken(const char** cursor, u32* length)
+{
+    const char* token = *cursor;
+    while (*token == ' ' || *token == '\t')
+    {
+        token++;
+    }
+
+    const char* end = token;
+    while (*end && *end != ' ' && *end != '\t')
+    {
+        end++;
+    }
+
+    *cursor = end;
+    *length = (u32)(end - token);
+
+    return *length ? token : 0;
+}
+
+chess_internal inline bool ExternalEngineIsToken(const char* token, u32 length, const char* name)
+{
+    return token && strlen(name) == length && memcmp(token, name, length) == 0;
+}
+
+chess_internal inline s64 ExternalEngineNextNumber(const char** cursor)
+{
+    char* end;
+    s64   result = strtoll(*cursor, &end, 10);
+    *cursor      = end;
+
+    return result;
+}
+
+chess_internal inline void ExternalEngineCopyText(ExternalEngineMessage* message, const char* text)
+{
+    while (*text == ' ' || *text == '\t')
+    {
+        text++;
+    }
+
+    u32 length = (u32)strlen(text);
+    if (length >= sizeof(message->text))
+    {
+        length = sizeof(message->text) - 1;
+    }
+    memcpy(message->text, text, length);
+    message->text[length] = '\0';
+}
+
+// Lines the game does not use (option, info string, info currmove...) return false
+bool ExternalEngineParseLine(const char* line, ExternalEngineMessage* message)
+{
+    CHESS_ASSERT(line);
+    CHESS_ASSERT(message);
+
+    memset(message, 0, sizeof(*message));
+
+    const char* cursor = line;
+    u32         length;
+    const char* token = ExternalEngineNextToken(&cursor, &length);
+
+    if (ExternalEngineIsToken(token, length, "uciok"))
+    {
+        message->type = EXTERNAL_ENGINE_MESSAGE_UCIOK;
+        return true;
+    }
+    if (ExternalEngineIsToken(token, length, "readyok"))
+    {
+        message->type = EXTERNAL_ENGINE_MESSAGE_READYOK;
+        return true;
+    }
+    if (ExternalEngineIsToken(token, length, "bestmove"))
+    {
+        token = ExternalEngineNextToken(&cursor, &length);
+        if (!token || length >= UCI_STR_MAX_LENGTH)
+        {
+            return false;
+        }
+        message->type = EXTERNAL_ENGINE_MESSAGE_BESTMOVE;
+        memcpy(message->text, token, length);
+        return true;
+    }
+    if (ExternalEngineIsToken(token, length, "id"))
+    {
+        token = ExternalEngineNextToken(&cursor, &length);
+        if (!ExternalEngineIsToken(token, length, "name"))
+        {
+            return false;
+        }
+        message->type = EXTERNAL_ENGINE_MESSAGE_ID_NAME;
+        ExternalEngineCopyText(message, cursor);
+        return true;
+    }
+    if (!ExternalEngineIsToken(token, length, "info"))
+    {
+        return false;
+    }
+
+    // Only lines with a score are kept, the pv is the rest of the line
+    message->type = EXTERNAL_ENGINE_MESSAGE_INFO;
+    bool hasScore = false;
+    while ((token = ExternalEngineNextToken(&cursor, &length)) != 0)
+    {
+        if (ExternalEngineIsToken(token, length, "string"))
+        {
+            return false;
+        }
+        else if (ExternalEngineIsToken(token, length, "pv"))
+        {
+            ExternalEngineCopyText(message, cursor);
+            break;
+        }
+        else if (ExternalEngineIsToken(token, length, "score"))
+        {
+            token = ExternalEngineNextToken(&cursor, &length);
+            if (ExternalEngineIsToken(token, length, "cp") || ExternalEngineIsToken(token, length, "mate"))
+            {
+                message->isMate = length == 4;
+                message->score  = (s32)ExternalEngineNextNumber(&cursor);
+                hasScore        = true;
+            }
+        }
+        else if (ExternalEngineIsToken(token, length, "depth"))
+        {
+            message->depth = (u32)ExternalEngineNextNumber(&cursor);
+        }
+        else if (ExternalEngineIsToken(token, length, "nodes"))
+        {
+            message->nodes = (u64)ExternalEngineNextNumber(&cursor);
+        }
+        else if (ExternalEngineIsToken(token, length, "nps"))
+        {
+            message->nps = (u64)ExternalEngineNextNumber(&cursor);
+        }
+        else if (ExternalEngineIsToken(token, length, "time"))
+        {
+            message->milliseconds = (u32)ExternalEngineNextNumber(&cursor);
+        }
+    }
+
+    return hasScore;
+}
+
+// Reader side of the ring, returns false when the message was dropped
+chess_internal bool ExternalEnginePush(ExternalEngine* engine, const ExternalEngineMessage* message)
+{
+    u32 writeIndex = engine->writeIndex.load(std::memory_order_relaxed);
+    while (writeIndex - engine->readIndex.load(std::memory_order_acquire) == EXTERNAL_ENGINE_RING_SIZE)
+    {
+        if (message->type == EXTERNAL_ENGINE_MESSAGE_INFO || engine->cancel->load(std::memory_order_relaxed) ||
+            engine->stopReader.load(std::memory_order_relaxed))
+        {
+            engine->droppedInfos.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    engine->messages[writeIndex & (EXTERNAL_ENGINE_RING_SIZE - 1)] = *message;
+    engine->writeIndex.store(writeIndex + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Runs on the IO queue until the engine closes its output, the game stops the reader or the code is reloaded
+void ExternalEngineRead(ExternalEngine* engine)
+{
+    CHESS_ASSERT(engine);
+
+    char buffer[4096];
+    while (!engine->cancel->load(std::memory_order_relaxed) && !engine->stopReader.load(std::memory_order_relaxed))
+    {
+        s32 size = engine->ProcessRead(engine->process, buffer, sizeof(buffer), EXTERNAL_ENGINE_READ_TIMEOUT_MS);
+        if (size < 0)
+        {
+            engine->isClosed.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        f64 seconds = size > 0 ? engine->TimerGetTicks() : 0.0;
+        for (s32 i = 0; i < size; i++)
+        {
+            char c = buffer[i];
+            if (c != '\n' && c != '\r')
+            {
+                // Overlong lines are cut, the tail is not worth a bigger buffer
+                if (engine->lineLength < EXTERNAL_ENGINE_LINE_MAX - 1)
+                {
+                    engine->line[engine->lineLength++] = c;
+                }
+                continue;
+            }
+            if (engine->lineLength == 0)
+            {
+                continue;
+            }
+
+            engine->line[engine->lineLength] = '\0';
+            engine->lineLength               = 0;
+
+            ExternalEngineMessage message;
+            if (ExternalEngineParseLine(engine->line, &message))
+            {
+                message.receivedSeconds = seconds;
+                ExternalEnginePush(engine, &message);
+            }
+        }
+    }
+
+    engine->isReaderRunning.store(false, std::memory_order_release);
+}
+
+chess_internal PLATFORM_WORK_QUEUE_CALLBACK(ExternalEngineReadWork)
+{
+    ExternalEngineRead((ExternalEngine*)data);
+}
+
+// Null when the command can not be started
+ExternalEngine* ExternalEngineStart(MemoryArena* arena, GameMemory* memory, const char* commandLine)
+{
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(memory);
+    CHESS_ASSERT(commandLine);
+
+    PlatformProcess* process = memory->platform.ProcessStart(commandLine);
+    if (!process)
+    {
+        return 0;
+    }
+
+    ExternalEngine* result =
+        new (ArenaPushSize(arena, sizeof(ExternalEngine), alignof(ExternalEngine))) ExternalEngine();
+    result->process       = process;
+    result->ProcessRead   = memory->platform.ProcessRead;
+    result->TimerGetTicks = memory->platform.TimerGetTicks;
+    result->cancel        = &memory->cancelWork;
+
+    ExternalEngineSend(result, memory, "uci\nisready\n");
+    ExternalEngineUpdate(result, memory);
+
+    return result;
+}
+
+// Blocks until the reader returns, at most one read timeout
+void ExternalEngineStop(ExternalEngine* engine, GameMemory* memory)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(memory);
+
+    ExternalEngineSend(engine, memory, "quit\n");
+    engine->stopReader.store(true, std::memory_order_relaxed);
+    while (engine->isReaderRunning.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+
+    memory->platform.ProcessStop(engine->process);
+    engine->process = 0;
+    engine->isClosed.store(true, std::memory_order_relaxed);
+}
+
+// Once per frame: restarts the reader after a game code reload cancelled it
+void ExternalEngineUpdate(ExternalEngine* engine, GameMemory* memory)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(memory);
+
+    if (!engine->isReaderRunning.load(std::memory_order_acquire) && !engine->isClosed.load(std::memory_order_relaxed))
+    {
+        engine->isReaderRunning.store(true, std::memory_order_relaxed);
+        memory->platform.WorkQueueAddEntry(memory->ioQueue, ExternalEngineReadWork, engine);
+    }
+}
+
+// Commands are short, a full pipe means the engine stopped reading
+bool ExternalEngineSend(ExternalEngine* engine, GameMemory* memory, const char* format, ...)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(memory);
+
+    if (!engine->process)
+    {
+        return false;
+    }
+
+    char    buffer[EXTERNAL_ENGINE_LINE_MAX * 4];
+    va_list args;
+    va_start(args, format);
+    s32 length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    bool result = length > 0 && length < (s32)sizeof(buffer) &&
+                  memory->platform.ProcessWrite(engine->process, buffer, (u32)length);
+    if (!result)
+    {
+        memory->platform.Log("GAME unable to write to the external engine");
+    }
+
+    return result;
+}
+
+// Game thread side of the ring, false when it is empty
+bool ExternalEnginePoll(ExternalEngine* engine, ExternalEngineMessage* message)
+{
+    CHESS_ASSERT(engine);
+    CHESS_ASSERT(message);
+
+    u32 readIndex = engine->readIndex.load(std::memory_order_relaxed);
+    if (readIndex == engine->writeIndex.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    *message = engine->messages[readIndex & (EXTERNAL_ENGINE_RING_SIZE - 1)];
+    engine->readIndex.store(readIndex + 1, std::memory_order_release);
+
+    return true;
+}
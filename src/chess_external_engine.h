@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+
+#include "chess_platform.h"
+
+// Any UCI engine binary as the opponent or the analyzer. The platform spawns it with its standard input and
+// output on pipes, a reader entry on the IO queue parses its output into messages and pushes them to a single
+// producer, single consumer ring. The game thread sends commands and drains the ring once per frame, so a burst of
+// engine output costs the frame one pass over the ring at most.
+
+#define EXTERNAL_ENGINE_PATH            "../data/engine.txt" // Command line of the engine, first line
+#define EXTERNAL_ENGINE_RING_SIZE       1024                 // Power of two
+#define EXTERNAL_ENGINE_LINE_MAX        2048
+#define EXTERNAL_ENGINE_PV_MAX          128
+#define EXTERNAL_ENGINE_NAME_MAX        64
+#define EXTERNAL_ENGINE_READ_TIMEOUT_MS 10
+
+enum
+{
+    EXTERNAL_ENGINE_MESSAGE_ID_NAME,
+    EXTERNAL_ENGINE_MESSAGE_UCIOK,
+    EXTERNAL_ENGINE_MESSAGE_READYOK,
+    EXTERNAL_ENGINE_MESSAGE_INFO,
+    EXTERNAL_ENGINE_MESSAGE_BESTMOVE
+};
+
+// Parsed on the reader thread, moves stay text because only the game thread knows the position
+struct ExternalEngineMessage
+{
+    u32  type;
+    u32  depth;
+    s32  score; // Side to move point of view, centipawns or moves to mate
+    bool isMate;
+    u64  nodes;
+    u64  nps;
+    u32  milliseconds;
+    f64  receivedSeconds;              // Platform timer when the reader parsed the line
+    char text[EXTERNAL_ENGINE_PV_MAX]; // Principal variation, best move or engine name
+};
+
+struct ExternalEngine
+{
+    PlatformProcess* process;
+
+    // Platform entry points for the reader entry, they stay valid across game code reloads
+    PlatformProcessReadFunc*   ProcessRead;
+    PlatformTimerGetTicksFunc* TimerGetTicks;
+    const std::atomic<bool>*   cancel;
+
+    std::atomic<bool> isReaderRunning;
+    std::atomic<bool> stopReader;
+    std::atomic<bool> isClosed;
+
+    // Reader only, the line being assembled across reads
+    char line[EXTERNAL_ENGINE_LINE_MAX];
+    u32  lineLength;
+
+    // Info lines are dropped when the ring is full, the other messages wait for room
+    alignas(64) std::atomic<u32> writeIndex;
+    alignas(64) std::atomic<u32> readIndex;
+    std::atomic<u64>             droppedInfos;
+    ExternalEngineMessage        messages[EXTERNAL_ENGINE_RING_SIZE];
+
+    // Game thread only
+    char                  name[EXTERNAL_ENGINE_NAME_MAX];
+    bool                  isSearching;
+    bool                  isInfinite;
+    bool                  isStopSent;
+    u64                   searchKey;
+    ExternalEngineMessage info; // Last info of the running search
+};
+
+ExternalEngine* ExternalEngineStart(MemoryArena* arena, GameMemory* memory, const char* commandLine);
+void            ExternalEngineStop(ExternalEngine* engine, GameMemory* memory);
+void            ExternalEngineUpdate(ExternalEngine* engine, GameMemory* memory);
+bool            ExternalEngineSend(ExternalEngine* engine, GameMemory* memory, const char* format, ...);
+bool            ExternalEnginePoll(ExternalEngine* engine, ExternalEngineMessage* message);
+bool            ExternalEngineParseLine(const char* line, ExternalEngineMessage* message);
+void            ExternalEngineRead(ExternalEngine* engine);
@@ -1,22 +1,542 @@
-#include <Disservin/chess.hpp>
-
 #define CELL_INDEX(row, col)       (col + row * 8)
 #define CELL_ROW(index)            (index / 8)
 #define CELL_COL(index)            (index % 8)
+#define CELL_BIT(index)            (1ULL << (index))
 #define VALIDATE_CELL_INDEX(index) CHESS_ASSERT(index >= 0 && index <= 63)
 
 #define DEFAULT_FEN_STRING "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
-chess_internal inline u32                 GetInternalMoveType(chess::Board& _board, chess::Move& _move);
-chess_internal inline chess::PieceGenType GetExternalPieceGenType(chess::PieceType _pieceType);
-chess_internal inline chess::Board        GetExternalBoard(Board* board);
+chess_internal inline u32               GetInternalMoveType(chess::Move _move, chess::Piece _captured);
+chess_internal inline Move              GetInternalMove(chess::Move _move, chess::Piece _captured);
+chess_internal inline u32               GetInternalColor(chess::Color _color);
+chess_internal inline u32               GetInternalGameResult(chess::GameResult _gameResult, chess::Color _color);
+chess_internal inline chess::GameResult GetExternalGameResult(Board* board, u32 moveCount);
+chess_internal inline u64               CellsBetween(u32 fromCell, u32 toCell);
+chess_internal void                     MoveGenMasksCompute(const chess::Board& _board, MoveGenMasks* masks);
+chess_internal u64                      GetAttackedCells(const chess::Board& _board, u32 kingCell);
+chess_internal u32                      GenerateCellMoves(const chess::Board& _board, const MoveGenMasks* masks,
+                                                          u32 cellIndex, Move* moves);
+chess_internal void                     BoardUpdatePositionInfo(Board* board);
+chess_internal void                     BoardHistoryStartAt(Board* board);
+chess_internal bool                     BoardPackedIsValid(const chess::PackedBoard& packed);
+chess_internal inline u32               BoardHistoryKeyframeCount(u32 plyCount);
+
+void BoardPosition::MoveDo(chess::Move move, BoardHistoryEntry* entry)
+{
+    CHESS_ASSERT(entry);
+
+    chess::Piece _captured = move.typeOf() == chess::Move::CASTLING ? chess::Piece(chess::Piece::NONE) : at(move.to());
+
+    entry->move      = move.move();
+    entry->captured  = (u8)_captured.internal();
+    entry->castling  = (u8)cr_.hashIndex();
+    entry->enpassant = (u8)ep_sq_.index();
+    entry->halfMoves = hfm_;
+
+    makeMove(move);
+
+    // The entry already holds the undo state, keep chess::Board state stack empty so it never grows
+    prev_states_.clear();
+}
+
+void BoardPosition::MoveUndo(const BoardHistoryEntry* entry, u64 key)
+{
+    CHESS_ASSERT(entry);
+
+    // Castling rights are stored as KQkq bits, files are always the standard ones
+    CastlingRights _castling;
+    _castling.clear();
+    if (entry->castling & 1)
+    {
+        _castling.setCastlingRight(chess::Color::WHITE, CastlingRights::Side::KING_SIDE, chess::File::FILE_H);
+    }
+    if (entry->castling & 2)
+    {
+        _castling.setCastlingRight(chess::Color::WHITE, CastlingRights::Side::QUEEN_SIDE, chess::File::FILE_A);
+    }
+    if (entry->castling & 4)
+    {
+        _castling.setCastlingRight(chess::Color::BLACK, CastlingRights::Side::KING_SIDE, chess::File::FILE_H);
+    }
+    if (entry->castling & 8)
+    {
+        _castling.setCastlingRight(chess::Color::BLACK, CastlingRights::Side::QUEEN_SIDE, chess::File::FILE_A);
+    }
+
+    chess::Piece  _captured((chess::Piece::underlying)entry->captured);
+    chess::Square _enpassant((int)entry->enpassant);
+
+    prev_states_.emplace_back(key, _castling, _enpassant, entry->halfMoves, _captured);
+    unmakeMove(chess::Move(entry->move));
+}
+
+// Packed boards do not store the move counters, and chess::Board::Compact::decode leaves the castling paths empty
+void BoardPosition::Restore(const chess::PackedBoard& packed, u8 halfMoves, u32 plies)
+{
+    chess::Board::operator=(chess::Board::Compact::decode(packed));
+    hfm_   = halfMoves;
+    plies_ = (u16)plies;
+
+    // Standard chess only, cells between king and rook
+    castling_path[0][1] = chess::Bitboard(CELL_BIT(5) | CELL_BIT(6));
+    castling_path[0][0] = chess::Bitboard(CELL_BIT(1) | CELL_BIT(2) | CELL_BIT(3));
+    castling_path[1][1] = chess::Bitboard(CELL_BIT(61) | CELL_BIT(62));
+    castling_path[1][0] = chess::Bitboard(CELL_BIT(57) | CELL_BIT(58) | CELL_BIT(59));
+}
+
+// Initial position is always stored as keyframes[0], restoring a history never needs the FEN
+chess_internal void BoardHistoryStartAt(Board* board)
+{
+    BoardHistory* history  = &board->history;
+    history->count         = 0;
+    history->length        = 0;
+    history->rootPlies     = board->position->GetPlies();
+    history->rootHalfMoves = (u8)board->position->halfMoveClock();
+    history->keyframes[0]  = chess::Board::Compact::encode(*board->position);
+}
+
+chess_internal inline u32 BoardHistoryKeyframeCount(u32 plyCount)
+{
+    return plyCount == 0 ? 1 : (plyCount - 1) / BOARD_HISTORY_KEYFRAME_INTERVAL + 1;
+}
+
+// Bytes BoardInit takes from the arena, alignment padding included
+u64 BoardArenaSize(u32 maxPlies)
+{
+    return (sizeof(BoardHistoryEntry) + sizeof(u64)) * maxPlies +
+           sizeof(chess::PackedBoard) * BoardHistoryKeyframeCount(maxPlies) + sizeof(BoardPosition) + 4 * 64;
+}
+
+// Board memory lives in permanentStorage and is never constructed, so the position is created in place
+void BoardInit(Board* board, const char* fen, MemoryArena* arena, u32 maxPlies)
+{
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(maxPlies > 1 && maxPlies <= BOARD_HISTORY_MAX_PLIES);
+
+    BoardHistory* history = &board->history;
+    history->entries      = ARENA_PUSH_ARRAY(arena, BoardHistoryEntry, maxPlies);
+    history->keys         = ARENA_PUSH_ARRAY(arena, u64, maxPlies);
+    history->keyframes    = ARENA_PUSH_ARRAY(arena, chess::PackedBoard, BoardHistoryKeyframeCount(maxPlies));
+    history->maxPlies     = maxPlies;
+
+    board->position = ARENA_PUSH_ARRAY(arena, BoardPosition, 1);
+    new (board->position) BoardPosition(fen);
+
+    BoardHistoryStartAt(board);
+    BoardUpdatePositionInfo(board);
+}
+
+// chess::Board::setFen takes most malformed strings and asserts later on a missing king, so the piece placement
+// is checked first: eight ranks, eight files each and one king per side
+chess_internal bool BoardFenIsValid(const char* fen)
+{
+    u32 ranks      = 1;
+    u32 files      = 0;
+    u32 whiteKings = 0;
+    u32 blackKings = 0;
+    for (; *fen && *fen != ' '; fen++)
+    {
+        char c = *fen;
+        if (c == '/')
+        {
+            if (files != 8)
+            {
+                return false;
+            }
+            ranks++;
+            files = 0;
+        }
+        else if (c >= '1' && c <= '8')
+        {
+            files += c - '0';
+        }
+        else if (strchr("pnbrqkPNBRQK", c))
+        {
+            files++;
+            whiteKings += c == 'K';
+            blackKings += c == 'k';
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return ranks == 8 && files == 8 && whiteKings == 1 && blackKings == 1;
+}
+
+// Every FEN from a file goes through here, loaders with a bare chess::Board call it directly.
+// False when the placement is malformed or the side that just moved is left in check, the searches and the move
+// generator would capture the king. The position is undefined then.
+bool BoardPositionSetFen(chess::Board* position, const char* fen)
+{
+    CHESS_ASSERT(position);
+    CHESS_ASSERT(fen);
+
+    if (!BoardFenIsValid(fen) || !position->setFen(fen))
+    {
+        return false;
+    }
+
+    chess::Color sideToMove = position->sideToMove();
+    return !position->isAttacked(position->kingSq(~sideToMove), sideToMove);
+}
+
+// A FEN that does not parse, from a PGN tag for instance, resets to the initial position and returns false
+bool BoardReset(Board* board, const char* fen)
+{
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(fen);
+
+    BoardPosition* position = board->position;
+    bool           validFen = BoardPositionSetFen(position, fen);
+    if (!validFen)
+    {
+        position->setFen(chess::constants::STARTPOS);
+    }
+
+    BoardHistoryStartAt(board);
+    BoardUpdatePositionInfo(board);
+
+    return validFen;
+}
+
+// chess::Board is polymorphic, after a game code reload its vtable pointer references the unloaded module.
+// Move the position into a new object constructed by the current module.
+void BoardReload(Board* board)
+{
+    CHESS_ASSERT(board);
+
+    BoardPosition _position = std::move(*board->position);
+    new (board->position) BoardPosition(std::move(_position));
+}
+
+// Entries, keys and keyframes of the plies played so far, packed back to back
+u64 BoardHistorySnapshotSize(u32 plyCount)
+{
+    return (sizeof(BoardHistoryEntry) + sizeof(u64)) * plyCount +
+           sizeof(chess::PackedBoard) * BoardHistoryKeyframeCount(plyCount);
+}
+
+void BoardHistorySnapshot(Board* board, void* buffer)
+{
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(buffer);
+
+    BoardHistory* history = &board->history;
+    u8*           cursor  = (u8*)buffer;
+
+    memcpy(cursor, history->entries, sizeof(BoardHistoryEntry) * history->count);
+    cursor += sizeof(BoardHistoryEntry) * history->count;
+    memcpy(cursor, history->keys, sizeof(u64) * history->count);
+    cursor += sizeof(u64) * history->count;
+    memcpy(cursor, history->keyframes, sizeof(chess::PackedBoard) * BoardHistoryKeyframeCount(history->count));
+}
+
+// Board memory has been copied in, but the live position still reflects the old one.
+// Starts from the last keyframe before the current ply and replays at most BOARD_HISTORY_KEYFRAME_INTERVAL moves.
+void BoardHistoryRestore(Board* board, const void* buffer, u32 plyCount)
+{
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(buffer);
+    CHESS_ASSERT(plyCount < board->history.maxPlies);
+
+    BoardHistory* history = &board->history;
+    const u8*     cursor  = (const u8*)buffer;
+
+    memcpy(history->entries, cursor, sizeof(BoardHistoryEntry) * plyCount);
+    cursor += sizeof(BoardHistoryEntry) * plyCount;
+    memcpy(history->keys, cursor, sizeof(u64) * plyCount);
+    cursor += sizeof(u64) * plyCount;
+    memcpy(history->keyframes, cursor, sizeof(chess::PackedBoard) * BoardHistoryKeyframeCount(plyCount));
+    history->count  = plyCount;
+    history->length = plyCount;
+
+    u32 keyframe  = BoardHistoryKeyframeCount(plyCount) - 1;
+    u32 ply       = keyframe * BOARD_HISTORY_KEYFRAME_INTERVAL;
+    u8  halfMoves = ply < plyCount ? history->entries[ply].halfMoves : history->rootHalfMoves;
+    board->position->Restore(history->keyframes[keyframe], halfMoves, history->rootPlies + ply);
+
+    for (; ply < plyCount; ply++)
+    {
+        board->position->MoveDo(chess::Move(history->entries[ply].move), &history->entries[ply]);
+    }
+
+    BoardUpdatePositionInfo(board);
+}
+
+// chess::Board::Compact::decode asserts on more than two castling rooks a side and on castling rights without a
+// king, the nibbles are checked first. A packed board that does not encode back to itself is rejected as well.
+chess_internal bool BoardPackedIsValid(const chess::PackedBoard& packed)
+{
+    u64 occupied = 0;
+    for (u32 i = 0; i < 8; i++)
+    {
+        occupied |= (u64)packed[i] << (56 - i * 8);
+    }
+
+    u32 pieceCount = (u32)chess::Bitboard(occupied).count();
+    if (pieceCount > 32)
+    {
+        return false;
+    }
+
+    u32 whiteKings   = 0;
+    u32 blackKings   = 0;
+    u32 whiteCastles = 0;
+    u32 blackCastles = 0;
+    for (u32 offset = 16; offset < 16 + pieceCount; offset++)
+    {
+        u32 nibble = (packed[offset / 2] >> (offset % 2 == 0 ? 4 : 0)) & 0xF;
+        whiteKings += nibble == 5;
+        blackKings += nibble == 11 || nibble == 15;
+        whiteCastles += nibble == 13;
+        blackCastles += nibble == 14;
+    }
+    if (whiteKings != 1 || blackKings != 1 || whiteCastles > 2 || blackCastles > 2)
+    {
+        return false;
+    }
+
+    chess::PackedBoard encoded = chess::Board::Compact::encode(chess::Board::Compact::decode(packed));
+    return memcmp(&encoded, &packed, sizeof(chess::PackedBoard)) == 0;
+}
+
+// Snapshot read from a file, replayed from keyframes[0] before BoardHistoryRestore trusts it: every move must be
+// legal in its position and the stored entries, keys and keyframes must match the ones the replay produces.
+bool BoardHistoryIsValid(const void* buffer, u32 plyCount, u32 rootPlies, u8 rootHalfMoves)
+{
+    CHESS_ASSERT(buffer);
+
+    if (plyCount >= BOARD_HISTORY_MAX_PLIES)
+    {
+        return false;
+    }
+
+    const BoardHistoryEntry*  entries   = (const BoardHistoryEntry*)buffer;
+    const u64*                keys      = (const u64*)(entries + plyCount);
+    const chess::PackedBoard* keyframes = (const chess::PackedBoard*)(keys + plyCount);
+
+    // The buffer comes straight from the file, no alignment can be assumed
+    chess::PackedBoard keyframe;
+    memcpy(&keyframe, &keyframes[0], sizeof(chess::PackedBoard));
+    if (!BoardPackedIsValid(keyframe))
+    {
+        return false;
+    }
+
+    BoardPosition position;
+    position.Restore(keyframe, rootHalfMoves, rootPlies);
+
+    for (u32 ply = 0; ply < plyCount; ply++)
+    {
+        BoardHistoryEntry entry;
+        u64               key;
+        memcpy(&entry, &entries[ply], sizeof(BoardHistoryEntry));
+        memcpy(&key, &keys[ply], sizeof(u64));
+
+        if (ply % BOARD_HISTORY_KEYFRAME_INTERVAL == 0)
+        {
+            memcpy(&keyframe, &keyframes[ply / BOARD_HISTORY_KEYFRAME_INTERVAL], sizeof(chess::PackedBoard));
+            chess::PackedBoard encoded = chess::Board::Compact::encode(position);
+            if (memcmp(&encoded, &keyframe, sizeof(chess::PackedBoard)) != 0)
+            {
+                return false;
+            }
+        }
+        if (position.hash() != key)
+        {
+            return false;
+        }
+
+        chess::Move  _move(entry.move);
+        MoveGenMasks masks;
+        Move         moves[PIECE_MOVE_LIST_MAX];
+        MoveGenMasksCompute(position, &masks);
+        u32 moveCount = GenerateCellMoves(position, &masks, (u32)_move.from().index(), moves);
+        u32 moveIndex = 0;
+        for (; moveIndex < moveCount && moves[moveIndex].data != entry.move; moveIndex++)
+        {
+        }
+        if (moveIndex == moveCount)
+        {
+            return false;
+        }
+
+        BoardHistoryEntry replayed;
+        position.MoveDo(_move, &replayed);
+        if (memcmp(&replayed, &entry, sizeof(BoardHistoryEntry)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Same bookkeeping as BoardMoveDo without the position info, for loaders writing a whole game at once.
+// The info is stale until the next BoardSeek.
+// False and nothing played when the history is full
+bool BoardHistoryAppend(Board* board, chess::Move move)
+{
+    CHESS_ASSERT(board);
+
+    BoardHistory* history = &board->history;
+    if (history->count + 1 >= history->maxPlies)
+    {
+        return false;
+    }
+
+    if (history->count % BOARD_HISTORY_KEYFRAME_INTERVAL == 0)
+    {
+        history->keyframes[history->count / BOARD_HISTORY_KEYFRAME_INTERVAL] =
+            chess::Board::Compact::encode(*board->position);
+    }
+
+    history->keys[history->count] = board->position->hash();
+    board->position->MoveDo(move, &history->entries[history->count]);
+    history->count++;
+    history->length = history->count;
+
+    return true;
+}
+
+// Any ply up to the history length. Steps from the current ply when it is the shorter way, otherwise starts at
+// the last keyframe before 'ply', at most BOARD_HISTORY_KEYFRAME_INTERVAL moves are replayed either way.
+void BoardSeek(Board* board, u32 ply)
+{
+    CHESS_ASSERT(board);
+
+    BoardHistory* history = &board->history;
+    CHESS_ASSERT(ply <= history->length);
+
+    u32 keyframe = ply / BOARD_HISTORY_KEYFRAME_INTERVAL;
+    if (keyframe >= BoardHistoryKeyframeCount(history->length))
+    {
+        keyframe = BoardHistoryKeyframeCount(history->length) - 1;
+    }
+    u32 start = keyframe * BOARD_HISTORY_KEYFRAME_INTERVAL;
+
+    if (ply < history->count && history->count - ply <= ply - start)
+    {
+        for (; history->count > ply; history->count--)
+        {
+            board->position->MoveUndo(&history->entries[history->count - 1], history->keys[history->count - 1]);
+        }
+    }
+    else
+    {
+        if (ply < history->count || history->count < start)
+        {
+            u8 halfMoves = start < history->length ? history->entries[start].halfMoves : history->rootHalfMoves;
+            board->position->Restore(history->keyframes[keyframe], halfMoves, history->rootPlies + start);
+            history->count = start;
+        }
+        for (; history->count < ply; history->count++)
+        {
+            board->position->MoveDo(chess::Move(history->entries[history->count].move),
+                                    &history->entries[history->count]);
+        }
+    }
+
+    BoardUpdatePositionInfo(board);
+}
 
-Board BoardCreate(const char* fen)
+// 'buffer' must hold at least FEN_STR_MAX_LENGTH characters. Same text as chess::Board::getFen, written in place
+// so a frame asking for it does not allocate.
+void BoardGetFen(Board* board, char* buffer)
 {
-    Board        board;
-    Board::Delta state{ Move{}, fen };
-    board.deltas.push(state);
-    return board;
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(buffer);
+
+    const BoardPosition& _position = *board->position;
+
+    u32 length = 0;
+    for (s32 rank = 7; rank >= 0; rank--)
+    {
+        u32 emptyCells = 0;
+        for (s32 file = 0; file < 8; file++)
+        {
+            chess::Piece _piece = _position.at(chess::Square(rank * 8 + file));
+            if (_piece == chess::Piece::NONE)
+            {
+                emptyCells++;
+                continue;
+            }
+            if (emptyCells)
+            {
+                buffer[length++] = (char)('0' + emptyCells);
+                emptyCells       = 0;
+            }
+            buffer[length++] = "PNBRQKpnbrqk"[(u32)_piece.internal()];
+        }
+        if (emptyCells)
+        {
+            buffer[length++] = (char)('0' + emptyCells);
+        }
+        if (rank > 0)
+        {
+            buffer[length++] = '/';
+        }
+    }
+
+    buffer[length++] = ' ';
+    buffer[length++] = _position.sideToMove() == chess::Color::WHITE ? 'w' : 'b';
+    buffer[length++] = ' ';
+
+    chess::Board::CastlingRights _castling = _position.castlingRights();
+    if (_castling.isEmpty())
+    {
+        buffer[length++] = '-';
+    }
+    else
+    {
+        const char* rights = "KQkq";
+        for (u32 i = 0; i < 4; i++)
+        {
+            chess::Color side = i < 2 ? chess::Color::WHITE : chess::Color::BLACK;
+            if (_castling.has(side, (i & 1) ? chess::Board::CastlingRights::Side::QUEEN_SIDE
+                                            : chess::Board::CastlingRights::Side::KING_SIDE))
+            {
+                buffer[length++] = rights[i];
+            }
+        }
+    }
+
+    chess::Square _enpassant = _position.enpassantSq();
+    buffer[length++]         = ' ';
+    if (_enpassant == chess::Square::NO_SQ)
+    {
+        buffer[length++] = '-';
+    }
+    else
+    {
+        buffer[length++] = (char)('a' + _enpassant.index() % 8);
+        buffer[length++] = (char)('1' + _enpassant.index() / 8);
+    }
+
+    u32 counters[2] = { (u32)_position.halfMoveClock(), (u32)_position.fullMoveNumber() };
+    for (u32 i = 0; i < 2; i++)
+    {
+        char digits[10];
+        u32  digitCount = 0;
+        u32  value      = counters[i];
+        do
+        {
+            digits[digitCount++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        buffer[length++] = ' ';
+        while (digitCount)
+        {
+            buffer[length++] = digits[--digitCount];
+        }
+    }
+
+    CHESS_ASSERT(length < FEN_STR_MAX_LENGTH);
+    buffer[length] = '\0';
 }
 
 Piece BoardGetPiece(Board* board, u32 cellIndex)
@@ -24,54 +544,550 @@ Piece BoardGetPiece(Board* board, u32 cellIndex)
     CHESS_ASSERT(board);
     VALIDATE_CELL_INDEX(cellIndex);
 
-    Piece result;
-    result.cellIndex = cellIndex;
+    Piece result;
+    result.cellIndex = cellIndex;
+
+    chess::Piece _piece = board->position->at(cellIndex);
+
+    switch (_piece.type().internal())
+    {
+    case chess::PieceType::PAWN:
+    {
+        result.type = PIECE_TYPE_PAWN;
+        break;
+    }
+    case chess::PieceType::BISHOP:
+    {
+        result.type = PIECE_TYPE_BISHOP;
+        break;
+    }
+    case chess::PieceType::KNIGHT:
+    {
+        result.type = PIECE_TYPE_KNIGHT;
+        break;
+    }
+    case chess::PieceType::ROOK:
+    {
+        result.type = PIECE_TYPE_ROOK;
+        break;
+    }
+
+    case chess::PieceType::KING:
+    {
+        result.type = PIECE_TYPE_KING;
+        break;
+    }
+    case chess::PieceType::QUEEN:
+    {
+        result.type = PIECE_TYPE_QUEEN;
+        break;
+    }
+    case chess::PieceType::NONE:
+    {
+        result.type = PIECE_TYPE_NONE;
+        break;
+    }
+    default:
+    {
+        CHESS_ASSERT(0);
+    }
+    }
+
+    if (_piece.color() == chess::Color::WHITE)
+    {
+        result.color = PIECE_COLOR_WHITE;
+    }
+    else
+    {
+        result.color = PIECE_COLOR_BLACK;
+    }
+
+    return result;
+}
+
+chess_internal inline u32 GetInternalMoveType(chess::Move _move, chess::Piece _captured)
+{
+    u32 result;
+
+    switch (_move.typeOf())
+    {
+    case chess::Move::ENPASSANT:
+    {
+        result = MOVE_TYPE_ENPASSANT;
+        break;
+    }
+    case chess::Move::PROMOTION:
+    {
+        result = MOVE_TYPE_PROMOTION;
+        break;
+    }
+    case chess::Move::CASTLING:
+    {
+        result = MOVE_TYPE_CASTLING;
+        break;
+    }
+    default:
+    {
+        // CAPTURE
+        if (_captured != chess::Piece::NONE)
+        {
+            result = MOVE_TYPE_CAPTURE;
+        }
+        else
+        {
+            result = MOVE_TYPE_NORMAL;
+        }
+
+        break;
+    }
+    }
+
+    return result;
+}
+
+chess_internal inline Move GetInternalMove(chess::Move _move, chess::Piece _captured)
+{
+    Move move;
+    move.from = (u32)_move.from().index();
+    move.to   = (u32)_move.to().index();
+    move.type = GetInternalMoveType(_move, _captured);
+    move.data = _move.move();
+
+    // chess::Move encodes castling as king captures rook, the board shows the king destination
+    if (move.type == MOVE_TYPE_CASTLING)
+    {
+        u32  cellCount = (u32)Max(move.from, move.to) - (u32)Min(move.from, move.to);
+        bool white     = CELL_ROW(move.from) == 0;
+        CHESS_ASSERT(cellCount == 4 || cellCount == 3);
+
+        // Long-castling
+        if (cellCount == 4)
+        {
+            if (white)
+            {
+                move.to = 2;
+            }
+            else
+            {
+                move.to = 58;
+            }
+        }
+        // Sort-castling
+        else if (cellCount == 3)
+        {
+            if (white)
+            {
+                move.to = 6;
+            }
+            else
+            {
+                move.to = 62;
+            }
+        }
+    }
+
+    return move;
+}
+
+chess_internal inline u32 GetInternalColor(chess::Color _color)
+{
+    u32 color = PIECE_COLOR_NONE;
+
+    switch (_color.internal())
+    {
+    case chess::Color::WHITE:
+    {
+        color = PIECE_COLOR_WHITE;
+        break;
+    }
+    case chess::Color::BLACK:
+    {
+        color = PIECE_COLOR_BLACK;
+        break;
+    }
+    case chess::Color::NONE:
+    {
+        color = PIECE_COLOR_NONE;
+        break;
+    }
+    default:
+    {
+        CHESS_ASSERT(0);
+    }
+    }
+
+    return color;
+}
+
+chess_internal inline u32 GetInternalGameResult(chess::GameResult _gameResult, chess::Color _color)
+{
+    u32 result;
+
+    switch (_gameResult)
+    {
+    case chess::GameResult::WIN:
+    {
+        if (_color == chess::Color::WHITE)
+        {
+            result = BOARD_GAME_RESULT_WIN;
+        }
+        else
+        {
+            result = BOARD_GAME_RESULT_LOSE;
+        }
+        break;
+    }
+    case chess::GameResult::LOSE:
+    {
+        if (_color == chess::Color::WHITE)
+        {
+            result = BOARD_GAME_RESULT_LOSE;
+        }
+        else
+        {
+            result = BOARD_GAME_RESULT_WIN;
+        }
+        break;
+    }
+    case chess::GameResult::DRAW:
+    {
+        result = BOARD_GAME_RESULT_DRAW;
+        break;
+    }
+    case chess::GameResult::NONE:
+    {
+        result = BOARD_GAME_RESULT_NONE;
+        break;
+    }
+    default:
+    {
+        CHESS_ASSERT(0);
+    }
+    }
+
+    return result;
+}
+
+// Same rules as chess::Board::isGameOver, reusing the legal moves already generated for the position
+chess_internal inline chess::GameResult GetExternalGameResult(Board* board, u32 moveCount)
+{
+    chess::Board&     _board = *board->position;
+    chess::GameResult _result;
+
+    if (_board.isHalfMoveDraw())
+    {
+        bool checkmate = moveCount == 0 && _board.inCheck();
+        _result        = checkmate ? chess::GameResult::LOSE : chess::GameResult::DRAW;
+    }
+    else if (_board.isInsufficientMaterial() || BoardIsRepetition(board))
+    {
+        _result = chess::GameResult::DRAW;
+    }
+    else if (moveCount == 0)
+    {
+        _result = _board.inCheck() ? chess::GameResult::LOSE : chess::GameResult::DRAW;
+    }
+    else
+    {
+        _result = chess::GameResult::NONE;
+    }
+
+    return _result;
+}
+
+// Cells between two cells on the same line, 'toCell' included
+chess_internal inline u64 CellsBetween(u32 fromCell, u32 toCell)
+{
+    chess::Square   _from((int)fromCell);
+    chess::Square   _to((int)toCell);
+    chess::Bitboard _fromBit(CELL_BIT(fromCell));
+    chess::Bitboard _toBit(CELL_BIT(toCell));
+
+    u64 result = CELL_BIT(toCell);
+
+    chess::Bitboard _rook = chess::attacks::rook(_from, _toBit);
+    if (_rook & _toBit)
+    {
+        result |= (_rook & chess::attacks::rook(_to, _fromBit)).getBits();
+    }
+    else
+    {
+        chess::Bitboard _bishop = chess::attacks::bishop(_from, _toBit);
+        if (_bishop & _toBit)
+        {
+            result |= (_bishop & chess::attacks::bishop(_to, _fromBit)).getBits();
+        }
+    }
+
+    return result;
+}
+
+chess_internal void MoveGenMasksCompute(const chess::Board& _board, MoveGenMasks* masks)
+{
+    CHESS_ASSERT(masks);
+
+    chess::Color  _us   = _board.sideToMove();
+    chess::Color  _them = ~_us;
+    chess::Square _king = _board.kingSq(_us);
+
+    u64 usCells       = _board.us(_us).getBits();
+    u64 themCells     = _board.us(_them).getBits();
+    u64 occupied      = usCells | themCells;
+    u64 queens        = _board.pieces(chess::PieceType::QUEEN, _them).getBits();
+    u64 diagonals     = _board.pieces(chess::PieceType::BISHOP, _them).getBits() | queens;
+    u64 orthogonals   = _board.pieces(chess::PieceType::ROOK, _them).getBits() | queens;
+    u64 knights       = _board.pieces(chess::PieceType::KNIGHT, _them).getBits();
+    u64 pawns         = _board.pieces(chess::PieceType::PAWN, _them).getBits();
+    u32 kingCell      = (u32)_king.index();
+    masks->kingCell   = kingCell;
+    masks->checkCount = 0;
+
+    u64 checkers = (chess::attacks::knight(_king).getBits() & knights) |
+                   (chess::attacks::pawn(_us, _king).getBits() & pawns) |
+                   (chess::attacks::bishop(_king, occupied).getBits() & diagonals) |
+                   (chess::attacks::rook(_king, occupied).getBits() & orthogonals);
+
+    masks->checkMask = ~0ULL;
+    if (checkers)
+    {
+        masks->checkCount = (u32)chess::Bitboard(checkers).count();
+        masks->checkMask  = masks->checkCount == 1 ? CellsBetween(kingCell, CellBitboardPop(&checkers)) : 0;
+    }
+
+    // Sliders that see the king through our pieces, the ray is a pin when it crosses exactly one of them
+    masks->pinDiagonal   = 0;
+    masks->pinOrthogonal = 0;
+
+    u64 pinners = chess::attacks::bishop(_king, themCells).getBits() & diagonals;
+    while (pinners)
+    {
+        u64 ray = CellsBetween(kingCell, CellBitboardPop(&pinners));
+        if (chess::Bitboard(ray & usCells).count() == 1)
+        {
+            masks->pinDiagonal |= ray;
+        }
+    }
+
+    pinners = chess::attacks::rook(_king, themCells).getBits() & orthogonals;
+    while (pinners)
+    {
+        u64 ray = CellsBetween(kingCell, CellBitboardPop(&pinners));
+        if (chess::Bitboard(ray & usCells).count() == 1)
+        {
+            masks->pinOrthogonal |= ray;
+        }
+    }
+}
+
+// Cells seen by the opponent, the king is removed so it can not step back along the ray of a checking slider
+chess_internal u64 GetAttackedCells(const chess::Board& _board, u32 kingCell)
+{
+    chess::Color    _them = ~_board.sideToMove();
+    chess::Bitboard _occupied(_board.occ().getBits() & ~CELL_BIT(kingCell));
+
+    u64 queens      = _board.pieces(chess::PieceType::QUEEN, _them).getBits();
+    u64 diagonals   = _board.pieces(chess::PieceType::BISHOP, _them).getBits() | queens;
+    u64 orthogonals = _board.pieces(chess::PieceType::ROOK, _them).getBits() | queens;
+    u64 knights     = _board.pieces(chess::PieceType::KNIGHT, _them).getBits();
+    u64 pawns       = _board.pieces(chess::PieceType::PAWN, _them).getBits();
+
+    u64 result = chess::attacks::king(_board.kingSq(_them)).getBits();
+    while (pawns)
+    {
+        result |= chess::attacks::pawn(_them, chess::Square((int)CellBitboardPop(&pawns))).getBits();
+    }
+    while (knights)
+    {
+        result |= chess::attacks::knight(chess::Square((int)CellBitboardPop(&knights))).getBits();
+    }
+    while (diagonals)
+    {
+        result |= chess::attacks::bishop(chess::Square((int)CellBitboardPop(&diagonals)), _occupied).getBits();
+    }
+    while (orthogonals)
+    {
+        result |= chess::attacks::rook(chess::Square((int)CellBitboardPop(&orthogonals)), _occupied).getBits();
+    }
+
+    return result;
+}
+
+// Legal moves of the piece on 'cellIndex' only, 'moves' must hold PIECE_MOVE_LIST_MAX moves
+chess_internal u32 GenerateCellMoves(const chess::Board& _board, const MoveGenMasks* masks, u32 cellIndex, Move* moves)
+{
+    CHESS_ASSERT(masks);
+    CHESS_ASSERT(moves);
+    VALIDATE_CELL_INDEX(cellIndex);
+
+    chess::Color  _us    = _board.sideToMove();
+    chess::Square _from((int)cellIndex);
+    chess::Piece  _piece = _board.at(_from);
+
+    if (_piece == chess::Piece::NONE || _piece.color() != _us)
+    {
+        return 0;
+    }
+
+    u64 usCells   = _board.us(_us).getBits();
+    u64 themCells = _board.them(_us).getBits();
+    u64 occupied  = usCells | themCells;
+    u64 cellBit   = CELL_BIT(cellIndex);
+    u64 targets   = 0;
+    u32 moveCount = 0;
 
-    chess::Board _board = GetExternalBoard(board);
-    chess::Piece _piece = _board.at(cellIndex);
+    chess::Bitboard _occupied(occupied);
 
     switch (_piece.type().internal())
     {
-    case chess::PieceType::PAWN:
+    case chess::PieceType::KING:
     {
-        result.type      = PIECE_TYPE_PAWN;
-        result.meshIndex = MESH_PAWN;
+        // Boxed in by its own pieces, castling path is blocked too
+        targets = chess::attacks::king(_from).getBits() & ~usCells;
+        if (!targets)
+        {
+            return 0;
+        }
+
+        u64 attacked = GetAttackedCells(_board, cellIndex);
+        targets &= ~attacked;
+
+        chess::Board::CastlingRights _rights = _board.castlingRights();
+        if (masks->checkCount == 0 && _rights.has(_us))
+        {
+            for (auto _side : { chess::Board::CastlingRights::Side::KING_SIDE,
+                                chess::Board::CastlingRights::Side::QUEEN_SIDE })
+            {
+                bool          kingSide = _side == chess::Board::CastlingRights::Side::KING_SIDE;
+                chess::Square _kingTo  = chess::Square::castling_king_square(kingSide, _us);
+
+                if (!_rights.has(_us, _side) || (occupied & _board.getCastlingPath(_us, kingSide).getBits()) ||
+                    (CellsBetween(cellIndex, (u32)_kingTo.index()) & attacked))
+                {
+                    continue;
+                }
+
+                chess::Square _rook(_rights.getRookFile(_us, _side), _from.rank());
+                moves[moveCount++] = GetInternalMove(chess::Move::make<chess::Move::CASTLING>(_from, _rook),
+                                                     chess::Piece(chess::Piece::NONE));
+            }
+        }
         break;
     }
-    case chess::PieceType::BISHOP:
+    case chess::PieceType::PAWN:
     {
-        result.type      = PIECE_TYPE_BISHOP;
-        result.meshIndex = MESH_BISHOP;
-        break;
+        bool white   = _us == chess::Color::WHITE;
+        u32  forward = white ? cellIndex + 8 : cellIndex - 8;
+
+        // Pushes stay on the file, captures leave it
+        if (!(cellBit & masks->pinDiagonal) && !(occupied & CELL_BIT(forward)))
+        {
+            targets        = CELL_BIT(forward);
+            u32 doublePush = white ? forward + 8 : forward - 8;
+            if (CELL_ROW(cellIndex) == (white ? 1u : 6u) && !(occupied & CELL_BIT(doublePush)))
+            {
+                targets |= CELL_BIT(doublePush);
+            }
+
+            if (cellBit & masks->pinOrthogonal)
+            {
+                targets &= masks->pinOrthogonal;
+            }
+        }
+
+        u64 captures = chess::attacks::pawn(_us, _from).getBits();
+        if (!(cellBit & masks->pinOrthogonal))
+        {
+            targets |= captures & themCells & ((cellBit & masks->pinDiagonal) ? masks->pinDiagonal : ~0ULL);
+        }
+
+        chess::Square _enpassant = _board.enpassantSq();
+        if (masks->checkCount < 2 && _enpassant != chess::Square::NO_SQ && (captures & CELL_BIT(_enpassant.index())))
+        {
+            u32 enpassantCell = (u32)_enpassant.index();
+            u32 capturedCell  = white ? enpassantCell - 8 : enpassantCell + 8;
+
+            // Both pawns leave their cells at once, test the king against sliders on the resulting board
+            chess::Square   _king((int)masks->kingCell);
+            chess::Bitboard _after((occupied ^ cellBit ^ CELL_BIT(capturedCell)) | CELL_BIT(enpassantCell));
+
+            u64 queens      = _board.pieces(chess::PieceType::QUEEN, ~_us).getBits();
+            u64 diagonals   = _board.pieces(chess::PieceType::BISHOP, ~_us).getBits() | queens;
+            u64 orthogonals = _board.pieces(chess::PieceType::ROOK, ~_us).getBits() | queens;
+            u64 sliders     = (chess::attacks::bishop(_king, _after).getBits() & diagonals) |
+                              (chess::attacks::rook(_king, _after).getBits() & orthogonals);
+
+            if ((masks->checkMask & (CELL_BIT(capturedCell) | CELL_BIT(enpassantCell))) && !sliders)
+            {
+                moves[moveCount++] = GetInternalMove(chess::Move::make<chess::Move::ENPASSANT>(_from, _enpassant),
+                                                     chess::Piece(chess::Piece::NONE));
+            }
+        }
+
+        targets &= masks->checkMask;
+        while (targets)
+        {
+            u32           toCell = CellBitboardPop(&targets);
+            chess::Square _to((int)toCell);
+            chess::Piece  _captured = _board.at(_to);
+
+            if (CELL_ROW(toCell) == 0 || CELL_ROW(toCell) == 7)
+            {
+                // Queen first, BoardMoveFind resolves promotions to the first match
+                for (auto _type : { chess::PieceType::QUEEN, chess::PieceType::ROOK, chess::PieceType::BISHOP,
+                                    chess::PieceType::KNIGHT })
+                {
+                    moves[moveCount++] =
+                        GetInternalMove(chess::Move::make<chess::Move::PROMOTION>(_from, _to, _type), _captured);
+                }
+            }
+            else
+            {
+                moves[moveCount++] = GetInternalMove(chess::Move::make<chess::Move::NORMAL>(_from, _to), _captured);
+            }
+        }
+
+        return moveCount;
     }
     case chess::PieceType::KNIGHT:
     {
-        result.type      = PIECE_TYPE_KNIGHT;
-        result.meshIndex = MESH_KNIGHT;
+        if (!(cellBit & (masks->pinDiagonal | masks->pinOrthogonal)))
+        {
+            targets = chess::attacks::knight(_from).getBits();
+        }
         break;
     }
-    case chess::PieceType::ROOK:
+    case chess::PieceType::BISHOP:
     {
-        result.type      = PIECE_TYPE_ROOK;
-        result.meshIndex = MESH_ROOK;
+        if (!(cellBit & masks->pinOrthogonal))
+        {
+            targets = chess::attacks::bishop(_from, _occupied).getBits();
+            targets &= (cellBit & masks->pinDiagonal) ? masks->pinDiagonal : ~0ULL;
+        }
         break;
     }
-
-    case chess::PieceType::KING:
+    case chess::PieceType::ROOK:
     {
-        result.type      = PIECE_TYPE_KING;
-        result.meshIndex = MESH_KING;
+        if (!(cellBit & masks->pinDiagonal))
+        {
+            targets = chess::attacks::rook(_from, _occupied).getBits();
+            targets &= (cellBit & masks->pinOrthogonal) ? masks->pinOrthogonal : ~0ULL;
+        }
         break;
     }
     case chess::PieceType::QUEEN:
     {
-        result.type      = PIECE_TYPE_QUEEN;
-        result.meshIndex = MESH_QUEEN;
-        break;
-    }
-    case chess::PieceType::NONE:
-    {
-        result.type = PIECE_TYPE_NONE;
+        if (cellBit & masks->pinDiagonal)
+        {
+            targets = chess::attacks::bishop(_from, _occupied).getBits() & masks->pinDiagonal;
+        }
+        else if (cellBit & masks->pinOrthogonal)
+        {
+            targets = chess::attacks::rook(_from, _occupied).getBits() & masks->pinOrthogonal;
+        }
+        else
+        {
+            targets = chess::attacks::queen(_from, _occupied).getBits();
+        }
         break;
     }
     default:
@@ -80,198 +1096,201 @@ Piece BoardGetPiece(Board* board, u32 cellIndex)
     }
     }
 
-    if (_piece.color() == chess::Color::WHITE)
+    // Only the king moves out of a double check, everything else has to land on the check mask
+    if (_piece.type() != chess::PieceType::KING)
     {
-        result.color        = PIECE_COLOR_WHITE;
-        result.textureIndex = TEXTURE_WHITE_ALBEDO;
+        targets &= masks->checkMask & ~usCells;
     }
-    else
+
+    while (targets)
     {
-        result.color        = PIECE_COLOR_BLACK;
-        result.textureIndex = TEXTURE_BLACK_ALBEDO;
+        chess::Square _to((int)CellBitboardPop(&targets));
+        moves[moveCount++] = GetInternalMove(chess::Move::make<chess::Move::NORMAL>(_from, _to), _board.at(_to));
     }
 
-    return result;
+    CHESS_ASSERT(moveCount <= PIECE_MOVE_LIST_MAX);
+    return moveCount;
 }
 
-chess_internal inline u32 GetInternalMoveType(chess::Board& _board, chess::Move& _move)
+// Derived state is computed once per position, Board* queries only read it
+chess_internal void BoardUpdatePositionInfo(Board* board)
 {
-    u32 result;
+    CHESS_ASSERT(board);
 
-    switch (_move.typeOf())
-    {
-    case chess::Move::ENPASSANT:
-    {
-        result = MOVE_TYPE_ENPASSANT;
-        break;
-    }
-    case chess::Move::PROMOTION:
-    {
-        result = MOVE_TYPE_PROMOTION;
-        break;
-    }
-    case chess::Move::CASTLING:
-    {
-        result = MOVE_TYPE_CASTLING;
-        break;
-    }
-    default:
+    chess::Board& _board = *board->position;
+    PositionInfo* info   = &board->info;
+    chess::Color  _color = _board.sideToMove();
+
+    MoveGenMasks masks;
+    MoveGenMasksCompute(_board, &masks);
+
+    memset(info->cellMoveOffset, 0, sizeof(info->cellMoveOffset));
+    memset(info->cellMoveCount, 0, sizeof(info->cellMoveCount));
+    memset(info->cellTargets, 0, sizeof(info->cellTargets));
+
+    // Own pieces are visited in cell order, so every piece move list is already a contiguous range
+    u32 moveCount = 0;
+    u64 pieces    = _board.us(_color).getBits();
+    while (pieces)
     {
-        chess::PieceType _toPiece = _board.at(_move.to()).type();
+        u32   cellIndex = CellBitboardPop(&pieces);
+        Move* movelist  = &info->moves[moveCount];
+        u32   cellCount = GenerateCellMoves(_board, &masks, cellIndex, movelist);
 
-        // CHECK
-        if (_board.givesCheck(_move) != chess::CheckType::NO_CHECK)
-        {
-            result = MOVE_TYPE_CHECK;
-        }
-        // CAPTURE
-        else if (_toPiece != chess::PieceType::NONE)
-        {
-            result = MOVE_TYPE_CAPTURE;
-        }
-        else
+        for (u32 moveIndex = 0; moveIndex < cellCount; moveIndex++)
         {
-            result = MOVE_TYPE_NORMAL;
+            info->cellTargets[cellIndex] |= CELL_BIT(movelist[moveIndex].to);
         }
 
-        break;
-    }
+        info->cellMoveOffset[cellIndex] = (u16)moveCount;
+        info->cellMoveCount[cellIndex]  = (u16)cellCount;
+        moveCount += cellCount;
     }
 
-    return result;
+    info->moveCount     = moveCount;
+    info->opponentCells = _board.them(_color).getBits();
+    info->turn          = GetInternalColor(_color);
+    info->inCheck       = masks.checkCount > 0;
+    info->kingCell      = masks.kingCell;
+    info->gameResult    = GetInternalGameResult(GetExternalGameResult(board, info->moveCount), _color);
 }
 
-#pragma warning(push)
-#pragma warning(disable : 4715)
-chess_internal inline chess::PieceGenType GetExternalPieceGenType(chess::PieceType _pieceType)
+// Returns a view into the position move table, valid until the position changes
+Move* BoardGetPieceMoveList(Board* board, u32 cellIndex, u32* moveCount)
 {
-    // clang-format off
-	switch (_pieceType.internal())
-	{
-	case chess::PieceType::PAWN:   { return chess::PieceGenType::PAWN; }
-	case chess::PieceType::BISHOP: { return chess::PieceGenType::BISHOP; }
-	case chess::PieceType::KNIGHT: { return chess::PieceGenType::KNIGHT; }
-	case chess::PieceType::QUEEN:  { return chess::PieceGenType::QUEEN; }
-	case chess::PieceType::KING:   { return chess::PieceGenType::KING; }
-	case chess::PieceType::ROOK:   { return chess::PieceGenType::ROOK; }
-	default:                       { CHESS_ASSERT(0); }
-	}
-    // clang-format on
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(moveCount);
+    VALIDATE_CELL_INDEX(cellIndex);
+
+    PositionInfo* info = &board->info;
+
+    *moveCount = info->cellMoveCount[cellIndex];
+    return &info->moves[info->cellMoveOffset[cellIndex]];
 }
-#pragma warning(pop)
 
-chess_internal inline chess::Board GetExternalBoard(Board* board)
+// Square-targeted generation outside of the move table, 'moves' must hold PIECE_MOVE_LIST_MAX moves
+u32 BoardGeneratePieceMoves(Board* board, u32 cellIndex, Move* moves)
 {
-    chess::Board _board{};
-    bool         validFen = _board.setFen(board->deltas.peek().fen);
-    CHESS_ASSERT(validFen);
-    return _board;
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(moves);
+    VALIDATE_CELL_INDEX(cellIndex);
+
+    MoveGenMasks masks;
+    MoveGenMasksCompute(*board->position, &masks);
+
+    return GenerateCellMoves(*board->position, &masks, cellIndex, moves);
 }
 
-Move* BoardGetPieceMoveList(Board* board, u32 cellIndex, u32* moveCount)
+u64 BoardGetPieceTargets(Board* board, u32 cellIndex)
 {
     CHESS_ASSERT(board);
-    CHESS_ASSERT(moveCount);
     VALIDATE_CELL_INDEX(cellIndex);
 
-    Move* result = nullptr;
-    *moveCount   = 0;
+    return board->info.cellTargets[cellIndex];
+}
 
-    chess::Board     _board     = GetExternalBoard(board);
-    chess::Piece     _piece     = _board.at(cellIndex);
-    chess::PieceType _pieceType = _piece.type();
+bool BoardMoveIsLegal(Board* board, u32 fromCell, u32 toCell)
+{
+    CHESS_ASSERT(board);
+    VALIDATE_CELL_INDEX(fromCell);
+    VALIDATE_CELL_INDEX(toCell);
 
-    if (_pieceType == chess::PieceType::NONE)
-    {
-        *moveCount = 0;
-    }
-    else
-    {
-        chess::Movelist     _rawMovelist{};
-        chess::Movelist     _movelist;
-        chess::PieceGenType _genType = GetExternalPieceGenType(_pieceType);
-        chess::movegen::legalmoves(_rawMovelist, _board, _genType);
+    return (board->info.cellTargets[fromCell] & CELL_BIT(toCell)) != 0;
+}
 
-        for (const auto& _move : _rawMovelist)
-        {
-            if (_move.from().index() == cellIndex)
-            {
-                _movelist.add(_move);
-            }
-        }
+// En passant target cell is empty, so it is not reported as a capture
+bool BoardMoveIsCapture(Board* board, u32 toCell)
+{
+    CHESS_ASSERT(board);
+    VALIDATE_CELL_INDEX(toCell);
 
-        u32 movelistSize = _movelist.size();
-        *moveCount       = movelistSize;
-        result           = new Move[movelistSize];
-        for (u32 i = 0; i < movelistSize; i++)
-        {
-            chess::Move& _move = _movelist[i];
+    return (board->info.opponentCells & CELL_BIT(toCell)) != 0;
+}
 
-            Move* move = &result[i];
-            move->from = (u32)_move.from().index();
-            move->to   = (u32)_move.to().index();
-            move->type = GetInternalMoveType(_board, _move);
+// Returns the first legal move between both cells, promotions resolve to the queen
+Move* BoardMoveFind(Board* board, u32 fromCell, u32 toCell)
+{
+    CHESS_ASSERT(board);
 
-            if (move->type == MOVE_TYPE_CASTLING)
-            {
-                u32          cellCount = (u32)Max(move->from, move->to) - (u32)Min(move->from, move->to);
-                chess::Color _color    = _board.sideToMove();
-                CHESS_ASSERT(_color != chess::Color::NONE);
-                CHESS_ASSERT(cellCount == 4 || cellCount == 3);
+    Move* result = nullptr;
 
-                // Long-castling
-                if (cellCount == 4)
-                {
-                    if (_color == chess::Color::WHITE)
-                    {
-                        move->to = 2;
-                    }
-                    else
-                    {
-                        move->to = 58;
-                    }
-                }
-                // Sort-castling
-                else if (cellCount == 3)
-                {
-                    if (_color == chess::Color::WHITE)
-                    {
-                        move->to = 6;
-                    }
-                    else
-                    {
-                        move->to = 62;
-                    }
-                }
+    if (BoardMoveIsLegal(board, fromCell, toCell))
+    {
+        u32   moveCount;
+        Move* movelist = BoardGetPieceMoveList(board, fromCell, &moveCount);
+        for (u32 moveIndex = 0; moveIndex < moveCount; moveIndex++)
+        {
+            if (movelist[moveIndex].to == toCell)
+            {
+                result = &movelist[moveIndex];
+                break;
             }
-
-            std::string uciStr = chess::uci::moveToUci(_move);
-            strncpy(move->uci, uciStr.c_str(), sizeof(move->uci) - 1);
-            move->uci[sizeof(move->uci) - 1] = '\0';
         }
     }
 
     return result;
 }
 
-void FreePieceMoveList(Move* movelist)
+bool BoardMoveGivesCheck(Board* board, Move* move)
 {
-    if (movelist)
+    CHESS_ASSERT(board);
+    CHESS_ASSERT(move);
+
+    return board->position->givesCheck(chess::Move(move->data)) != chess::CheckType::NO_CHECK;
+}
+
+// 'buffer' must hold at least UCI_STR_MAX_LENGTH characters
+void BoardMoveGetUci(Move* move, char* buffer)
+{
+    CHESS_ASSERT(move);
+    CHESS_ASSERT(buffer);
+
+    chess::Move _move(move->data);
+
+    u32 length       = 0;
+    buffer[length++] = 'a' + (char)CELL_COL(move->from);
+    buffer[length++] = '1' + (char)CELL_ROW(move->from);
+    buffer[length++] = 'a' + (char)CELL_COL(move->to);
+    buffer[length++] = '1' + (char)CELL_ROW(move->to);
+
+    if (_move.typeOf() == chess::Move::PROMOTION)
     {
-        delete[] movelist;
+        // Promotion piece is stored in bits 12-13, starting at knight
+        buffer[length++] = "nbrq"[(move->data >> 12) & 3];
     }
+
+    buffer[length] = '\0';
 }
 
-void BoardMoveDo(Board* board, Move* move)
+// False and nothing played when the history is full. On a BOARD_HISTORY_MAX_PLIES board the draw rules end a game
+// long before that, only a file with a game of a million plies gets there.
+bool BoardMoveDo(Board* board, Move* move)
 {
     CHESS_ASSERT(board);
     CHESS_ASSERT(move);
 
-    chess::Board _board = GetExternalBoard(board);
-    chess::Move  _move  = chess::uci::uciToMove(_board, move->uci);
+    BoardHistory* history = &board->history;
+    if (history->count + 1 >= history->maxPlies)
+    {
+        return false;
+    }
+
+    if (history->count % BOARD_HISTORY_KEYFRAME_INTERVAL == 0)
+    {
+        history->keyframes[history->count / BOARD_HISTORY_KEYFRAME_INTERVAL] =
+            chess::Board::Compact::encode(*board->position);
+    }
+
+    // Playing the next move of the history keeps the plies after it
+    bool isNext = history->count < history->length && history->entries[history->count].move == move->data;
+
+    history->keys[history->count] = board->position->hash();
+    board->position->MoveDo(chess::Move(move->data), &history->entries[history->count]);
+    history->count++;
+    history->length = isNext ? history->length : history->count;
+    BoardUpdatePositionInfo(board);
 
-    _board.makeMove(_move);
-    board->deltas.push(Board::Delta{ *move, _board.getFen() });
+    return true;
 }
 
 void BoardMoveUndo(Board* board)
@@ -279,129 +1298,91 @@ void BoardMoveUndo(Board* board)
     CHESS_ASSERT(board);
     CHESS_ASSERT(BoardMoveCanUndo(board));
 
-    board->deltas.pop();
+    BoardHistory* history = &board->history;
+    history->count--;
+    board->position->MoveUndo(&history->entries[history->count], history->keys[history->count]);
+    BoardUpdatePositionInfo(board);
 }
 
 bool BoardMoveCanUndo(Board* board)
 {
     CHESS_ASSERT(board);
-    return board->deltas.top >= 2;
+    return board->history.count > 0;
 }
 
-Move BoardMoveGetLast(Board* board)
+bool BoardMoveCanRedo(Board* board)
 {
     CHESS_ASSERT(board);
-    return board->deltas.peek().lastMove;
+    return board->history.count < board->history.length;
 }
 
-u32 BoardGetTurn(Board* board)
+Move BoardMoveGetLast(Board* board)
 {
     CHESS_ASSERT(board);
+    CHESS_ASSERT(board->history.count > 0);
 
-    chess::Board _board = GetExternalBoard(board);
-    chess::Color _color = _board.sideToMove();
-
-    u32 color;
-
-    switch (_color)
-    {
-    case chess::Color::WHITE:
-    {
-        color = PIECE_COLOR_WHITE;
-        break;
-    }
-    case chess::Color::BLACK:
-    {
-        color = PIECE_COLOR_BLACK;
-        break;
-    }
-    case chess::Color::NONE:
-    {
-        color = PIECE_COLOR_NONE;
-        break;
-    }
-    default:
-    {
-        CHESS_ASSERT(0);
-    }
-    }
+    BoardHistoryEntry* entry = &board->history.entries[board->history.count - 1];
+    return GetInternalMove(chess::Move(entry->move), chess::Piece((chess::Piece::underlying)entry->captured));
+}
 
-    return color;
+u32 BoardGetTurn(Board* board)
+{
+    CHESS_ASSERT(board);
+    return board->info.turn;
 }
 
 u32 BoardGetGameResult(Board* board)
 {
     CHESS_ASSERT(board);
+    return board->info.gameResult;
+}
 
-    chess::Board                                          _board      = GetExternalBoard(board);
-    std::pair<chess::GameResultReason, chess::GameResult> _result     = _board.isGameOver();
-    chess::GameResult                                     _gameResult = std::get<1>(_result);
-    chess::Color                                          _color      = _board.sideToMove();
+bool BoardGameStarted(Board* board)
+{
+    CHESS_ASSERT(board);
+    return board->history.count > 0;
+}
 
-    u32 result;
+// Threefold repetition, only positions with the same side to move since the last capture or pawn move can repeat
+bool BoardIsRepetition(Board* board)
+{
+    CHESS_ASSERT(board);
 
-    switch (_gameResult)
-    {
-    case chess::GameResult::WIN:
-    {
-        if (_color == chess::Color::WHITE)
-        {
-            result = BOARD_GAME_RESULT_WIN;
-        }
-        else
-        {
-            result = BOARD_GAME_RESULT_LOSE;
-        }
-        break;
-    }
-    case chess::GameResult::LOSE:
+    BoardHistory* history  = &board->history;
+    u64           key      = board->position->hash();
+    s32           firstPly = (s32)history->count - (s32)board->position->halfMoveClock();
+    u32           repeated = 0;
+
+    for (s32 ply = (s32)history->count - 2; ply >= 0 && ply >= firstPly; ply -= 2)
     {
-        if (_color == chess::Color::WHITE)
-        {
-            result = BOARD_GAME_RESULT_LOSE;
-        }
-        else
+        if (history->keys[ply] == key && ++repeated == 2)
         {
-            result = BOARD_GAME_RESULT_WIN;
+            return true;
         }
-        break;
-    }
-    case chess::GameResult::DRAW:
-    {
-        result = BOARD_GAME_RESULT_DRAW;
-        break;
-    }
-    case chess::GameResult::NONE:
-    {
-        result = BOARD_GAME_RESULT_NONE;
-        break;
-    }
-    default:
-    {
-        CHESS_ASSERT(0);
-    }
     }
 
-    return result;
+    return false;
 }
 
-bool BoardGameStarted(Board* board)
+bool BoardInCheck(Board* board)
 {
     CHESS_ASSERT(board);
-    return board->deltas.peek().fen != DEFAULT_FEN_STRING;
+    return board->info.inCheck;
 }
 
-bool BoardInCheck(Board* board)
+u32 BoardGetKingCell(Board* board)
 {
     CHESS_ASSERT(board);
-
-    chess::Board _board = GetExternalBoard(board);
-    return _board.inCheck();
+    return board->info.kingCell;
 }
 
-u32 BoardGetKingCell(Board* board)
+u32 CellBitboardPop(u64* cells)
 {
-    CHESS_ASSERT(board);
-    chess::Board _board = GetExternalBoard(board);
-    return (u32)_board.kingSq(_board.sideToMove()).index();
+    CHESS_ASSERT(cells);
+    CHESS_ASSERT(*cells);
+
+    chess::Bitboard _cells(*cells);
+    u32             cellIndex = (u32)_cells.pop();
+    *cells                    = _cells.getBits();
+    return cellIndex;
 }
\ No newline at end of file
@@ -1,7 +1,18 @@
 #pragma once
 
+#include <Disservin/chess.hpp>
+
 #define UCI_STR_MAX_LENGTH 10
 #define FEN_STR_MAX_LENGTH 92
+#define MOVE_LIST_MAX      256
+
+// A queen in the center reaches 27 cells, a pawn on the 7th rank emits 12 promotions
+#define PIECE_MOVE_LIST_MAX 32
+
+// A history of maxPlies holds maxPlies - 1 plies, BoardInit preallocates it from the arena
+#define BOARD_HISTORY_MAX_PLIES         (1 << 20) // Game, PGN and archive boards
+#define BOARD_HISTORY_SEARCH_PLIES      1024      // Boards that hold a search root or walk a few plies below it
+#define BOARD_HISTORY_KEYFRAME_INTERVAL 32
 
 enum
 {
@@ -27,15 +38,12 @@ struct Piece
     u32 type;
     u32 color;
     u32 cellIndex;
-    u32 meshIndex;
-    u32 textureIndex;
 };
 
 enum
 {
     MOVE_TYPE_NORMAL,
     MOVE_TYPE_CAPTURE,
-    MOVE_TYPE_CHECK,
     MOVE_TYPE_ENPASSANT,
     MOVE_TYPE_CASTLING,
     MOVE_TYPE_PROMOTION
@@ -43,10 +51,10 @@ enum
 
 struct Move
 {
-    u32  from;
-    u32  to;
-    u32  type;
-    char uci[UCI_STR_MAX_LENGTH];
+    u32 from;
+    u32 to;
+    u32 type;
+    u16 data; // chess::Move encoding
 };
 
 enum
@@ -57,27 +65,112 @@ enum
     BOARD_GAME_RESULT_DRAW
 };
 
-struct Board
+// Check and pin rays of the side to move, shared by every origin cell of a position
+// checkMask is every cell when not in check, the checker and the cells in between when in single check
+// pin masks hold the ray from the king to each pinner, pinner included
+struct MoveGenMasks
 {
-    struct Delta
-    {
-        Move        lastMove;
-        std::string fen;
-    };
+    u64 checkMask;
+    u64 pinDiagonal;
+    u64 pinOrthogonal;
+    u32 checkCount;
+    u32 kingCell;
+};
 
-    Stack<Delta> deltas;
+// Derived state of the current position, filled once every time the position changes
+// Legal moves are grouped by origin cell, cellMoveOffset/cellMoveCount index into moves
+// cellTargets holds one bit per destination cell for every origin cell
+struct PositionInfo
+{
+    Move moves[MOVE_LIST_MAX];
+    u32  moveCount;
+    u16  cellMoveOffset[64];
+    u16  cellMoveCount[64];
+    u64  cellTargets[64];
+    u64  opponentCells;
+    u32  turn;
+    u32  gameResult;
+    u32  kingCell;
+    bool inCheck;
+};
+
+// Everything needed to unmake a move exactly, state is the one before the move was made
+struct BoardHistoryEntry
+{
+    u16 move;      // chess::Move encoding
+    u8  captured;  // chess::Piece
+    u8  castling;  // KQkq rights as chess::Board::CastlingRights::hashIndex
+    u8  enpassant; // chess::Square, 64 when there is none
+    u8  halfMoves;
+};
+
+// Plies played since the initial position, one keyframe is stored every BOARD_HISTORY_KEYFRAME_INTERVAL plies
+// keyframes[0] is always the initial position, its move counters are kept in rootHalfMoves/rootPlies
+// keys[ply] is the Zobrist key of the position before entries[ply] was played
+// Plies past count up to length are still valid after an undo or a seek, a different move drops them
+struct BoardHistory
+{
+    BoardHistoryEntry*  entries;
+    u64*                keys;
+    chess::PackedBoard* keyframes;
+    u32                 count;
+    u32                 length;
+    u32                 maxPlies;
+    u32                 rootPlies;
+    u8                  rootHalfMoves;
+};
+
+// chess::Board keeps its own undo state in a std::vector, BoardPosition moves it into BoardHistory entries
+struct BoardPosition : chess::Board
+{
+    using chess::Board::Board;
+
+    void MoveDo(chess::Move move, BoardHistoryEntry* entry);
+    void MoveUndo(const BoardHistoryEntry* entry, u64 key);
+    void Restore(const chess::PackedBoard& packed, u8 halfMoves, u32 plies);
+    u32  GetPlies() const { return (u32)plies_; }
+};
+
+// Board is plain data and can be copied as raw memory. The live chess::Board is not, it lives in the arena
+// and is rebuilt from the history by BoardHistoryRestore after the Board memory is copied back.
+struct Board
+{
+    // Live position, updated incrementally by BoardMoveDo/BoardMoveUndo
+    BoardPosition* position;
+    PositionInfo   info;
+    BoardHistory   history;
 };
 
-Board BoardCreate(const char* fen);
+bool  BoardPositionSetFen(chess::Board* position, const char* fen);
+u64   BoardArenaSize(u32 maxPlies);
+void  BoardInit(Board* board, const char* fen, MemoryArena* arena, u32 maxPlies);
+bool  BoardReset(Board* board, const char* fen);
+void  BoardReload(Board* board);
+u64   BoardHistorySnapshotSize(u32 plyCount);
+void  BoardHistorySnapshot(Board* board, void* buffer);
+void  BoardHistoryRestore(Board* board, const void* buffer, u32 plyCount);
+bool  BoardHistoryIsValid(const void* buffer, u32 plyCount, u32 rootPlies, u8 rootHalfMoves);
+bool  BoardHistoryAppend(Board* board, chess::Move move);
+void  BoardSeek(Board* board, u32 ply);
+void  BoardGetFen(Board* board, char* buffer);
 Piece BoardGetPiece(Board* board, u32 cellIndex);
 Move* BoardGetPieceMoveList(Board* board, u32 cellIndex, u32* moveCount);
-void  FreePieceMoveList(Move* move);
-void  BoardMoveDo(Board* board, Move* move);
+u32   BoardGeneratePieceMoves(Board* board, u32 cellIndex, Move* moves);
+u64   BoardGetPieceTargets(Board* board, u32 cellIndex);
+bool  BoardMoveIsLegal(Board* board, u32 fromCell, u32 toCell);
+bool  BoardMoveIsCapture(Board* board, u32 toCell);
+Move* BoardMoveFind(Board* board, u32 fromCell, u32 toCell);
+bool  BoardMoveGivesCheck(Board* board, Move* move);
+void  BoardMoveGetUci(Move* move, char* buffer);
+bool  BoardMoveDo(Board* board, Move* move);
 void  BoardMoveUndo(Board* board);
 bool  BoardMoveCanUndo(Board* board);
+bool  BoardMoveCanRedo(Board* board);
 Move  BoardMoveGetLast(Board* board);
 u32   BoardGetTurn(Board* board);
 u32   BoardGetGameResult(Board* board);
 bool  BoardGameStarted(Board* board);
+bool  BoardIsRepetition(Board* board);
 bool  BoardInCheck(Board* board);
-u32   BoardGetKingCell(Board* board);
\ No newline at end of file
+u32   BoardGetKingCell(Board* board);
+u32   CellBitboardPop(u64* cells);
\ No newline at end of file
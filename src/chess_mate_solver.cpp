@@ -0,0 +1,445 @@
+#include "chess_mate_solver.h"
+
+#include <algorithm>
+#include <chrono>
+
+struct MateSolverNumbers
+{
+    u32 proof;
+    u32 disproof;
+    u32 distance;
+};
+
+chess_internal inline f64 MateSolverGetSeconds()
+{
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Saturates below MATE_SOLVER_INFINITE, only proofs and disproofs reach it
+chess_internal inline u32 MateSolverAdd(u32 a, u32 b)
+{
+    if (a >= MATE_SOLVER_INFINITE || b >= MATE_SOLVER_INFINITE)
+    {
+        return MATE_SOLVER_INFINITE;
+    }
+
+    u32 result = a + b;
+
+    return result < MATE_SOLVER_INFINITE ? result : MATE_SOLVER_INFINITE - 1;
+}
+
+// The table is rounded down to a power of two entries
+MateSolver* MateSolverCreate(MemoryArena* arena, u64 tableSize)
+{
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(tableSize >= 2 * sizeof(MateSolverEntry));
+
+    MateSolver* result = new (ArenaPushSize(arena, sizeof(MateSolver), alignof(MateSolver))) MateSolver();
+    result->mailbox.store(MATE_SOLVER_MAILBOX_IDLE);
+
+    u64 entryCount = 2;
+    while (entryCount * 2 * sizeof(MateSolverEntry) <= tableSize)
+    {
+        entryCount *= 2;
+    }
+    result->entries = (MateSolverEntry*)ArenaPushSize(arena, entryCount * sizeof(MateSolverEntry), 64);
+    result->mask    = entryCount - 1;
+
+    return result;
+}
+
+void MateSolverClear(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    CHESS_ASSERT(!MateSolverIsSearching(solver));
+
+    memset(solver->entries, 0, (solver->mask + 1) * sizeof(MateSolverEntry));
+    solver->usedEntries = 0;
+}
+
+// Same as EngineReload, the position vtable points into the previous game code
+void MateSolverReload(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    CHESS_ASSERT(!MateSolverIsSearching(solver));
+
+    chess::Board _position = std::move(solver->position);
+    new (&solver->position) chess::Board(std::move(_position));
+}
+
+// Proof numbers depend on who attacks, the same position gets another key when black is the attacker
+chess_internal inline u64 MateSolverGetKey(MateSolver* solver, const chess::Board& position)
+{
+    return position.hash() ^ solver->attackerKey;
+}
+
+chess_internal inline MateSolverEntry* MateSolverProbe(MateSolver* solver, u64 key)
+{
+    MateSolverEntry* bucket = &solver->entries[key & solver->mask & ~1ULL];
+    if (bucket[0].key == key)
+    {
+        return &bucket[0];
+    }
+    if (bucket[1].key == key)
+    {
+        return &bucket[1];
+    }
+
+    return 0;
+}
+
+// A proof holds with more plies left, a disproof with fewer, anything else only for the same plies
+chess_internal bool MateSolverLookup(MateSolver* solver, u64 key, u32 depth, MateSolverNumbers* numbers)
+{
+    MateSolverEntry* entry = MateSolverProbe(solver, key);
+    if (!entry)
+    {
+        return false;
+    }
+
+    if (entry->proof == 0 && entry->distance <= depth)
+    {
+        *numbers = { 0, MATE_SOLVER_INFINITE, entry->distance };
+        return true;
+    }
+    if (entry->disproof == 0 && entry->depth >= depth)
+    {
+        *numbers = { MATE_SOLVER_INFINITE, 0, 0 };
+        return true;
+    }
+    if (entry->depth == depth && entry->proof != 0 && entry->disproof != 0)
+    {
+        *numbers = { entry->proof, entry->disproof, 0 };
+        return true;
+    }
+
+    return false;
+}
+
+// Proofs are never replaced by something else of the same position, the bucket keeps the entry with more work
+chess_internal void MateSolverStore(MateSolver* solver, u64 key, u32 depth, MateSolverNumbers numbers, u16 move,
+                                   u64 work)
+{
+    MateSolverEntry* bucket = &solver->entries[key & solver->mask & ~1ULL];
+    MateSolverEntry* entry  = MateSolverProbe(solver, key);
+    if (entry)
+    {
+        if (entry->proof == 0 && (numbers.proof != 0 || entry->distance <= numbers.distance))
+        {
+            return;
+        }
+    }
+    else
+    {
+        entry = bucket[0].key == 0 || (bucket[1].key != 0 && bucket[0].work <= bucket[1].work) ? &bucket[0]
+                                                                                              : &bucket[1];
+        solver->usedEntries += entry->key == 0;
+    }
+
+    entry->key      = key;
+    entry->proof    = numbers.proof;
+    entry->disproof = numbers.disproof;
+    entry->work     = work < 0xFFFFFFFF ? (u32)work : 0xFFFFFFFF;
+    entry->move     = move;
+    entry->depth    = (u8)depth;
+    entry->distance = (u8)numbers.distance;
+}
+
+// Every position made counts, like the engine nodes, so both speeds compare
+chess_internal inline void MateSolverCountNodes(MateSolver* solver, u32 count)
+{
+    u64 previous = solver->nodes;
+    solver->nodes += count;
+    if (previous / MATE_SOLVER_CHECK_INTERVAL != solver->nodes / MATE_SOLVER_CHECK_INTERVAL)
+    {
+        solver->publishedNodes.store(solver->nodes, std::memory_order_relaxed);
+        if (solver->stop.load(std::memory_order_relaxed) ||
+            (solver->cancel && solver->cancel->load(std::memory_order_relaxed)) ||
+            (solver->maxNodes && solver->nodes >= solver->maxNodes))
+        {
+            solver->stopped = true;
+        }
+    }
+}
+
+// Numbers of a child seen for the first time. Defender nodes are expanded right away: mates and stalemates are
+// settled here and the defender move count is the proof number, so checks and few replies are tried first.
+chess_internal MateSolverNumbers MateSolverInitChild(MateSolver* solver, u32 depth, bool isOr)
+{
+    MateSolverNumbers result = { MATE_SOLVER_INFINITE, 0, 0 };
+    if (isOr)
+    {
+        if (depth > 0)
+        {
+            result = { 1, 1, 0 };
+        }
+        return result;
+    }
+
+    // Out of attacker plies only a mate counts, and a mate needs a check
+    bool inCheck = solver->position.inCheck();
+    if (depth < 2 && !inCheck)
+    {
+        return result;
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, solver->position);
+    if (moves.empty())
+    {
+        if (inCheck)
+        {
+            result = { 0, MATE_SOLVER_INFINITE, 0 };
+        }
+    }
+    else if (depth >= 2)
+    {
+        result = { (u32)moves.size(), 1, 0 };
+    }
+
+    return result;
+}
+
+// Multiple iterative deepening: the node is searched until its proof or disproof number reaches the threshold.
+// Children thresholds use the 1 + epsilon trick of df-pn+, the second best child is allowed to get a quarter
+// worse before the search switches to it, which saves most of the re-expansions.
+chess_internal MateSolverNumbers MateSolverMid(MateSolver* solver, u32 depth, bool isOr, u32 proofThreshold,
+                                               u32 disproofThreshold)
+{
+    chess::Board& position  = solver->position;
+    u64           key       = MateSolverGetKey(solver, position);
+    u64           startNode = solver->nodes;
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, position);
+
+    // Mated defender, attacker out of moves, or not enough plies left for the attacker to mate
+    MateSolverNumbers result = { MATE_SOLVER_INFINITE, 0, 0 };
+    if (moves.empty() || depth < (isOr ? 1u : 2u))
+    {
+        if (moves.empty() && !isOr && position.inCheck())
+        {
+            result = { 0, MATE_SOLVER_INFINITE, 0 };
+        }
+        MateSolverStore(solver, key, depth, result, chess::Move::NO_MOVE, 0);
+        return result;
+    }
+
+    MateSolverNumbers children[chess::constants::MAX_MOVES];
+    MateSolverCountNodes(solver, (u32)moves.size());
+    for (s32 i = 0; i < moves.size(); i++)
+    {
+        position.makeMove(moves[i]);
+        if (!MateSolverLookup(solver, MateSolverGetKey(solver, position), depth - 1, &children[i]))
+        {
+            children[i] = MateSolverInitChild(solver, depth - 1, !isOr);
+        }
+        position.unmakeMove(moves[i]);
+    }
+
+    // OR nodes: proof is the smallest child proof, disproof the sum. AND nodes the other way around.
+    for (;;)
+    {
+        u32 best   = 0;
+        u32 first  = MATE_SOLVER_INFINITE + 1;
+        u32 second = MATE_SOLVER_INFINITE;
+        u32 sum    = 0;
+        for (s32 i = 0; i < moves.size(); i++)
+        {
+            u32 minSide = isOr ? children[i].proof : children[i].disproof;
+            u32 sumSide = isOr ? children[i].disproof : children[i].proof;
+            if (minSide < first)
+            {
+                second = first < MATE_SOLVER_INFINITE ? first : MATE_SOLVER_INFINITE;
+                first  = minSide;
+                best   = (u32)i;
+            }
+            else if (minSide < second)
+            {
+                second = minSide;
+            }
+            sum = MateSolverAdd(sum, sumSide);
+        }
+
+        result.proof    = isOr ? first : sum;
+        result.disproof = isOr ? sum : first;
+        if (result.proof >= proofThreshold || result.disproof >= disproofThreshold || solver->stopped)
+        {
+            break;
+        }
+
+        u32 minThreshold = isOr ? proofThreshold : disproofThreshold;
+        u32 sumThreshold = isOr ? disproofThreshold : proofThreshold;
+        u32 childMin     = second + second / 4 + 1;
+        childMin         = childMin < minThreshold ? childMin : minThreshold;
+        u32 childSum     = sumThreshold - sum + (isOr ? children[best].disproof : children[best].proof);
+
+        position.makeMove(moves[best]);
+        children[best] = MateSolverMid(solver, depth - 1, !isOr, isOr ? childMin : childSum, isOr ? childSum : childMin);
+        position.unmakeMove(moves[best]);
+    }
+
+    // Shortest mate for the attacker, longest defence for the defender
+    u16 move = chess::Move::NO_MOVE;
+    if (result.proof == 0)
+    {
+        u32 chosen = 0;
+        for (s32 i = 0; i < moves.size(); i++)
+        {
+            if (children[i].proof != 0)
+            {
+                continue;
+            }
+            if (move == chess::Move::NO_MOVE || (isOr ? children[i].distance < chosen : children[i].distance > chosen))
+            {
+                chosen = children[i].distance;
+                move   = moves[i].move();
+            }
+        }
+        result.distance = chosen + 1;
+    }
+
+    MateSolverStore(solver, key, depth, result, move, solver->nodes - startNode);
+
+    return result;
+}
+
+// Follows the proving moves of the table from the root, the line ends early when an entry was replaced
+chess_internal void MateSolverGetLine(MateSolver* solver, MateSolverResult* result)
+{
+    chess::Board position = solver->position;
+
+    result->lineLength = 0;
+    while (result->lineLength < MATE_SOLVER_MAX_PLIES)
+    {
+        MateSolverEntry* entry = MateSolverProbe(solver, MateSolverGetKey(solver, position));
+        if (!entry || entry->proof != 0 || entry->move == chess::Move::NO_MOVE)
+        {
+            break;
+        }
+
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, position);
+        if (std::find(moves.begin(), moves.end(), chess::Move(entry->move)) == moves.end())
+        {
+            break;
+        }
+
+        result->line[result->lineLength++] = entry->move;
+        position.makeMove(chess::Move(entry->move));
+    }
+}
+
+// Copies the position, the caller then runs MateSolverRun once, from any thread
+// Returns false when a solve is still running or its result was not polled yet
+bool MateSolverStart(MateSolver* solver, const chess::Board& position, u32 maxMate, u64 maxNodes)
+{
+    CHESS_ASSERT(solver);
+
+    if (solver->mailbox.load(std::memory_order_acquire) != MATE_SOLVER_MAILBOX_IDLE)
+    {
+        return false;
+    }
+
+    solver->position     = position;
+    solver->attackerKey  = position.sideToMove() == chess::Color::WHITE ? 0 : 0x9E3779B97F4A7C15ULL;
+    solver->maxMate      = maxMate < MATE_SOLVER_MAX_MATE ? maxMate : MATE_SOLVER_MAX_MATE;
+    solver->maxNodes     = maxNodes;
+    solver->nodes        = 0;
+    solver->stopped      = false;
+    solver->startSeconds = MateSolverGetSeconds();
+    solver->publishedNodes.store(0, std::memory_order_relaxed);
+    solver->provenMateIn.store(0, std::memory_order_relaxed);
+    solver->stop.store(false, std::memory_order_relaxed);
+    solver->mailbox.store(MATE_SOLVER_MAILBOX_SEARCHING, std::memory_order_release);
+
+    return true;
+}
+
+// Any mate within maxMate first, proof-number search finds one long before it could prove there is none.
+// Then the same search with two plies less each time, until that fails: the last proof is the shortest mate.
+void MateSolverRun(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    CHESS_ASSERT(solver->mailbox.load(std::memory_order_acquire) == MATE_SOLVER_MAILBOX_SEARCHING);
+
+    MateSolverResult* result = &solver->result;
+    memset(result, 0, sizeof(*result));
+    result->type = MATE_SOLVER_RESULT_UNKNOWN;
+    result->key  = solver->position.hash();
+    MateSolverCountNodes(solver, 1);
+
+    u32 depth = 2 * solver->maxMate - 1;
+    for (;;)
+    {
+        MateSolverNumbers root = MateSolverMid(solver, depth, true, MATE_SOLVER_INFINITE, MATE_SOLVER_INFINITE);
+        if (solver->stopped)
+        {
+            break;
+        }
+        if (root.proof != 0)
+        {
+            if (result->type != MATE_SOLVER_RESULT_MATE)
+            {
+                result->type = MATE_SOLVER_RESULT_NO_MATE;
+            }
+            result->isShortest = result->type == MATE_SOLVER_RESULT_MATE;
+            break;
+        }
+
+        if (result->type != MATE_SOLVER_RESULT_MATE)
+        {
+            result->firstNodes   = solver->nodes;
+            result->firstSeconds = MateSolverGetSeconds() - solver->startSeconds;
+        }
+        result->type   = MATE_SOLVER_RESULT_MATE;
+        result->mateIn = (root.distance + 1) / 2;
+        MateSolverGetLine(solver, result);
+        solver->provenMateIn.store(result->mateIn, std::memory_order_relaxed);
+        if (root.distance < 3)
+        {
+            result->isShortest = true;
+            break;
+        }
+        depth = root.distance - 2;
+    }
+
+    result->nodes   = solver->nodes;
+    result->seconds = MateSolverGetSeconds() - solver->startSeconds;
+    solver->publishedNodes.store(solver->nodes, std::memory_order_relaxed);
+    solver->mailbox.store(MATE_SOLVER_MAILBOX_READY, std::memory_order_release);
+}
+
+void MateSolverStop(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    solver->stop.store(true, std::memory_order_relaxed);
+}
+
+bool MateSolverIsSearching(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    return solver->mailbox.load(std::memory_order_acquire) == MATE_SOLVER_MAILBOX_SEARCHING;
+}
+
+// Non-blocking, true once per solve when its result is available
+bool MateSolverPollResult(MateSolver* solver, MateSolverResult* result)
+{
+    CHESS_ASSERT(solver);
+    CHESS_ASSERT(result);
+
+    bool isReady = solver->mailbox.load(std::memory_order_acquire) == MATE_SOLVER_MAILBOX_READY;
+    if (isReady)
+    {
+        *result = solver->result;
+        solver->mailbox.store(MATE_SOLVER_MAILBOX_IDLE, std::memory_order_release);
+    }
+
+    return isReady;
+}
+
+u64 MateSolverGetNodes(MateSolver* solver)
+{
+    CHESS_ASSERT(solver);
+    return solver->publishedNodes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+
+#include "chess_game_logic.h"
+
+// Forced mate solver for the side to move, depth-first proof-number search (df-pn) over chess::movegen.
+// The attacker moves at OR nodes, the defender at AND nodes. A node is proven when the attacker mates within the
+// plies left, disproven otherwise. The first proof is searched with every ply allowed, then the search is repeated
+// two plies shorter until it fails, the table carries proofs and disproofs from one length to the next.
+// Every proof and disproof number lives in a fixed size table carved from the arena, nothing else is allocated.
+
+#define MATE_SOLVER_MAX_MATE       16                          // Longest mate tried, in moves
+#define MATE_SOLVER_MAX_PLIES      (2 * MATE_SOLVER_MAX_MATE)
+#define MATE_SOLVER_INFINITE       (1u << 30)
+#define MATE_SOLVER_CHECK_INTERVAL 4096
+#define MATE_SOLVER_TABLE_SIZE     MEGABYTES(16)
+
+// Same protocol as the engine mailbox, IDLE -> SEARCHING on MateSolverStart, SEARCHING -> READY when
+// MateSolverRun returns, READY -> IDLE on MateSolverPollResult
+enum
+{
+    MATE_SOLVER_MAILBOX_IDLE,
+    MATE_SOLVER_MAILBOX_SEARCHING,
+    MATE_SOLVER_MAILBOX_READY
+};
+
+enum
+{
+    MATE_SOLVER_RESULT_MATE,    // Forced mate in mateIn moves, the shortest one when isShortest
+    MATE_SOLVER_RESULT_NO_MATE, // No mate within maxMate moves
+    MATE_SOLVER_RESULT_UNKNOWN  // Stopped or out of nodes before the first proof
+};
+
+// Numbers are from the attacker point of view at every node. 'depth' is the plies left when the entry was
+// written, 'distance' the plies to mate of a proven entry and 'move' the move that proves it: the shortest mate
+// at OR nodes, the longest defence at AND nodes.
+struct MateSolverEntry
+{
+    u64 key;
+    u32 proof;
+    u32 disproof;
+    u32 work; // Nodes spent below the entry, the cheaper of a bucket is replaced
+    u16 move; // chess::Move encoding
+    u8  depth;
+    u8  distance;
+};
+
+struct MateSolverResult
+{
+    u32  type;
+    u32  mateIn;
+    bool isShortest;
+    u16  line[MATE_SOLVER_MAX_PLIES]; // Attacker and defender moves until mate
+    u32  lineLength;
+    u64  nodes;
+    f64  seconds;
+    u64  firstNodes; // Spent until the first proof
+    f64  firstSeconds;
+    u64  key; // Root position
+};
+
+struct MateSolver
+{
+    MateSolverEntry* entries; // Buckets of two entries
+    u64              mask;
+    u64              usedEntries;
+
+    chess::Board position;
+    u64          attackerKey; // Mixed into every key
+    u32          maxMate;
+    u64          maxNodes; // Zero means no limit
+    u64          nodes;
+    f64          startSeconds;
+    bool         stopped;
+
+    // Optional, checked together with stop, the game points it at GameMemory::cancelWork
+    const std::atomic<bool>* cancel;
+
+    std::atomic<bool> stop;
+    std::atomic<u64>  publishedNodes; // Copy of nodes every MATE_SOLVER_CHECK_INTERVAL
+    std::atomic<u32>  provenMateIn;   // Shortest mate proven so far, 0 before the first proof
+    std::atomic<u32>  mailbox;
+    MateSolverResult  result;
+};
+
+MateSolver* MateSolverCreate(MemoryArena* arena, u64 tableSize);
+void        MateSolverClear(MateSolver* solver);
+void        MateSolverReload(MateSolver* solver);
+bool        MateSolverStart(MateSolver* solver, const chess::Board& position, u32 maxMate, u64 maxNodes);
+void        MateSolverRun(MateSolver* solver);
+void        MateSolverStop(MateSolver* solver);
+bool        MateSolverIsSearching(MateSolver* solver);
+bool        MateSolverPollResult(MateSolver* solver, MateSolverResult* result);
+u64         MateSolverGetNodes(MateSolver* solver);
@@ -0,0 +1,375 @@
+#include "chess_nnue.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define NNUE_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define NNUE_TARGET(isa)
+#else
+#define NNUE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define NNUE_X64 0
+#endif
+
+// Piece of the given color, type and cell seen from one side, cells are mirrored for black so both perspectives
+// share the weights
+chess_internal inline u32 NnueGetFeature(u32 perspective, u32 piece, u32 cell)
+{
+    u32 color    = piece / 6;
+    u32 type     = piece % 6;
+    u32 side     = color != perspective;
+    u32 relative = perspective == 0 ? cell : cell ^ 56;
+
+    return (side * 6 + type) * 64 + relative;
+}
+
+// ----------------------------------------------------------------------------
+// Kernels
+// Apply writes out = in + adds - subs over one perspective, the refresh is the same with in = biases.
+// Dot returns the clipped ReLU of both perspectives times the output weights, wrapping like the SIMD lanes do.
+typedef void NnueApplyFunc(s16* out, const s16* in, const s16* const* adds, u32 addCount, const s16* const* subs,
+                           u32 subCount, u32 size);
+typedef u32  NnueDotFunc(const s16* us, const s16* them, const s16* weights, u32 size);
+
+chess_internal void NnueApplyScalar(s16* out, const s16* in, const s16* const* adds, u32 addCount,
+                                    const s16* const* subs, u32 subCount, u32 size)
+{
+    for (u32 i = 0; i < size; i++)
+    {
+        u16 value = (u16)in[i];
+        for (u32 j = 0; j < addCount; j++)
+        {
+            value += (u16)adds[j][i];
+        }
+        for (u32 j = 0; j < subCount; j++)
+        {
+            value -= (u16)subs[j][i];
+        }
+        out[i] = (s16)value;
+    }
+}
+
+chess_internal u32 NnueDotScalar(const s16* us, const s16* them, const s16* weights, u32 size)
+{
+    u32 result = 0;
+    for (u32 i = 0; i < size; i++)
+    {
+        s32 a = us[i] < 0 ? 0 : us[i] > NNUE_CLIP ? NNUE_CLIP : us[i];
+        s32 b = them[i] < 0 ? 0 : them[i] > NNUE_CLIP ? NNUE_CLIP : them[i];
+        result += (u32)(a * weights[i]);
+        result += (u32)(b * weights[size + i]);
+    }
+
+    return result;
+}
+
+#if NNUE_X64
+NNUE_TARGET("sse4.1")
+chess_internal void NnueApplySse41(s16* out, const s16* in, const s16* const* adds, u32 addCount,
+                                   const s16* const* subs, u32 subCount, u32 size)
+{
+    for (u32 i = 0; i < size; i += 8)
+    {
+        __m128i value = _mm_load_si128((const __m128i*)&in[i]);
+        for (u32 j = 0; j < addCount; j++)
+        {
+            value = _mm_add_epi16(value, _mm_load_si128((const __m128i*)&adds[j][i]));
+        }
+        for (u32 j = 0; j < subCount; j++)
+        {
+            value = _mm_sub_epi16(value, _mm_load_si128((const __m128i*)&subs[j][i]));
+        }
+        _mm_store_si128((__m128i*)&out[i], value);
+    }
+}
+
+NNUE_TARGET("sse4.1")
+chess_internal u32 NnueDotSse41(const s16* us, const s16* them, const s16* weights, u32 size)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i clip = _mm_set1_epi16(NNUE_CLIP);
+    __m128i sum  = _mm_setzero_si128();
+    for (u32 i = 0; i < size; i += 8)
+    {
+        __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)&us[i]), zero), clip);
+        __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)&them[i]), zero), clip);
+        sum       = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_load_si128((const __m128i*)&weights[i])));
+        sum       = _mm_add_epi32(sum, _mm_madd_epi16(b, _mm_load_si128((const __m128i*)&weights[size + i])));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (u32)_mm_cvtsi128_si32(sum);
+}
+
+NNUE_TARGET("avx2")
+chess_internal void NnueApplyAvx2(s16* out, const s16* in, const s16* const* adds, u32 addCount,
+                                  const s16* const* subs, u32 subCount, u32 size)
+{
+    for (u32 i = 0; i < size; i += 16)
+    {
+        __m256i value = _mm256_load_si256((const __m256i*)&in[i]);
+        for (u32 j = 0; j < addCount; j++)
+        {
+            value = _mm256_add_epi16(value, _mm256_load_si256((const __m256i*)&adds[j][i]));
+        }
+        for (u32 j = 0; j < subCount; j++)
+        {
+            value = _mm256_sub_epi16(value, _mm256_load_si256((const __m256i*)&subs[j][i]));
+        }
+        _mm256_store_si256((__m256i*)&out[i], value);
+    }
+}
+
+NNUE_TARGET("avx2")
+chess_internal u32 NnueDotAvx2(const s16* us, const s16* them, const s16* weights, u32 size)
+{
+    __m256i zero = _mm256_setzero_si256();
+    __m256i clip = _mm256_set1_epi16(NNUE_CLIP);
+    __m256i sum  = _mm256_setzero_si256();
+    for (u32 i = 0; i < size; i += 16)
+    {
+        __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)&us[i]), zero), clip);
+        __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)&them[i]), zero), clip);
+        sum       = _mm256_add_epi32(sum, _mm256_madd_epi16(a, _mm256_load_si256((const __m256i*)&weights[i])));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(b, _mm256_load_si256((const __m256i*)&weights[size + i])));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (u32)_mm_cvtsi128_si32(half);
+}
+
+chess_internal NnueApplyFunc* const nnueApplyKernels[NNUE_KERNEL_COUNT] = { NnueApplyScalar, NnueApplySse41,
+                                                                            NnueApplyAvx2 };
+chess_internal NnueDotFunc* const   nnueDotKernels[NNUE_KERNEL_COUNT]   = { NnueDotScalar, NnueDotSse41, NnueDotAvx2 };
+#else
+chess_internal NnueApplyFunc* const nnueApplyKernels[NNUE_KERNEL_COUNT] = { NnueApplyScalar, NnueApplyScalar,
+                                                                            NnueApplyScalar };
+chess_internal NnueDotFunc* const   nnueDotKernels[NNUE_KERNEL_COUNT] = { NnueDotScalar, NnueDotScalar, NnueDotScalar };
+#endif
+
+bool NnueIsKernelSupported(u32 kernel)
+{
+    bool result = kernel == NNUE_KERNEL_SCALAR;
+
+#if NNUE_X64
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool hasSse41 = (info[2] >> 19) & 1;
+    bool hasOsAvx = ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    bool hasAvx2 = hasOsAvx && ((info[1] >> 5) & 1);
+#else
+    bool hasSse41 = __builtin_cpu_supports("sse4.1");
+    bool hasAvx2  = __builtin_cpu_supports("avx2");
+#endif
+    result = result || (kernel == NNUE_KERNEL_SSE41 && hasSse41) || (kernel == NNUE_KERNEL_AVX2 && hasAvx2);
+#endif
+
+    return result;
+}
+
+const char* NnueGetKernelName(u32 kernel)
+{
+    chess_internal const char* names[NNUE_KERNEL_COUNT] = { "scalar", "sse4.1", "avx2" };
+    CHESS_ASSERT(kernel < NNUE_KERNEL_COUNT);
+
+    return names[kernel];
+}
+// ----------------------------------------------------------------------------
+
+// Returns false when the content is not a network this code can run
+bool NnueLoad(NnueNetwork* network, MemoryArena* arena, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(network);
+    CHESS_ASSERT(arena);
+
+    if (!content || contentSize < sizeof(NnueFileHeader))
+    {
+        return false;
+    }
+
+    NnueFileHeader header;
+    memcpy(&header, content, sizeof(header));
+
+    u32 hiddenSize  = header.hiddenSize;
+    u64 weightCount = ((u64)NNUE_INPUT_SIZE + 1 + 2) * hiddenSize;
+    bool isValid    = header.magic == NNUE_MAGIC && header.version == NNUE_VERSION &&
+                   header.inputSize == NNUE_INPUT_SIZE && hiddenSize > 0 && hiddenSize <= NNUE_MAX_HIDDEN &&
+                   (hiddenSize % NNUE_HIDDEN_ALIGN) == 0 && header.outputDivisor != 0 &&
+                   contentSize == sizeof(header) + weightCount * sizeof(s16) + sizeof(s32);
+    if (!isValid)
+    {
+        return false;
+    }
+
+    const u8* weights = (const u8*)content + sizeof(header);
+    s16*      copy    = (s16*)ArenaPushSize(arena, weightCount * sizeof(s16), 64);
+    memcpy(copy, weights, weightCount * sizeof(s16));
+
+    network->hiddenSize     = hiddenSize;
+    network->outputScale    = header.outputScale;
+    network->outputDivisor  = header.outputDivisor;
+    network->featureWeights = copy;
+    network->featureBiases  = copy + (u64)NNUE_INPUT_SIZE * hiddenSize;
+    network->outputWeights  = network->featureBiases + hiddenSize;
+    memcpy(&network->outputBias, weights + weightCount * sizeof(s16), sizeof(s32));
+
+    network->kernel = NNUE_KERNEL_SCALAR;
+    for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+    {
+        if (NnueIsKernelSupported(kernel))
+        {
+            network->kernel = kernel;
+        }
+    }
+
+    return true;
+}
+
+// Full rebuild from the pieces on the board, only needed at the root of a search
+void NnueRefresh(NnueNetwork* network, NnueAccumulator* accumulator, const chess::Board& position)
+{
+    CHESS_ASSERT(network);
+    CHESS_ASSERT(accumulator);
+
+    const s16* rows[2][32];
+    u32        rowCount = 0;
+
+    chess::Bitboard occupied = position.occ();
+    while (occupied && rowCount < 32)
+    {
+        u32 cell  = occupied.pop();
+        u32 piece = (u32)position.at(chess::Square((s32)cell));
+        for (u32 perspective = 0; perspective < 2; perspective++)
+        {
+            u32 feature                = NnueGetFeature(perspective, piece, cell);
+            rows[perspective][rowCount] = &network->featureWeights[(u64)feature * network->hiddenSize];
+        }
+        rowCount++;
+    }
+
+    NnueApplyFunc* Apply = nnueApplyKernels[network->kernel];
+    for (u32 perspective = 0; perspective < 2; perspective++)
+    {
+        Apply(accumulator->values[perspective], network->featureBiases, rows[perspective], rowCount, 0, 0,
+              network->hiddenSize);
+    }
+}
+
+// Position before the move, castling moves are encoded king takes own rook
+void NnueGetChanges(const chess::Board& position, chess::Move move, NnueChanges* changes)
+{
+    CHESS_ASSERT(changes);
+
+    chess::Square from  = move.from();
+    chess::Square to    = move.to();
+    chess::Piece  piece = position.at(from);
+    chess::Color  color = piece.color();
+
+    changes->addCount = 0;
+    changes->subCount = 0;
+
+    changes->subPieces[changes->subCount] = (u8)(s32)piece;
+    changes->subCells[changes->subCount]  = (u8)from.index();
+    changes->subCount++;
+
+    if (move.typeOf() == chess::Move::CASTLING)
+    {
+        bool          isKingSide = to > from;
+        chess::Square kingTo     = chess::Square::castling_king_square(isKingSide, color);
+        chess::Square rookTo     = chess::Square::castling_rook_square(isKingSide, color);
+        chess::Piece  rook       = position.at(to);
+
+        changes->subPieces[changes->subCount] = (u8)(s32)rook;
+        changes->subCells[changes->subCount]  = (u8)to.index();
+        changes->subCount++;
+
+        changes->addPieces[changes->addCount] = (u8)(s32)piece;
+        changes->addCells[changes->addCount]  = (u8)kingTo.index();
+        changes->addCount++;
+        changes->addPieces[changes->addCount] = (u8)(s32)rook;
+        changes->addCells[changes->addCount]  = (u8)rookTo.index();
+        changes->addCount++;
+
+        return;
+    }
+
+    chess::Piece  captured     = position.at(to);
+    chess::Square capturedCell = to;
+    if (move.typeOf() == chess::Move::ENPASSANT)
+    {
+        capturedCell = to.ep_square();
+        captured     = position.at(capturedCell);
+    }
+    if (captured != chess::Piece::NONE)
+    {
+        changes->subPieces[changes->subCount] = (u8)(s32)captured;
+        changes->subCells[changes->subCount]  = (u8)capturedCell.index();
+        changes->subCount++;
+    }
+
+    chess::Piece placed = piece;
+    if (move.typeOf() == chess::Move::PROMOTION)
+    {
+        placed = chess::Piece(move.promotionType(), color);
+    }
+    changes->addPieces[changes->addCount] = (u8)(s32)placed;
+    changes->addCells[changes->addCount]  = (u8)to.index();
+    changes->addCount++;
+}
+
+// Copy on make: the previous accumulator stays untouched, so unmaking a move is only stepping back one entry
+void NnueApplyChanges(NnueNetwork* network, NnueAccumulator* next, const NnueAccumulator* previous,
+                      const NnueChanges* changes)
+{
+    CHESS_ASSERT(network);
+    CHESS_ASSERT(next && previous && changes);
+
+    NnueApplyFunc* Apply = nnueApplyKernels[network->kernel];
+    for (u32 perspective = 0; perspective < 2; perspective++)
+    {
+        const s16* adds[NNUE_MAX_CHANGES];
+        const s16* subs[NNUE_MAX_CHANGES];
+        for (u32 i = 0; i < changes->addCount; i++)
+        {
+            u32 feature = NnueGetFeature(perspective, changes->addPieces[i], changes->addCells[i]);
+            adds[i]     = &network->featureWeights[(u64)feature * network->hiddenSize];
+        }
+        for (u32 i = 0; i < changes->subCount; i++)
+        {
+            u32 feature = NnueGetFeature(perspective, changes->subPieces[i], changes->subCells[i]);
+            subs[i]     = &network->featureWeights[(u64)feature * network->hiddenSize];
+        }
+
+        Apply(next->values[perspective], previous->values[perspective], adds, changes->addCount, subs,
+              changes->subCount, network->hiddenSize);
+    }
+}
+
+// Call before making the move on the position
+void NnueUpdate(NnueNetwork* network, NnueAccumulator* next, const NnueAccumulator* previous,
+                const chess::Board& position, chess::Move move)
+{
+    NnueChanges changes;
+    NnueGetChanges(position, move, &changes);
+    NnueApplyChanges(network, next, previous, &changes);
+}
+
+// Side to move point of view, in centipawns
+s32 NnueEvaluate(NnueNetwork* network, const NnueAccumulator* accumulator, chess::Color sideToMove)
+{
+    CHESS_ASSERT(network);
+    CHESS_ASSERT(accumulator);
+
+    u32 us     = (u32)(s32)sideToMove;
+    s32 output = (s32)nnueDotKernels[network->kernel](accumulator->values[us], accumulator->values[us ^ 1],
+                                                      network->outputWeights, network->hiddenSize);
+
+    return (s32)(((s64)output + network->outputBias) * network->outputScale / network->outputDivisor);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "chess_game_logic.h"
+
+// Efficiently updatable evaluation: one int16 feature transformer per perspective followed by a clipped ReLU and a
+// single output neuron. Integer only, so every kernel returns the same bits.
+
+#define NNUE_MAGIC        0x45554E43 // "CNUE"
+#define NNUE_VERSION      1
+#define NNUE_INPUT_SIZE   768 // 2 sides * 6 piece types * 64 cells, relative to the perspective
+#define NNUE_MAX_HIDDEN   512
+#define NNUE_HIDDEN_ALIGN 16 // int16 lanes of an AVX2 register
+#define NNUE_CLIP         255
+#define NNUE_MAX_CHANGES  2
+
+// Arena space NnueLoad takes for the largest network: weights, biases and output weights, aligned to 64
+#define NNUE_MAX_ARENA_SIZE (((u64)NNUE_INPUT_SIZE + 1 + 2) * NNUE_MAX_HIDDEN * sizeof(s16) + 64)
+
+#define NNUE_NETWORK_PATH "../data/chess_eval.nnue"
+
+// Kernels share one layout, the best supported one is picked by NnueLoad
+enum
+{
+    NNUE_KERNEL_SCALAR,
+    NNUE_KERNEL_SSE41,
+    NNUE_KERNEL_AVX2,
+    NNUE_KERNEL_COUNT
+};
+
+// Little endian file layout: this header, s16 feature weights [NNUE_INPUT_SIZE][hiddenSize], s16 feature biases
+// [hiddenSize], s16 output weights [2][hiddenSize] (side to move first) and the s32 output bias.
+// Evaluation is (output + outputBias) * outputScale / outputDivisor, in centipawns for the side to move.
+struct NnueFileHeader
+{
+    u32 magic;
+    u32 version;
+    u32 inputSize;
+    u32 hiddenSize;
+    s32 outputScale;
+    s32 outputDivisor;
+};
+
+// Weights are copied to the arena at 64 byte alignment, so the file memory can be freed after NnueLoad
+struct NnueNetwork
+{
+    u32  hiddenSize;
+    s32  outputBias;
+    s32  outputScale;
+    s32  outputDivisor;
+    s16* featureWeights;
+    s16* featureBiases;
+    s16* outputWeights;
+    u32  kernel;
+};
+
+// Hidden layer before the activation, indexed by chess::Color
+struct alignas(64) NnueAccumulator
+{
+    s16 values[2][NNUE_MAX_HIDDEN];
+};
+
+// Pieces a move removes and adds, chess::Piece and chess::Square encodings
+struct NnueChanges
+{
+    u8 addCount;
+    u8 subCount;
+    u8 addPieces[NNUE_MAX_CHANGES];
+    u8 addCells[NNUE_MAX_CHANGES];
+    u8 subPieces[NNUE_MAX_CHANGES];
+    u8 subCells[NNUE_MAX_CHANGES];
+};
+
+bool        NnueLoad(NnueNetwork* network, MemoryArena* arena, const void* content, u64 contentSize);
+bool        NnueIsKernelSupported(u32 kernel);
+const char* NnueGetKernelName(u32 kernel);
+void        NnueRefresh(NnueNetwork* network, NnueAccumulator* accumulator, const chess::Board& position);
+void        NnueGetChanges(const chess::Board& position, chess::Move move, NnueChanges* changes);
+void        NnueApplyChanges(NnueNetwork* network, NnueAccumulator* next, const NnueAccumulator* previous,
+                             const NnueChanges* changes);
+void        NnueUpdate(NnueNetwork* network, NnueAccumulator* next, const NnueAccumulator* previous,
+                       const chess::Board& position, chess::Move move);
+s32         NnueEvaluate(NnueNetwork* network, const NnueAccumulator* accumulator, chess::Color sideToMove);
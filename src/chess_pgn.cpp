@@ -0,0 +1,253 @@
+#include "chess_pgn.h"
+
+#include <istream>
+
+// The offsets array is reserved once, every file opened afterwards reuses it
+void PgnInit(PgnFile* pgn, MemoryArena* arena)
+{
+    CHESS_ASSERT(pgn);
+    CHESS_ASSERT(arena);
+
+    pgn->offsets = ARENA_PUSH_ARRAY(arena, u64, PGN_MAX_GAMES);
+    PgnOpen(pgn, 0, 0);
+}
+
+// Nothing is scanned here, a missing file is an empty one
+void PgnOpen(PgnFile* pgn, const void* content, u64 contentSize)
+{
+    CHESS_ASSERT(pgn);
+
+    pgn->content     = (const char*)content;
+    pgn->contentSize = content ? contentSize : 0;
+    pgn->gameCount   = 0;
+    pgn->scanOffset  = 0;
+    pgn->isInMoves   = false;
+    pgn->isIndexed   = pgn->contentSize == 0;
+}
+
+// A game starts at the first tag line of the file and at every tag line that follows movetext. Lines are scanned
+// whole, so a step can overrun the budget by one line. True once the end of the file is reached.
+bool PgnIndexStep(PgnFile* pgn, u64 budget)
+{
+    CHESS_ASSERT(pgn);
+
+    const char* content = pgn->content;
+    u64         offset  = pgn->scanOffset;
+    u64         end     = pgn->contentSize - offset > budget ? offset + budget : pgn->contentSize;
+    while (offset < end)
+    {
+        const char* line    = content + offset;
+        const char* newline = (const char*)memchr(line, '\n', pgn->contentSize - offset);
+        u64         next    = newline ? (u64)(newline - content) + 1 : pgn->contentSize;
+
+        if (line[0] == '[')
+        {
+            if (pgn->isInMoves || pgn->gameCount == 0)
+            {
+                // Games past the offsets array are not listed
+                if (pgn->gameCount == PGN_MAX_GAMES)
+                {
+                    offset = pgn->contentSize;
+                    break;
+                }
+                pgn->offsets[pgn->gameCount++] = offset;
+                pgn->isInMoves                 = false;
+            }
+        }
+        else if (line[0] != '\n' && line[0] != '\r')
+        {
+            pgn->isInMoves = true;
+        }
+
+        offset = next;
+    }
+
+    pgn->scanOffset = offset;
+    pgn->isIndexed  = offset >= pgn->contentSize;
+
+    return pgn->isIndexed;
+}
+
+// The end of a game is the start of the next one, the index is extended until it is known
+bool PgnGetGameRange(PgnFile* pgn, u32 gameIndex, u64* begin, u64* end)
+{
+    CHESS_ASSERT(pgn);
+    CHESS_ASSERT(begin);
+    CHESS_ASSERT(end);
+
+    while (gameIndex + 1 >= pgn->gameCount && !pgn->isIndexed)
+    {
+        PgnIndexStep(pgn, KILOBYTES(64));
+    }
+    if (gameIndex >= pgn->gameCount)
+    {
+        return false;
+    }
+
+    *begin = pgn->offsets[gameIndex];
+    *end   = gameIndex + 1 < pgn->gameCount ? pgn->offsets[gameIndex + 1] : pgn->contentSize;
+
+    return true;
+}
+
+chess_internal void PgnCopyTagValue(char* buffer, const char* value, u64 length)
+{
+    u64 count = length < PGN_TAG_MAX_LENGTH - 1 ? length : PGN_TAG_MAX_LENGTH - 1;
+    memcpy(buffer, value, count);
+    buffer[count] = '\0';
+}
+
+// Straight from the tag lines of the mapped file, without the parser. Missing tags read as "?".
+bool PgnReadTags(PgnFile* pgn, u32 gameIndex, PgnTags* tags)
+{
+    CHESS_ASSERT(pgn);
+    CHESS_ASSERT(tags);
+
+    strcpy(tags->white, "?");
+    strcpy(tags->black, "?");
+    strcpy(tags->result, "?");
+    strcpy(tags->date, "?");
+
+    u64 begin;
+    u64 end;
+    if (!PgnGetGameRange(pgn, gameIndex, &begin, &end))
+    {
+        return false;
+    }
+
+    const char* cursor = pgn->content + begin;
+    const char* last   = pgn->content + end;
+    while (cursor < last && *cursor == '[')
+    {
+        const char* lineEnd = (const char*)memchr(cursor, '\n', last - cursor);
+        lineEnd             = lineEnd ? lineEnd : last;
+
+        // [Key "Value"]
+        const char* key      = cursor + 1;
+        const char* keyEnd   = (const char*)memchr(key, ' ', lineEnd - key);
+        const char* value    = keyEnd ? (const char*)memchr(keyEnd, '"', lineEnd - keyEnd) : 0;
+        const char* valueEnd = value ? (const char*)memchr(value + 1, '"', lineEnd - value - 1) : 0;
+        if (valueEnd)
+        {
+            u64 keyLength = keyEnd - key;
+            value++;
+            char* buffer = keyLength == 5 && memcmp(key, "White", 5) == 0    ? tags->white
+                           : keyLength == 5 && memcmp(key, "Black", 5) == 0  ? tags->black
+                           : keyLength == 6 && memcmp(key, "Result", 6) == 0 ? tags->result
+                           : keyLength == 4 && memcmp(key, "Date", 4) == 0   ? tags->date
+                                                                             : 0;
+            if (buffer)
+            {
+                PgnCopyTagValue(buffer, value, valueEnd - value);
+            }
+        }
+
+        cursor = lineEnd + 1;
+    }
+
+    return true;
+}
+
+// chess::pgn::StreamParser reads from an std::istream, this one reads the mapped bytes in place
+struct PgnMemoryBuffer : std::streambuf
+{
+    PgnMemoryBuffer(const char* begin, const char* end)
+    {
+        setg((char*)begin, (char*)begin, (char*)end);
+    }
+};
+
+// Moves are parsed against the live position and appended to the history as they come, the SAN text is only
+// ever a view into the parser buffer
+class PgnBoardVisitor : public chess::pgn::Visitor
+{
+public:
+    Board* board;
+    bool   isValid;
+
+    void startPgn()
+    {
+        BoardReset(board, chess::constants::STARTPOS);
+        isValid = true;
+    }
+
+    void header(std::string_view key, std::string_view value)
+    {
+        if (key == "FEN")
+        {
+            // A FEN longer than any legal one fails instead of being cut into a different position
+            char fen[FEN_STR_MAX_LENGTH];
+            isValid = value.size() < FEN_STR_MAX_LENGTH;
+            if (isValid)
+            {
+                memcpy(fen, value.data(), value.size());
+                fen[value.size()] = '\0';
+                isValid           = BoardReset(board, fen);
+            }
+        }
+    }
+
+    void startMoves()
+    {
+        if (!isValid)
+        {
+            skipPgn(true);
+        }
+    }
+
+    void move(std::string_view san, std::string_view)
+    {
+        if (!isValid)
+        {
+            return;
+        }
+
+        chess::Move move;
+        try
+        {
+            move = chess::uci::parseSan(*board->position, san);
+        }
+        catch (...)
+        {
+            move = chess::Move::NO_MOVE;
+        }
+        if (move == chess::Move::NO_MOVE || !BoardHistoryAppend(board, move))
+        {
+            isValid = false;
+            return;
+        }
+    }
+
+    void endPgn()
+    {
+    }
+};
+
+// The board is left on the initial position of the game with every move ready to step through. A game with an
+// illegal move keeps the moves before it. Returns the plies loaded.
+u32 PgnLoadGame(PgnFile* pgn, u32 gameIndex, Board* board)
+{
+    CHESS_ASSERT(pgn);
+    CHESS_ASSERT(board);
+
+    u64 begin;
+    u64 end;
+    if (!PgnGetGameRange(pgn, gameIndex, &begin, &end))
+    {
+        return 0;
+    }
+
+    PgnMemoryBuffer buffer(pgn->content + begin, pgn->content + end);
+    std::istream    stream(&buffer);
+
+    PgnBoardVisitor visitor;
+    visitor.board = board;
+
+    chess::pgn::StreamParser<PGN_PARSER_BUFFER_WIDTH> parser(stream);
+    parser.readGames(visitor);
+
+    u32 plies = board->history.count;
+    BoardSeek(board, 0);
+
+    return plies;
+}
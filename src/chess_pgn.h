@@ -0,0 +1,39 @@
+#pragma once
+
+#include "chess_game_logic.h"
+
+// Multi-game PGN read in place from a mapped file. Games are found by byte offset as the index grows a budget at a
+// time, a game is only parsed when it is listed or loaded. Loading writes its moves straight into Board history.
+
+#define PGN_PATH                "../data/games.pgn"
+#define PGN_MAX_GAMES           (1 << 21)
+#define PGN_INDEX_FRAME_BUDGET  MEGABYTES(4) // Bytes scanned per frame until the whole file is indexed
+#define PGN_TAG_MAX_LENGTH      32
+#define PGN_PARSER_BUFFER_WIDTH 64 // chess::pgn::StreamParser reads WIDTH * WIDTH bytes at a time
+
+struct PgnFile
+{
+    const char* content;
+    u64         contentSize;
+    u64*        offsets; // First byte of every game found so far
+    u32         gameCount;
+    u64         scanOffset; // Everything before it is indexed, always at the start of a line
+    bool        isInMoves;  // The last line scanned was movetext, the next tag line starts a game
+    bool        isIndexed;
+};
+
+// Seven tag roster subset shown in the game list, truncated to fit
+struct PgnTags
+{
+    char white[PGN_TAG_MAX_LENGTH];
+    char black[PGN_TAG_MAX_LENGTH];
+    char result[PGN_TAG_MAX_LENGTH];
+    char date[PGN_TAG_MAX_LENGTH];
+};
+
+void PgnInit(PgnFile* pgn, MemoryArena* arena);
+void PgnOpen(PgnFile* pgn, const void* content, u64 contentSize);
+bool PgnIndexStep(PgnFile* pgn, u64 budget);
+bool PgnGetGameRange(PgnFile* pgn, u32 gameIndex, u64* begin, u64* end);
+bool PgnReadTags(PgnFile* pgn, u32 gameIndex, PgnTags* tags);
+u32  PgnLoadGame(PgnFile* pgn, u32 gameIndex, Board* board);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 enum
 {
     GAME_INPUT_CONTROLLER_KEYBOARD_0,
@@ -15,6 +17,10 @@ enum
     GAME_BUTTON_ACTION,
     GAME_BUTTON_CANCEL,
     GAME_BUTTON_START,
+    GAME_BUTTON_REWIND,
+    GAME_BUTTON_SAVE,
+    GAME_BUTTON_LOAD,
+    GAME_BUTTON_SOLVE,
     GAME_BUTTON_COUNT
 };
 
@@ -54,6 +60,10 @@ struct GameInputController
             GameButtonState buttonAction;
             GameButtonState buttonCancel;
             GameButtonState buttonStart;
+            GameButtonState buttonRewind;
+            GameButtonState buttonSave;
+            GameButtonState buttonLoad;
+            GameButtonState buttonSolve;
         };
     };
 };
@@ -99,6 +109,14 @@ struct FileReadResult
     const char* filename;
 };
 
+// Read-only view of a whole file, the OS pages it in on first touch so the size costs nothing up front
+struct FileMapResult
+{
+    const void* content;
+    u64         contentSize;
+    void*       handle; // Platform mapping, passed back to FileUnmap
+};
+
 #define PLATFORM_SOUND_LOAD(name) Sound name(const char* filename)
 typedef PLATFORM_SOUND_LOAD(PlatformSoundLoadFunc);
 
@@ -132,27 +150,77 @@ typedef PLATFORM_TIMER_GET_TICKS(PlatformTimerGetTicksFunc);
 #define PLATFORM_FILE_READ_ENTIRE(name) FileReadResult name(const char* filename)
 typedef PLATFORM_FILE_READ_ENTIRE(PlatformFileReadEntireFunc);
 
+#define PLATFORM_FILE_WRITE_ENTIRE(name) bool name(const char* filename, const void* memory, u64 size)
+typedef PLATFORM_FILE_WRITE_ENTIRE(PlatformFileWriteEntireFunc);
+
 #define PLATFORM_FILE_FREE_MEMORY(name) void name(void* memory)
 typedef PLATFORM_FILE_FREE_MEMORY(PlatformFileFreeMemoryFunc);
 
+#define PLATFORM_FILE_MAP(name) FileMapResult name(const char* filename)
+typedef PLATFORM_FILE_MAP(PlatformFileMapFunc);
+
+#define PLATFORM_FILE_UNMAP(name) void name(FileMapResult* file)
+typedef PLATFORM_FILE_UNMAP(PlatformFileUnmapFunc);
+
 #define PLATFORM_LOG(name) void name(const char* fmt, ...)
 typedef PLATFORM_LOG(PlatformLogFunc);
 
+// Child process with its standard input and output redirected to pipes, the game side never blocks on them
+struct PlatformProcess;
+
+// Null when the command can not be started
+#define PLATFORM_PROCESS_START(name) PlatformProcess* name(const char* commandLine)
+typedef PLATFORM_PROCESS_START(PlatformProcessStartFunc);
+
+// Non-blocking, false when the pipe is full or closed
+#define PLATFORM_PROCESS_WRITE(name) bool name(PlatformProcess* process, const void* data, u32 size)
+typedef PLATFORM_PROCESS_WRITE(PlatformProcessWriteFunc);
+
+// Waits at most timeoutMilliseconds for output: bytes read, 0 on timeout, -1 once the process closed its output
+#define PLATFORM_PROCESS_READ(name) s32 name(PlatformProcess* process, void* buffer, u32 size, u32 timeoutMilliseconds)
+typedef PLATFORM_PROCESS_READ(PlatformProcessReadFunc);
+
+// Closes the input pipe, gives the process a moment to exit and kills it otherwise
+#define PLATFORM_PROCESS_STOP(name) void name(PlatformProcess* process)
+typedef PLATFORM_PROCESS_STOP(PlatformProcessStopFunc);
+
+// Background work, entries run on the platform worker threads in any order
+struct PlatformWorkQueue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue* queue, void* data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(PlatformWorkQueueCallback);
+
+#define PLATFORM_WORK_QUEUE_ADD_ENTRY(name)                                                                            \
+    void name(PlatformWorkQueue* queue, PlatformWorkQueueCallback* callback, void* data)
+typedef PLATFORM_WORK_QUEUE_ADD_ENTRY(PlatformWorkQueueAddEntryFunc);
+
+#define PLATFORM_WORK_QUEUE_COMPLETE_ALL(name) void name(PlatformWorkQueue* queue)
+typedef PLATFORM_WORK_QUEUE_COMPLETE_ALL(PlatformWorkQueueCompleteAllFunc);
+
 struct PlatformAPI
 {
-    PlatformSoundLoadFunc*           SoundLoad;
-    PlatformSoundPlayFunc*           SoundPlay;
-    PlatformSoundDestroyFunc*        SoundDestroy;
-    PlatformImageLoadFunc*           ImageLoad;
-    PlatformImageDestroyFunc*        ImageDestroy;
-    PlatformWindowGetDimensionFunc*  WindowGetDimension;
-    PlatformWindowSetFullscreenFunc* WindowSetFullscreen;
-    PlatformWindowSetWindowedFunc*   WindowSetWindowed;
-    PlatformWindowCanResizeFunc*     WindowCanResize;
-    PlatformTimerGetTicksFunc*       TimerGetTicks;
-    PlatformFileReadEntireFunc*      FileReadEntire;
-    PlatformFileFreeMemoryFunc*      FileFreeMemory;
-    PlatformLogFunc*                 Log;
+    PlatformSoundLoadFunc*            SoundLoad;
+    PlatformSoundPlayFunc*            SoundPlay;
+    PlatformSoundDestroyFunc*         SoundDestroy;
+    PlatformImageLoadFunc*            ImageLoad;
+    PlatformImageDestroyFunc*         ImageDestroy;
+    PlatformWindowGetDimensionFunc*   WindowGetDimension;
+    PlatformWindowSetFullscreenFunc*  WindowSetFullscreen;
+    PlatformWindowSetWindowedFunc*    WindowSetWindowed;
+    PlatformWindowCanResizeFunc*      WindowCanResize;
+    PlatformTimerGetTicksFunc*        TimerGetTicks;
+    PlatformFileReadEntireFunc*       FileReadEntire;
+    PlatformFileWriteEntireFunc*      FileWriteEntire;
+    PlatformFileFreeMemoryFunc*       FileFreeMemory;
+    PlatformFileMapFunc*              FileMap;
+    PlatformFileUnmapFunc*            FileUnmap;
+    PlatformLogFunc*                  Log;
+    PlatformProcessStartFunc*         ProcessStart;
+    PlatformProcessWriteFunc*         ProcessWrite;
+    PlatformProcessReadFunc*          ProcessRead;
+    PlatformProcessStopFunc*          ProcessStop;
+    PlatformWorkQueueAddEntryFunc*    WorkQueueAddEntry;
+    PlatformWorkQueueCompleteAllFunc* WorkQueueCompleteAll;
 };
 
 struct GameMemory
@@ -162,6 +230,15 @@ struct GameMemory
     DrawAPI     draw;
     u64         permanentStorageSize;
     void*       permanentStorage;
+
+    PlatformWorkQueue* workQueue;
+    u32                workQueueThreadCount;
+    // Two threads for entries that block, a pipe reader may hold one for the session while file reads like the
+    // explorer lookups use the other. Never waited on by CompleteAll except on reload, so its entries have to
+    // return on cancelWork too.
+    PlatformWorkQueue* ioQueue;
+    // Set by the platform before the game code is unloaded, work entries must return as soon as possible
+    std::atomic<bool> cancelWork;
 };
 
 #define GAME_UPDATE_AND_RENDER(name) bool name(GameMemory* memory, f32 delta)
@@ -24,7 +24,7 @@
 
 #define ARRAY_COUNT(arr) sizeof(arr) / sizeof(arr[0])
 
-#define chess_internal static;
+#define chess_internal static
 
 typedef uint8_t  u8;
 typedef uint16_t u16;
@@ -160,31 +160,36 @@ struct Rect
     f32 h;
 };
 
-template <typename T>
-struct Stack
+// Linear allocator over a fixed memory block, allocations live as long as the block
+struct MemoryArena
 {
-    static constexpr u32 stackSize = 500;
+    u8* base;
+    u64 size;
+    u64 used;
+};
 
-    T   elements[stackSize];
-    u32 top = 0u;
+inline void ArenaInit(MemoryArena* arena, void* base, u64 size)
+{
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT(base);
 
-    void push(T element)
-    {
-        CHESS_ASSERT(top < stackSize);
-        elements[top++] = element;
-    }
+    arena->base = (u8*)base;
+    arena->size = size;
+    arena->used = 0;
+}
 
-    T pop()
-    {
-        CHESS_ASSERT(top > 0);
-        return elements[--top];
-    }
+inline void* ArenaPushSize(MemoryArena* arena, u64 size, u64 alignment = 16)
+{
+    CHESS_ASSERT(arena);
+    CHESS_ASSERT((alignment & (alignment - 1)) == 0);
 
-    T peek() const
-    {
-        CHESS_ASSERT(top > 0);
-        return elements[top - 1];
-    }
+    // The base is wherever the caller's block starts, often just past a state struct, so the address is aligned
+    uintptr_t address = (uintptr_t)(arena->base + arena->used);
+    u64       offset  = arena->used + (((address + (alignment - 1)) & ~(alignment - 1)) - address);
+    CHESS_ASSERT(offset + size <= arena->size);
 
-    void clear() { top = 0; }
-};
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+#define ARENA_PUSH_ARRAY(arena, type, count) (type*)ArenaPushSize(arena, sizeof(type) * (count), alignof(type))
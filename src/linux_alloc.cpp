@@ -0,0 +1,207 @@
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+
+// Allocation test of the piece drag path: a game is played with a random legal move per ply and, before each move,
+// every piece of the side to move is dragged over every cell for a few frames with the board queries the game makes
+// while dragging: hover picking, the target and capture highlights, the check and last move highlights and the three
+// DrawScene passes. The drop looks the move up, formats its UCI text, plays it and formats the FEN the game logs. A
+// counting operator new wraps the frames, any allocation fails the run.
+
+#define ALLOC_DEFAULT_PLIES 200
+#define ALLOC_DRAG_FRAMES   4 // Per hovered cell
+
+chess_internal u64 allocCount;
+
+void* operator new(size_t size)
+{
+    allocCount++;
+    void* result = malloc(size ? size : 1);
+    if (!result)
+    {
+        throw std::bad_alloc();
+    }
+    return result;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    operator delete(memory);
+}
+
+chess_internal inline u64 AllocRandom(u64* state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 33;
+}
+
+// One frame of a piece of fromCell held over hoverCell, folded into the result so nothing is optimized away
+chess_internal u64 AllocDragFrame(Board* board, u32 fromCell, u32 hoverCell)
+{
+    u64 sum = 0;
+
+    // Input: turn, result and the piece under the cursor
+    sum += BoardGetTurn(board) + BoardGetGameResult(board);
+    Piece hoverPiece = BoardGetPiece(board, hoverCell);
+    sum += hoverPiece.type;
+
+    // Render: check and last move highlights, legal targets and captures of the dragged piece
+    if (BoardInCheck(board))
+    {
+        sum += BoardGetKingCell(board);
+    }
+    if (BoardGameStarted(board))
+    {
+        sum += BoardMoveGetLast(board).to;
+    }
+    u64 targets = BoardGetPieceTargets(board, fromCell);
+    while (targets)
+    {
+        u32 cellIndex = CellBitboardPop(&targets);
+        sum += BoardMoveIsCapture(board, cellIndex) ? 2 : 1;
+    }
+    sum += BoardMoveIsLegal(board, fromCell, hoverCell);
+
+    // DrawScene for the picking, shadow and render passes
+    for (u32 pass = 0; pass < 3; pass++)
+    {
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            sum += BoardGetPiece(board, cellIndex).color;
+        }
+    }
+
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    u32 plies = argc > 1 ? (u32)atoi(argv[1]) : ALLOC_DEFAULT_PLIES;
+    if (plies == 0 || plies >= BOARD_HISTORY_MAX_PLIES)
+    {
+        fprintf(stderr, "usage: %s [plies]\n", argv[0]);
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(64);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    Board board;
+    BoardInit(&board, DEFAULT_FEN_STRING, &arena, plies + 1);
+
+    // A counter that misses allocations would pass anything, the probe is too long for the small string buffer
+    u64 probeStart = allocCount;
+    {
+        std::string probe(64, 'x');
+    }
+    if (allocCount == probeStart)
+    {
+        fprintf(stderr, "[LINUX] operator new is not counted\n");
+        return 1;
+    }
+
+    u64 randomState = 1;
+    u64 sum         = 0;
+    u64 dragFrames  = 0;
+    u64 dragAllocs  = 0;
+    u64 drops       = 0;
+    u64 dropAllocs  = 0;
+    u32 ply         = 0;
+    for (; ply < plies && BoardGetGameResult(&board) == BOARD_GAME_RESULT_NONE; ply++)
+    {
+        u32 turn = BoardGetTurn(&board);
+
+        u64 allocStart = allocCount;
+        for (u32 fromCell = 0; fromCell < 64; fromCell++)
+        {
+            Piece piece = BoardGetPiece(&board, fromCell);
+            if (piece.type == PIECE_TYPE_NONE || piece.color != turn)
+            {
+                continue;
+            }
+            for (u32 hoverCell = 0; hoverCell < 64; hoverCell++)
+            {
+                for (u32 frame = 0; frame < ALLOC_DRAG_FRAMES; frame++)
+                {
+                    sum += AllocDragFrame(&board, fromCell, hoverCell);
+                    dragFrames++;
+                }
+            }
+        }
+        dragAllocs += allocCount - allocStart;
+
+        // Drop of a random legal move, as EndPieceDrag does it
+        u32 fromCells[64];
+        u32 fromCount = 0;
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            if (BoardGetPieceTargets(&board, cellIndex))
+            {
+                fromCells[fromCount++] = cellIndex;
+            }
+        }
+        u32 fromCell = fromCells[AllocRandom(&randomState) % fromCount];
+        u32   moveCount;
+        Move* moves  = BoardGetPieceMoveList(&board, fromCell, &moveCount);
+        u32   toCell = moves[AllocRandom(&randomState) % moveCount].to;
+
+        allocStart = allocCount;
+        Move* move = BoardMoveFind(&board, fromCell, toCell);
+        char  uci[UCI_STR_MAX_LENGTH];
+        BoardMoveGetUci(move, uci);
+        BoardMoveDo(&board, move);
+        char fen[FEN_STR_MAX_LENGTH];
+        BoardGetFen(&board, fen);
+        sum += BoardInCheck(&board) + uci[0] + fen[0];
+        dropAllocs += allocCount - allocStart;
+        drops++;
+    }
+
+    printf("%u plies, %llu drag frames: %llu allocations, %llu drops: %llu allocations (checksum %llu)\n", ply,
+           (unsigned long long)dragFrames, (unsigned long long)dragAllocs, (unsigned long long)drops,
+           (unsigned long long)dropAllocs, (unsigned long long)sum);
+
+    if (dragAllocs || dropAllocs)
+    {
+        fprintf(stderr, "[LINUX] the drag path allocated\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_pgn.h"
+#include "chess_pgn.cpp"
+#include "chess_archive.h"
+#include "chess_archive.cpp"
+
+// Game archive benchmark: opens an archive written by ingest or the game, loads every game into a Board the way the
+// game list does and reports games/s. With -v the PGN the archive was made from is loaded game by game too, the time
+// compared and every game checked: same plies, same keys, same result and the same White, Black and Date tags.
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal void* LinuxMapFile(const char* path, u64* size)
+{
+    int         file = open(path, O_RDONLY);
+    struct stat fileStat;
+    if (file < 0 || fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", path);
+        return 0;
+    }
+
+    *size         = (u64)fileStat.st_size;
+    void* content = mmap(0, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (content == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map '%s'\n", path);
+        return 0;
+    }
+
+    return content;
+}
+
+// PgnTags values are truncated to PGN_TAG_MAX_LENGTH - 1 characters
+chess_internal bool ArchiveToolTagEquals(const char* pgnTag, const char* archiveTag)
+{
+    return strncmp(pgnTag, archiveTag, PGN_TAG_MAX_LENGTH - 1) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* pgnPath = 0;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 'v':
+        {
+            pgnPath = value;
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex >= argc)
+    {
+        fprintf(stderr, "usage: %s [-v games.pgn] games.carc\n", argv[0]);
+        return 1;
+    }
+
+    u64   contentSize = 0;
+    void* content     = LinuxMapFile(argv[argIndex], &contentSize);
+    if (!content)
+    {
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(128);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    Board board;
+    BoardInit(&board, chess::constants::STARTPOS, &arena, BOARD_HISTORY_MAX_PLIES);
+
+    f64           start = LinuxGetSeconds();
+    ArchiveReader archive;
+    if (!ArchiveOpen(&archive, content, contentSize))
+    {
+        fprintf(stderr, "[LINUX] '%s' is not a game archive\n", argv[argIndex]);
+        return 1;
+    }
+    f64 openSeconds = LinuxGetSeconds() - start;
+
+    printf("open: %llu games, %llu plies, %llu tag strings, %s moves, %.1f MB, %.1f us\n",
+           (unsigned long long)archive.gameCount, (unsigned long long)archive.header->plyCount,
+           (unsigned long long)archive.header->stringCount,
+           archive.header->encoding == ARCHIVE_ENCODING_MOVE16 ? "16-bit" : "legal index", contentSize / (1024.0 * 1024.0),
+           openSeconds * 1000000.0);
+
+    // Every game into the board, moves read in place
+    u64 plies = 0;
+    start     = LinuxGetSeconds();
+    for (u64 i = 0; i < archive.gameCount; i++)
+    {
+        plies += ArchiveLoadGame(&archive, i, &board);
+    }
+    f64 loadSeconds = LinuxGetSeconds() - start;
+    printf("load: %llu games, %llu plies in %.3fs, %.0f games/s, %.2f M plies/s\n",
+           (unsigned long long)archive.gameCount, (unsigned long long)plies, loadSeconds,
+           loadSeconds > 0.0 ? archive.gameCount / loadSeconds : 0.0,
+           loadSeconds > 0.0 ? plies / loadSeconds / 1000000.0 : 0.0);
+
+    if (!pgnPath)
+    {
+        return plies == archive.header->plyCount ? 0 : 1;
+    }
+
+    u64   pgnSize    = 0;
+    void* pgnContent = LinuxMapFile(pgnPath, &pgnSize);
+    if (!pgnContent)
+    {
+        return 1;
+    }
+
+    PgnFile pgn;
+    PgnInit(&pgn, &arena);
+    PgnOpen(&pgn, pgnContent, pgnSize);
+    while (!PgnIndexStep(&pgn, MEGABYTES(64)))
+    {
+    }
+
+    Board pgnBoard;
+    BoardInit(&pgnBoard, chess::constants::STARTPOS, &arena, BOARD_HISTORY_MAX_PLIES);
+
+    // Same loads from the PGN, then the archive game compared against it
+    u64 games      = pgn.gameCount < archive.gameCount ? pgn.gameCount : archive.gameCount;
+    u64 pgnPlies   = 0;
+    u64 wrongGames = 0;
+    f64 pgnSeconds = 0.0;
+    for (u64 i = 0; i < games; i++)
+    {
+        start        = LinuxGetSeconds();
+        u32 gamePlies = PgnLoadGame(&pgn, (u32)i, &pgnBoard);
+        pgnSeconds += LinuxGetSeconds() - start;
+        pgnPlies += gamePlies;
+
+        PgnTags tags;
+        PgnReadTags(&pgn, (u32)i, &tags);
+        u32 result = strcmp(tags.result, "1-0") == 0       ? ARCHIVE_RESULT_WHITE
+                     : strcmp(tags.result, "0-1") == 0     ? ARCHIVE_RESULT_BLACK
+                     : strcmp(tags.result, "1/2-1/2") == 0 ? ARCHIVE_RESULT_DRAW
+                                                           : ARCHIVE_RESULT_UNKNOWN;
+
+        bool isSame = ArchiveLoadGame(&archive, i, &board) == gamePlies && archive.games[i].result == result &&
+                      ArchiveToolTagEquals(tags.white, ArchiveGetTag(&archive, i, ARCHIVE_TAG_WHITE)) &&
+                      ArchiveToolTagEquals(tags.black, ArchiveGetTag(&archive, i, ARCHIVE_TAG_BLACK)) &&
+                      ArchiveToolTagEquals(tags.date, ArchiveGetTag(&archive, i, ARCHIVE_TAG_DATE)) &&
+                      board.position->hash() == pgnBoard.position->hash();
+        for (u32 ply = 0; isSame && ply < gamePlies; ply++)
+        {
+            isSame = board.history.entries[ply].move == pgnBoard.history.entries[ply].move &&
+                     board.history.keys[ply] == pgnBoard.history.keys[ply];
+        }
+
+        if (!isSame && wrongGames++ < 10)
+        {
+            printf("game %llu differs: %s - %s %s\n", (unsigned long long)i, tags.white, tags.black, tags.result);
+        }
+    }
+
+    printf("pgn: %llu games, %llu plies in %.3fs, %.0f games/s, archive load %.1fx faster, %.1f MB against %.1f MB\n",
+           (unsigned long long)games, (unsigned long long)pgnPlies, pgnSeconds,
+           pgnSeconds > 0.0 ? games / pgnSeconds : 0.0, loadSeconds > 0.0 ? pgnSeconds / loadSeconds : 0.0,
+           contentSize / (1024.0 * 1024.0), pgnSize / (1024.0 * 1024.0));
+    printf("verify: %llu of %llu games differ, %u PGN games and %llu archive games\n", (unsigned long long)wrongGames,
+           (unsigned long long)games, pgn.gameCount, (unsigned long long)archive.gameCount);
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("peak RSS %.1f MB\n", usage.ru_maxrss / 1024.0);
+
+    return wrongGames || pgn.gameCount != archive.gameCount ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+
+// Headless search benchmark: fixed depth Lazy SMP searches over a fixed position set, repeated for 1, 2, 4, ...
+// threads up to -t. Time to depth is the Lazy SMP speedup, nodes/sec shows how well the threads themselves scale.
+
+#define BENCH_DEFAULT_THREADS 16
+#define BENCH_DEFAULT_DEPTH   8
+#define BENCH_DEFAULT_HASH_MB 64
+
+struct BenchPosition
+{
+    const char* name;
+    const char* fen;
+};
+
+chess_internal BenchPosition benchSuite[] = {
+    { "startpos", DEFAULT_FEN_STRING },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1" },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8" },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10" },
+};
+
+// Lives at the start of the mapped memory, like GameState in permanentStorage
+struct LinuxBenchState
+{
+    Board       board;
+    MemoryArena arena;
+    Engine*     engine;
+    pthread_t   threads[ENGINE_MAX_THREADS];
+};
+
+chess_internal void* BenchThreadProc(void* parameter)
+{
+    EngineSearch((EngineThread*)parameter);
+    return 0;
+}
+
+// Every search starts from an empty hash table so thread counts are compared on the same work.
+// False when the search could not be started or left no result.
+chess_internal bool BenchSearch(LinuxBenchState* state, const char* fen, u32 depth, u32 threadCount,
+                                EngineResult* result)
+{
+    Engine* engine = state->engine;
+
+    BoardReset(&state->board, fen);
+    EngineClearHash(engine);
+
+    EngineLimits limits = { depth, 0, 0.0 };
+    if (!EngineStart(engine, &state->board, limits, threadCount))
+    {
+        return false;
+    }
+
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        pthread_create(&state->threads[i], 0, BenchThreadProc, &engine->threads[i]);
+    }
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        pthread_join(state->threads[i], 0);
+    }
+
+    return EnginePollResult(engine, result);
+}
+
+int main(int argc, char** argv)
+{
+    u32 maxThreads = BENCH_DEFAULT_THREADS;
+    u32 depth      = BENCH_DEFAULT_DEPTH;
+    u32 hashMB     = BENCH_DEFAULT_HASH_MB;
+    bool verbose   = false;
+
+    int argIndex = 1;
+    for (; argIndex < argc && argv[argIndex][0] == '-' && argv[argIndex][1] != '\0'; argIndex++)
+    {
+        char option = argv[argIndex][1];
+        if (option == 'v')
+        {
+            verbose = true;
+        }
+        else if (argIndex + 1 < argc && (option == 't' || option == 'd' || option == 'm'))
+        {
+            u32 value = (u32)atoi(argv[++argIndex]);
+            switch (option)
+            {
+            case 't':
+            {
+                maxThreads = value;
+                break;
+            }
+            case 'd':
+            {
+                depth = value;
+                break;
+            }
+            case 'm':
+            {
+                hashMB = value;
+                break;
+            }
+            }
+        }
+        else
+        {
+            argIndex = argc + 1;
+        }
+    }
+
+    if (argIndex != argc || maxThreads == 0 || maxThreads > ENGINE_MAX_THREADS || depth == 0 || hashMB == 0)
+    {
+        fprintf(stderr, "usage: %s [-t maxThreads] [-d depth] [-m hashMB] [-v]\n", argv[0]);
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(64) + MEGABYTES(hashMB) + sizeof(EngineThread) * maxThreads;
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxBenchState* state = (LinuxBenchState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxBenchState), storageSize - sizeof(LinuxBenchState));
+    BoardInit(&state->board, DEFAULT_FEN_STRING, &state->arena, BOARD_HISTORY_SEARCH_PLIES);
+    state->engine = EngineCreate(&state->arena, maxThreads, MEGABYTES(hashMB));
+
+    printf("%u online cores, %u MB hash, depth %u, %llu positions\n", (u32)sysconf(_SC_NPROCESSORS_ONLN), hashMB, depth,
+           (unsigned long long)ARRAY_COUNT(benchSuite));
+
+    f64 baselineSeconds = 0.0;
+    f64 baselineNps     = 0.0;
+    for (u32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+    {
+        f64 seconds = 0.0;
+        u64 nodes   = 0;
+        for (u32 positionIndex = 0; positionIndex < ARRAY_COUNT(benchSuite); positionIndex++)
+        {
+            BenchPosition* position = &benchSuite[positionIndex];
+            EngineResult   result;
+            if (!BenchSearch(state, position->fen, depth, threadCount, &result))
+            {
+                fprintf(stderr, "[LINUX] search of '%s' with %u threads failed\n", position->name, threadCount);
+                return 1;
+            }
+
+            seconds += result.seconds;
+            nodes += result.nodes;
+
+            if (verbose)
+            {
+                printf("  %-10s  %s  score %6d  nodes %10llu  %6.2fs\n", position->name,
+                       chess::uci::moveToUci(chess::Move(result.move)).c_str(), result.score,
+                       (unsigned long long)result.nodes, result.seconds);
+            }
+        }
+
+        f64 nps = nodes / seconds;
+        if (threadCount == 1)
+        {
+            baselineSeconds = seconds;
+            baselineNps     = nps;
+        }
+
+        printf("threads %2u  time %8.2fs  nodes %11llu  %7.2f Mnps  time to depth %5.2fx  nps %5.2fx\n", threadCount,
+               seconds, (unsigned long long)nodes, nps / 1000000.0, baselineSeconds / seconds, nps / baselineNps);
+    }
+
+    return 0;
+}
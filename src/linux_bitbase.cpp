@@ -0,0 +1,175 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_bitbase.h"
+#include "chess_bitbase.cpp"
+
+// Endgame bitbase generator: runs the retrograde passes on -t threads, reports the time, the size and the
+// outcome counts of every table, checks a few textbook positions and optionally writes the game cache file.
+
+struct BitbaseCheck
+{
+    const char* fen;
+    u32         expected; // BITBASE_RESULT_*, side to move point of view
+};
+
+chess_internal BitbaseCheck bitbaseChecks[] = {
+    // King on the sixth in front of its pawn wins with either side to move
+    { "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", BITBASE_RESULT_WIN },
+    { "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", BITBASE_RESULT_LOSS },
+    // Defending king in the corner of a rook pawn
+    { "k7/8/8/PK6/8/8/8/8 w - - 0 1", BITBASE_RESULT_DRAW },
+    // Pawn outside the square of the king
+    { "7k/8/8/P7/8/8/8/7K b - - 0 1", BITBASE_RESULT_LOSS },
+    // Undefended rook next to the king
+    { "8/8/8/4R3/3k4/8/8/K7 b - - 0 1", BITBASE_RESULT_DRAW },
+    { "8/8/8/4R3/3k4/8/8/K7 w - - 0 1", BITBASE_RESULT_WIN },
+    // Stalemate
+    { "k7/8/1QK5/8/8/8/8/8 b - - 0 1", BITBASE_RESULT_DRAW },
+    // Black as the strong side, stalemate and mate
+    { "7k/8/8/8/8/1q6/8/K7 w - - 0 1", BITBASE_RESULT_DRAW },
+    { "8/8/8/8/8/1k6/1q6/K7 w - - 0 1", BITBASE_RESULT_LOSS },
+};
+
+struct LinuxBitbaseState
+{
+    MemoryArena       arena;
+    Bitbases          bitbases;
+    BitbaseGenerator* generator;
+    pthread_t         threads[BITBASE_MAX_SLICES];
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal void* BitbaseThreadProc(void* parameter)
+{
+    BitbaseRunSlice((BitbaseSlice*)parameter);
+    return 0;
+}
+
+// One thread per slice and pass, a pass is long enough for the thread start to vanish
+chess_internal BITBASE_RUN_SLICES(LinuxBitbaseRunSlices)
+{
+    LinuxBitbaseState* state = (LinuxBitbaseState*)context;
+
+    for (u32 i = 1; i < generator->sliceCount; i++)
+    {
+        pthread_create(&state->threads[i], 0, BitbaseThreadProc, &generator->slices[i]);
+    }
+    BitbaseRunSlice(&generator->slices[0]);
+    for (u32 i = 1; i < generator->sliceCount; i++)
+    {
+        pthread_join(state->threads[i], 0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    u32         threadCount = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* outputPath  = 0;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 't':
+        {
+            threadCount = (u32)atoi(value);
+            break;
+        }
+        case 'o':
+        {
+            outputPath = value;
+            break;
+        }
+        default:
+        {
+            argIndex = argc + 1;
+            break;
+        }
+        }
+    }
+
+    if (argIndex != argc || threadCount == 0 || threadCount > BITBASE_MAX_SLICES)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-o %s]\n", argv[0], BITBASE_CACHE_FILE);
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(4);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxBitbaseState* state = (LinuxBitbaseState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxBitbaseState), storageSize - sizeof(LinuxBitbaseState));
+    BitbaseInit(&state->bitbases, &state->arena);
+    state->generator = BitbaseGeneratorCreate(&state->bitbases, &state->arena, threadCount);
+
+    f64 start = LinuxGetSeconds();
+    BitbaseGenerate(state->generator, LinuxBitbaseRunSlices, state);
+    f64 seconds = LinuxGetSeconds() - start;
+
+    printf("%u threads, generated in %.3fs, %llu bytes in memory (%u KB per table), %u KB generation scratch\n",
+           threadCount, seconds, (unsigned long long)sizeof(BitbaseTables), (u32)(sizeof(u64) * BITBASE_WORDS / 1024),
+           (u32)(BITBASE_POSITIONS / 1024));
+
+    const char* names[BITBASE_COUNT] = { "KQK", "KRK", "KPK" };
+    for (u32 ending = 0; ending < BITBASE_COUNT; ending++)
+    {
+        u64 wins[2] = { 0, 0 };
+        for (u32 i = 0; i < BITBASE_POSITIONS; i++)
+        {
+            wins[i / (BITBASE_POSITIONS / 2)] += BitbaseIsWin(state->bitbases.tables, ending, i);
+        }
+        printf("%s  wins with the strong side to move %6llu, with the weak side to move %6llu\n", names[ending],
+               (unsigned long long)wins[0], (unsigned long long)wins[1]);
+    }
+
+    u32 failed = 0;
+    for (u32 i = 0; i < ARRAY_COUNT(bitbaseChecks); i++)
+    {
+        chess::Board position(bitbaseChecks[i].fen);
+        u32          result = BitbaseProbe(&state->bitbases, position);
+        if (result != bitbaseChecks[i].expected)
+        {
+            printf("FAILED %s: %u, expected %u\n", bitbaseChecks[i].fen, result, bitbaseChecks[i].expected);
+            failed++;
+        }
+    }
+    printf("%llu of %llu textbook positions ok\n", (unsigned long long)(ARRAY_COUNT(bitbaseChecks) - failed),
+           (unsigned long long)ARRAY_COUNT(bitbaseChecks));
+
+    if (outputPath)
+    {
+        FILE* file = fopen(outputPath, "wb");
+        if (!file || fwrite(state->bitbases.tables, sizeof(BitbaseTables), 1, file) != 1)
+        {
+            fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+            return 1;
+        }
+        fclose(file);
+        printf("written to '%s'\n", outputPath);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,448 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_book.h"
+#include "chess_book.cpp"
+
+// Polyglot book builder: streams PGN files through chess::pgn::StreamParser and records (key, move, weight) for
+// the first plies of every game. Records fill a fixed buffer, every full buffer is sorted, merged by (key, move)
+// and spilled to a temporary run, then the runs are k-way merged into the book. Memory stays at the buffer size
+// whatever the input size.
+
+#define BOOK_DEFAULT_PLIES     20
+#define BOOK_DEFAULT_MEMORY_MB 256
+#define BOOK_MAX_RUNS          1024
+#define BOOK_RUN_BUFFER_SIZE   KILOBYTES(256)
+
+// Polyglot weights: 2 for a move of the winner, 1 for a draw, 0 for the loser. Moves that only lost are dropped.
+#define BOOK_WEIGHT_WIN  2
+#define BOOK_WEIGHT_DRAW 1
+
+struct BookRecord
+{
+    u64 key;
+    u32 weight;
+    u16 move; // Polyglot encoding
+};
+
+// Sorted, duplicate free spill of one full buffer, read back through a small buffer during the merge
+struct BookRun
+{
+    FILE*       file;
+    BookRecord* buffer;
+    u32         count;
+    u32         index;
+    BookRecord  head;
+};
+
+struct LinuxBookState
+{
+    MemoryArena arena;
+
+    BookRecord* records;
+    u64         recordCapacity;
+    u64         recordCount;
+
+    BookRun runs[BOOK_MAX_RUNS];
+    u32     runCount;
+
+    u32  maxPlies;
+    u64  games;
+    u64  skippedGames;
+    u64  positions;
+};
+
+chess_internal inline bool BookRecordLess(const BookRecord& a, const BookRecord& b)
+{
+    return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+
+// Sorts the buffer and merges equal (key, move) records, returns the new count
+chess_internal u64 BookSortRecords(BookRecord* records, u64 count)
+{
+    std::sort(records, records + count, BookRecordLess);
+
+    u64 result = 0;
+    for (u64 i = 0; i < count; i++)
+    {
+        if (result > 0 && records[result - 1].key == records[i].key && records[result - 1].move == records[i].move)
+        {
+            records[result - 1].weight += records[i].weight;
+        }
+        else
+        {
+            records[result++] = records[i];
+        }
+    }
+
+    return result;
+}
+
+chess_internal void BookSpillRun(LinuxBookState* state)
+{
+    u64 count = BookSortRecords(state->records, state->recordCount);
+
+    if (state->runCount == BOOK_MAX_RUNS)
+    {
+        fprintf(stderr, "[LINUX] more than %u runs, raise the memory budget\n", BOOK_MAX_RUNS);
+        exit(1);
+    }
+
+    FILE* file = tmpfile();
+    if (!file || fwrite(state->records, sizeof(BookRecord), count, file) != count)
+    {
+        fprintf(stderr, "[LINUX] unable to write a temporary run\n");
+        exit(1);
+    }
+    rewind(file);
+
+    BookRun* run = &state->runs[state->runCount++];
+    run->file    = file;
+
+    state->recordCount = 0;
+}
+
+// Visitor callbacks: the result header sets the weights before the moves arrive
+class BookVisitor : public chess::pgn::Visitor
+{
+public:
+    LinuxBookState* state;
+    chess::Board    position;
+    u32             ply;
+    u32             whiteWeight;
+    u32             blackWeight;
+    bool            isValid;
+
+    void startPgn()
+    {
+        position.setFen(chess::constants::STARTPOS);
+        ply         = 0;
+        whiteWeight = BOOK_WEIGHT_DRAW;
+        blackWeight = BOOK_WEIGHT_DRAW;
+        isValid     = true;
+    }
+
+    void header(std::string_view key, std::string_view value)
+    {
+        if (key == "FEN")
+        {
+            // The tag value is not terminated, a FEN longer than any legal one fails like a malformed one
+            char fen[FEN_STR_MAX_LENGTH];
+            isValid = value.size() < FEN_STR_MAX_LENGTH;
+            if (isValid)
+            {
+                memcpy(fen, value.data(), value.size());
+                fen[value.size()] = '\0';
+                isValid           = BoardPositionSetFen(&position, fen);
+            }
+        }
+        else if (key == "Result")
+        {
+            whiteWeight = value == "1-0" ? BOOK_WEIGHT_WIN : value == "0-1" ? 0 : BOOK_WEIGHT_DRAW;
+            blackWeight = value == "1-0" ? 0 : value == "0-1" ? BOOK_WEIGHT_WIN : BOOK_WEIGHT_DRAW;
+            isValid     = isValid && value != "*";
+        }
+    }
+
+    void startMoves()
+    {
+        if (!isValid)
+        {
+            skipPgn(true);
+        }
+    }
+
+    void move(std::string_view san, std::string_view)
+    {
+        if (!isValid || ply >= state->maxPlies)
+        {
+            return;
+        }
+
+        chess::Move move;
+        try
+        {
+            move = chess::uci::parseSan(position, san);
+        }
+        catch (...)
+        {
+            move = chess::Move::NO_MOVE;
+        }
+        if (move == chess::Move::NO_MOVE)
+        {
+            isValid = false;
+            return;
+        }
+
+        u32 weight = position.sideToMove() == chess::Color::WHITE ? whiteWeight : blackWeight;
+        if (weight > 0)
+        {
+            if (state->recordCount == state->recordCapacity)
+            {
+                BookSpillRun(state);
+            }
+            BookRecord* record = &state->records[state->recordCount++];
+            record->key        = position.hash();
+            record->move       = BookEncodeMove(move);
+            record->weight     = weight;
+            state->positions++;
+        }
+
+        position.makeMove(move);
+        ply++;
+    }
+
+    void endPgn()
+    {
+        state->games += isValid;
+        state->skippedGames += !isValid;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Merge
+chess_internal bool BookRunAdvance(BookRun* run)
+{
+    if (run->index == run->count)
+    {
+        run->count = (u32)fread(run->buffer, sizeof(BookRecord), BOOK_RUN_BUFFER_SIZE / sizeof(BookRecord),
+                                run->file);
+        run->index = 0;
+        if (run->count == 0)
+        {
+            return false;
+        }
+    }
+    run->head = run->buffer[run->index++];
+
+    return true;
+}
+
+// Min heap of run indices ordered by their head record
+chess_internal void BookHeapSiftDown(BookRun* runs, u32* heap, u32 heapCount, u32 index)
+{
+    for (;;)
+    {
+        u32 smallest = index;
+        u32 left     = index * 2 + 1;
+        u32 right    = left + 1;
+        if (left < heapCount && BookRecordLess(runs[heap[left]].head, runs[heap[smallest]].head))
+        {
+            smallest = left;
+        }
+        if (right < heapCount && BookRecordLess(runs[heap[right]].head, runs[heap[smallest]].head))
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        u32 _index     = heap[index];
+        heap[index]    = heap[smallest];
+        heap[smallest] = _index;
+        index          = smallest;
+    }
+}
+
+// Writes the moves of one key, weights are scaled down together when one overflows 16 bits
+chess_internal u64 BookFlushKey(FILE* output, BookRecord* moves, u32 moveCount)
+{
+    u32 maxWeight = 0;
+    for (u32 i = 0; i < moveCount; i++)
+    {
+        if (moves[i].weight > maxWeight)
+        {
+            maxWeight = moves[i].weight;
+        }
+    }
+
+    u64 result = 0;
+    for (u32 i = 0; i < moveCount; i++)
+    {
+        u64 weight = maxWeight > 0xFFFF ? (u64)moves[i].weight * 0xFFFF / maxWeight : moves[i].weight;
+        if (weight > 0)
+        {
+            u8 entry[BOOK_ENTRY_SIZE];
+            BookWriteEntry(entry, moves[i].key, moves[i].move, (u16)weight);
+            fwrite(entry, 1, BOOK_ENTRY_SIZE, output);
+            result++;
+        }
+    }
+
+    return result;
+}
+
+chess_internal u64 BookMergeRuns(LinuxBookState* state, FILE* output)
+{
+    u32 heap[BOOK_MAX_RUNS];
+    u32 heapCount = 0;
+    for (u32 i = 0; i < state->runCount; i++)
+    {
+        BookRun* run = &state->runs[i];
+        run->buffer  = (BookRecord*)ArenaPushSize(&state->arena, BOOK_RUN_BUFFER_SIZE);
+        if (BookRunAdvance(run))
+        {
+            heap[heapCount++] = i;
+        }
+    }
+    for (u32 i = heapCount / 2; i-- > 0;)
+    {
+        BookHeapSiftDown(state->runs, heap, heapCount, i);
+    }
+
+    // Moves of the current key, a position has at most 218 legal moves
+    BookRecord moves[256];
+    u32        moveCount = 0;
+
+    u64 result = 0;
+    while (heapCount > 0)
+    {
+        BookRun*   run    = &state->runs[heap[0]];
+        BookRecord record = run->head;
+
+        if (moveCount > 0 && moves[moveCount - 1].key != record.key)
+        {
+            result += BookFlushKey(output, moves, moveCount);
+            moveCount = 0;
+        }
+        if (moveCount > 0 && moves[moveCount - 1].move == record.move)
+        {
+            moves[moveCount - 1].weight += record.weight;
+        }
+        else if (moveCount < ARRAY_COUNT(moves))
+        {
+            moves[moveCount++] = record;
+        }
+
+        if (!BookRunAdvance(run))
+        {
+            fclose(run->file);
+            heap[0] = heap[--heapCount];
+        }
+        BookHeapSiftDown(state->runs, heap, heapCount, 0);
+    }
+    result += BookFlushKey(output, moves, moveCount);
+
+    return result;
+}
+// ----------------------------------------------------------------------------
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* outputPath = "book.bin";
+    u32         maxPlies   = BOOK_DEFAULT_PLIES;
+    u32         memoryMB   = BOOK_DEFAULT_MEMORY_MB;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 'o':
+        {
+            outputPath = value;
+            break;
+        }
+        case 'p':
+        {
+            maxPlies = (u32)atoi(value);
+            break;
+        }
+        case 'm':
+        {
+            memoryMB = (u32)atoi(value);
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex >= argc || maxPlies == 0 || memoryMB == 0)
+    {
+        fprintf(stderr, "usage: %s [-o book.bin] [-p plies] [-m memoryMB] games.pgn...\n", argv[0]);
+        return 1;
+    }
+
+    // The record buffer takes the budget, the merge buffers and the parser come on top
+    u64   recordSize  = MEGABYTES(memoryMB);
+    u64   storageSize = sizeof(LinuxBookState) + recordSize + BOOK_MAX_RUNS * BOOK_RUN_BUFFER_SIZE;
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxBookState* state = (LinuxBookState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxBookState), storageSize - sizeof(LinuxBookState));
+    state->recordCapacity = recordSize / sizeof(BookRecord);
+    state->records        = ARENA_PUSH_ARRAY(&state->arena, BookRecord, state->recordCapacity);
+    state->maxPlies       = maxPlies;
+
+    BookVisitor visitor;
+    visitor.state = state;
+
+    f64 start = LinuxGetSeconds();
+    for (; argIndex < argc; argIndex++)
+    {
+        std::ifstream stream(argv[argIndex], std::ios::binary);
+        if (!stream)
+        {
+            fprintf(stderr, "[LINUX] unable to open '%s'\n", argv[argIndex]);
+            return 1;
+        }
+
+        chess::pgn::StreamParser parser(stream);
+        parser.readGames(visitor);
+    }
+    if (state->recordCount > 0)
+    {
+        BookSpillRun(state);
+    }
+    f64 parseSeconds = LinuxGetSeconds() - start;
+
+    FILE* output = fopen(outputPath, "wb");
+    if (!output)
+    {
+        fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+        return 1;
+    }
+    u64 entries = BookMergeRuns(state, output);
+    fclose(output);
+    f64 seconds = LinuxGetSeconds() - start;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%llu games (%llu skipped), %llu positions, %u runs, %llu entries written to '%s'\n",
+           (unsigned long long)state->games, (unsigned long long)state->skippedGames,
+           (unsigned long long)state->positions, state->runCount, (unsigned long long)entries, outputPath);
+    printf("parse %.2fs  merge %.2fs  %.0f games/s  peak RSS %.1f MB (budget %u MB)\n", parseSeconds,
+           seconds - parseSeconds, state->games / parseSeconds, usage.ru_maxrss / 1024.0, memoryMB);
+
+    return 0;
+}
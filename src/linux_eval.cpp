@@ -0,0 +1,455 @@
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+
+// Network micro-benchmark: walks the perft positions, checks that every kernel keeps the incremental accumulators
+// equal to a full refresh and returns the same evaluations, then times accumulator updates, refreshes and evals
+// per kernel. Last, a search of every position runs with the network loaded once per kernel and must return the
+// same move, score and node count each time. With -g it writes the network built from the engine piece-square
+// tables instead.
+
+#define EVAL_DEFAULT_DEPTH   3
+#define EVAL_MAX_DEPTH       8
+#define EVAL_MAX_EDGES       (1 << 22)
+#define EVAL_SAMPLE_COUNT    4096
+#define EVAL_UPDATE_ROUNDS   4
+#define EVAL_EVALUATE_ROUNDS 256
+#define EVAL_REFRESH_ROUNDS  20000
+#define EVAL_SEARCH_DEPTH    5
+#define EVAL_SEARCH_HASH_MB  16
+#define EVAL_SEARCH_OFFSET   8 // Bytes past a cache line where the search arena starts
+
+// Piece-square network: 16 neurons per side and piece type, neuron k weighs a feature floor((value + k) / 16), so
+// the 16 of them add up to the exact table value while every neuron stays inside the clipped ReLU range
+#define EVAL_PST_NEURONS 16
+#define EVAL_PST_HIDDEN  (2 * 6 * EVAL_PST_NEURONS)
+#define EVAL_PST_BIAS    32
+
+struct EvalPosition
+{
+    const char* name;
+    const char* fen;
+};
+
+chess_internal EvalPosition evalSuite[] = {
+    { "startpos", DEFAULT_FEN_STRING },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1" },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8" },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10" },
+};
+
+// One move of the walk, replayed from the accumulator of its ply
+struct EvalEdge
+{
+    NnueChanges changes;
+    u8          ply;
+};
+
+// Lives at the start of the mapped memory
+struct LinuxEvalState
+{
+    MemoryArena arena;
+    NnueNetwork network;
+
+    // The search gets its own copy of the network in an arena that starts off a cache line, like the arenas the
+    // game and the tools place right after their state struct
+    MemoryArena searchArena;
+    NnueNetwork searchNetwork;
+    Board       board;
+    Engine*     engine;
+
+    EvalEdge* edges;
+    u32       edgeCount;
+    u32       rootEdges[ARRAY_COUNT(evalSuite) + 1];
+
+    NnueAccumulator* samples;
+    u32              sampleCount;
+
+    // Incremental accumulators per kernel along the walk, compared against a refresh at every node
+    NnueAccumulator stacks[NNUE_KERNEL_COUNT][EVAL_MAX_DEPTH + 1];
+    NnueAccumulator refreshed;
+    u64             nodes;
+    u64             mismatches;
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal inline s32 EvalFloorDivide(s32 a, s32 b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+chess_internal bool EvalWritePieceSquareNetwork(const char* filename)
+{
+    u32  hiddenSize  = EVAL_PST_HIDDEN;
+    u64  weightCount = ((u64)NNUE_INPUT_SIZE + 1 + 2) * hiddenSize;
+    u64  fileSize    = sizeof(NnueFileHeader) + weightCount * sizeof(s16) + sizeof(s32);
+    u8*  content     = (u8*)calloc(1, fileSize);
+    s16* weights     = (s16*)(content + sizeof(NnueFileHeader));
+    s16* biases      = weights + (u64)NNUE_INPUT_SIZE * hiddenSize;
+    s16* outputs     = biases + hiddenSize;
+
+    // Both perspectives add up to own minus their material, so the sum is twice the evaluation
+    NnueFileHeader header = { NNUE_MAGIC, NNUE_VERSION, NNUE_INPUT_SIZE, hiddenSize, 1, 2 };
+    memcpy(content, &header, sizeof(header));
+
+    for (u32 side = 0; side < 2; side++)
+    {
+        for (u32 type = 0; type < 6; type++)
+        {
+            for (u32 cell = 0; cell < 64; cell++)
+            {
+                // Tables have a8 first: own pieces are mirrored, their pieces are already seen from the other side
+                u32 feature = (side * 6 + type) * 64 + cell;
+                u32 index   = side == 0 ? cell ^ 56 : cell;
+                s32 value   = engineMaterial[type] + enginePieceSquare[type][index];
+                for (u32 k = 0; k < EVAL_PST_NEURONS; k++)
+                {
+                    u32 neuron                                      = (side * 6 + type) * EVAL_PST_NEURONS + k;
+                    weights[(u64)feature * hiddenSize + neuron] = (s16)EvalFloorDivide(value + (s32)k, 16);
+                }
+            }
+        }
+    }
+
+    for (u32 neuron = 0; neuron < hiddenSize; neuron++)
+    {
+        s16 sign                    = neuron < hiddenSize / 2 ? 1 : -1;
+        biases[neuron]              = EVAL_PST_BIAS;
+        outputs[neuron]             = sign;
+        outputs[hiddenSize + neuron] = (s16)-sign;
+    }
+
+    FILE* file = fopen(filename, "wb");
+    bool result = file && fwrite(content, 1, fileSize, file) == fileSize;
+    if (file)
+    {
+        fclose(file);
+    }
+    free(content);
+
+    return result;
+}
+
+chess_internal bool EvalReadNetwork(NnueNetwork* network, MemoryArena* arena, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    u64 size = (u64)ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    void* content = malloc(size);
+    bool  result  = content && fread(content, 1, size, file) == size &&
+                  NnueLoad(network, arena, content, size);
+    free(content);
+    fclose(file);
+
+    return result;
+}
+
+// Records every move down to depth and checks all kernels against a refresh at every node on the way
+chess_internal void EvalWalk(LinuxEvalState* state, chess::Board& position, u32 ply, u32 depth)
+{
+    NnueNetwork* network = &state->network;
+
+    NnueRefresh(network, &state->refreshed, position);
+    s32 evaluation = NnueEvaluate(network, &state->refreshed, position.sideToMove());
+    for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+    {
+        if (NnueIsKernelSupported(kernel))
+        {
+            network->kernel              = kernel;
+            NnueAccumulator* accumulator = &state->stacks[kernel][ply];
+            bool isSame = memcmp(accumulator->values[0], state->refreshed.values[0], network->hiddenSize * 2) == 0 &&
+                          memcmp(accumulator->values[1], state->refreshed.values[1], network->hiddenSize * 2) == 0 &&
+                          NnueEvaluate(network, accumulator, position.sideToMove()) == evaluation;
+            state->mismatches += !isSame;
+        }
+    }
+    network->kernel = NNUE_KERNEL_SCALAR;
+
+    if ((state->nodes++ % 64) == 0 && state->sampleCount < EVAL_SAMPLE_COUNT)
+    {
+        state->samples[state->sampleCount++] = state->refreshed;
+    }
+
+    if (ply == depth)
+    {
+        return;
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, position);
+    for (const chess::Move& move : moves)
+    {
+        if (state->edgeCount < EVAL_MAX_EDGES)
+        {
+            EvalEdge* edge = &state->edges[state->edgeCount++];
+            NnueGetChanges(position, move, &edge->changes);
+            edge->ply = (u8)ply;
+        }
+
+        for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+        {
+            if (NnueIsKernelSupported(kernel))
+            {
+                network->kernel = kernel;
+                NnueUpdate(network, &state->stacks[kernel][ply + 1], &state->stacks[kernel][ply], position, move);
+            }
+        }
+        network->kernel = NNUE_KERNEL_SCALAR;
+
+        position.makeMove(move);
+        EvalWalk(state, position, ply + 1, depth);
+        position.unmakeMove(move);
+    }
+}
+
+// Searches on the calling thread from an empty hash table, the engine thread accumulators and the network weights
+// both come from the search arena and go through the aligned loads and stores of the kernel
+chess_internal bool EvalSearch(LinuxEvalState* state, const char* fen, u32 kernel, EngineResult* result)
+{
+    Engine* engine          = state->engine;
+    engine->network         = &state->searchNetwork;
+    engine->network->kernel = kernel;
+
+    BoardReset(&state->board, fen);
+    EngineClearHash(engine);
+
+    EngineLimits limits = { EVAL_SEARCH_DEPTH, 0, 0.0 };
+    if (!EngineStart(engine, &state->board, limits, 1))
+    {
+        return false;
+    }
+    EngineSearch(&engine->threads[0]);
+
+    return EnginePollResult(engine, result);
+}
+
+int main(int argc, char** argv)
+{
+    const char* networkPath = "data/chess_eval.nnue";
+    const char* outputPath  = 0;
+    u32         depth       = EVAL_DEFAULT_DEPTH;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 'n':
+        {
+            networkPath = value;
+            break;
+        }
+        case 'g':
+        {
+            outputPath = value;
+            break;
+        }
+        case 'd':
+        {
+            depth = (u32)atoi(value);
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex != argc || depth == 0 || depth > EVAL_MAX_DEPTH)
+    {
+        fprintf(stderr, "usage: %s [-n network] [-d depth] [-g output]\n", argv[0]);
+        return 1;
+    }
+
+    if (outputPath)
+    {
+        if (!EvalWritePieceSquareNetwork(outputPath))
+        {
+            fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+            return 1;
+        }
+        printf("piece-square network written to '%s'\n", outputPath);
+        return 0;
+    }
+
+    u64   storageSize = MEGABYTES(256);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxEvalState* state = (LinuxEvalState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxEvalState), storageSize - sizeof(LinuxEvalState));
+    if (!EvalReadNetwork(&state->network, &state->arena, networkPath))
+    {
+        fprintf(stderr, "[LINUX] no valid network at '%s'\n", networkPath);
+        return 1;
+    }
+
+    NnueNetwork* network = &state->network;
+    state->edges         = ARENA_PUSH_ARRAY(&state->arena, EvalEdge, EVAL_MAX_EDGES);
+    state->samples       = ARENA_PUSH_ARRAY(&state->arena, NnueAccumulator, EVAL_SAMPLE_COUNT);
+
+    for (u32 positionIndex = 0; positionIndex < ARRAY_COUNT(evalSuite); positionIndex++)
+    {
+        chess::Board position(evalSuite[positionIndex].fen);
+        for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+        {
+            network->kernel = NNUE_KERNEL_SCALAR;
+            NnueRefresh(network, &state->stacks[kernel][0], position);
+        }
+
+        state->rootEdges[positionIndex] = state->edgeCount;
+        EvalWalk(state, position, 0, depth);
+    }
+    state->rootEdges[ARRAY_COUNT(evalSuite)] = state->edgeCount;
+
+    printf("%u hidden, depth %u, %llu nodes, %u moves, %u samples, %s\n", network->hiddenSize, depth,
+           (unsigned long long)state->nodes, state->edgeCount, state->sampleCount,
+           state->mismatches ? "MISMATCH" : "every kernel matches the refresh");
+
+    for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+    {
+        if (!NnueIsKernelSupported(kernel))
+        {
+            printf("%-7s  not supported\n", NnueGetKernelName(kernel));
+            continue;
+        }
+        network->kernel = kernel;
+
+        // Replays the recorded moves, each one updates both perspectives from the accumulator of its ply
+        f64 updateSeconds = 0.0;
+        for (u32 round = 0; round < EVAL_UPDATE_ROUNDS; round++)
+        {
+            for (u32 positionIndex = 0; positionIndex < ARRAY_COUNT(evalSuite); positionIndex++)
+            {
+                chess::Board position(evalSuite[positionIndex].fen);
+                NnueRefresh(network, &state->stacks[kernel][0], position);
+
+                f64 start = LinuxGetSeconds();
+                for (u32 i = state->rootEdges[positionIndex]; i < state->rootEdges[positionIndex + 1]; i++)
+                {
+                    EvalEdge* edge = &state->edges[i];
+                    NnueApplyChanges(network, &state->stacks[kernel][edge->ply + 1], &state->stacks[kernel][edge->ply],
+                                     &edge->changes);
+                }
+                updateSeconds += LinuxGetSeconds() - start;
+            }
+        }
+
+        f64 refreshSeconds = 0.0;
+        for (u32 positionIndex = 0; positionIndex < ARRAY_COUNT(evalSuite); positionIndex++)
+        {
+            chess::Board position(evalSuite[positionIndex].fen);
+
+            f64 start = LinuxGetSeconds();
+            for (u32 round = 0; round < EVAL_REFRESH_ROUNDS; round++)
+            {
+                NnueRefresh(network, &state->refreshed, position);
+            }
+            refreshSeconds += LinuxGetSeconds() - start;
+        }
+
+        // Checksum of every evaluation, equal across kernels when they return the same bits
+        u64 checksum = 0;
+        f64 start    = LinuxGetSeconds();
+        for (u32 round = 0; round < EVAL_EVALUATE_ROUNDS; round++)
+        {
+            for (u32 i = 0; i < state->sampleCount; i++)
+            {
+                chess::Color sideToMove = chess::Color((s32)(i & 1));
+                checksum = checksum * 31 + (u64)(u32)NnueEvaluate(network, &state->samples[i], sideToMove);
+            }
+        }
+        f64 evaluateSeconds = LinuxGetSeconds() - start;
+
+        f64 updates  = (f64)state->edgeCount * EVAL_UPDATE_ROUNDS;
+        f64 refresh  = (f64)ARRAY_COUNT(evalSuite) * EVAL_REFRESH_ROUNDS;
+        f64 evaluate = (f64)state->sampleCount * EVAL_EVALUATE_ROUNDS;
+        printf("%-7s  update %7.1f ns  refresh %7.1f ns  eval %7.2f Mevals/s  checksum %016llx\n",
+               NnueGetKernelName(kernel), updateSeconds / updates * 1e9, refreshSeconds / refresh * 1e9,
+               evaluate / evaluateSeconds / 1000000.0, (unsigned long long)checksum);
+    }
+
+    u64 searchSize = state->arena.size - state->arena.used - 64;
+    u8* searchBase = (u8*)ArenaPushSize(&state->arena, searchSize, 64) + EVAL_SEARCH_OFFSET;
+    ArenaInit(&state->searchArena, searchBase, searchSize - EVAL_SEARCH_OFFSET);
+    if (!EvalReadNetwork(&state->searchNetwork, &state->searchArena, networkPath))
+    {
+        fprintf(stderr, "[LINUX] no valid network at '%s'\n", networkPath);
+        return 1;
+    }
+    BoardInit(&state->board, DEFAULT_FEN_STRING, &state->searchArena, BOARD_HISTORY_SEARCH_PLIES);
+    state->engine = EngineCreate(&state->searchArena, 1, MEGABYTES(EVAL_SEARCH_HASH_MB));
+
+    bool searchesMatch = true;
+    for (u32 positionIndex = 0; positionIndex < ARRAY_COUNT(evalSuite); positionIndex++)
+    {
+        EngineResult reference = {};
+        bool         hasResult = false;
+        for (u32 kernel = 0; kernel < NNUE_KERNEL_COUNT; kernel++)
+        {
+            if (!NnueIsKernelSupported(kernel))
+            {
+                continue;
+            }
+
+            EngineResult result;
+            if (!EvalSearch(state, evalSuite[positionIndex].fen, kernel, &result))
+            {
+                fprintf(stderr, "[LINUX] %s search did not finish on %s\n", NnueGetKernelName(kernel),
+                        evalSuite[positionIndex].name);
+                return 1;
+            }
+
+            if (!hasResult)
+            {
+                reference = result;
+                hasResult = true;
+            }
+            else if (result.move != reference.move || result.score != reference.score ||
+                     result.nodes != reference.nodes)
+            {
+                searchesMatch = false;
+            }
+        }
+
+        printf("%-9s  search depth %u  %-5s  score %5d  %8llu nodes\n", evalSuite[positionIndex].name,
+               EVAL_SEARCH_DEPTH, chess::uci::moveToUci(chess::Move(reference.move)).c_str(), reference.score,
+               (unsigned long long)reference.nodes);
+    }
+    printf("%s\n", searchesMatch ? "every kernel searches the same tree" : "SEARCH MISMATCH");
+
+    return state->mismatches || !searchesMatch ? 1 : 0;
+}
@@ -0,0 +1,575 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_pgn.h"
+#include "chess_pgn.cpp"
+#include "chess_archive.h"
+#include "chess_archive.cpp"
+#include "chess_explorer.h"
+#include "chess_explorer.cpp"
+
+// Opening explorer index builder: every game of the input archives or PGN files is loaded into a Board and the
+// (key, move, result) of its first plies taken from the history. Entries fill a fixed buffer, every full buffer is
+// sorted, merged by (key, move) and spilled to a temporary run, then the runs are k-way merged into the index with
+// the bucket table counted on the way. Memory stays at the buffer size whatever the input size.
+// The index is then mapped with its page cache dropped and timed with random lookups, cold then warm. An existing
+// index given alone is only timed.
+
+#define EXPLORER_DEFAULT_PLIES     40
+#define EXPLORER_DEFAULT_MEMORY_MB 256
+#define EXPLORER_DEFAULT_LOOKUPS   100000
+#define EXPLORER_COLD_LOOKUPS      1000
+#define EXPLORER_MAX_RUNS          1024
+#define EXPLORER_RUN_BUFFER_SIZE   KILOBYTES(256)
+
+// Sorted, duplicate free spill of one full buffer, read back through a small buffer during the merge
+struct ExplorerRun
+{
+    FILE*          file;
+    ExplorerEntry* buffer;
+    u32            count;
+    u32            index;
+    ExplorerEntry  head;
+};
+
+struct LinuxExplorerState
+{
+    MemoryArena arena;
+    Board       board;
+
+    ExplorerEntry* entries;
+    u64            entryCapacity;
+    u64            entryCount;
+
+    ExplorerRun runs[EXPLORER_MAX_RUNS];
+    u32         runCount;
+    u64         runEntries; // Spilled so far, the index holds at most this many
+
+    u32 maxPlies;
+    u64 games;
+    u64 skippedGames;
+    u64 plies;
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal inline u64 ExplorerToolRandom(u64* state)
+{
+    u64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z     = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+chess_internal inline bool ExplorerEntryLess(const ExplorerEntry& a, const ExplorerEntry& b)
+{
+    return a.key < b.key || (a.key == b.key && a.move < b.move);
+}
+
+// Sums the results of equal (key, move) entries into the first one
+chess_internal inline void ExplorerEntryAdd(ExplorerEntry* entry, const ExplorerEntry* other)
+{
+    entry->white += other->white;
+    entry->draws += other->draws;
+    entry->black += other->black;
+}
+
+// Sorts the buffer and merges equal (key, move) entries, returns the new count
+chess_internal u64 ExplorerSortEntries(ExplorerEntry* entries, u64 count)
+{
+    std::sort(entries, entries + count, ExplorerEntryLess);
+
+    u64 result = 0;
+    for (u64 i = 0; i < count; i++)
+    {
+        if (result > 0 && entries[result - 1].key == entries[i].key && entries[result - 1].move == entries[i].move)
+        {
+            ExplorerEntryAdd(&entries[result - 1], &entries[i]);
+        }
+        else
+        {
+            entries[result++] = entries[i];
+        }
+    }
+
+    return result;
+}
+
+chess_internal void ExplorerSpillRun(LinuxExplorerState* state)
+{
+    u64 count = ExplorerSortEntries(state->entries, state->entryCount);
+
+    if (state->runCount == EXPLORER_MAX_RUNS)
+    {
+        fprintf(stderr, "[LINUX] more than %u runs, raise the memory budget\n", EXPLORER_MAX_RUNS);
+        exit(1);
+    }
+
+    FILE* file = tmpfile();
+    if (!file || fwrite(state->entries, sizeof(ExplorerEntry), count, file) != count)
+    {
+        fprintf(stderr, "[LINUX] unable to write a temporary run\n");
+        exit(1);
+    }
+    rewind(file);
+
+    ExplorerRun* run = &state->runs[state->runCount++];
+    run->file        = file;
+
+    state->runEntries += count;
+    state->entryCount = 0;
+}
+
+// The board holds a loaded game, keys[ply] is the position entries[ply].move was played from
+chess_internal void ExplorerAddGame(LinuxExplorerState* state, u32 result)
+{
+    if (result == ARCHIVE_RESULT_UNKNOWN)
+    {
+        state->skippedGames++;
+        return;
+    }
+
+    BoardHistory* history = &state->board.history;
+    u32           plies   = history->length < state->maxPlies ? history->length : state->maxPlies;
+    for (u32 ply = 0; ply < plies; ply++)
+    {
+        if (state->entryCount == state->entryCapacity)
+        {
+            ExplorerSpillRun(state);
+        }
+
+        ExplorerEntry* entry = &state->entries[state->entryCount++];
+        memset(entry, 0, sizeof(ExplorerEntry));
+        entry->key   = history->keys[ply];
+        entry->move  = history->entries[ply].move;
+        entry->white = result == ARCHIVE_RESULT_WHITE;
+        entry->draws = result == ARCHIVE_RESULT_DRAW;
+        entry->black = result == ARCHIVE_RESULT_BLACK;
+    }
+
+    state->games++;
+    state->plies += plies;
+}
+
+chess_internal void* LinuxMapFile(const char* path, u64* size)
+{
+    int         file = open(path, O_RDONLY);
+    struct stat fileStat;
+    if (file < 0 || fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", path);
+        return 0;
+    }
+
+    *size         = (u64)fileStat.st_size;
+    void* content = mmap(0, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (content == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map '%s'\n", path);
+        return 0;
+    }
+
+    return content;
+}
+
+// Archives are read in place, anything else is taken as PGN and indexed first
+chess_internal bool ExplorerAddFile(LinuxExplorerState* state, PgnFile* pgn, const char* path)
+{
+    u64   contentSize = 0;
+    void* content     = LinuxMapFile(path, &contentSize);
+    if (!content)
+    {
+        return false;
+    }
+    madvise(content, contentSize, MADV_SEQUENTIAL);
+
+    ArchiveReader archive;
+    if (ArchiveOpen(&archive, content, contentSize))
+    {
+        for (u64 i = 0; i < archive.gameCount; i++)
+        {
+            ArchiveLoadGame(&archive, i, &state->board);
+            ExplorerAddGame(state, archive.games[i].result);
+        }
+    }
+    else
+    {
+        PgnOpen(pgn, content, contentSize);
+        while (!PgnIndexStep(pgn, MEGABYTES(64)))
+        {
+        }
+        for (u32 i = 0; i < pgn->gameCount; i++)
+        {
+            PgnTags tags;
+            PgnLoadGame(pgn, i, &state->board);
+            PgnReadTags(pgn, i, &tags);
+            ExplorerAddGame(state, strcmp(tags.result, "1-0") == 0       ? ARCHIVE_RESULT_WHITE
+                                   : strcmp(tags.result, "0-1") == 0     ? ARCHIVE_RESULT_BLACK
+                                   : strcmp(tags.result, "1/2-1/2") == 0 ? ARCHIVE_RESULT_DRAW
+                                                                         : ARCHIVE_RESULT_UNKNOWN);
+        }
+        PgnOpen(pgn, 0, 0);
+    }
+
+    munmap(content, contentSize);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Merge
+chess_internal bool ExplorerRunAdvance(ExplorerRun* run)
+{
+    if (run->index == run->count)
+    {
+        run->count = (u32)fread(run->buffer, sizeof(ExplorerEntry), EXPLORER_RUN_BUFFER_SIZE / sizeof(ExplorerEntry),
+                                run->file);
+        run->index = 0;
+        if (run->count == 0)
+        {
+            return false;
+        }
+    }
+    run->head = run->buffer[run->index++];
+
+    return true;
+}
+
+// Min heap of run indices ordered by their head entry
+chess_internal void ExplorerHeapSiftDown(ExplorerRun* runs, u32* heap, u32 heapCount, u32 index)
+{
+    for (;;)
+    {
+        u32 smallest = index;
+        u32 left     = index * 2 + 1;
+        u32 right    = left + 1;
+        if (left < heapCount && ExplorerEntryLess(runs[heap[left]].head, runs[heap[smallest]].head))
+        {
+            smallest = left;
+        }
+        if (right < heapCount && ExplorerEntryLess(runs[heap[right]].head, runs[heap[smallest]].head))
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        u32 _index     = heap[index];
+        heap[index]    = heap[smallest];
+        heap[smallest] = _index;
+        index          = smallest;
+    }
+}
+
+// Entries go out in order after the header and the bucket table, which are written last once counted
+chess_internal bool ExplorerMergeRuns(LinuxExplorerState* state, FILE* output, ExplorerHeader* header)
+{
+    u32 bucketBits = 0;
+    while (bucketBits < EXPLORER_MAX_BUCKET_BITS &&
+           ((u64)EXPLORER_BUCKET_ENTRIES << (bucketBits + 1)) <= state->runEntries)
+    {
+        bucketBits++;
+    }
+    u64  bucketCount = 1ULL << bucketBits;
+    u64* buckets     = ARENA_PUSH_ARRAY(&state->arena, u64, bucketCount + 1);
+    memset(buckets, 0, sizeof(u64) * (bucketCount + 1));
+
+    memset(header, 0, sizeof(ExplorerHeader));
+    header->magic         = EXPLORER_MAGIC;
+    header->version       = EXPLORER_VERSION;
+    header->bucketBits    = (u16)bucketBits;
+    header->gameCount     = state->games;
+    header->entriesOffset = sizeof(ExplorerHeader) + sizeof(u64) * (bucketCount + 1);
+    fseek(output, (long)header->entriesOffset, SEEK_SET);
+
+    u32 heap[EXPLORER_MAX_RUNS];
+    u32 heapCount = 0;
+    for (u32 i = 0; i < state->runCount; i++)
+    {
+        ExplorerRun* run = &state->runs[i];
+        run->buffer      = (ExplorerEntry*)ArenaPushSize(&state->arena, EXPLORER_RUN_BUFFER_SIZE);
+        if (ExplorerRunAdvance(run))
+        {
+            heap[heapCount++] = i;
+        }
+    }
+    for (u32 i = heapCount / 2; i-- > 0;)
+    {
+        ExplorerHeapSiftDown(state->runs, heap, heapCount, i);
+    }
+
+    // Equal entries of different runs come out one after the other
+    ExplorerEntry entry;
+    u64           lastKey  = 0;
+    bool          hasEntry = false;
+    bool          isValid  = true;
+    while (heapCount > 0 || hasEntry)
+    {
+        ExplorerRun* run = heapCount > 0 ? &state->runs[heap[0]] : 0;
+        if (run && hasEntry && entry.key == run->head.key && entry.move == run->head.move)
+        {
+            ExplorerEntryAdd(&entry, &run->head);
+        }
+        else
+        {
+            if (hasEntry)
+            {
+                u64 bucket = bucketBits ? entry.key >> (64 - bucketBits) : 0;
+                buckets[bucket + 1]++;
+                header->positionCount += header->entryCount == 0 || entry.key != lastKey;
+                header->entryCount++;
+                lastKey = entry.key;
+                isValid = isValid && fwrite(&entry, sizeof(entry), 1, output) == 1;
+            }
+            hasEntry = run != 0;
+            if (run)
+            {
+                entry = run->head;
+            }
+        }
+
+        if (run)
+        {
+            if (!ExplorerRunAdvance(run))
+            {
+                fclose(run->file);
+                heap[0] = heap[--heapCount];
+            }
+            ExplorerHeapSiftDown(state->runs, heap, heapCount, 0);
+        }
+    }
+
+    // Counts to first entry indices
+    for (u64 i = 0; i < bucketCount; i++)
+    {
+        buckets[i + 1] += buckets[i];
+    }
+
+    fseek(output, 0, SEEK_SET);
+    isValid = isValid && fwrite(header, sizeof(ExplorerHeader), 1, output) == 1 &&
+              fwrite(buckets, sizeof(u64), bucketCount + 1, output) == bucketCount + 1;
+
+    return isValid;
+}
+// ----------------------------------------------------------------------------
+
+chess_internal int ExplorerQsortCompare(const void* a, const void* b)
+{
+    f64 x = *(const f64*)a;
+    f64 y = *(const f64*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Page cache of the index dropped first, so the first lookups read the file like a cold start of the game
+chess_internal bool ExplorerBenchmark(const char* path, u32 lookups, MemoryArena* arena)
+{
+    int file = open(path, O_RDONLY);
+    if (file >= 0)
+    {
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+
+    u64   contentSize = 0;
+    void* content     = LinuxMapFile(path, &contentSize);
+    f64   start       = LinuxGetSeconds();
+
+    Explorer* explorer = ExplorerCreate(arena);
+    if (!content || !ExplorerOpen(explorer, content, contentSize))
+    {
+        fprintf(stderr, "[LINUX] '%s' is not an explorer index\n", path);
+        return false;
+    }
+    f64 openSeconds = LinuxGetSeconds() - start;
+
+    const ExplorerHeader* header = explorer->header;
+    printf("index: %llu positions, %llu entries, %llu games, %u bucket bits, %.1f MB, opened in %.1f us\n",
+           (unsigned long long)header->positionCount, (unsigned long long)header->entryCount,
+           (unsigned long long)header->gameCount, header->bucketBits, contentSize / (1024.0 * 1024.0),
+           openSeconds * 1000000.0);
+    if (explorer->entryCount == 0)
+    {
+        return true;
+    }
+
+    // Keys of random entries, every other lookup a random key that is almost surely absent
+    f64* times       = ARENA_PUSH_ARRAY(arena, f64, lookups);
+    u64  randomState = 1;
+    u64  found       = 0;
+    u64  moves       = 0;
+    for (u32 pass = 0; pass < 2; pass++)
+    {
+        u32 count = pass == 0 ? (lookups < EXPLORER_COLD_LOOKUPS ? lookups : EXPLORER_COLD_LOOKUPS) : lookups;
+        f64 total = 0.0;
+        for (u32 i = 0; i < count; i++)
+        {
+            u64 key = ExplorerToolRandom(&randomState);
+            if (i % 2 == 0)
+            {
+                key = explorer->entries[key % explorer->entryCount].key;
+            }
+
+            ExplorerMove positionMoves[EXPLORER_MAX_MOVES];
+            f64          lookupStart = LinuxGetSeconds();
+            u32          moveCount   = ExplorerLookup(explorer, key, positionMoves, EXPLORER_MAX_MOVES, 0);
+            times[i]                 = LinuxGetSeconds() - lookupStart;
+            total += times[i];
+            found += moveCount > 0;
+            moves += moveCount;
+        }
+
+        qsort(times, count, sizeof(f64), ExplorerQsortCompare);
+        printf("%s: %u lookups, half present, mean %.2f us, median %.2f us, p99 %.2f us, max %.2f us\n",
+               pass == 0 ? "cold" : "warm", count, total / count * 1000000.0, times[count / 2] * 1000000.0,
+               times[count * 99 / 100] * 1000000.0, times[count - 1] * 1000000.0);
+    }
+    printf("found %llu positions, %.1f moves each\n", (unsigned long long)found, found ? (f64)moves / found : 0.0);
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* outputPath = "explorer.bin";
+    u32         maxPlies   = EXPLORER_DEFAULT_PLIES;
+    u32         memoryMB   = EXPLORER_DEFAULT_MEMORY_MB;
+    u32         lookups    = EXPLORER_DEFAULT_LOOKUPS;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 'o':
+        {
+            outputPath = value;
+            break;
+        }
+        case 'p':
+        {
+            maxPlies = (u32)atoi(value);
+            break;
+        }
+        case 'm':
+        {
+            memoryMB = (u32)atoi(value);
+            break;
+        }
+        case 'q':
+        {
+            lookups = (u32)atoi(value);
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex >= argc || maxPlies == 0 || memoryMB == 0 || lookups == 0)
+    {
+        fprintf(stderr, "usage: %s [-o explorer.bin] [-p plies] [-m memoryMB] [-q lookups] games.carc|games.pgn...\n",
+                argv[0]);
+        return 1;
+    }
+
+    // The entry buffer takes the budget, the merge buffers, the bucket table, the PGN index and the board on top
+    u64   entrySize   = MEGABYTES(memoryMB);
+    u64   storageSize = sizeof(LinuxExplorerState) + entrySize + EXPLORER_MAX_RUNS * EXPLORER_RUN_BUFFER_SIZE +
+                      sizeof(u64) * ((1ULL << EXPLORER_MAX_BUCKET_BITS) + 1) + MEGABYTES(64) +
+                      sizeof(f64) * lookups + sizeof(Explorer) + KILOBYTES(64);
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxExplorerState* state = (LinuxExplorerState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxExplorerState), storageSize - sizeof(LinuxExplorerState));
+
+    // An index alone is only timed
+    u64   firstSize  = 0;
+    void* firstInput = argIndex + 1 == argc ? LinuxMapFile(argv[argIndex], &firstSize) : 0;
+    if (firstInput && firstSize >= sizeof(u32) && *(const u32*)firstInput == EXPLORER_MAGIC)
+    {
+        munmap(firstInput, firstSize);
+        return ExplorerBenchmark(argv[argIndex], lookups, &state->arena) ? 0 : 1;
+    }
+    if (firstInput)
+    {
+        munmap(firstInput, firstSize);
+    }
+
+    state->entryCapacity = entrySize / sizeof(ExplorerEntry);
+    state->entries       = ARENA_PUSH_ARRAY(&state->arena, ExplorerEntry, state->entryCapacity);
+    state->maxPlies      = maxPlies;
+    BoardInit(&state->board, chess::constants::STARTPOS, &state->arena, BOARD_HISTORY_MAX_PLIES);
+
+    PgnFile pgn;
+    PgnInit(&pgn, &state->arena);
+
+    f64 start = LinuxGetSeconds();
+    for (; argIndex < argc; argIndex++)
+    {
+        if (!ExplorerAddFile(state, &pgn, argv[argIndex]))
+        {
+            return 1;
+        }
+    }
+    if (state->entryCount > 0)
+    {
+        ExplorerSpillRun(state);
+    }
+    f64 loadSeconds = LinuxGetSeconds() - start;
+
+    FILE* output = fopen(outputPath, "wb");
+    if (!output)
+    {
+        fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+        return 1;
+    }
+    ExplorerHeader header;
+    bool           isWritten = ExplorerMergeRuns(state, output, &header);
+    isWritten                = fclose(output) == 0 && isWritten;
+    f64 seconds              = LinuxGetSeconds() - start;
+    if (!isWritten)
+    {
+        fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+        return 1;
+    }
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%llu games (%llu without result), %llu plies, %u runs, %llu positions and %llu entries written to '%s'\n",
+           (unsigned long long)state->games, (unsigned long long)state->skippedGames,
+           (unsigned long long)state->plies, state->runCount, (unsigned long long)header.positionCount,
+           (unsigned long long)header.entryCount, outputPath);
+    printf("load and sort %.2fs  merge %.2fs  %.0f games/s  peak RSS %.1f MB (budget %u MB)\n", loadSeconds,
+           seconds - loadSeconds, state->games / loadSeconds, usage.ru_maxrss / 1024.0, memoryMB);
+
+    return ExplorerBenchmark(outputPath, lookups, &state->arena) ? 0 : 1;
+}
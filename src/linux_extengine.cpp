@@ -0,0 +1,472 @@
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_camera.h"
+#include "chess_draw_api.h"
+#include "chess_platform.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_external_engine.h"
+#include "chess_external_engine.cpp"
+
+// External engine adapter benchmark: drives ExternalEngine through Linux pipes with a 60 Hz frame loop, like the
+// game does. Without -e it runs itself with -f as a fake engine that answers the UCI handshake and emits info lines
+// stamped with the monotonic clock in the nodes field, so every line has a send time:
+// - go movetime <ms>: one info line per millisecond, the pace of a real engine at low depth
+// - go depth <lines>: that many info lines as fast as the pipe takes them, then bestmove
+
+#define EXTENGINE_FRAME_SECONDS (1.0 / 60.0)
+#define EXTENGINE_ROUND_TRIPS   1000
+#define EXTENGINE_PACED_MS      2000
+#define EXTENGINE_BURST_LINES   200000
+#define EXTENGINE_MAX_SAMPLES   (1 << 20)
+
+struct PlatformProcess
+{
+    pid_t pid;
+    s32   input;  // Write end of the child standard input, O_NONBLOCK
+    s32   output; // Read end of the child standard output, O_NONBLOCK
+};
+
+struct LinuxExtEngineState
+{
+    MemoryArena     arena;
+    GameMemory      memory;
+    ExternalEngine* engine;
+    f64             samples[2][EXTENGINE_MAX_SAMPLES];
+    f64             drains[EXTENGINE_MAX_SAMPLES];
+};
+
+// ----------------------------------------------------------------------------
+// Timer
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal void LinuxSleepSeconds(f64 seconds)
+{
+    if (seconds > 0.0)
+    {
+        timespec interval = { (time_t)seconds, (long)((seconds - (f64)(time_t)seconds) * 1000000000.0) };
+        nanosleep(&interval, 0);
+    }
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Platform
+PLATFORM_TIMER_GET_TICKS(LinuxTimerGetTicks)
+{
+    return LinuxGetSeconds();
+}
+
+PLATFORM_LOG(LinuxLog)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\n");
+}
+
+// The command runs through /bin/sh like a line of the engine file
+PLATFORM_PROCESS_START(LinuxProcessStart)
+{
+    s32 toChild[2];
+    s32 fromChild[2];
+    if (pipe(toChild) != 0)
+    {
+        return 0;
+    }
+    if (pipe(fromChild) != 0)
+    {
+        close(toChild[0]);
+        close(toChild[1]);
+        return 0;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(toChild[0], STDIN_FILENO);
+        dup2(fromChild[1], STDOUT_FILENO);
+        close(toChild[0]);
+        close(toChild[1]);
+        close(fromChild[0]);
+        close(fromChild[1]);
+        execl("/bin/sh", "sh", "-c", commandLine, (char*)0);
+        _exit(127);
+    }
+
+    close(toChild[0]);
+    close(fromChild[1]);
+    if (pid < 0)
+    {
+        fprintf(stderr, "[LINUX] unable to start '%s'\n", commandLine);
+        close(toChild[1]);
+        close(fromChild[0]);
+        return 0;
+    }
+    fcntl(toChild[1], F_SETFL, fcntl(toChild[1], F_GETFL) | O_NONBLOCK);
+    fcntl(fromChild[0], F_SETFL, fcntl(fromChild[0], F_GETFL) | O_NONBLOCK);
+
+    PlatformProcess* result = (PlatformProcess*)malloc(sizeof(PlatformProcess));
+    result->pid             = pid;
+    result->input           = toChild[1];
+    result->output          = fromChild[0];
+
+    return result;
+}
+
+PLATFORM_PROCESS_WRITE(LinuxProcessWrite)
+{
+    return write(process->input, data, size) == (ssize_t)size;
+}
+
+PLATFORM_PROCESS_READ(LinuxProcessRead)
+{
+    pollfd descriptor = { process->output, POLLIN, 0 };
+    if (poll(&descriptor, 1, (s32)timeoutMilliseconds) <= 0)
+    {
+        return 0;
+    }
+
+    ssize_t result = read(process->output, buffer, size);
+    if (result < 0 && errno == EAGAIN)
+    {
+        return 0;
+    }
+
+    return result > 0 ? (s32)result : -1;
+}
+
+PLATFORM_PROCESS_STOP(LinuxProcessStop)
+{
+    if (!process)
+    {
+        return;
+    }
+
+    close(process->input);
+    bool hasExited = false;
+    for (u32 i = 0; i < 500 && !hasExited; i++)
+    {
+        hasExited = waitpid(process->pid, 0, WNOHANG) == process->pid;
+        if (!hasExited)
+        {
+            LinuxSleepSeconds(0.001);
+        }
+    }
+    if (!hasExited)
+    {
+        fprintf(stderr, "[LINUX] process did not exit, killing it\n");
+        kill(process->pid, SIGKILL);
+        waitpid(process->pid, 0, 0);
+    }
+    close(process->output);
+    free(process);
+}
+
+struct LinuxIoEntry
+{
+    PlatformWorkQueueCallback* callback;
+    void*                      data;
+};
+
+chess_internal void* LinuxIoThreadProc(void* parameter)
+{
+    LinuxIoEntry entry = *(LinuxIoEntry*)parameter;
+    free(parameter);
+    entry.callback(0, entry.data);
+
+    return 0;
+}
+
+// The IO queue only ever runs pipe readers, a detached thread per entry is the same thing here
+PLATFORM_WORK_QUEUE_ADD_ENTRY(LinuxIoQueueAddEntry)
+{
+    LinuxIoEntry* entry = (LinuxIoEntry*)malloc(sizeof(LinuxIoEntry));
+    entry->callback     = callback;
+    entry->data         = data;
+
+    pthread_t thread;
+    pthread_create(&thread, 0, LinuxIoThreadProc, entry);
+    pthread_detach(thread);
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Fake engine
+chess_internal s32 FakeEngineRun()
+{
+    static char output[1 << 16];
+    setvbuf(stdout, output, _IOFBF, sizeof(output));
+
+    char line[1024];
+    while (fgets(line, sizeof(line), stdin))
+    {
+        char command[32] = "";
+        char limit[32]   = "";
+        u32  value       = 0;
+        sscanf(line, "%31s %31s %u", command, limit, &value);
+
+        if (strcmp(command, "uci") == 0)
+        {
+            printf("id name Fake engine\nid author chess\nuciok\n");
+        }
+        else if (strcmp(command, "isready") == 0)
+        {
+            printf("readyok\n");
+        }
+        else if (strcmp(command, "go") == 0)
+        {
+            bool isPaced = strcmp(limit, "movetime") == 0;
+            for (u32 i = 0; i < value; i++)
+            {
+                if (isPaced)
+                {
+                    LinuxSleepSeconds(0.001);
+                }
+                printf("info depth %u seldepth %u score cp %d nodes %llu nps 1000000 time %u pv e2e4 e7e5 g1f3 b8c6 "
+                       "f1b5 a7a6 b5a4 g8f6 e1g1 f8e7\n",
+                       i % 64 + 1, i % 64 + 4, (s32)(i % 200) - 100,
+                       (unsigned long long)(LinuxGetSeconds() * 1000000000.0), i);
+                if (isPaced)
+                {
+                    fflush(stdout);
+                }
+            }
+            printf("bestmove e2e4 ponder e7e5\n");
+        }
+        else if (strcmp(command, "quit") == 0)
+        {
+            break;
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
+// ----------------------------------------------------------------------------
+
+chess_internal f64 Percentile(f64* values, u32 count, f64 percentile)
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    std::sort(values, values + count);
+    u32 index = (u32)(percentile * (count - 1));
+
+    return values[index];
+}
+
+// Frames at 60 Hz until bestmove, every frame drains the ring like GameUpdateAndRender
+// Stamped info lines give the latency until the reader parsed them and until a frame drained them
+chess_internal void RunSearch(LinuxExtEngineState* state, const char* go, bool isStamped, const char* name)
+{
+    ExternalEngine* engine = state->engine;
+
+    u64 droppedBefore = engine->droppedInfos.load();
+    u32 infoCount     = 0;
+    u32 frameCount    = 0;
+    f64 bestSeconds   = 0.0;
+    f64 maxPerFrame   = 0;
+
+    ExternalEngineSend(engine, &state->memory, "go %s\n", go);
+    f64  start  = LinuxGetSeconds();
+    bool isDone = false;
+    while (!isDone && LinuxGetSeconds() - start < 60.0)
+    {
+        f64 frameStart = LinuxGetSeconds();
+        ExternalEngineUpdate(engine, &state->memory);
+
+        u32                   frameInfos = 0;
+        ExternalEngineMessage message;
+        while (ExternalEnginePoll(engine, &message))
+        {
+            f64 now = LinuxGetSeconds();
+            if (message.type == EXTERNAL_ENGINE_MESSAGE_INFO)
+            {
+                if (isStamped && infoCount < EXTENGINE_MAX_SAMPLES)
+                {
+                    f64 sent                     = message.nodes / 1000000000.0;
+                    state->samples[0][infoCount] = (message.receivedSeconds - sent) * 1000.0;
+                    state->samples[1][infoCount] = (now - sent) * 1000.0;
+                }
+                infoCount++;
+                frameInfos++;
+            }
+            else if (message.type == EXTERNAL_ENGINE_MESSAGE_BESTMOVE)
+            {
+                bestSeconds = message.receivedSeconds;
+                isDone      = true;
+            }
+        }
+
+        f64 drain = (LinuxGetSeconds() - frameStart) * 1000000.0;
+        if (frameCount < EXTENGINE_MAX_SAMPLES)
+        {
+            state->drains[frameCount] = drain;
+        }
+        frameCount++;
+        maxPerFrame = frameInfos > maxPerFrame ? frameInfos : maxPerFrame;
+
+        LinuxSleepSeconds(EXTENGINE_FRAME_SECONDS - (LinuxGetSeconds() - frameStart));
+    }
+
+    u32 samples  = infoCount < EXTENGINE_MAX_SAMPLES ? infoCount : EXTENGINE_MAX_SAMPLES;
+    u32 drains   = frameCount < EXTENGINE_MAX_SAMPLES ? frameCount : EXTENGINE_MAX_SAMPLES;
+    u64 dropped  = engine->droppedInfos.load() - droppedBefore;
+    f64 duration = bestSeconds - start;
+
+    // Dropped lines were parsed too, the reader keeps up with the engine and only the ring overflows
+    printf("%s: %u info lines in %u frames, %llu dropped, %.0f lines/s parsed, at most %.0f per frame\n", name,
+           infoCount, frameCount, (unsigned long long)dropped,
+           duration > 0.0 ? (infoCount + dropped) / duration : 0.0, maxPerFrame);
+    printf("  frame drain        median %7.1f us  p99 %7.1f us  max %7.1f us\n", Percentile(state->drains, drains, 0.5),
+           Percentile(state->drains, drains, 0.99), Percentile(state->drains, drains, 1.0));
+    if (isStamped)
+    {
+        printf("  engine to reader   median %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+               Percentile(state->samples[0], samples, 0.5), Percentile(state->samples[0], samples, 0.99),
+               Percentile(state->samples[0], samples, 1.0));
+        printf("  engine to frame    median %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+               Percentile(state->samples[1], samples, 0.5), Percentile(state->samples[1], samples, 0.99),
+               Percentile(state->samples[1], samples, 1.0));
+    }
+}
+
+// Waits for the first message of the given type without frame pacing, false after a second
+chess_internal bool WaitMessage(LinuxExtEngineState* state, u32 type)
+{
+    f64 start = LinuxGetSeconds();
+    while (LinuxGetSeconds() - start < 1.0)
+    {
+        ExternalEngineMessage message;
+        while (ExternalEnginePoll(state->engine, &message))
+        {
+            if (message.type == EXTERNAL_ENGINE_MESSAGE_ID_NAME)
+            {
+                u32 length = (u32)strlen(message.text);
+                if (length >= sizeof(state->engine->name))
+                {
+                    length = sizeof(state->engine->name) - 1;
+                }
+                memcpy(state->engine->name, message.text, length);
+                state->engine->name[length] = '\0';
+            }
+            if (message.type == type)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 2 && strcmp(argv[1], "-f") == 0)
+    {
+        return FakeEngineRun();
+    }
+
+    char        selfCommand[1024];
+    const char* command = 0;
+    if (argc == 3 && strcmp(argv[1], "-e") == 0)
+    {
+        command = argv[2];
+    }
+    else if (argc == 1)
+    {
+        char    self[900];
+        ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+        self[length > 0 ? length : 0] = '\0';
+        snprintf(selfCommand, sizeof(selfCommand), "'%s' -f", self);
+        command = selfCommand;
+    }
+    else
+    {
+        fprintf(stderr, "usage: %s [-e \"engine command line\"]\n", argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    u64   storageSize = sizeof(LinuxExtEngineState) + MEGABYTES(4);
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxExtEngineState* state = (LinuxExtEngineState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxExtEngineState), storageSize - sizeof(LinuxExtEngineState));
+    state->memory.platform.TimerGetTicks     = LinuxTimerGetTicks;
+    state->memory.platform.Log               = LinuxLog;
+    state->memory.platform.ProcessStart      = LinuxProcessStart;
+    state->memory.platform.ProcessWrite      = LinuxProcessWrite;
+    state->memory.platform.ProcessRead       = LinuxProcessRead;
+    state->memory.platform.ProcessStop       = LinuxProcessStop;
+    state->memory.platform.WorkQueueAddEntry = LinuxIoQueueAddEntry;
+
+    state->engine = ExternalEngineStart(&state->arena, &state->memory, command);
+    if (!state->engine || !WaitMessage(state, EXTERNAL_ENGINE_MESSAGE_READYOK))
+    {
+        fprintf(stderr, "[LINUX] no UCI handshake from '%s'\n", command);
+        return 1;
+    }
+    printf("engine '%s', %u message ring, %llu bytes\n", state->engine->name, EXTERNAL_ENGINE_RING_SIZE,
+           (unsigned long long)sizeof(ExternalEngine));
+
+    // isready round trips, the game thread polls without frames here
+    for (u32 i = 0; i < EXTENGINE_ROUND_TRIPS; i++)
+    {
+        f64 start = LinuxGetSeconds();
+        ExternalEngineSend(state->engine, &state->memory, "isready\n");
+        WaitMessage(state, EXTERNAL_ENGINE_MESSAGE_READYOK);
+        state->samples[0][i] = (LinuxGetSeconds() - start) * 1000.0;
+    }
+    printf("isready round trip   median %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+           Percentile(state->samples[0], EXTENGINE_ROUND_TRIPS, 0.5),
+           Percentile(state->samples[0], EXTENGINE_ROUND_TRIPS, 0.99),
+           Percentile(state->samples[0], EXTENGINE_ROUND_TRIPS, 1.0));
+
+    char go[64];
+    if (argc == 1)
+    {
+        sprintf(go, "movetime %u", EXTENGINE_PACED_MS);
+        RunSearch(state, go, true, "paced, 1 line/ms");
+        sprintf(go, "depth %u", EXTENGINE_BURST_LINES);
+        RunSearch(state, go, true, "burst");
+    }
+    else
+    {
+        ExternalEngineSend(state->engine, &state->memory, "position startpos\n");
+        RunSearch(state, "movetime 2000", false, "go movetime 2000");
+    }
+
+    f64 start = LinuxGetSeconds();
+    ExternalEngineStop(state->engine, &state->memory);
+    printf("stopped in %.3f ms\n", (LinuxGetSeconds() - start) * 1000.0);
+
+    return 0;
+}
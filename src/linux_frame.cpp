@@ -0,0 +1,150 @@
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+
+// Per-frame board query benchmark: the queries GameUpdateAndRender makes every frame, three DrawScene passes of
+// BoardGetPiece over the 64 cells plus the turn, result, check, last move and undo/redo queries, timed on the live
+// Board. The same queries are then answered the way the board did before it kept a live chess::Board, a
+// chess::Board parsed from the FEN of the position for every query, and both per-frame costs are reported.
+
+#define FRAME_DEFAULT_FRAMES 10000
+#define FRAME_SCENE_PASSES   3 // Picking, shadow and render
+
+struct FramePosition
+{
+    const char* name;
+    const char* fen;
+};
+
+chess_internal FramePosition framePositions[] = {
+    { "startpos", DEFAULT_FEN_STRING },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1" },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+// Folded into the result so the compiler keeps every query
+chess_internal u64 FrameQueriesLive(Board* board)
+{
+    u64 sum = 0;
+    for (u32 pass = 0; pass < FRAME_SCENE_PASSES; pass++)
+    {
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            Piece piece = BoardGetPiece(board, cellIndex);
+            sum += piece.type + piece.color;
+        }
+    }
+
+    sum += BoardGetTurn(board) + BoardGetGameResult(board) + BoardInCheck(board) + BoardGetKingCell(board);
+    sum += BoardGameStarted(board) + BoardMoveCanUndo(board) + BoardMoveCanRedo(board);
+    if (BoardGameStarted(board))
+    {
+        sum += BoardMoveGetLast(board).to;
+    }
+
+    return sum;
+}
+
+// Every query starts from the FEN, like GetExternalBoard did
+chess_internal u64 FrameQueriesFen(const std::string& fen)
+{
+    u64 sum = 0;
+    for (u32 pass = 0; pass < FRAME_SCENE_PASSES; pass++)
+    {
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            chess::Board _board(fen);
+            sum += (u32)_board.at(chess::Square(cellIndex)).internal();
+        }
+    }
+
+    {
+        chess::Board _board(fen);
+        sum += _board.sideToMove() == chess::Color::WHITE;
+    }
+    {
+        chess::Board _board(fen);
+        sum += (u32)_board.isGameOver().second;
+    }
+    {
+        chess::Board _board(fen);
+        sum += _board.inCheck();
+    }
+    {
+        chess::Board _board(fen);
+        sum += _board.kingSq(_board.sideToMove()).index();
+    }
+
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    u32 frames = argc > 1 ? (u32)atoi(argv[1]) : FRAME_DEFAULT_FRAMES;
+    if (frames == 0)
+    {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(64);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    Board board;
+    BoardInit(&board, DEFAULT_FEN_STRING, &arena, BOARD_HISTORY_SEARCH_PLIES);
+
+    u64 sum = 0;
+    for (u32 i = 0; i < ARRAY_COUNT(framePositions); i++)
+    {
+        FramePosition* position = &framePositions[i];
+        BoardReset(&board, position->fen);
+        std::string fen = board.position->getFen();
+
+        f64 start = LinuxGetSeconds();
+        for (u32 frame = 0; frame < frames; frame++)
+        {
+            sum += FrameQueriesLive(&board);
+        }
+        f64 liveSeconds = LinuxGetSeconds() - start;
+
+        // Far slower, a tenth of the frames is enough for a stable number
+        u32 fenFrames = frames / 10 > 0 ? frames / 10 : 1;
+        start         = LinuxGetSeconds();
+        for (u32 frame = 0; frame < fenFrames; frame++)
+        {
+            sum += FrameQueriesFen(fen);
+        }
+        f64 fenSeconds = LinuxGetSeconds() - start;
+
+        f64 liveFrame = liveSeconds / frames * 1000000.0;
+        f64 fenFrame  = fenSeconds / fenFrames * 1000000.0;
+        printf("%-10s FEN per query %8.1f us/frame  live board %6.2f us/frame  %6.0fx\n", position->name, fenFrame,
+               liveFrame, liveFrame > 0.0 ? fenFrame / liveFrame : 0.0);
+    }
+    printf("checksum %llu\n", (unsigned long long)sum);
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+
+// Frame time test of the game thread while the computer searches: a frame loop paced at 60 frames per second makes
+// the engine and board queries GameUpdateAndRender makes every frame, EnginePollResult, EngineGetInfo,
+// EngineIsSearching and EngineGetNodes for the HUD, three DrawScene passes of BoardGetPiece and the turn, result,
+// check and last move queries. It runs first with the engine idle, then during an EngineStart search limited to
+// -s seconds on every other core. The run fails when the search frames are slower than the idle ones by more than
+// -r times plus a fixed slack, or when the search overruns its limit.
+
+#define FRAMETIME_DEFAULT_SECONDS 5.0
+#define FRAMETIME_DEFAULT_RATIO   3.0
+#define FRAMETIME_HASH_MB         16
+#define FRAMETIME_FPS             60.0
+#define FRAMETIME_SLACK_US        50.0 // Frames of a few microseconds are mostly timer and wakeup noise
+#define FRAMETIME_OVERRUN_SECONDS 1.0  // Search time past its limit before the run fails
+
+#define FRAMETIME_FEN "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+
+// Lives at the start of the mapped memory, like GameState in permanentStorage
+struct LinuxFrametimeState
+{
+    Board       board;
+    MemoryArena arena;
+    Engine*     engine;
+    pthread_t   threads[ENGINE_MAX_THREADS];
+};
+
+struct FrametimeStats
+{
+    u32 frameCount;
+    f64 mean; // Microseconds
+    f64 p99;
+    f64 max;
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal void* FrametimeThreadProc(void* parameter)
+{
+    EngineSearch((EngineThread*)parameter);
+    return 0;
+}
+
+chess_internal int FrametimeCompare(const void* a, const void* b)
+{
+    f64 left  = *(const f64*)a;
+    f64 right = *(const f64*)b;
+    return left < right ? -1 : left > right ? 1 : 0;
+}
+
+// Folded into the result so the compiler keeps every query, isReady is set once the search result was taken
+chess_internal u64 FrametimeFrame(LinuxFrametimeState* state, bool* isReady)
+{
+    Engine* engine = state->engine;
+    Board*  board  = &state->board;
+    u64     sum    = 0;
+
+    EngineResult result;
+    if (EnginePollResult(engine, &result))
+    {
+        *isReady = true;
+        sum += result.move;
+    }
+
+    EngineInfo info;
+    if (EngineGetInfo(engine, &info))
+    {
+        sum += info.depth + info.nodes;
+    }
+    sum += EngineIsSearching(engine) + EngineGetNodes(engine);
+
+    for (u32 pass = 0; pass < 3; pass++)
+    {
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            Piece piece = BoardGetPiece(board, cellIndex);
+            sum += piece.type + piece.color;
+        }
+    }
+    sum += BoardGetTurn(board) + BoardGetGameResult(board) + BoardInCheck(board) + BoardGetKingCell(board);
+    if (BoardGameStarted(board))
+    {
+        sum += BoardMoveGetLast(board).to;
+    }
+
+    return sum;
+}
+
+// Frames until 'seconds' have passed, or until the search result was taken when 'untilReady' is set.
+// Sleeps to the next 1/60 s like a vsync'd frame, only the frame itself is timed.
+chess_internal FrametimeStats FrametimeRun(LinuxFrametimeState* state, f64* samples, u32 maxFrames, f64 seconds,
+                                           bool untilReady, u64* sum)
+{
+    f64  start     = LinuxGetSeconds();
+    f64  nextFrame = start;
+    bool isReady   = false;
+    u32  frame     = 0;
+    for (; frame < maxFrames && !isReady; frame++)
+    {
+        if (!untilReady && nextFrame - start >= seconds)
+        {
+            break;
+        }
+
+        f64 frameStart = LinuxGetSeconds();
+        *sum += FrametimeFrame(state, &isReady);
+        samples[frame] = (LinuxGetSeconds() - frameStart) * 1000000.0;
+
+        nextFrame += 1.0 / FRAMETIME_FPS;
+        f64 remaining = nextFrame - LinuxGetSeconds();
+        if (remaining > 0.0)
+        {
+            timespec wait = { (time_t)remaining, (long)((remaining - (time_t)remaining) * 1000000000.0) };
+            nanosleep(&wait, 0);
+        }
+    }
+
+    FrametimeStats result = {};
+    result.frameCount     = frame;
+    if (frame)
+    {
+        for (u32 i = 0; i < frame; i++)
+        {
+            result.mean += samples[i];
+        }
+        result.mean /= frame;
+
+        qsort(samples, frame, sizeof(f64), FrametimeCompare);
+        result.p99 = samples[(u32)((frame - 1) * 0.99)];
+        result.max = samples[frame - 1];
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    u32 cores      = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    u32 maxThreads = cores > 1 ? cores - 1 : 1; // Like the game work queue, one core is left to the frame loop
+    f64 seconds    = FRAMETIME_DEFAULT_SECONDS;
+    f64 ratio      = FRAMETIME_DEFAULT_RATIO;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char        option = argv[argIndex][1];
+        const char* value  = argv[argIndex + 1];
+        if (option == 't')
+        {
+            maxThreads = (u32)atoi(value);
+        }
+        else if (option == 's')
+        {
+            seconds = atof(value);
+        }
+        else if (option == 'r')
+        {
+            ratio = atof(value);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (argIndex != argc || maxThreads == 0 || maxThreads > ENGINE_MAX_THREADS || seconds <= 0.0 || ratio < 1.0)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-s seconds] [-r ratio]\n", argv[0]);
+        return 1;
+    }
+
+    u32 maxFrames   = (u32)((seconds + FRAMETIME_OVERRUN_SECONDS) * FRAMETIME_FPS) + 1;
+    u64 storageSize = MEGABYTES(64) + MEGABYTES(FRAMETIME_HASH_MB) + sizeof(EngineThread) * maxThreads +
+                      sizeof(f64) * maxFrames;
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxFrametimeState* state = (LinuxFrametimeState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxFrametimeState), storageSize - sizeof(LinuxFrametimeState));
+    BoardInit(&state->board, FRAMETIME_FEN, &state->arena, BOARD_HISTORY_SEARCH_PLIES);
+    state->engine = EngineCreate(&state->arena, maxThreads, MEGABYTES(FRAMETIME_HASH_MB));
+    f64* samples  = ARENA_PUSH_ARRAY(&state->arena, f64, maxFrames);
+
+    printf("%u online cores, %u search threads, %.1fs search, %.0f frames per second\n", cores, maxThreads, seconds,
+           FRAMETIME_FPS);
+
+    u64            sum  = 0;
+    FrametimeStats idle = FrametimeRun(state, samples, maxFrames, seconds, false, &sum);
+
+    EngineLimits limits = { 0, 0, seconds };
+    if (!EngineStart(state->engine, &state->board, limits, maxThreads))
+    {
+        fprintf(stderr, "[LINUX] unable to start the search\n");
+        return 1;
+    }
+    for (u32 i = 0; i < maxThreads; i++)
+    {
+        pthread_create(&state->threads[i], 0, FrametimeThreadProc, &state->engine->threads[i]);
+    }
+
+    f64            searchStart   = LinuxGetSeconds();
+    FrametimeStats search        = FrametimeRun(state, samples, maxFrames, seconds, true, &sum);
+    f64            searchSeconds = LinuxGetSeconds() - searchStart;
+
+    // Frames ran out before the result came back, the search is stopped so the threads can be joined
+    bool isOverrun = EngineIsSearching(state->engine);
+    if (isOverrun)
+    {
+        EngineStop(state->engine);
+    }
+    for (u32 i = 0; i < maxThreads; i++)
+    {
+        pthread_join(state->threads[i], 0);
+    }
+
+    printf("idle    %4u frames  mean %7.2f us  p99 %7.2f us  max %7.2f us\n", idle.frameCount, idle.mean, idle.p99,
+           idle.max);
+    printf("search  %4u frames  mean %7.2f us  p99 %7.2f us  max %7.2f us  (%.2fs, checksum %llu)\n",
+           search.frameCount, search.mean, search.p99, search.max, searchSeconds, (unsigned long long)sum);
+
+    if (isOverrun)
+    {
+        fprintf(stderr, "[LINUX] the search ran past its %.1fs limit\n", seconds);
+        return 1;
+    }
+    if (search.mean > idle.mean * ratio + FRAMETIME_SLACK_US || search.p99 > idle.p99 * ratio + FRAMETIME_SLACK_US)
+    {
+        fprintf(stderr, "[LINUX] frames during the search are more than %.1fx slower than idle frames\n", ratio);
+        return 1;
+    }
+
+    return 0;
+}
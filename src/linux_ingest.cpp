@@ -0,0 +1,621 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_pgn.h"
+#include "chess_pgn.cpp"
+#include "chess_archive.h"
+#include "chess_archive.cpp"
+
+// Parallel PGN ingestion: the file is mapped and cut into fixed size chunks, every chunk moved forward to the next
+// "[Event " line so no game is split. Workers find their own boundaries with a SIMD scanner, then parse their chunk
+// with their own chess::pgn::StreamParser and Board, encoding every game into a slot buffer. The main thread adds
+// the slots to the archive in chunk order, so the output is the same whatever the thread count.
+//
+// Output is a game archive (chess_archive.h), moves as u16 or with -i as one byte legal move indices. Slot records
+// are an IngestGameRecord, ARCHIVE_TAG_COUNT null terminated tag values, then the encoded moves.
+
+#define INGEST_DEFAULT_CHUNK_MB 8
+#define INGEST_SLOTS_PER_WORKER 2
+#define INGEST_MAX_THREADS      256
+#define INGEST_TAG_MAX_LENGTH   256
+#define INGEST_BYTES_PER_GAME   48 // Archive tables are sized for one game and one new tag value per this many bytes
+
+#pragma pack(push, 1)
+struct IngestGameRecord
+{
+    u32 plyCount;
+    u8  result;
+};
+#pragma pack(pop)
+
+// One chunk in flight: a worker fills it while chunkIndex is its chunk and isReady is false, the writer empties it
+// once isReady, then hands it to chunkIndex + slotCount
+struct IngestSlot
+{
+    u8*  data;
+    u64  size;
+    u32  chunkIndex;
+    u64  games;
+    u64  plies;
+    u64  truncatedGames;
+    u64  droppedGames; // Records that did not fit the slot
+    bool isReady;
+};
+
+struct IngestState
+{
+    const char* content;
+    u64         contentSize;
+    u64         chunkSize;
+    u32         chunkCount;
+    u32         encoding;
+
+    std::atomic<u32> nextChunk;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  readySignal;
+    pthread_cond_t  freeSignal;
+    IngestSlot*     slots;
+    u32             slotCount;
+};
+
+struct IngestWorker
+{
+    IngestState* state;
+    pthread_t    thread;
+    Board        board;
+};
+
+// Archive writes land in a stdio stream, moves arrive in order and only the tables seek
+struct IngestOutput
+{
+    FILE* file;
+    u64   position;
+    u64   size;
+};
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+// ----------------------------------------------------------------------------
+// Game boundaries
+// A game starts at offset 0 and at every "[Event " that begins a line. Lines starting with '[' are found 16 or 32
+// bytes at a time by matching '\n' at i and '[' at i + 1 with two unaligned loads, the tag name is only compared for
+// those candidates. Returns contentSize when there is no game start at or after 'offset'.
+chess_internal inline bool IngestIsGameStart(const char* content, u64 contentSize, u64 offset)
+{
+    return contentSize - offset >= 7 && memcmp(content + offset, "[Event ", 7) == 0;
+}
+
+chess_internal u64 IngestFindGameStartScalar(const char* content, u64 contentSize, u64 offset)
+{
+    for (u64 i = offset - 1; i + 1 < contentSize; i++)
+    {
+        if (content[i] == '\n' && content[i + 1] == '[' && IngestIsGameStart(content, contentSize, i + 1))
+        {
+            return i + 1;
+        }
+    }
+
+    return contentSize;
+}
+
+chess_internal u64 IngestFindGameStartSse2(const char* content, u64 contentSize, u64 offset)
+{
+    __m128i newline = _mm_set1_epi8('\n');
+    __m128i bracket = _mm_set1_epi8('[');
+
+    u64 i = offset - 1;
+    for (; i + 17 <= contentSize; i += 16)
+    {
+        __m128i lines = _mm_loadu_si128((const __m128i*)(content + i));
+        __m128i next  = _mm_loadu_si128((const __m128i*)(content + i + 1));
+        u32     mask  = (u32)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(lines, newline), _mm_cmpeq_epi8(next, bracket)));
+        for (; mask; mask &= mask - 1)
+        {
+            u64 start = i + __builtin_ctz(mask) + 1;
+            if (IngestIsGameStart(content, contentSize, start))
+            {
+                return start;
+            }
+        }
+    }
+
+    return i + 1 < contentSize ? IngestFindGameStartScalar(content, contentSize, i + 1) : contentSize;
+}
+
+__attribute__((target("avx2"))) chess_internal u64 IngestFindGameStartAvx2(const char* content, u64 contentSize,
+                                                                           u64 offset)
+{
+    __m256i newline = _mm256_set1_epi8('\n');
+    __m256i bracket = _mm256_set1_epi8('[');
+
+    u64 i = offset - 1;
+    for (; i + 33 <= contentSize; i += 32)
+    {
+        __m256i lines = _mm256_loadu_si256((const __m256i*)(content + i));
+        __m256i next  = _mm256_loadu_si256((const __m256i*)(content + i + 1));
+        u32     mask  = (u32)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(lines, newline), _mm256_cmpeq_epi8(next, bracket)));
+        for (; mask; mask &= mask - 1)
+        {
+            u64 start = i + __builtin_ctz(mask) + 1;
+            if (IngestIsGameStart(content, contentSize, start))
+            {
+                return start;
+            }
+        }
+    }
+
+    return i + 1 < contentSize ? IngestFindGameStartScalar(content, contentSize, i + 1) : contentSize;
+}
+
+typedef u64 IngestFindGameStartFunc(const char* content, u64 contentSize, u64 offset);
+
+chess_internal IngestFindGameStartFunc* IngestFindGameStartKernel = IngestFindGameStartSse2;
+
+chess_internal u64 IngestFindGameStart(const char* content, u64 contentSize, u64 offset)
+{
+    if (offset == 0 || offset >= contentSize)
+    {
+        return offset < contentSize ? 0 : contentSize;
+    }
+
+    return IngestFindGameStartKernel(content, contentSize, offset);
+}
+
+// ----------------------------------------------------------------------------
+// Parsing
+// PgnBoardVisitor already writes every move into the Board history, the record is taken from it at the end of
+// each game
+class IngestVisitor : public PgnBoardVisitor
+{
+public:
+    IngestSlot* slot;
+    u64         capacity;
+    u32         encoding;
+    u8          result;
+    char        tags[ARCHIVE_TAG_COUNT][INGEST_TAG_MAX_LENGTH];
+
+    void startPgn()
+    {
+        PgnBoardVisitor::startPgn();
+        result = ARCHIVE_RESULT_UNKNOWN;
+        for (u32 i = 0; i < ARCHIVE_TAG_COUNT; i++)
+        {
+            tags[i][0] = '\0';
+        }
+    }
+
+    void header(std::string_view key, std::string_view value)
+    {
+        PgnBoardVisitor::header(key, value);
+
+        // An invalid FEN leaves the game on the initial position, as PgnLoadGame does
+        s32 tag = key == "Event"            ? ARCHIVE_TAG_EVENT
+                  : key == "Site"           ? ARCHIVE_TAG_SITE
+                  : key == "Date"           ? ARCHIVE_TAG_DATE
+                  : key == "Round"          ? ARCHIVE_TAG_ROUND
+                  : key == "White"          ? ARCHIVE_TAG_WHITE
+                  : key == "Black"          ? ARCHIVE_TAG_BLACK
+                  : key == "FEN" && isValid ? ARCHIVE_TAG_FEN
+                                            : -1;
+        if (tag >= 0)
+        {
+            u64 length = value.size() < INGEST_TAG_MAX_LENGTH - 1 ? value.size() : INGEST_TAG_MAX_LENGTH - 1;
+            memcpy(tags[tag], value.data(), length);
+            tags[tag][length] = '\0';
+        }
+        else if (key == "Result")
+        {
+            result = value == "1-0"       ? ARCHIVE_RESULT_WHITE
+                     : value == "0-1"     ? ARCHIVE_RESULT_BLACK
+                     : value == "1/2-1/2" ? ARCHIVE_RESULT_DRAW
+                                          : ARCHIVE_RESULT_UNKNOWN;
+        }
+    }
+
+    // A game with an illegal move keeps the moves before it, the same game PgnLoadGame reads.
+    // A record that does not fit what is left of the slot is dropped and counted.
+    void endPgn()
+    {
+        BoardHistory* history = &board->history;
+
+        u64 tagSize = 0;
+        for (u32 i = 0; i < ARCHIVE_TAG_COUNT; i++)
+        {
+            tagSize += strlen(tags[i]) + 1;
+        }
+        u64 size = sizeof(IngestGameRecord) + tagSize + history->count * sizeof(u16);
+        if (slot->size + size > capacity)
+        {
+            slot->droppedGames++;
+            return;
+        }
+        slot->truncatedGames += !isValid;
+
+        IngestGameRecord record = { history->count, result };
+        memcpy(slot->data + slot->size, &record, sizeof(record));
+        slot->size += sizeof(record);
+
+        for (u32 i = 0; i < ARCHIVE_TAG_COUNT; i++)
+        {
+            u64 length = strlen(tags[i]) + 1;
+            memcpy(slot->data + slot->size, tags[i], length);
+            slot->size += length;
+        }
+
+        slot->size += ArchiveEncodeMoves(board, encoding, slot->data + slot->size);
+        slot->games++;
+        slot->plies += history->count;
+    }
+};
+
+chess_internal void* IngestWorkerThreadProc(void* parameter)
+{
+    IngestWorker* worker = (IngestWorker*)parameter;
+    IngestState*  state  = worker->state;
+
+    IngestVisitor visitor;
+    visitor.board    = &worker->board;
+    visitor.capacity = state->chunkSize * 2;
+    visitor.encoding = state->encoding;
+
+    for (;;)
+    {
+        u32 chunkIndex = state->nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunkIndex >= state->chunkCount)
+        {
+            break;
+        }
+
+        IngestSlot* slot = &state->slots[chunkIndex % state->slotCount];
+        pthread_mutex_lock(&state->lock);
+        while (slot->chunkIndex != chunkIndex || slot->isReady)
+        {
+            pthread_cond_wait(&state->freeSignal, &state->lock);
+        }
+        pthread_mutex_unlock(&state->lock);
+
+        slot->size           = 0;
+        slot->games          = 0;
+        slot->plies          = 0;
+        slot->truncatedGames = 0;
+        slot->droppedGames   = 0;
+        visitor.slot         = slot;
+
+        u64 begin = IngestFindGameStart(state->content, state->contentSize, chunkIndex * state->chunkSize);
+        u64 end   = IngestFindGameStart(state->content, state->contentSize, (chunkIndex + 1) * state->chunkSize);
+        if (begin < end)
+        {
+            PgnMemoryBuffer buffer(state->content + begin, state->content + end);
+            std::istream    stream(&buffer);
+
+            chess::pgn::StreamParser<PGN_PARSER_BUFFER_WIDTH> parser(stream);
+            parser.readGames(visitor);
+        }
+
+        pthread_mutex_lock(&state->lock);
+        slot->isReady = true;
+        pthread_cond_broadcast(&state->readySignal);
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    return 0;
+}
+
+chess_internal ARCHIVE_WRITE(IngestWrite)
+{
+    IngestOutput* output = (IngestOutput*)context;
+    if (offset != output->position && fseek(output->file, (long)offset, SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    output->position = offset + size;
+    output->size     = output->position > output->size ? output->position : output->size;
+    return fwrite(data, 1, size, output->file) == size;
+}
+
+// Game records of one slot into the archive, in the order they were parsed
+chess_internal void IngestAddSlot(ArchiveWriter* writer, IngestSlot* slot)
+{
+    u64 moveBytes = ArchiveGetMoveSize(writer->encoding);
+    u8* cursor    = slot->data;
+    for (u64 i = 0; i < slot->games; i++)
+    {
+        IngestGameRecord record;
+        memcpy(&record, cursor, sizeof(record));
+        cursor += sizeof(record);
+
+        const char* tags[ARCHIVE_TAG_COUNT];
+        for (u32 j = 0; j < ARCHIVE_TAG_COUNT; j++)
+        {
+            tags[j] = (const char*)cursor;
+            cursor += strlen(tags[j]) + 1;
+        }
+
+        ArchiveWriterAddGame(writer, cursor, record.plyCount * moveBytes, record.plyCount, tags, record.result);
+        cursor += record.plyCount * moveBytes;
+    }
+}
+
+struct IngestRun
+{
+    u64  games;
+    u64  plies;
+    u64  truncatedGames;
+    u64  droppedGames;
+    u64  bytesWritten;
+    u64  tagStrings;
+    f64  seconds;
+    bool isWritten;
+};
+
+// Slots are added in chunk order by the calling thread while the workers parse the chunks after them
+chess_internal IngestRun IngestRunThreads(IngestState* state, IngestWorker* workers, u32 threadCount,
+                                          ArchiveWriter* writer)
+{
+    IngestRun run = {};
+
+    state->nextChunk.store(0, std::memory_order_relaxed);
+    state->slotCount = threadCount * INGEST_SLOTS_PER_WORKER;
+    for (u32 i = 0; i < state->slotCount; i++)
+    {
+        state->slots[i].chunkIndex = i;
+        state->slots[i].isReady    = false;
+    }
+
+    f64 start = LinuxGetSeconds();
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        pthread_create(&workers[i].thread, 0, IngestWorkerThreadProc, &workers[i]);
+    }
+
+    for (u32 chunkIndex = 0; chunkIndex < state->chunkCount; chunkIndex++)
+    {
+        IngestSlot* slot = &state->slots[chunkIndex % state->slotCount];
+        pthread_mutex_lock(&state->lock);
+        while (!slot->isReady)
+        {
+            pthread_cond_wait(&state->readySignal, &state->lock);
+        }
+        pthread_mutex_unlock(&state->lock);
+
+        IngestAddSlot(writer, slot);
+        run.games += slot->games;
+        run.plies += slot->plies;
+        run.truncatedGames += slot->truncatedGames;
+        run.droppedGames += slot->droppedGames;
+
+        pthread_mutex_lock(&state->lock);
+        slot->isReady    = false;
+        slot->chunkIndex = chunkIndex + state->slotCount;
+        pthread_cond_broadcast(&state->freeSignal);
+        pthread_mutex_unlock(&state->lock);
+    }
+
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        pthread_join(workers[i].thread, 0);
+    }
+    run.isWritten = ArchiveWriterFinish(writer);
+    fflush(((IngestOutput*)writer->context)->file);
+    run.seconds = LinuxGetSeconds() - start;
+
+    run.bytesWritten = ((IngestOutput*)writer->context)->size;
+    run.tagStrings   = writer->stringCount;
+
+    return run;
+}
+
+int main(int argc, char** argv)
+{
+    const char* outputPath  = "games.carc";
+    u32         threadCount = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    u32         chunkMB     = INGEST_DEFAULT_CHUNK_MB;
+    u32         encoding    = ARCHIVE_ENCODING_MOVE16;
+    bool        isScaling   = false;
+
+    int argIndex = 1;
+    for (; argIndex < argc && argv[argIndex][0] == '-' && argv[argIndex][1] != '\0'; argIndex++)
+    {
+        char option = argv[argIndex][1];
+        if (option == 's' || option == 'i')
+        {
+            isScaling = isScaling || option == 's';
+            if (option == 'i')
+            {
+                encoding = ARCHIVE_ENCODING_INDEX8;
+            }
+            continue;
+        }
+        if (argIndex + 1 >= argc)
+        {
+            argIndex = argc;
+            break;
+        }
+
+        char* value = argv[++argIndex];
+        switch (option)
+        {
+        case 't':
+        {
+            threadCount = (u32)atoi(value);
+            break;
+        }
+        case 'c':
+        {
+            chunkMB = (u32)atoi(value);
+            break;
+        }
+        case 'o':
+        {
+            outputPath = value;
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex >= argc || threadCount == 0 || threadCount > INGEST_MAX_THREADS || chunkMB == 0)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-c chunkMB] [-o games.carc] [-i] [-s] games.pgn\n", argv[0]);
+        return 1;
+    }
+
+    int         file = open(argv[argIndex], O_RDONLY);
+    struct stat fileStat;
+    if (file < 0 || fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", argv[argIndex]);
+        return 1;
+    }
+    u64   contentSize = (u64)fileStat.st_size;
+    void* content     = mmap(0, contentSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (content == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map '%s'\n", argv[argIndex]);
+        return 1;
+    }
+    madvise(content, contentSize, MADV_SEQUENTIAL);
+
+    IngestOutput output = { fopen(outputPath, "wb"), 0, 0 };
+    if (!output.file)
+    {
+        fprintf(stderr, "[LINUX] unable to write '%s'\n", outputPath);
+        return 1;
+    }
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        IngestFindGameStartKernel = IngestFindGameStartAvx2;
+    }
+
+    // Every worker gets a Board, the slots hold one chunk of output each. A chunk reaches up to the end of the game
+    // that crosses its end, records are never larger than their PGN.
+    u32 slotCount   = threadCount * INGEST_SLOTS_PER_WORKER;
+    u64 chunkSize   = MEGABYTES(chunkMB);
+    u64 maxGames    = contentSize / INGEST_BYTES_PER_GAME + 1;
+    u64 maxStrings  = maxGames < 0xFFFFFFFE ? maxGames : 0xFFFFFFFE;
+    u64 stringSize  = contentSize < 0xFFFFFFFF ? contentSize + 2 : 0xFFFFFFFF;
+    u64 writerSize  = maxGames * sizeof(ArchiveGame) + maxStrings * (sizeof(u32) * (ARCHIVE_HASH_SLOTS * 2 + 1)) +
+                     stringSize + KILOBYTES(64);
+    u64 storageSize = sizeof(IngestState) + threadCount * (sizeof(IngestWorker) + MEGABYTES(32)) +
+                      slotCount * (sizeof(IngestSlot) + chunkSize * 2) + writerSize;
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    IngestState* state = new (ARENA_PUSH_ARRAY(&arena, IngestState, 1)) IngestState();
+    state->content     = (const char*)content;
+    state->contentSize = contentSize;
+    state->chunkSize   = chunkSize;
+    state->chunkCount  = (u32)((contentSize + chunkSize - 1) / chunkSize);
+    state->encoding    = encoding;
+    state->slots       = ARENA_PUSH_ARRAY(&arena, IngestSlot, slotCount);
+    for (u32 i = 0; i < slotCount; i++)
+    {
+        state->slots[i].data = (u8*)ArenaPushSize(&arena, chunkSize * 2);
+    }
+    pthread_mutex_init(&state->lock, 0);
+    pthread_cond_init(&state->readySignal, 0);
+    pthread_cond_init(&state->freeSignal, 0);
+
+    IngestWorker* workers = ARENA_PUSH_ARRAY(&arena, IngestWorker, threadCount);
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        workers[i].state = state;
+        BoardInit(&workers[i].board, chess::constants::STARTPOS, &arena, BOARD_HISTORY_MAX_PLIES);
+    }
+
+    // Boundary scan alone on one thread, SIMD against the line by line scan of the game index
+    f64 start  = LinuxGetSeconds();
+    u64 starts = 0;
+    u64 offset = IngestFindGameStart(state->content, contentSize, 0);
+    for (; offset < contentSize; offset = IngestFindGameStart(state->content, contentSize, offset + 1))
+    {
+        starts++;
+    }
+    f64 scanSeconds = LinuxGetSeconds() - start;
+
+    PgnFile pgn;
+    PgnInit(&pgn, &arena);
+    PgnOpen(&pgn, content, contentSize);
+    start = LinuxGetSeconds();
+    while (!PgnIndexStep(&pgn, MEGABYTES(64)))
+    {
+    }
+    f64 lineSeconds = LinuxGetSeconds() - start;
+
+    printf("%.1f MB, %u chunks of %u MB, %s scanner\n", contentSize / (1024.0 * 1024.0), state->chunkCount, chunkMB,
+           IngestFindGameStartKernel == IngestFindGameStartAvx2 ? "AVX2" : "SSE2");
+    printf("scan: %llu games, %.0f MB/s, line by line %u games %.0f MB/s\n", (unsigned long long)starts,
+           contentSize / scanSeconds / (1024.0 * 1024.0), pgn.gameCount, contentSize / lineSeconds / (1024.0 * 1024.0));
+
+    // 1, 2, 4, ... threads with -s, the output is rewritten by every run
+    f64  baseSeconds = 0.0;
+    bool isWritten   = true;
+    for (u32 threads = isScaling ? 1 : threadCount;; threads = threads * 2 < threadCount ? threads * 2 : threadCount)
+    {
+        MemoryArena   runArena = arena;
+        ArchiveWriter writer;
+        output.size = 0;
+        ArchiveWriterInit(&writer, &runArena, encoding, maxGames, maxStrings, stringSize, IngestWrite, &output);
+
+        IngestRun run = IngestRunThreads(state, workers, threads, &writer);
+        baseSeconds   = baseSeconds > 0.0 ? baseSeconds : run.seconds;
+        isWritten     = isWritten && run.isWritten;
+
+        printf("threads %3u  %8.3fs  %7.1f MB/s  %9.0f games/s  %5.2fx  %llu games, %llu truncated, %llu dropped, "
+               "%llu plies, %llu tag strings, %.1f MB written, %.2f bytes per ply\n",
+               threads, run.seconds, contentSize / run.seconds / (1024.0 * 1024.0), run.games / run.seconds,
+               baseSeconds / run.seconds, (unsigned long long)run.games, (unsigned long long)run.truncatedGames,
+               (unsigned long long)run.droppedGames, (unsigned long long)run.plies, (unsigned long long)run.tagStrings, run.bytesWritten / (1024.0 * 1024.0),
+               run.plies ? (f64)run.bytesWritten / run.plies : 0.0);
+
+        if (threads == threadCount)
+        {
+            break;
+        }
+    }
+    fclose(output.file);
+
+    if (!isWritten)
+    {
+        fprintf(stderr, "[LINUX] unable to write '%s', the archive is full or the disk is\n", outputPath);
+        return 1;
+    }
+
+    return 0;
+}
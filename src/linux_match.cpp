@@ -0,0 +1,912 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+
+// Self-play match between two engine configurations for regression testing. Every worker thread owns a Board and
+// one single threaded Engine per configuration and plays whole games, so workers share nothing but the game
+// counter, the result counters and the PGN writer. Openings are sampled from an EPD file and every opening is
+// played twice with colors swapped. The main thread prints games/sec, the Elo difference of A over B with its 95%
+// interval and the SPRT log-likelihood ratio, and stops the match once the SPRT accepts a hypothesis.
+
+#define MATCH_DEFAULT_GAMES     1000
+#define MATCH_DEFAULT_NODES     20000
+#define MATCH_DEFAULT_HASH_MB   8
+#define MATCH_MAX_PLIES         400 // Adjudicated as a draw
+#define MATCH_MAX_OPENINGS      (1 << 20)
+#define MATCH_SPEC_MAX_LENGTH   128
+#define MATCH_REPORT_SECONDS    1.0
+#define MATCH_GAME_TEXT_SIZE    KILOBYTES(16) // Tags and movetext of MATCH_MAX_PLIES SAN moves
+#define MATCH_CHUNK_SIZE        KILOBYTES(64)
+#define MATCH_CHUNKS_PER_WORKER 4
+
+// Both hypotheses are rejected with 5% error
+#define MATCH_SPRT_ALPHA 0.05
+#define MATCH_SPRT_BETA  0.05
+
+enum
+{
+    MATCH_SPRT_RUNNING,
+    MATCH_SPRT_H0, // A is not better than elo0
+    MATCH_SPRT_H1  // A is better than elo1
+};
+
+// Parsed from "depth=8 nodes=20000 movetime=50 hash=8 eval=file bitbases=0"
+struct MatchConfig
+{
+    char         spec[MATCH_SPEC_MAX_LENGTH];
+    EngineLimits limits;
+    u32          hashMB;
+    NnueNetwork  network;
+    bool         hasNetwork;
+    bool         useBitbases;
+};
+
+struct MatchChunk
+{
+    MatchChunk* next;
+    u32         size;
+    char        data[MATCH_CHUNK_SIZE];
+};
+
+// Workers fill whole chunks and hand them over, the writer thread does the file IO. Chunks cycle between the
+// free list and the full queue, a worker only waits when the disk falls behind every chunk in flight.
+struct MatchWriter
+{
+    FILE*           file;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  fullSignal;
+    pthread_cond_t  freeSignal;
+    MatchChunk*     freeChunks;
+    MatchChunk*     fullFirst;
+    MatchChunk*     fullLast;
+    bool            isDone;
+    u64             bytesWritten;
+};
+
+struct MatchWorker
+{
+    struct LinuxMatchState* state;
+    pthread_t               thread;
+    MemoryArena             arena;
+    Board                   board;
+    Engine*                 engines[2]; // Indexed by configuration
+    MatchChunk*             chunk;
+    char                    gameText[MATCH_GAME_TEXT_SIZE];
+};
+
+struct LinuxMatchState
+{
+    MemoryArena arena;
+    MatchConfig configs[2];
+    Bitbases    bitbases;
+
+    char (*openings)[FEN_STR_MAX_LENGTH];
+    u32  openingCount;
+    u64  seed;
+
+    MatchWorker* workers;
+    u32          workerCount;
+    u32          gameCount;
+    MatchWriter  writer;
+    char         date[16];
+
+    f64 elo0;
+    f64 elo1;
+
+    std::atomic<u32>  nextGame;
+    std::atomic<bool> stop;
+    std::atomic<bool> isFailed; // An engine did not play a legal move, the match is stopped
+
+    // Results from the point of view of configuration A
+    std::atomic<u32> wins;
+    std::atomic<u32> draws;
+    std::atomic<u32> losses;
+    std::atomic<u64> plies;
+    std::atomic<u32> adjudicated;
+};
+
+chess_internal const char* matchDefaultOpenings[] = {
+    DEFAULT_FEN_STRING,
+    "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+    "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq - 0 1",
+    "rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 2 2",
+};
+
+chess_internal inline f64 MatchGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+// splitmix64, the opening of a game pair only depends on the seed and the pair index
+chess_internal inline u64 MatchRandom(u64 value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+    return value ^ (value >> 31);
+}
+
+// ----------------------------------------------------------------------------
+// Configurations
+chess_internal bool MatchLoadNetwork(MatchConfig* config, MemoryArena* arena, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    u64 size = (u64)ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    void* content = malloc(size);
+    bool  result  = content && fread(content, 1, size, file) == size &&
+                  NnueLoad(&config->network, arena, content, size);
+    free(content);
+    fclose(file);
+
+    return result;
+}
+
+chess_internal bool MatchParseConfig(MatchConfig* config, MemoryArena* arena, const char* spec)
+{
+    if (strlen(spec) >= MATCH_SPEC_MAX_LENGTH)
+    {
+        return false;
+    }
+    strcpy(config->spec, spec);
+
+    char buffer[MATCH_SPEC_MAX_LENGTH];
+    strcpy(buffer, spec);
+
+    config->limits      = { 0, MATCH_DEFAULT_NODES, 0.0 };
+    config->hashMB      = MATCH_DEFAULT_HASH_MB;
+    config->useBitbases = true;
+
+    bool  hasLimit = false;
+    char* context  = 0;
+    for (char* token = strtok_r(buffer, " ,", &context); token; token = strtok_r(0, " ,", &context))
+    {
+        char* value = strchr(token, '=');
+        if (!value)
+        {
+            return false;
+        }
+        *value++ = '\0';
+
+        if (strcmp(token, "depth") == 0 || strcmp(token, "nodes") == 0 || strcmp(token, "movetime") == 0)
+        {
+            // The first limit given replaces the default node budget
+            if (!hasLimit)
+            {
+                config->limits = {};
+                hasLimit       = true;
+            }
+            if (token[0] == 'd')
+            {
+                config->limits.depth = (u32)atoi(value);
+            }
+            else if (token[0] == 'n')
+            {
+                config->limits.nodes = (u64)atoll(value);
+            }
+            else
+            {
+                config->limits.seconds = atof(value) / 1000.0;
+            }
+        }
+        else if (strcmp(token, "hash") == 0)
+        {
+            config->hashMB = (u32)atoi(value);
+        }
+        else if (strcmp(token, "bitbases") == 0)
+        {
+            config->useBitbases = atoi(value) != 0;
+        }
+        else if (strcmp(token, "eval") == 0)
+        {
+            config->hasNetwork = MatchLoadNetwork(config, arena, value);
+            if (!config->hasNetwork)
+            {
+                fprintf(stderr, "[LINUX] no valid network at '%s'\n", value);
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return config->hashMB > 0 &&
+           (config->limits.depth || config->limits.nodes || config->limits.seconds > 0.0);
+}
+
+// Same cache file as the game, generated in memory when it is missing
+chess_internal void MatchLoadBitbases(LinuxMatchState* state)
+{
+    BitbaseInit(&state->bitbases, &state->arena);
+
+    FILE* file = fopen(BITBASE_CACHE_FILE, "rb");
+    if (file)
+    {
+        BitbaseTables* tables = (BitbaseTables*)malloc(sizeof(BitbaseTables));
+        if (tables && fread(tables, 1, sizeof(BitbaseTables), file) == sizeof(BitbaseTables))
+        {
+            BitbaseLoad(&state->bitbases, tables, sizeof(BitbaseTables));
+        }
+        free(tables);
+        fclose(file);
+    }
+
+    if (!state->bitbases.isReady)
+    {
+        BitbaseGenerator* generator = BitbaseGeneratorCreate(&state->bitbases, &state->arena, 1);
+        BitbaseGenerate(generator, 0, 0);
+    }
+}
+
+// EPD lines keep their first four fields, the move counters are reset. Returns the opening count, 0 on error.
+chess_internal u32 MatchLoadOpenings(LinuxMatchState* state, const char* filename)
+{
+    state->openings = (char(*)[FEN_STR_MAX_LENGTH])ArenaPushSize(
+        &state->arena, (u64)MATCH_MAX_OPENINGS * FEN_STR_MAX_LENGTH, 64);
+
+    if (!filename)
+    {
+        for (u32 i = 0; i < ARRAY_COUNT(matchDefaultOpenings); i++)
+        {
+            strcpy(state->openings[i], matchDefaultOpenings[i]);
+        }
+        return ARRAY_COUNT(matchDefaultOpenings);
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", filename);
+        return 0;
+    }
+
+    chess::Board position;
+    char         line[1024];
+    u32          result  = 0;
+    u32          skipped = 0;
+    while (result < MATCH_MAX_OPENINGS && fgets(line, sizeof(line), file))
+    {
+        char fields[4][72];
+        if (sscanf(line, "%71s %71s %71s %71s", fields[0], fields[1], fields[2], fields[3]) != 4)
+        {
+            continue;
+        }
+
+        char* fen = state->openings[result];
+        s32   length =
+            snprintf(fen, FEN_STR_MAX_LENGTH, "%s %s %s %s 0 1", fields[0], fields[1], fields[2], fields[3]);
+        if (length >= FEN_STR_MAX_LENGTH || !BoardPositionSetFen(&position, fen) ||
+            position.isGameOver().second != chess::GameResult::NONE)
+        {
+            skipped++;
+            continue;
+        }
+        result++;
+    }
+    fclose(file);
+
+    if (skipped)
+    {
+        fprintf(stderr, "[LINUX] skipped %u invalid or finished openings\n", skipped);
+    }
+
+    return result;
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// PGN writer
+chess_internal void* MatchWriterThreadProc(void* parameter)
+{
+    MatchWriter* writer = (MatchWriter*)parameter;
+
+    pthread_mutex_lock(&writer->lock);
+    for (;;)
+    {
+        while (!writer->fullFirst && !writer->isDone)
+        {
+            pthread_cond_wait(&writer->fullSignal, &writer->lock);
+        }
+        MatchChunk* chunk = writer->fullFirst;
+        if (!chunk)
+        {
+            break;
+        }
+        writer->fullFirst = chunk->next;
+        writer->fullLast  = writer->fullFirst ? writer->fullLast : 0;
+        pthread_mutex_unlock(&writer->lock);
+
+        if (writer->file)
+        {
+            fwrite(chunk->data, 1, chunk->size, writer->file);
+        }
+
+        pthread_mutex_lock(&writer->lock);
+        writer->bytesWritten += chunk->size;
+        chunk->size       = 0;
+        chunk->next       = writer->freeChunks;
+        writer->freeChunks = chunk;
+        pthread_cond_signal(&writer->freeSignal);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return 0;
+}
+
+chess_internal void MatchWriterInit(MatchWriter* writer, MemoryArena* arena, FILE* file, u32 chunkCount)
+{
+    writer->file = file;
+    pthread_mutex_init(&writer->lock, 0);
+    pthread_cond_init(&writer->fullSignal, 0);
+    pthread_cond_init(&writer->freeSignal, 0);
+
+    for (u32 i = 0; i < chunkCount; i++)
+    {
+        MatchChunk* chunk  = ARENA_PUSH_ARRAY(arena, MatchChunk, 1);
+        chunk->next        = writer->freeChunks;
+        chunk->size        = 0;
+        writer->freeChunks = chunk;
+    }
+
+    pthread_create(&writer->thread, 0, MatchWriterThreadProc, writer);
+}
+
+// Queues the chunk, returns an empty one when asked for
+chess_internal MatchChunk* MatchWriterSubmit(MatchWriter* writer, MatchChunk* chunk, bool needsChunk)
+{
+    pthread_mutex_lock(&writer->lock);
+    if (chunk)
+    {
+        chunk->next = 0;
+        if (writer->fullLast)
+        {
+            writer->fullLast->next = chunk;
+        }
+        else
+        {
+            writer->fullFirst = chunk;
+        }
+        writer->fullLast = chunk;
+        pthread_cond_signal(&writer->fullSignal);
+    }
+
+    MatchChunk* result = 0;
+    if (needsChunk)
+    {
+        while (!writer->freeChunks)
+        {
+            pthread_cond_wait(&writer->freeSignal, &writer->lock);
+        }
+        result             = writer->freeChunks;
+        writer->freeChunks = result->next;
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return result;
+}
+
+// Writes every queued chunk and joins the writer thread
+chess_internal void MatchWriterFinish(MatchWriter* writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    writer->isDone = true;
+    pthread_cond_signal(&writer->fullSignal);
+    pthread_mutex_unlock(&writer->lock);
+
+    pthread_join(writer->thread, 0);
+    if (writer->file)
+    {
+        fclose(writer->file);
+    }
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Games
+struct MatchGame
+{
+    u32  index;
+    u32  openingIndex;
+    bool isWhiteA;
+    u32  result;      // BOARD_GAME_RESULT_*, white point of view
+    bool isAdjudicated;
+    u16  moves[MATCH_MAX_PLIES];
+    u32  moveCount;
+};
+
+chess_internal u32 MatchAppend(char* buffer, u32 size, u32 used, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    s32 length = vsnprintf(buffer + used, size - used, format, args);
+    va_end(args);
+
+    return length > 0 && used + (u32)length < size ? used + (u32)length : used;
+}
+
+// Tags, then SAN movetext wrapped at 80 columns
+chess_internal u32 MatchFormatPgn(LinuxMatchState* state, MatchWorker* worker, MatchGame* game)
+{
+    const char* result = game->result == BOARD_GAME_RESULT_WIN    ? "1-0"
+                         : game->result == BOARD_GAME_RESULT_LOSE ? "0-1"
+                                                                  : "1/2-1/2";
+    const char* fen    = state->openings[game->openingIndex];
+    MatchConfig* white = &state->configs[game->isWhiteA ? 0 : 1];
+    MatchConfig* black = &state->configs[game->isWhiteA ? 1 : 0];
+
+    char* text = worker->gameText;
+    u32   size = sizeof(worker->gameText);
+    u32   used = 0;
+    used = MatchAppend(text, size, used, "[Event \"Self-play match\"]\n[Site \"?\"]\n[Date \"%s\"]\n[Round \"%u\"]\n",
+                       state->date, game->index + 1);
+    used = MatchAppend(text, size, used, "[White \"%c %s\"]\n[Black \"%c %s\"]\n[Result \"%s\"]\n",
+                       game->isWhiteA ? 'A' : 'B', white->spec, game->isWhiteA ? 'B' : 'A', black->spec, result);
+    if (strcmp(fen, DEFAULT_FEN_STRING) != 0)
+    {
+        used = MatchAppend(text, size, used, "[SetUp \"1\"]\n[FEN \"%s\"]\n", fen);
+    }
+    used = MatchAppend(text, size, used, "[PlyCount \"%u\"]\n", game->moveCount);
+    if (game->isAdjudicated)
+    {
+        used = MatchAppend(text, size, used, "[Termination \"adjudication\"]\n");
+    }
+    used = MatchAppend(text, size, used, "\n");
+
+    chess::Board position(fen);
+    u32          column = 0;
+    for (u32 i = 0; i < game->moveCount; i++)
+    {
+        char        number[16] = "";
+        chess::Move move(game->moves[i]);
+        if (position.sideToMove() == chess::Color::WHITE)
+        {
+            snprintf(number, sizeof(number), "%u. ", position.fullMoveNumber());
+        }
+        else if (i == 0)
+        {
+            snprintf(number, sizeof(number), "%u... ", position.fullMoveNumber());
+        }
+        std::string san    = chess::uci::moveToSan(position, move);
+        u32         length = (u32)(strlen(number) + san.size());
+        if (column > 0 && column + 1 + length > 80)
+        {
+            used   = MatchAppend(text, size, used, "\n");
+            column = 0;
+        }
+        used = MatchAppend(text, size, used, "%s%s%s", column > 0 ? " " : "", number, san.c_str());
+        column += length + (column > 0);
+        position.makeMove(move);
+    }
+    used = MatchAppend(text, size, used, "%s%s\n\n", column > 0 ? " " : "", result);
+
+    return used;
+}
+
+// False when a search could not start or its move is not legal in the position, the game is then unfinished
+chess_internal bool MatchPlayGame(LinuxMatchState* state, MatchWorker* worker, MatchGame* game)
+{
+    Board* board = &worker->board;
+    BoardReset(board, state->openings[game->openingIndex]);
+    EngineClearHash(worker->engines[0]);
+    EngineClearHash(worker->engines[1]);
+
+    game->moveCount     = 0;
+    game->isAdjudicated = false;
+    while (BoardGetGameResult(board) == BOARD_GAME_RESULT_NONE)
+    {
+        if (game->moveCount == MATCH_MAX_PLIES)
+        {
+            game->isAdjudicated = true;
+            break;
+        }
+
+        bool         isTurnA = (BoardGetTurn(board) == PIECE_COLOR_WHITE) == game->isWhiteA;
+        MatchConfig* config  = &state->configs[isTurnA ? 0 : 1];
+        Engine*      engine  = worker->engines[isTurnA ? 0 : 1];
+
+        // The whole search runs on the worker thread
+        if (!EngineStart(engine, board, config->limits, 1))
+        {
+            return false;
+        }
+        EngineSearch(&engine->threads[0]);
+
+        EngineResult result;
+        if (!EnginePollResult(engine, &result))
+        {
+            return false;
+        }
+
+        Move* move = 0;
+        for (u32 i = 0; i < board->info.moveCount && !move; i++)
+        {
+            move = board->info.moves[i].data == result.move ? &board->info.moves[i] : 0;
+        }
+        // The move table is regenerated by BoardMoveDo, the move is recorded first
+        if (!move)
+        {
+            return false;
+        }
+        game->moves[game->moveCount] = move->data;
+        if (!BoardMoveDo(board, move))
+        {
+            return false;
+        }
+        game->moveCount++;
+    }
+
+    game->result = game->isAdjudicated ? (u32)BOARD_GAME_RESULT_DRAW : BoardGetGameResult(board);
+
+    return true;
+}
+
+chess_internal void* MatchWorkerThreadProc(void* parameter)
+{
+    MatchWorker*     worker = (MatchWorker*)parameter;
+    LinuxMatchState* state  = worker->state;
+
+    MatchGame game;
+    for (;;)
+    {
+        u32 gameIndex = state->nextGame.fetch_add(1, std::memory_order_relaxed);
+        if (gameIndex >= state->gameCount || state->stop.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        game.index        = gameIndex;
+        game.openingIndex = (u32)(MatchRandom(state->seed ^ (gameIndex / 2)) % state->openingCount);
+        game.isWhiteA     = (gameIndex & 1) == 0;
+        if (!MatchPlayGame(state, worker, &game))
+        {
+            fprintf(stderr, "[LINUX] game %u: no legal move from the engine, the match is stopped\n", gameIndex + 1);
+            state->isFailed.store(true, std::memory_order_relaxed);
+            state->stop.store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        u32 size = MatchFormatPgn(state, worker, &game);
+        if (worker->chunk->size + size > MATCH_CHUNK_SIZE)
+        {
+            worker->chunk = MatchWriterSubmit(&state->writer, worker->chunk, true);
+        }
+        memcpy(worker->chunk->data + worker->chunk->size, worker->gameText, size);
+        worker->chunk->size += size;
+
+        bool isDraw = game.result == BOARD_GAME_RESULT_DRAW;
+        bool isWinA = (game.result == BOARD_GAME_RESULT_WIN) == game.isWhiteA;
+        (isDraw ? state->draws : isWinA ? state->wins : state->losses).fetch_add(1, std::memory_order_relaxed);
+        state->plies.fetch_add(game.moveCount, std::memory_order_relaxed);
+        state->adjudicated.fetch_add(game.isAdjudicated, std::memory_order_relaxed);
+    }
+
+    MatchWriterSubmit(&state->writer, worker->chunk, false);
+    worker->chunk = 0;
+
+    return 0;
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Statistics
+chess_internal inline f64 MatchScoreToElo(f64 score)
+{
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+chess_internal inline f64 MatchEloToScore(f64 elo)
+{
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+struct MatchStats
+{
+    u32 games;
+    f64 score;
+    f64 elo;
+    f64 eloError; // Half width of the 95% interval
+    f64 llr;
+    u32 sprt;
+};
+
+// Trinomial model: normal approximation of the score with the per game variance, the SPRT log-likelihood ratio is
+// the usual GSPRT approximation n * (s1 - s0) * (2s - s0 - s1) / (2 * variance)
+chess_internal MatchStats MatchGetStats(LinuxMatchState* state)
+{
+    u32 wins   = state->wins.load(std::memory_order_relaxed);
+    u32 draws  = state->draws.load(std::memory_order_relaxed);
+    u32 losses = state->losses.load(std::memory_order_relaxed);
+
+    MatchStats result = {};
+    result.games      = wins + draws + losses;
+    if (result.games == 0)
+    {
+        return result;
+    }
+
+    f64 n        = (f64)result.games;
+    f64 score    = (wins + 0.5 * draws) / n;
+    f64 variance = (wins * (1.0 - score) * (1.0 - score) + draws * (0.5 - score) * (0.5 - score) +
+                    losses * score * score) /
+                   n;
+    result.score = score;
+
+    if (score > 0.0 && score < 1.0)
+    {
+        f64 deviation   = sqrt(variance / n);
+        f64 low         = score - 1.96 * deviation;
+        f64 high        = score + 1.96 * deviation;
+        low             = low > 0.0 ? low : 0.0001;
+        high            = high < 1.0 ? high : 0.9999;
+        result.elo      = MatchScoreToElo(score);
+        result.eloError = (MatchScoreToElo(high) - MatchScoreToElo(low)) / 2.0;
+    }
+    else
+    {
+        result.elo = score > 0.0 ? 999.0 : -999.0;
+    }
+
+    if (variance > 0.0)
+    {
+        f64 score0 = MatchEloToScore(state->elo0);
+        f64 score1 = MatchEloToScore(state->elo1);
+        result.llr = n * (score1 - score0) * (2.0 * score - score0 - score1) / (2.0 * variance);
+    }
+
+    f64 lowerBound = log(MATCH_SPRT_BETA / (1.0 - MATCH_SPRT_ALPHA));
+    f64 upperBound = log((1.0 - MATCH_SPRT_BETA) / MATCH_SPRT_ALPHA);
+    result.sprt    = result.llr >= upperBound   ? MATCH_SPRT_H1
+                     : result.llr <= lowerBound ? MATCH_SPRT_H0
+                                                : MATCH_SPRT_RUNNING;
+
+    return result;
+}
+
+chess_internal void MatchPrintStats(LinuxMatchState* state, f64 seconds)
+{
+    MatchStats  stats = MatchGetStats(state);
+    const char* sprt  = stats.sprt == MATCH_SPRT_H1 ? "H1 accepted" : stats.sprt == MATCH_SPRT_H0 ? "H0 accepted" : "";
+
+    printf("games %6u  %6.2f games/s  +%u =%u -%u  score %5.1f%%  elo %+7.1f +- %5.1f  llr %5.2f (%.2f, %.2f) %s\n",
+           stats.games, seconds > 0.0 ? stats.games / seconds : 0.0, state->wins.load(), state->draws.load(),
+           state->losses.load(), stats.score * 100.0, stats.elo, stats.eloError, stats.llr,
+           log(MATCH_SPRT_BETA / (1.0 - MATCH_SPRT_ALPHA)), log((1.0 - MATCH_SPRT_BETA) / MATCH_SPRT_ALPHA), sprt);
+    fflush(stdout);
+}
+// ----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    u32         workerCount  = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    u32         gameCount    = MATCH_DEFAULT_GAMES;
+    const char* openingsFile = 0;
+    const char* pgnFile      = 0;
+    const char* specs[2]     = { "", "" };
+    f64         elo0         = 0.0;
+    f64         elo1         = 5.0;
+    u64         seed         = 1;
+    bool        isValid      = true;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-' && isValid; argIndex += 2)
+    {
+        const char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 't':
+        {
+            workerCount = (u32)atoi(value);
+            break;
+        }
+        case 'g':
+        {
+            gameCount = (u32)atoi(value);
+            break;
+        }
+        case 'e':
+        {
+            openingsFile = value;
+            break;
+        }
+        case 'o':
+        {
+            pgnFile = value;
+            break;
+        }
+        case 'a':
+        {
+            specs[0] = value;
+            break;
+        }
+        case 'b':
+        {
+            specs[1] = value;
+            break;
+        }
+        case 's':
+        {
+            isValid = sscanf(value, "%lf,%lf", &elo0, &elo1) == 2 && elo0 < elo1;
+            break;
+        }
+        case 'r':
+        {
+            seed = (u64)atoll(value);
+            break;
+        }
+        default:
+        {
+            isValid = false;
+        }
+        }
+    }
+
+    if (!isValid || argIndex != argc || workerCount == 0 || workerCount > 1024 || gameCount == 0)
+    {
+        fprintf(stderr,
+                "usage: %s [-t threads] [-g games] [-e openings.epd] [-o games.pgn] [-a spec] [-b spec] "
+                "[-s elo0,elo1] [-r seed]\n"
+                "  spec: \"depth=N nodes=N movetime=ms hash=MB eval=file bitbases=0|1\", default nodes=%u hash=%u\n",
+                argv[0], MATCH_DEFAULT_NODES, MATCH_DEFAULT_HASH_MB);
+        return 1;
+    }
+
+    u64   storageSize = sizeof(LinuxMatchState) + (u64)MATCH_MAX_OPENINGS * FEN_STR_MAX_LENGTH + MEGABYTES(64);
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxMatchState* state = new (storage) LinuxMatchState();
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxMatchState), storageSize - sizeof(LinuxMatchState));
+    state->gameCount   = gameCount;
+    state->workerCount = workerCount;
+    state->seed        = seed;
+    state->elo0        = elo0;
+    state->elo1        = elo1;
+
+    for (u32 i = 0; i < 2; i++)
+    {
+        if (!MatchParseConfig(&state->configs[i], &state->arena, specs[i]))
+        {
+            fprintf(stderr, "[LINUX] invalid configuration '%s'\n", specs[i]);
+            return 1;
+        }
+    }
+
+    state->openingCount = MatchLoadOpenings(state, openingsFile);
+    if (state->openingCount == 0)
+    {
+        fprintf(stderr, "[LINUX] no openings\n");
+        return 1;
+    }
+
+    FILE* file = 0;
+    if (pgnFile)
+    {
+        file = fopen(pgnFile, "wb");
+        if (!file)
+        {
+            fprintf(stderr, "[LINUX] unable to create '%s'\n", pgnFile);
+            return 1;
+        }
+    }
+
+    time_t    now = time(0);
+    struct tm date;
+    localtime_r(&now, &date);
+    strftime(state->date, sizeof(state->date), "%Y.%m.%d", &date);
+
+    // Workers get their own mapping, sized by the hash tables of both configurations and a board that holds one game.
+    // The PGN chunks of the writer and the worker array come from the same mapping, each worker arena is 64 byte
+    // aligned.
+    u64 workerSize = MEGABYTES(1) + BoardArenaSize(MATCH_MAX_PLIES + 1) +
+                     MEGABYTES(state->configs[0].hashMB + state->configs[1].hashMB);
+    u64 workerStorageSize =
+        workerCount * (sizeof(MatchWorker) + MATCH_CHUNKS_PER_WORKER * sizeof(MatchChunk) + workerSize + 64);
+    void* workerStorage =
+        mmap(0, workerStorageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (workerStorage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)workerStorageSize);
+        return 1;
+    }
+    MemoryArena workerArena;
+    ArenaInit(&workerArena, workerStorage, workerStorageSize);
+
+    MatchLoadBitbases(state);
+    MatchWriterInit(&state->writer, &workerArena, file, workerCount * MATCH_CHUNKS_PER_WORKER);
+
+    state->workers = ARENA_PUSH_ARRAY(&workerArena, MatchWorker, workerCount);
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        MatchWorker* worker = new (&state->workers[i]) MatchWorker();
+        worker->state       = state;
+        ArenaInit(&worker->arena, ArenaPushSize(&workerArena, workerSize, 64), workerSize);
+        BoardInit(&worker->board, DEFAULT_FEN_STRING, &worker->arena, MATCH_MAX_PLIES + 1);
+        for (u32 j = 0; j < 2; j++)
+        {
+            MatchConfig* config = &state->configs[j];
+            Engine*      engine = EngineCreate(&worker->arena, 1, MEGABYTES(config->hashMB));
+            engine->network     = config->hasNetwork ? &config->network : 0;
+            engine->bitbases    = config->useBitbases ? &state->bitbases : 0;
+            worker->engines[j]  = engine;
+        }
+        worker->chunk = MatchWriterSubmit(&state->writer, 0, true);
+    }
+
+    printf("A: %s\nB: %s\n%u games, %u threads, %u openings, SPRT elo0 %.1f elo1 %.1f\n", state->configs[0].spec,
+           state->configs[1].spec, gameCount, workerCount, state->openingCount, elo0, elo1);
+
+    f64 start = MatchGetSeconds();
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        pthread_create(&state->workers[i].thread, 0, MatchWorkerThreadProc, &state->workers[i]);
+    }
+
+    // Games already started when the SPRT stops the match are finished and counted
+    f64 lastReport = start;
+    while (MatchGetStats(state).games < gameCount && !state->stop.load(std::memory_order_relaxed))
+    {
+        usleep(10000);
+        f64 seconds = MatchGetSeconds();
+        if (seconds - lastReport >= MATCH_REPORT_SECONDS)
+        {
+            lastReport = seconds;
+            MatchPrintStats(state, seconds - start);
+        }
+        if (MatchGetStats(state).sprt != MATCH_SPRT_RUNNING)
+        {
+            state->stop.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        pthread_join(state->workers[i].thread, 0);
+    }
+    f64 seconds = MatchGetSeconds() - start;
+    MatchWriterFinish(&state->writer);
+
+    MatchPrintStats(state, seconds);
+    MatchStats stats = MatchGetStats(state);
+    printf("%.2fs, %.1f plies per game, %u adjudicated, %llu PGN bytes\n", seconds,
+           stats.games ? (f64)state->plies.load() / stats.games : 0.0, state->adjudicated.load(),
+           (unsigned long long)state->writer.bytesWritten);
+
+    return state->isFailed.load() ? 1 : 0;
+}
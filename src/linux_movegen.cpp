@@ -0,0 +1,280 @@
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+
+// Checks and benchmark of single-cell move generation.
+// -v visits every node above the leaves of each position and compares the move table with chess::movegen::legalmoves
+// as sorted move lists, and every cell of the table with BoardGeneratePieceMoves move for move.
+// -c times BoardGeneratePieceMoves against legalmoves for the piece type filtered on the origin cell, the way a cell
+// was answered before, over every cell of the side to move, and the whole move table against a full legalmoves.
+// Both run when neither is given.
+
+#define MOVEGEN_BENCH_ITERATIONS 100000
+#define MOVEGEN_MAX_MISMATCHES   10 // Printed before the walk gives up
+
+struct MovegenPosition
+{
+    const char* name;
+    const char* fen;
+    u32         depth;
+};
+
+// https://www.chessprogramming.org/Perft_Results, plus two en passant captures that expose the king
+chess_internal MovegenPosition movegenSuite[] = {
+    { "startpos", DEFAULT_FEN_STRING, 5 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4 },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5 },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4 },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4 },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4 },
+    { "enpassant1", "8/8/8/KPp4r/8/8/8/4k3 w - c6 0 2", 4 },
+    { "enpassant2", "8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1", 4 },
+};
+
+chess_internal inline timespec LinuxGetWallClock()
+{
+    timespec result;
+    clock_gettime(CLOCK_MONOTONIC, &result);
+    return result;
+}
+
+chess_internal inline f64 LinuxGetSecondsElapsed(timespec start, timespec end)
+{
+    return (f64)(end.tv_sec - start.tv_sec) + (f64)(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+}
+
+chess_internal int MovegenCompareMoves(const void* a, const void* b)
+{
+    return (int)*(const u16*)a - (int)*(const u16*)b;
+}
+
+// Returns the number of nodes that disagree, the walk stops below a node once MOVEGEN_MAX_MISMATCHES were found
+chess_internal u64 MovegenVerify(Board* board, u32 depth, u64* nodes)
+{
+    PositionInfo* info = &board->info;
+
+    chess::Movelist _movelist;
+    chess::movegen::legalmoves(_movelist, *board->position);
+
+    bool isSame = (u32)_movelist.size() == info->moveCount;
+    if (isSame)
+    {
+        u16 tableMoves[MOVE_LIST_MAX];
+        u16 rawMoves[MOVE_LIST_MAX];
+        for (u32 i = 0; i < info->moveCount; i++)
+        {
+            tableMoves[i] = info->moves[i].data;
+            rawMoves[i]   = _movelist[i].move();
+        }
+        qsort(tableMoves, info->moveCount, sizeof(u16), MovegenCompareMoves);
+        qsort(rawMoves, info->moveCount, sizeof(u16), MovegenCompareMoves);
+        isSame = memcmp(tableMoves, rawMoves, sizeof(u16) * info->moveCount) == 0;
+    }
+    for (u32 cellIndex = 0; isSame && cellIndex < 64; cellIndex++)
+    {
+        u32   moveCount;
+        Move* piecelist = BoardGetPieceMoveList(board, cellIndex, &moveCount);
+        Move  generated[PIECE_MOVE_LIST_MAX];
+        isSame = BoardGeneratePieceMoves(board, cellIndex, generated) == moveCount;
+        for (u32 moveIndex = 0; isSame && moveIndex < moveCount; moveIndex++)
+        {
+            isSame = generated[moveIndex].data == piecelist[moveIndex].data;
+        }
+    }
+
+    (*nodes)++;
+    u64 mismatches = isSame ? 0 : 1;
+    if (!isSame)
+    {
+        printf("           moves differ at %s\n", board->position->getFen().c_str());
+    }
+
+    if (depth > 1)
+    {
+        u32  moveCount = info->moveCount;
+        Move movelist[MOVE_LIST_MAX];
+        memcpy(movelist, info->moves, sizeof(Move) * moveCount);
+
+        for (u32 moveIndex = 0; moveIndex < moveCount && mismatches < MOVEGEN_MAX_MISMATCHES; moveIndex++)
+        {
+            BoardMoveDo(board, &movelist[moveIndex]);
+            mismatches += MovegenVerify(board, depth - 1, nodes);
+            BoardMoveUndo(board);
+        }
+    }
+
+    return mismatches;
+}
+
+// Averages in ns per call, the returned sum only keeps the calls from being optimized away
+chess_internal u64 MovegenBench(Board* board, const MovegenPosition* position, u32 iterations)
+{
+    const BoardPosition& _board = *board->position;
+
+    u64 sum         = 0;
+    u32 cellCount   = 0;
+    f64 cellSeconds = 0.0;
+    f64 rawSeconds  = 0.0;
+    for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+    {
+        chess::Piece _piece = _board.at(chess::Square(cellIndex));
+        if (_piece == chess::Piece::NONE || _piece.color() != _board.sideToMove())
+        {
+            continue;
+        }
+        cellCount++;
+
+        timespec start = LinuxGetWallClock();
+        for (u32 i = 0; i < iterations; i++)
+        {
+            Move moves[PIECE_MOVE_LIST_MAX];
+            sum += BoardGeneratePieceMoves(board, cellIndex, moves);
+        }
+        cellSeconds += LinuxGetSecondsElapsed(start, LinuxGetWallClock());
+
+        int pieces = 1 << (int)_piece.type();
+        start      = LinuxGetWallClock();
+        for (u32 i = 0; i < iterations; i++)
+        {
+            chess::Movelist _movelist;
+            chess::movegen::legalmoves(_movelist, _board, pieces);
+            for (const auto& _move : _movelist)
+            {
+                sum += _move.from().index() == (int)cellIndex;
+            }
+        }
+        rawSeconds += LinuxGetSecondsElapsed(start, LinuxGetWallClock());
+    }
+
+    timespec start = LinuxGetWallClock();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        BoardUpdatePositionInfo(board);
+        sum += board->info.moveCount;
+    }
+    f64 tableSeconds = LinuxGetSecondsElapsed(start, LinuxGetWallClock());
+
+    start = LinuxGetWallClock();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        chess::Movelist _movelist;
+        chess::movegen::legalmoves(_movelist, _board);
+        sum += (u64)_movelist.size();
+    }
+    f64 legalSeconds = LinuxGetSecondsElapsed(start, LinuxGetWallClock());
+
+    f64 toNs = 1000000000.0 / iterations;
+    printf("%-10s cell %6.1f ns  legalmoves filtered %6.1f ns  (%2u cells)  table %7.1f ns  legalmoves %7.1f ns\n",
+           position->name, cellSeconds / cellCount * toNs, rawSeconds / cellCount * toNs, cellCount,
+           tableSeconds * toNs, legalSeconds * toNs);
+
+    return sum;
+}
+
+// Usage: movegen [-v] [-c] ["<fen>" <depth>]
+//          -v            checks the move table and every cell against legalmoves at every node above the leaves
+//          -c            times single-cell generation and the move table against legalmoves at each root
+int main(int argc, char** argv)
+{
+    bool verify    = false;
+    bool cellBench = false;
+
+    int argIndex = 1;
+    for (; argIndex < argc && argv[argIndex][0] == '-'; argIndex++)
+    {
+        char option = argv[argIndex][1];
+        if (option == 'v')
+        {
+            verify = true;
+        }
+        else if (option == 'c')
+        {
+            cellBench = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    int positionalCount = argc - argIndex;
+    if (positionalCount != 0 && positionalCount != 2)
+    {
+        fprintf(stderr, "usage: %s [-v] [-c] [\"<fen>\" <depth>]\n", argv[0]);
+        return 1;
+    }
+    if (!verify && !cellBench)
+    {
+        verify    = true;
+        cellBench = true;
+    }
+
+    MovegenPosition  custom;
+    MovegenPosition* positions     = movegenSuite;
+    u32              positionCount = ARRAY_COUNT(movegenSuite);
+    if (positionalCount == 2)
+    {
+        custom.name   = "custom";
+        custom.fen    = argv[argIndex];
+        custom.depth  = (u32)atoi(argv[argIndex + 1]);
+        positions     = &custom;
+        positionCount = 1;
+        if (custom.depth == 0)
+        {
+            fprintf(stderr, "[LINUX] depth must be at least 1\n");
+            return 1;
+        }
+    }
+
+    u64   storageSize = MEGABYTES(64);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    Board board;
+    BoardInit(&board, DEFAULT_FEN_STRING, &arena, BOARD_HISTORY_SEARCH_PLIES);
+
+    bool valid = true;
+    u64  sum   = 0;
+    for (u32 positionIndex = 0; positionIndex < positionCount; positionIndex++)
+    {
+        const MovegenPosition* position = &positions[positionIndex];
+        if (!BoardReset(&board, position->fen))
+        {
+            fprintf(stderr, "[LINUX] invalid position: %s\n", position->fen);
+            return 1;
+        }
+
+        if (verify)
+        {
+            u64 nodes      = 0;
+            u64 mismatches = MovegenVerify(&board, position->depth, &nodes);
+            printf("%-10s depth %u  %10llu nodes checked  %llu differ  %s\n", position->name, position->depth - 1,
+                   (unsigned long long)nodes, (unsigned long long)mismatches, mismatches ? "FAILED" : "ok");
+            valid &= mismatches == 0;
+        }
+        if (cellBench)
+        {
+            sum += MovegenBench(&board, position, MOVEGEN_BENCH_ITERATIONS);
+        }
+    }
+    if (cellBench)
+    {
+        printf("checksum %llu\n", (unsigned long long)sum);
+    }
+
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,751 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+
+#include <atomic>
+
+// Headless perft runner, measures the Board layer against raw chess::movegen on the same positions.
+// Both walkers bulk count at depth 1, so the difference is the cost of the wrapper per node.
+// With -t the suite runs hashed perft on a pool of worker threads, see PerftParallel.
+
+#define PERFT_MAX_THREADS    64
+#define PERFT_CACHE_MB       256
+#define PERFT_EPD_MAX_LINES  4096
+#define PERFT_SPLIT_PLIES    2
+#define PERFT_MAX_TASKS      (MOVE_LIST_MAX * MOVE_LIST_MAX)
+
+struct PerftPosition
+{
+    const char* name;
+    const char* fen;
+    u32         depth;
+    u64         nodes;
+};
+
+// https://www.chessprogramming.org/Perft_Results
+chess_internal PerftPosition perftSuite[] = {
+    { "startpos", DEFAULT_FEN_STRING, 5, 4865609 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+};
+
+// Lockless entry: 'check' is key ^ data, a torn write from another thread fails the key test and reads as a miss
+// data packs the depth in the low 8 bits and the node count above it
+struct PerftCacheEntry
+{
+    std::atomic<u64> check;
+    std::atomic<u64> data;
+};
+
+struct PerftCache
+{
+    PerftCacheEntry* entries;
+    u64              mask;
+};
+
+// Root split: the moves of the first PERFT_SPLIT_PLIES plies, the subtree below is counted by one worker
+struct PerftTask
+{
+    u16 moves[PERFT_SPLIT_PLIES];
+    u32 moveCount;
+};
+
+// Every worker owns a slice of the task list and claims from its front, idle workers claim from the others
+struct alignas(64) PerftQueue
+{
+    std::atomic<u32> next;
+    u32              end;
+};
+
+struct LinuxPerftState;
+
+struct PerftWorker
+{
+    LinuxPerftState* state;
+    pthread_t        thread;
+    u32              workerIndex;
+    Board            board;
+    bool             boardInitialized;
+    MemoryArena      arena;
+};
+
+struct PerftJob
+{
+    const char*      fen;
+    u32              depth;
+    PerftTask*       tasks;
+    u32              taskCount;
+    u32              workerCount;
+    PerftQueue       queues[PERFT_MAX_THREADS];
+    std::atomic<u64> nodes;
+};
+
+// Lives at the start of the mapped memory, Board is never constructed as a whole, like GameState in permanentStorage
+struct LinuxPerftState
+{
+    Board       board;
+    MemoryArena arena;
+    bool        isInitialized;
+
+    PerftCache        cache;
+    PerftJob          job;
+    PerftWorker       workers[PERFT_MAX_THREADS];
+    u32               workerCount;
+    bool              workersQuit;
+    pthread_barrier_t jobBegin;
+    pthread_barrier_t jobEnd;
+};
+
+// ----------------------------------------------------------------------------
+// Timer
+chess_internal inline timespec LinuxGetWallClock()
+{
+    timespec result;
+    clock_gettime(CLOCK_MONOTONIC, &result);
+    return result;
+}
+
+chess_internal inline f64 LinuxGetSecondsElapsed(timespec start, timespec end)
+{
+    return (f64)(end.tv_sec - start.tv_sec) + (f64)(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Perft cache
+chess_internal inline bool PerftCacheProbe(PerftCache* cache, u64 key, u32 depth, u64* nodes)
+{
+    PerftCacheEntry* entry = &cache->entries[key & cache->mask];
+
+    u64 check = entry->check.load(std::memory_order_relaxed);
+    u64 data  = entry->data.load(std::memory_order_relaxed);
+
+    bool result = (check ^ data) == key && (data & 0xFF) == depth;
+    if (result)
+    {
+        *nodes = data >> 8;
+    }
+
+    return result;
+}
+
+chess_internal inline void PerftCacheStore(PerftCache* cache, u64 key, u32 depth, u64 nodes)
+{
+    PerftCacheEntry* entry = &cache->entries[key & cache->mask];
+
+    u64 data = (nodes << 8) | depth;
+    entry->check.store(key ^ data, std::memory_order_relaxed);
+    entry->data.store(data, std::memory_order_relaxed);
+}
+// ----------------------------------------------------------------------------
+
+// Walks the position through the same calls the game uses: piece move lists, BoardMoveDo and BoardMoveUndo
+// Subtree counts are memoized by (Zobrist key, depth) when a cache is given
+chess_internal u64 PerftBoard(Board* board, u32 depth, PerftCache* cache = 0)
+{
+    u64 nodes = 0;
+
+    if (depth == 1)
+    {
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            u32 moveCount;
+            BoardGetPieceMoveList(board, cellIndex, &moveCount);
+            nodes += moveCount;
+        }
+    }
+    else
+    {
+        u64 key = board->position->hash();
+        if (cache && PerftCacheProbe(cache, key, depth, &nodes))
+        {
+            return nodes;
+        }
+
+        for (u32 cellIndex = 0; cellIndex < 64; cellIndex++)
+        {
+            // Move lists are views into the current position, copy them before the position changes
+            u32   moveCount;
+            Move  movelist[PIECE_MOVE_LIST_MAX];
+            Move* piecelist = BoardGetPieceMoveList(board, cellIndex, &moveCount);
+            memcpy(movelist, piecelist, sizeof(Move) * moveCount);
+
+            for (u32 moveIndex = 0; moveIndex < moveCount; moveIndex++)
+            {
+                BoardMoveDo(board, &movelist[moveIndex]);
+                nodes += PerftBoard(board, depth - 1, cache);
+                BoardMoveUndo(board);
+            }
+        }
+
+        if (cache)
+        {
+            PerftCacheStore(cache, key, depth, nodes);
+        }
+    }
+
+    return nodes;
+}
+
+chess_internal u64 PerftRaw(chess::Board& _board, u32 depth)
+{
+    chess::Movelist _movelist;
+    chess::movegen::legalmoves(_movelist, _board);
+
+    if (depth == 1)
+    {
+        return (u64)_movelist.size();
+    }
+
+    u64 nodes = 0;
+    for (const auto& _move : _movelist)
+    {
+        _board.makeMove(_move);
+        nodes += PerftRaw(_board, depth - 1);
+        _board.unmakeMove(_move);
+    }
+
+    return nodes;
+}
+
+// ----------------------------------------------------------------------------
+// Parallel perft
+chess_internal inline bool PerftQueueClaim(PerftQueue* queue, u32* taskIndex)
+{
+    // Claims never block: the counter only moves forward and overshooting the end simply fails
+    bool result = false;
+    if (queue->next.load(std::memory_order_relaxed) < queue->end)
+    {
+        u32 index = queue->next.fetch_add(1, std::memory_order_relaxed);
+        if (index < queue->end)
+        {
+            *taskIndex = index;
+            result     = true;
+        }
+    }
+
+    return result;
+}
+
+chess_internal void PerftWorkerRunJob(LinuxPerftState* state, PerftWorker* worker)
+{
+    PerftJob* job   = &state->job;
+    Board*    board = &worker->board;
+
+    if (!worker->boardInitialized)
+    {
+        BoardInit(board, job->fen, &worker->arena, BOARD_HISTORY_SEARCH_PLIES);
+        worker->boardInitialized = true;
+    }
+    else
+    {
+        BoardReset(board, job->fen);
+    }
+
+    u64 nodes = 0;
+    for (u32 queueOffset = 0; queueOffset < job->workerCount; queueOffset++)
+    {
+        PerftQueue* queue = &job->queues[(worker->workerIndex + queueOffset) % job->workerCount];
+
+        u32 taskIndex;
+        while (PerftQueueClaim(queue, &taskIndex))
+        {
+            PerftTask* task = &job->tasks[taskIndex];
+
+            // Task moves are replayed from the root, the move table of each ply provides the Move to play
+            for (u32 ply = 0; ply < task->moveCount; ply++)
+            {
+                PositionInfo* info = &board->info;
+                for (u32 moveIndex = 0; moveIndex < info->moveCount; moveIndex++)
+                {
+                    if (info->moves[moveIndex].data == task->moves[ply])
+                    {
+                        Move move = info->moves[moveIndex];
+                        BoardMoveDo(board, &move);
+                        break;
+                    }
+                }
+            }
+
+            nodes += PerftBoard(board, job->depth - task->moveCount, &state->cache);
+
+            for (u32 ply = 0; ply < task->moveCount; ply++)
+            {
+                BoardMoveUndo(board);
+            }
+        }
+    }
+
+    job->nodes.fetch_add(nodes, std::memory_order_relaxed);
+}
+
+chess_internal void* PerftWorkerProc(void* parameter)
+{
+    PerftWorker*     worker = (PerftWorker*)parameter;
+    LinuxPerftState* state  = worker->state;
+
+    for (;;)
+    {
+        pthread_barrier_wait(&state->jobBegin);
+        if (state->workersQuit)
+        {
+            break;
+        }
+
+        PerftWorkerRunJob(state, worker);
+        pthread_barrier_wait(&state->jobEnd);
+    }
+
+    return 0;
+}
+
+// Root positions with fewer plies than PERFT_SPLIT_PLIES + 1 are not worth splitting, tasks then stop earlier
+chess_internal void PerftCollectTasks(Board* board, PerftJob* job, u32 ply, u32 splitPlies, u16* moves)
+{
+    if (ply == splitPlies)
+    {
+        CHESS_ASSERT(job->taskCount < PERFT_MAX_TASKS);
+        PerftTask* task = &job->tasks[job->taskCount++];
+        memcpy(task->moves, moves, sizeof(u16) * splitPlies);
+        task->moveCount = splitPlies;
+        return;
+    }
+
+    u32  moveCount = board->info.moveCount;
+    Move movelist[MOVE_LIST_MAX];
+    memcpy(movelist, board->info.moves, sizeof(Move) * moveCount);
+
+    for (u32 moveIndex = 0; moveIndex < moveCount; moveIndex++)
+    {
+        moves[ply] = movelist[moveIndex].data;
+        BoardMoveDo(board, &movelist[moveIndex]);
+        PerftCollectTasks(board, job, ply + 1, splitPlies, moves);
+        BoardMoveUndo(board);
+    }
+}
+
+// Splits the first plies into tasks and lets the worker pool count the subtrees through the shared cache
+chess_internal u64 PerftParallel(LinuxPerftState* state, const PerftPosition* position, u32 workerCount)
+{
+    CHESS_ASSERT(workerCount > 0 && workerCount <= state->workerCount);
+
+    Board*    board = &state->board;
+    PerftJob* job   = &state->job;
+
+    if (!state->isInitialized)
+    {
+        BoardInit(board, position->fen, &state->arena, BOARD_HISTORY_SEARCH_PLIES);
+        state->isInitialized = true;
+    }
+    else
+    {
+        BoardReset(board, position->fen);
+    }
+
+    if (position->depth <= 1)
+    {
+        return PerftBoard(board, position->depth);
+    }
+
+    u16 moves[PERFT_SPLIT_PLIES];
+    u32 splitPlies = Min(position->depth - 1, PERFT_SPLIT_PLIES);
+    job->fen       = position->fen;
+    job->depth     = position->depth;
+    job->taskCount = 0;
+    job->nodes     = 0;
+    PerftCollectTasks(board, job, 0, splitPlies, moves);
+
+    // Contiguous slices keep sibling subtrees on one worker, where they share most cache entries
+    job->workerCount = workerCount;
+    for (u32 workerIndex = 0; workerIndex < state->workerCount; workerIndex++)
+    {
+        PerftQueue* queue = &job->queues[workerIndex];
+        u32         begin = (u32)((u64)job->taskCount * workerIndex / workerCount);
+        u32         end   = (u32)((u64)job->taskCount * (workerIndex + 1) / workerCount);
+        if (workerIndex >= workerCount)
+        {
+            begin = end = 0;
+        }
+
+        queue->next = begin;
+        queue->end  = end;
+    }
+
+    pthread_barrier_wait(&state->jobBegin);
+    pthread_barrier_wait(&state->jobEnd);
+
+    return job->nodes;
+}
+
+chess_internal void PerftWorkersStart(LinuxPerftState* state, u32 workerCount)
+{
+    state->workerCount = workerCount;
+    state->job.tasks   = ARENA_PUSH_ARRAY(&state->arena, PerftTask, PERFT_MAX_TASKS);
+    pthread_barrier_init(&state->jobBegin, 0, workerCount + 1);
+    pthread_barrier_init(&state->jobEnd, 0, workerCount + 1);
+
+    // Each worker keeps its own board, sized like the main one
+    u64 boardArenaSize = BoardArenaSize(BOARD_HISTORY_SEARCH_PLIES);
+    for (u32 workerIndex = 0; workerIndex < workerCount; workerIndex++)
+    {
+        PerftWorker* worker = &state->workers[workerIndex];
+        worker->state       = state;
+        worker->workerIndex = workerIndex;
+        ArenaInit(&worker->arena, ArenaPushSize(&state->arena, boardArenaSize), boardArenaSize);
+        pthread_create(&worker->thread, 0, PerftWorkerProc, worker);
+    }
+}
+
+chess_internal void PerftWorkersStop(LinuxPerftState* state)
+{
+    state->workersQuit = true;
+    pthread_barrier_wait(&state->jobBegin);
+
+    for (u32 workerIndex = 0; workerIndex < state->workerCount; workerIndex++)
+    {
+        pthread_join(state->workers[workerIndex].thread, 0);
+    }
+
+    pthread_barrier_destroy(&state->jobBegin);
+    pthread_barrier_destroy(&state->jobEnd);
+}
+
+// Subtrees counted for one thread count must not be reused by the next one
+chess_internal void PerftCacheClear(PerftCache* cache)
+{
+    memset((void*)cache->entries, 0, sizeof(PerftCacheEntry) * (cache->mask + 1));
+}
+
+// Returns false when the hashed parallel count disagrees with the expected node count
+chess_internal bool PerftRunParallel(LinuxPerftState* state, const PerftPosition* position, u32 workerCount,
+                                     f64* seconds)
+{
+    timespec start = LinuxGetWallClock();
+    u64      nodes = PerftParallel(state, position, workerCount);
+    *seconds       = LinuxGetSecondsElapsed(start, LinuxGetWallClock());
+
+    // Positions without a known count are checked against the unhashed single threaded walk
+    u64 expected = position->nodes;
+    if (expected == 0)
+    {
+        expected = PerftBoard(&state->board, position->depth);
+    }
+
+    bool valid = nodes == expected;
+
+    printf("%-10s depth %u  nodes %12llu  threads %2u  %8.3f s  %7.2f Mnps  %s\n", position->name, position->depth,
+           (unsigned long long)nodes, workerCount, *seconds, (f64)nodes / *seconds / 1000000.0, valid ? "ok" : "FAILED");
+
+    if (!valid)
+    {
+        printf("           expected %llu\n", (unsigned long long)expected);
+    }
+
+    return valid;
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// EPD perft suites, one position per line: <fen> ;D1 <nodes> ;D2 <nodes> ...
+// Lines with a position BoardReset would refuse are reported and skipped
+chess_internal u32 PerftLoadEpd(MemoryArena* arena, const char* filename, PerftPosition* positions, u32 maxDepth)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "[LINUX] unable to open file '%s'\n", filename);
+        return 0;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* content = ARENA_PUSH_ARRAY(arena, char, size + 1);
+    fread(content, 1, size, file);
+    content[size] = '\0';
+    fclose(file);
+
+    chess::Board _board;
+    u32          positionCount = 0;
+    u32          lineNumber    = 0;
+    char*        line          = content;
+    while (*line && positionCount < PERFT_EPD_MAX_LINES)
+    {
+        lineNumber++;
+        char* lineEnd = strchr(line, '\n');
+        char* next    = lineEnd ? lineEnd + 1 : line + strlen(line);
+        if (lineEnd)
+        {
+            *lineEnd = '\0';
+        }
+
+        char* fields = strchr(line, ';');
+        if (fields)
+        {
+            *fields = '\0';
+
+            PerftPosition* position = &positions[positionCount];
+            position->name          = "epd";
+            position->fen           = line;
+            position->depth         = 0;
+            position->nodes         = 0;
+
+            // Deepest listed depth, limited by maxDepth when given
+            for (char* field = fields + 1; field; field = strchr(field, ';'))
+            {
+                field += (*field == ';');
+                u32                depth;
+                unsigned long long nodes;
+                if (sscanf(field, " D%u %llu", &depth, &nodes) == 2 && depth > position->depth &&
+                    (maxDepth == 0 || depth <= maxDepth))
+                {
+                    position->depth = depth;
+                    position->nodes = (u64)nodes;
+                }
+            }
+
+            if (position->depth > 0 && !BoardPositionSetFen(&_board, line))
+            {
+                fprintf(stderr, "[LINUX] invalid position on line %u of '%s': %s\n", lineNumber, filename, line);
+            }
+            else if (position->depth > 0)
+            {
+                positionCount++;
+            }
+        }
+
+        line = next;
+    }
+
+    return positionCount;
+}
+// ----------------------------------------------------------------------------
+
+// Returns false when any of the walkers disagrees with the expected node count
+chess_internal bool PerftRun(LinuxPerftState* state, const PerftPosition* position)
+{
+    Board* board = &state->board;
+
+    if (!state->isInitialized)
+    {
+        BoardInit(board, position->fen, &state->arena, BOARD_HISTORY_SEARCH_PLIES);
+        state->isInitialized = true;
+    }
+    else
+    {
+        BoardReset(board, position->fen);
+    }
+
+    timespec boardStart   = LinuxGetWallClock();
+    u64      boardNodes   = PerftBoard(board, position->depth);
+    f64      boardSeconds = LinuxGetSecondsElapsed(boardStart, LinuxGetWallClock());
+
+    chess::Board _board(position->fen);
+
+    timespec rawStart   = LinuxGetWallClock();
+    u64      rawNodes   = PerftRaw(_board, position->depth);
+    f64      rawSeconds = LinuxGetSecondsElapsed(rawStart, LinuxGetWallClock());
+
+    bool valid = position->nodes == 0 || (boardNodes == position->nodes && rawNodes == position->nodes);
+
+    printf("%-10s depth %u  nodes %10llu  board %7.2f Mnps  raw %7.2f Mnps  overhead %5.2fx  %s\n", position->name,
+           position->depth, (unsigned long long)boardNodes, (f64)boardNodes / boardSeconds / 1000000.0,
+           (f64)rawNodes / rawSeconds / 1000000.0, boardSeconds / rawSeconds, valid ? "ok" : "FAILED");
+
+    if (!valid)
+    {
+        printf("           expected %llu, board %llu, raw %llu\n", (unsigned long long)position->nodes,
+               (unsigned long long)boardNodes, (unsigned long long)rawNodes);
+    }
+
+    return valid;
+}
+
+// Usage: perft [options]                  runs the standard suite
+//        perft [options] "<fen>" <depth>  runs a single position
+// Options: -t <threads>  hashed parallel perft
+//          -s            with -t, report scaling from 1 to <threads> workers
+//          -m <MB>       perft cache size, rounded down to a power of two
+//          -e <file>     EPD suite instead of the standard one
+//          -d <depth>    maximum depth for EPD positions
+int main(int argc, char** argv)
+{
+    u32         threadCount = 0;
+    u32         cacheMB     = PERFT_CACHE_MB;
+    u32         maxDepth    = 0;
+    bool        scaling     = false;
+    const char* epdFilename = 0;
+
+    int argIndex = 1;
+    for (; argIndex < argc && argv[argIndex][0] == '-' && argv[argIndex][1] != '\0'; argIndex++)
+    {
+        char option = argv[argIndex][1];
+        if (option == 's')
+        {
+            scaling = true;
+        }
+        else if (argIndex + 1 < argc && (option == 't' || option == 'm' || option == 'd' || option == 'e'))
+        {
+            const char* value = argv[++argIndex];
+            switch (option)
+            {
+            case 't':
+            {
+                threadCount = (u32)atoi(value);
+                break;
+            }
+            case 'm':
+            {
+                cacheMB = (u32)atoi(value);
+                break;
+            }
+            case 'd':
+            {
+                maxDepth = (u32)atoi(value);
+                break;
+            }
+            case 'e':
+            {
+                epdFilename = value;
+                break;
+            }
+            }
+        }
+        else
+        {
+            argIndex = argc + 1;
+        }
+    }
+
+    int positionalCount = argc - argIndex;
+    if (positionalCount != 0 && positionalCount != 2)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-s] [-m cacheMB] [-e file.epd] [-d depth] [\"<fen>\" <depth>]\n",
+                argv[0]);
+        return 1;
+    }
+
+    threadCount = Min(threadCount, (u32)PERFT_MAX_THREADS);
+    if (threadCount > 0 && cacheMB == 0)
+    {
+        cacheMB = 1;
+    }
+
+    // Board, worker histories and the perft cache are carved from one zeroed mapping,
+    // as the game does from permanentStorage. Pages are only committed once touched.
+    u64   cacheSize   = threadCount > 0 ? MEGABYTES(cacheMB) : 0;
+    u64   storageSize = MEGABYTES(64) + BoardArenaSize(BOARD_HISTORY_SEARCH_PLIES) * threadCount + cacheSize;
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxPerftState* state = (LinuxPerftState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxPerftState), storageSize - sizeof(LinuxPerftState));
+
+    PerftPosition* positions     = perftSuite;
+    u32            positionCount = ARRAY_COUNT(perftSuite);
+    PerftPosition  position;
+
+    if (positionalCount == 2)
+    {
+        position = { "custom", argv[argIndex], (u32)atoi(argv[argIndex + 1]), 0 };
+        if (position.depth == 0)
+        {
+            fprintf(stderr, "[LINUX] depth must be at least 1\n");
+            return 1;
+        }
+
+        chess::Board _board;
+        if (!BoardPositionSetFen(&_board, position.fen))
+        {
+            fprintf(stderr, "[LINUX] invalid position: %s\n", position.fen);
+            return 1;
+        }
+
+        positions     = &position;
+        positionCount = 1;
+    }
+    else if (epdFilename)
+    {
+        positions     = ARENA_PUSH_ARRAY(&state->arena, PerftPosition, PERFT_EPD_MAX_LINES);
+        positionCount = PerftLoadEpd(&state->arena, epdFilename, positions, maxDepth);
+        if (positionCount == 0)
+        {
+            fprintf(stderr, "[LINUX] no positions in '%s'\n", epdFilename);
+            return 1;
+        }
+    }
+
+    bool valid = true;
+
+    if (threadCount == 0)
+    {
+        for (u32 positionIndex = 0; positionIndex < positionCount; positionIndex++)
+        {
+            valid &= PerftRun(state, &positions[positionIndex]);
+        }
+    }
+    else
+    {
+        // Largest power of two entry count that fits in the requested size
+        u64 entryCount = 1;
+        while (entryCount * 2 * sizeof(PerftCacheEntry) <= cacheSize)
+        {
+            entryCount *= 2;
+        }
+
+        state->cache.entries = (PerftCacheEntry*)ArenaPushSize(&state->arena, entryCount * sizeof(PerftCacheEntry), 64);
+        state->cache.mask    = entryCount - 1;
+        PerftWorkersStart(state, threadCount);
+
+        printf("%u online cores, %llu MB perft cache\n", (u32)sysconf(_SC_NPROCESSORS_ONLN),
+               (unsigned long long)(entryCount * sizeof(PerftCacheEntry) / MEGABYTES(1)));
+
+        u32 firstCount = scaling ? 1 : threadCount;
+        f64 baseline   = 0.0;
+        for (u32 workerCount = firstCount; workerCount <= threadCount; workerCount++)
+        {
+            PerftCacheClear(&state->cache);
+
+            f64 total = 0.0;
+            for (u32 positionIndex = 0; positionIndex < positionCount; positionIndex++)
+            {
+                f64 seconds;
+                valid &= PerftRunParallel(state, &positions[positionIndex], workerCount, &seconds);
+                total += seconds;
+            }
+
+            if (workerCount == firstCount)
+            {
+                baseline = total;
+            }
+
+            if (scaling)
+            {
+                printf("threads %2u  total %8.3f s  speedup %5.2fx\n\n", workerCount, total, baseline / total);
+            }
+        }
+
+        PerftWorkersStop(state);
+    }
+
+    munmap(storage, storageSize);
+
+    return valid ? 0 : 1;
+}
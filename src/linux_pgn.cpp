@@ -0,0 +1,186 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_pgn.h"
+#include "chess_pgn.cpp"
+
+// PGN import benchmark, the same calls the game makes on a mapped file: time until the first page of the game list
+// can be drawn, the whole index built at the per frame budget, then random games loaded into a Board and random
+// plies seeked, every seeked position checked against the key recorded when the game was loaded.
+
+#define PGN_TOOL_LIST_ROWS      12 // Rows of the game list
+#define PGN_TOOL_DEFAULT_GAMES  1000
+#define PGN_TOOL_SEEKS_PER_GAME 16
+
+chess_internal inline f64 LinuxGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+chess_internal inline u64 PgnToolRandom(u64* state)
+{
+    u64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z     = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int main(int argc, char** argv)
+{
+    u32 gameLoads = PGN_TOOL_DEFAULT_GAMES;
+    u64 seed      = 1;
+
+    int argIndex = 1;
+    for (; argIndex + 1 < argc && argv[argIndex][0] == '-'; argIndex += 2)
+    {
+        char* value = argv[argIndex + 1];
+        switch (argv[argIndex][1])
+        {
+        case 'g':
+        {
+            gameLoads = (u32)atoi(value);
+            break;
+        }
+        case 'r':
+        {
+            seed = (u64)atoll(value);
+            break;
+        }
+        default:
+        {
+            argIndex = argc;
+            break;
+        }
+        }
+    }
+
+    if (argIndex >= argc)
+    {
+        fprintf(stderr, "usage: %s [-g games] [-r seed] games.pgn\n", argv[0]);
+        return 1;
+    }
+
+    int         file = open(argv[argIndex], O_RDONLY);
+    struct stat fileStat;
+    if (file < 0 || fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", argv[argIndex]);
+        return 1;
+    }
+    u64   contentSize = (u64)fileStat.st_size;
+    void* content     = mmap(0, contentSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (content == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map '%s'\n", argv[argIndex]);
+        return 1;
+    }
+
+    u64   storageSize = MEGABYTES(64);
+    void* storage     = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    MemoryArena arena;
+    ArenaInit(&arena, (u8*)storage, storageSize);
+
+    Board board;
+    BoardInit(&board, chess::constants::STARTPOS, &arena, BOARD_HISTORY_MAX_PLIES);
+
+    PgnFile pgn;
+    PgnInit(&pgn, &arena);
+
+    // First page, what the game list needs before it can be drawn
+    f64 start = LinuxGetSeconds();
+    PgnOpen(&pgn, content, contentSize);
+    PgnTags tags;
+    u32     listed = 0;
+    for (u32 i = 0; i < PGN_TOOL_LIST_ROWS; i++)
+    {
+        listed += PgnReadTags(&pgn, i, &tags);
+    }
+    f64 firstPageSeconds = LinuxGetSeconds() - start;
+    printf("first page: %u games listed after %.3f ms, %llu of %llu bytes scanned (%s - %s %s)\n", listed,
+           firstPageSeconds * 1000.0, (unsigned long long)pgn.scanOffset, (unsigned long long)contentSize,
+           listed ? tags.white : "", listed ? tags.black : "", listed ? tags.result : "");
+
+    // The rest one frame budget at a time
+    u32 frames       = 0;
+    f64 slowestFrame = 0.0;
+    start            = LinuxGetSeconds();
+    while (!pgn.isIndexed)
+    {
+        f64 frameStart = LinuxGetSeconds();
+        PgnIndexStep(&pgn, PGN_INDEX_FRAME_BUDGET);
+        f64 frameSeconds = LinuxGetSeconds() - frameStart;
+        slowestFrame     = frameSeconds > slowestFrame ? frameSeconds : slowestFrame;
+        frames++;
+    }
+    f64 indexSeconds = LinuxGetSeconds() - start;
+    printf("index: %u games in %.3fs, %.2f GB/s, %u frames of %llu MB, slowest %.2f ms\n", pgn.gameCount,
+           indexSeconds, indexSeconds > 0.0 ? contentSize / indexSeconds / (1024.0 * 1024.0 * 1024.0) : 0.0, frames,
+           (unsigned long long)(PGN_INDEX_FRAME_BUDGET / MEGABYTES(1)), slowestFrame * 1000.0);
+
+    if (pgn.gameCount == 0)
+    {
+        return 1;
+    }
+
+    // Random games into the board, then random plies of each
+    u64 randomState = seed;
+    u64 plies       = 0;
+    u32 emptyGames  = 0;
+    u32 seeks       = 0;
+    u32 wrongSeeks  = 0;
+    f64 loadSeconds = 0.0;
+    f64 seekSeconds = 0.0;
+    for (u32 i = 0; i < gameLoads; i++)
+    {
+        u32 gameIndex = (u32)(PgnToolRandom(&randomState) % pgn.gameCount);
+
+        f64 loadStart = LinuxGetSeconds();
+        u32 gamePlies = PgnLoadGame(&pgn, gameIndex, &board);
+        loadSeconds += LinuxGetSeconds() - loadStart;
+        plies += gamePlies;
+        emptyGames += gamePlies == 0;
+
+        for (u32 j = 0; j < PGN_TOOL_SEEKS_PER_GAME && gamePlies > 0; j++)
+        {
+            u32 ply = (u32)(PgnToolRandom(&randomState) % gamePlies);
+
+            f64 seekStart = LinuxGetSeconds();
+            BoardSeek(&board, ply);
+            seekSeconds += LinuxGetSeconds() - seekStart;
+
+            wrongSeeks += board.position->hash() != board.history.keys[ply];
+            seeks++;
+        }
+    }
+    printf("load: %u games, %llu plies, %u empty, %.1f us per game, %.2f M plies/s\n", gameLoads,
+           (unsigned long long)plies, emptyGames, gameLoads ? loadSeconds / gameLoads * 1000000.0 : 0.0,
+           loadSeconds > 0.0 ? plies / loadSeconds / 1000000.0 : 0.0);
+    printf("seek: %u random plies, %u wrong, %.2f us per seek\n", seeks, wrongSeeks,
+           seeks ? seekSeconds / seeks * 1000000.0 : 0.0);
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("peak RSS %.1f MB for a %.1f MB file\n", usage.ru_maxrss / 1024.0, contentSize / (1024.0 * 1024.0));
+
+    return wrongSeeks ? 1 : 0;
+}
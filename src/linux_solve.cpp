@@ -0,0 +1,399 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+#include "chess_mate_solver.h"
+#include "chess_mate_solver.cpp"
+
+// Batch mate solver: every worker thread owns a MateSolver and takes the next position of the file until none is
+// left. Lines are FEN or EPD, an EPD "dm N" operation is the expected mate length and is checked. With -a every
+// position is also searched by the alpha-beta engine until it reports a mate score, for comparison.
+
+#define SOLVE_DEFAULT_MATE     8
+#define SOLVE_DEFAULT_TABLE_MB 64
+#define SOLVE_DEFAULT_NODES    20000000 // Per position, a position without mate may not be disproven for hours
+#define SOLVE_ENGINE_HASH_MB   64
+#define SOLVE_MAX_POSITIONS    (1 << 16)
+#define SOLVE_MAX_THREADS      256
+
+struct SolvePosition
+{
+    char             fen[FEN_STR_MAX_LENGTH];
+    u32              expectedMate; // 0 when the line has no dm operation
+    MateSolverResult result;
+    u64              usedEntries;
+    EngineResult     search;
+    bool             isFailed; // The solver or the alpha-beta search could not run
+};
+
+struct SolveWorker
+{
+    struct LinuxSolveState* state;
+    pthread_t               thread;
+    MemoryArena             arena;
+    MateSolver*             solver;
+    Board                   board; // Only for the alpha-beta comparison
+    Engine*                 engine;
+};
+
+struct LinuxSolveState
+{
+    MemoryArena    arena;
+    SolvePosition* positions;
+    u32            positionCount;
+    u32            maxMate;
+    u64            maxNodes;
+    bool           useAlphaBeta;
+
+    SolveWorker      workers[SOLVE_MAX_THREADS];
+    u32              workerCount;
+    std::atomic<u32> nextPosition;
+};
+
+chess_internal inline f64 SolveGetSeconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+// FEN lines with or without move counters, EPD operations after the four fields. Returns the count, 0 on error.
+chess_internal u32 SolveLoadPositions(LinuxSolveState* state, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "[LINUX] unable to open '%s'\n", filename);
+        return 0;
+    }
+
+    chess::Board board;
+    char         line[1024];
+    u32          result = 0;
+    while (result < SOLVE_MAX_POSITIONS && fgets(line, sizeof(line), file))
+    {
+        char fields[6][72];
+        s32  fieldCount = sscanf(line, "%71s %71s %71s %71s %71s %71s", fields[0], fields[1], fields[2], fields[3],
+                                fields[4], fields[5]);
+        if (fieldCount < 4)
+        {
+            continue;
+        }
+
+        SolvePosition* position = &state->positions[result];
+        bool hasCounters = fieldCount == 6 && fields[4][0] >= '0' && fields[4][0] <= '9' && fields[5][0] >= '0' &&
+                           fields[5][0] <= '9';
+        s32 length = snprintf(position->fen, FEN_STR_MAX_LENGTH, "%s %s %s %s %s %s", fields[0], fields[1], fields[2],
+                              fields[3], hasCounters ? fields[4] : "0", hasCounters ? fields[5] : "1");
+        if (length < 0 || length >= FEN_STR_MAX_LENGTH || !BoardPositionSetFen(&board, position->fen))
+        {
+            fprintf(stderr, "[LINUX] invalid position: %s", line);
+            continue;
+        }
+
+        const char* mate       = strstr(line, "dm ");
+        position->expectedMate = mate ? (u32)atoi(mate + 3) : 0;
+        result++;
+    }
+    fclose(file);
+
+    return result;
+}
+
+// The engine stops by itself on a mate score, the node budget stops it otherwise.
+// False when the search could not start or left no result.
+chess_internal bool SolveAlphaBeta(LinuxSolveState* state, SolveWorker* worker, SolvePosition* position)
+{
+    Engine* engine = worker->engine;
+
+    BoardReset(&worker->board, position->fen);
+    EngineClearHash(engine);
+
+    EngineLimits limits = { 0, state->maxNodes, 0.0 };
+    limits.depth        = 2 * state->maxMate - 1;
+    if (!EngineStart(engine, &worker->board, limits, 1))
+    {
+        return false;
+    }
+    EngineSearch(&engine->threads[0]);
+
+    return EnginePollResult(engine, &position->search);
+}
+
+// The proven line has to end in checkmate after exactly 2 * mateIn - 1 plies
+chess_internal bool SolveIsLineMate(SolvePosition* position)
+{
+    MateSolverResult* result = &position->result;
+    if (result->type != MATE_SOLVER_RESULT_MATE || result->lineLength != 2 * result->mateIn - 1)
+    {
+        return false;
+    }
+
+    chess::Board board(position->fen);
+    for (u32 i = 0; i < result->lineLength; i++)
+    {
+        board.makeMove(chess::Move(result->line[i]));
+    }
+
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+
+    return moves.empty() && board.inCheck();
+}
+
+// Every position starts from an empty table, the numbers do not depend on the order of the batch
+chess_internal void* SolveThreadProc(void* parameter)
+{
+    SolveWorker*     worker = (SolveWorker*)parameter;
+    LinuxSolveState* state  = worker->state;
+
+    for (;;)
+    {
+        u32 index = state->nextPosition.fetch_add(1, std::memory_order_relaxed);
+        if (index >= state->positionCount)
+        {
+            break;
+        }
+
+        SolvePosition* position = &state->positions[index];
+        chess::Board   board(position->fen);
+
+        MateSolverClear(worker->solver);
+        bool isStarted = MateSolverStart(worker->solver, board, state->maxMate, state->maxNodes);
+        if (isStarted)
+        {
+            MateSolverRun(worker->solver);
+        }
+        if (!isStarted || !MateSolverPollResult(worker->solver, &position->result))
+        {
+            position->result.type = MATE_SOLVER_RESULT_UNKNOWN;
+            position->isFailed    = true;
+            continue;
+        }
+        position->usedEntries = worker->solver->usedEntries;
+
+        if (state->useAlphaBeta && !SolveAlphaBeta(state, worker, position))
+        {
+            position->search   = {};
+            position->isFailed = true;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    u32  workerCount  = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    u32  maxMate      = SOLVE_DEFAULT_MATE;
+    u64  maxNodes     = SOLVE_DEFAULT_NODES;
+    u32  tableMB      = SOLVE_DEFAULT_TABLE_MB;
+    bool useAlphaBeta = false;
+    bool verbose      = false;
+
+    int argIndex = 1;
+    for (; argIndex < argc && argv[argIndex][0] == '-' && argv[argIndex][1] != '\0'; argIndex++)
+    {
+        char option = argv[argIndex][1];
+        if (option == 'a')
+        {
+            useAlphaBeta = true;
+        }
+        else if (option == 'v')
+        {
+            verbose = true;
+        }
+        else if (argIndex + 1 < argc && (option == 't' || option == 'm' || option == 'n' || option == 's'))
+        {
+            u64 value = (u64)atoll(argv[++argIndex]);
+            switch (option)
+            {
+            case 't':
+            {
+                workerCount = (u32)value;
+                break;
+            }
+            case 'm':
+            {
+                maxMate = (u32)value;
+                break;
+            }
+            case 'n':
+            {
+                maxNodes = value;
+                break;
+            }
+            case 's':
+            {
+                tableMB = (u32)value;
+                break;
+            }
+            }
+        }
+        else
+        {
+            argIndex = argc + 1;
+        }
+    }
+
+    if (argIndex + 1 != argc || workerCount == 0 || workerCount > SOLVE_MAX_THREADS || maxMate == 0 ||
+        maxMate > MATE_SOLVER_MAX_MATE || tableMB == 0)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-m maxMate] [-n maxNodes] [-s tableMB] [-a] [-v] positions.epd\n",
+                argv[0]);
+        return 1;
+    }
+
+    u64 engineSize =
+        useAlphaBeta ? MEGABYTES(SOLVE_ENGINE_HASH_MB) + MEGABYTES(1) + BoardArenaSize(BOARD_HISTORY_SEARCH_PLIES) : 0;
+    u64 workerSize = MEGABYTES(tableMB) + KILOBYTES(64) + engineSize;
+    u64 storageSize =
+        sizeof(LinuxSolveState) + (u64)SOLVE_MAX_POSITIONS * sizeof(SolvePosition) + workerCount * workerSize;
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)storageSize);
+        return 1;
+    }
+
+    LinuxSolveState* state = new (storage) LinuxSolveState();
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxSolveState), storageSize - sizeof(LinuxSolveState));
+    state->positions    = ARENA_PUSH_ARRAY(&state->arena, SolvePosition, SOLVE_MAX_POSITIONS);
+    state->maxMate      = maxMate;
+    state->maxNodes     = maxNodes;
+    state->useAlphaBeta = useAlphaBeta;
+    state->workerCount  = workerCount;
+
+    state->positionCount = SolveLoadPositions(state, argv[argIndex]);
+    if (state->positionCount == 0)
+    {
+        fprintf(stderr, "[LINUX] no positions\n");
+        return 1;
+    }
+
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        SolveWorker* worker = &state->workers[i];
+        worker->state       = state;
+        ArenaInit(&worker->arena, ArenaPushSize(&state->arena, workerSize, 64), workerSize);
+        worker->solver = MateSolverCreate(&worker->arena, MEGABYTES(tableMB));
+        if (useAlphaBeta)
+        {
+            BoardInit(&worker->board, DEFAULT_FEN_STRING, &worker->arena, BOARD_HISTORY_SEARCH_PLIES);
+            worker->engine = EngineCreate(&worker->arena, 1, MEGABYTES(SOLVE_ENGINE_HASH_MB));
+        }
+    }
+
+    printf("%u positions, %u threads, mates up to %u moves, %u MB table per thread (%llu entries of %u bytes)\n",
+           state->positionCount, workerCount, maxMate, tableMB,
+           (unsigned long long)(state->workers[0].solver->mask + 1), (u32)sizeof(MateSolverEntry));
+
+    f64 start = SolveGetSeconds();
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        pthread_create(&state->workers[i].thread, 0, SolveThreadProc, &state->workers[i]);
+    }
+    for (u32 i = 0; i < workerCount; i++)
+    {
+        pthread_join(state->workers[i].thread, 0);
+    }
+    f64 wallSeconds = SolveGetSeconds() - start;
+
+    u32 solved      = 0;
+    u32 failed      = 0;
+    u32 verified    = 0;
+    u32 wrong       = 0;
+    u32 shortest    = 0;
+    u64 nodes       = 0;
+    f64 seconds     = 0.0;
+    u32 bothMates   = 0; // Mated by both solvers, the time comparison is over these
+    f64 firstTime   = 0.0;
+    f64 bothTime    = 0.0;
+    u64 maxUsed     = 0;
+    u32 searchMates = 0;
+    u64 searchNodes = 0;
+    f64 searchTime  = 0.0;
+    for (u32 i = 0; i < state->positionCount; i++)
+    {
+        SolvePosition*    position = &state->positions[i];
+        MateSolverResult* result   = &position->result;
+
+        if (position->isFailed)
+        {
+            fprintf(stderr, "[LINUX] position %u: the solver or the search could not run\n", i + 1);
+            failed++;
+        }
+        solved += result->type == MATE_SOLVER_RESULT_MATE;
+        verified += SolveIsLineMate(position);
+        wrong += position->expectedMate && (result->type != MATE_SOLVER_RESULT_MATE ||
+                                            result->mateIn != position->expectedMate);
+        shortest += result->type == MATE_SOLVER_RESULT_MATE && result->isShortest;
+        nodes += result->nodes;
+        seconds += result->seconds;
+        maxUsed = position->usedEntries > maxUsed ? position->usedEntries : maxUsed;
+
+        s32  searchScore  = position->search.score;
+        bool isSearchMate = useAlphaBeta && EngineIsMateScore(searchScore) && searchScore > 0;
+        u32  searchMateIn = (ENGINE_SCORE_MATE - searchScore + 1) / 2;
+        searchMates += isSearchMate;
+        searchNodes += position->search.nodes;
+        searchTime += position->search.seconds;
+        if (isSearchMate && result->type == MATE_SOLVER_RESULT_MATE)
+        {
+            bothMates += 1;
+            firstTime += result->firstSeconds;
+            bothTime += position->search.seconds;
+        }
+
+        if (verbose || (position->expectedMate && result->mateIn != position->expectedMate))
+        {
+            char line[MATE_SOLVER_MAX_PLIES * 6] = "";
+            u32  length                          = 0;
+            for (u32 j = 0; j < result->lineLength; j++)
+            {
+                length += sprintf(line + length, " %s", chess::uci::moveToUci(chess::Move(result->line[j])).c_str());
+            }
+
+            const char* outcome = result->type == MATE_SOLVER_RESULT_MATE      ? "mate"
+                                  : result->type == MATE_SOLVER_RESULT_NO_MATE ? "no mate"
+                                                                               : "unknown";
+            printf("%4u  %-7s %2u%c  first %9llu nodes %7.3fs  total %9llu nodes %7.3fs", i + 1, outcome,
+                   result->mateIn, result->isShortest ? ' ' : '?', (unsigned long long)result->firstNodes,
+                   result->firstSeconds, (unsigned long long)result->nodes, result->seconds);
+            if (useAlphaBeta)
+            {
+                printf("  alpha-beta %s %2u depth %2u %10llu nodes %7.3fs", isSearchMate ? "mate" : "----",
+                       isSearchMate ? searchMateIn : 0, position->search.depth,
+                       (unsigned long long)position->search.nodes, position->search.seconds);
+            }
+            printf("  %s\n", line);
+        }
+    }
+
+    printf("solved %u/%u, %u proven shortest, %u lines verified, %u wrong, %.2fs wall\n", solved,
+           state->positionCount, shortest, verified, wrong, wallSeconds);
+    printf("%llu nodes, %.2fs, %.2f Mnps per thread, table used %.1f MB at most\n", (unsigned long long)nodes,
+           seconds, seconds > 0.0 ? nodes / seconds / 1000000.0 : 0.0,
+           maxUsed * sizeof(MateSolverEntry) / (1024.0 * 1024.0));
+    if (useAlphaBeta)
+    {
+        printf("alpha-beta found %u/%u mates, %llu nodes, %.2fs\n", searchMates, state->positionCount,
+               (unsigned long long)searchNodes, searchTime);
+        printf("on the %u mates found by both: first proof after %.3fs, alpha-beta mate after %.3fs, %.1fx\n",
+               bothMates, firstTime, bothTime, firstTime > 0.0 ? bothTime / firstTime : 0.0);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,619 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess_types.h"
+#include "chess_math.h"
+#include "chess_game_logic.h"
+#include "chess_game_logic.cpp"
+#include "chess_nnue.cpp"
+#include "chess_bitbase.cpp"
+#include "chess_engine.h"
+#include "chess_engine.cpp"
+
+// Headless UCI front-end over the game Board layer and engine. The main thread only reads stdin, so isready and
+// stop are answered while the search runs on one pthread per EngineThread. A reporter thread polls the engine,
+// prints an info line per finished iteration and the best move once the result is in the mailbox.
+// Positions are updated incrementally: moves already on the board are kept, only the new ones are played.
+
+#define UCI_DEFAULT_HASH_MB  64
+#define UCI_MAX_HASH_MB      1024
+#define UCI_MOVE_OVERHEAD    0.05 // Seconds kept back for the GUI and the pipe
+#define UCI_MOVES_TO_GO      30   // Assumed moves left in sudden death
+#define UCI_POLL_NANOSECONDS 1000000
+#define UCI_FEN_MAX_LENGTH   128
+
+struct LinuxUciState
+{
+    Board       board;
+    MemoryArena arena;
+    char        rootFen[UCI_FEN_MAX_LENGTH]; // FEN the board history starts from
+
+    // Carved from its own mapping, cleared and rebuilt when Hash or Threads change
+    MemoryArena engineArena;
+    Engine*     engine;
+    u32         hashMB;
+    u32         threadCount;
+    MemoryArena networkArena; // Rewound before every load, only the last network is kept
+    NnueNetwork network;
+    bool        hasNetwork;
+    Bitbases    bitbases;
+
+    pthread_t       searchThreads[ENGINE_MAX_THREADS];
+    pthread_t       reporter;
+    bool            isSearching; // Reporter not joined yet
+    pthread_mutex_t outputLock;
+};
+
+// ----------------------------------------------------------------------------
+// Output
+// Info and bestmove lines come from the reporter thread, everything else from the main thread
+chess_internal void UciPrint(LinuxUciState* state, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    pthread_mutex_lock(&state->outputLock);
+    vprintf(format, args);
+    fflush(stdout);
+    pthread_mutex_unlock(&state->outputLock);
+    va_end(args);
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Engine
+chess_internal void UciEngineCreate(LinuxUciState* state)
+{
+    // Fresh zero pages for the hash table, the previous engine may have used a bigger one
+    madvise(state->engineArena.base, state->engineArena.size, MADV_DONTNEED);
+    state->engineArena.used = 0;
+
+    state->engine           = EngineCreate(&state->engineArena, state->threadCount, MEGABYTES(state->hashMB));
+    state->engine->network  = state->hasNetwork ? &state->network : 0;
+    state->engine->bitbases = &state->bitbases;
+}
+
+chess_internal bool UciLoadNetwork(LinuxUciState* state, const char* filename)
+{
+    state->networkArena.used = 0;
+
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    u64 size = (u64)ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    void* content = malloc(size);
+    bool  result  = content && fread(content, 1, size, file) == size &&
+                  NnueLoad(&state->network, &state->networkArena, content, size);
+    free(content);
+    fclose(file);
+
+    return result;
+}
+
+// Same cache file as the game, generated in memory when it is missing
+chess_internal void UciLoadBitbases(LinuxUciState* state)
+{
+    BitbaseInit(&state->bitbases, &state->arena);
+
+    FILE* file = fopen(BITBASE_CACHE_FILE, "rb");
+    if (file)
+    {
+        BitbaseTables* tables = (BitbaseTables*)malloc(sizeof(BitbaseTables));
+        if (tables && fread(tables, 1, sizeof(BitbaseTables), file) == sizeof(BitbaseTables))
+        {
+            BitbaseLoad(&state->bitbases, tables, sizeof(BitbaseTables));
+        }
+        free(tables);
+        fclose(file);
+    }
+
+    if (!state->bitbases.isReady)
+    {
+        BitbaseGenerator* generator = BitbaseGeneratorCreate(&state->bitbases, &state->arena, 1);
+        BitbaseGenerate(generator, 0, 0);
+    }
+}
+
+chess_internal void* UciSearchThreadProc(void* parameter)
+{
+    EngineSearch((EngineThread*)parameter);
+    return 0;
+}
+
+chess_internal void UciPrintInfo(LinuxUciState* state, const EngineInfo* info)
+{
+    Engine* engine = state->engine;
+
+    char score[32];
+    if (EngineIsMateScore(info->score))
+    {
+        s32 plies = ENGINE_SCORE_MATE - (info->score > 0 ? info->score : -info->score);
+        sprintf(score, "mate %d", info->score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+    }
+    else
+    {
+        sprintf(score, "cp %d", info->score);
+    }
+
+    char pv[ENGINE_MAX_PLY * (UCI_STR_MAX_LENGTH + 1)];
+    u32  length = 0;
+    for (u32 i = 0; i < info->pvLength; i++)
+    {
+        std::string uci = chess::uci::moveToUci(chess::Move(info->pv[i]));
+        length += sprintf(pv + length, " %s", uci.c_str());
+    }
+    pv[length] = '\0';
+
+    u64 nodes   = EngineGetNodes(engine);
+    f64 seconds = info->seconds > 0.001 ? info->seconds : 0.001;
+    UciPrint(state, "info depth %u score %s nodes %llu nps %llu time %u pv%s\n", info->depth, score,
+             (unsigned long long)nodes, (unsigned long long)(nodes / seconds), (u32)(info->seconds * 1000.0), pv);
+}
+
+// One info line per finished iteration, then the best move once every search thread is done
+chess_internal void* UciReporterProc(void* parameter)
+{
+    LinuxUciState* state  = (LinuxUciState*)parameter;
+    Engine*        engine = state->engine;
+
+    u32          printedDepth = 0;
+    EngineInfo   info;
+    EngineResult result;
+    for (;;)
+    {
+        bool isReady = EnginePollResult(engine, &result);
+        if (EngineGetInfo(engine, &info) && info.depth != printedDepth)
+        {
+            UciPrintInfo(state, &info);
+            printedDepth = info.depth;
+        }
+        if (isReady)
+        {
+            break;
+        }
+
+        timespec interval = { 0, UCI_POLL_NANOSECONDS };
+        nanosleep(&interval, 0);
+    }
+
+    for (u32 i = 0; i < engine->activeThreadCount; i++)
+    {
+        pthread_join(state->searchThreads[i], 0);
+    }
+
+    std::string bestMove = result.move ? chess::uci::moveToUci(chess::Move(result.move)) : "0000";
+    UciPrint(state, "bestmove %s\n", bestMove.c_str());
+
+    return 0;
+}
+
+// Waits for the best move of the running search, if any
+chess_internal void UciStopSearch(LinuxUciState* state)
+{
+    if (state->isSearching)
+    {
+        EngineStop(state->engine);
+        pthread_join(state->reporter, 0);
+        state->isSearching = false;
+    }
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Commands
+chess_internal inline bool UciIsToken(const char* token, const char* name)
+{
+    return token && strcmp(token, name) == 0;
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+// Keeps the common prefix of the board history and the new move list, undoes what differs and plays the rest
+chess_internal void UciPosition(LinuxUciState* state, char** context)
+{
+    Board* board = &state->board;
+
+    char  fen[UCI_FEN_MAX_LENGTH];
+    char* token = strtok_r(0, " \t", context);
+    if (UciIsToken(token, "startpos"))
+    {
+        strcpy(fen, DEFAULT_FEN_STRING);
+        token = strtok_r(0, " \t", context);
+    }
+    else if (UciIsToken(token, "fen"))
+    {
+        u32 length = 0;
+        for (token = strtok_r(0, " \t", context); token && !UciIsToken(token, "moves");
+             token = strtok_r(0, " \t", context))
+        {
+            u32 tokenLength = (u32)strlen(token);
+            if (length + tokenLength + 2 > UCI_FEN_MAX_LENGTH)
+            {
+                break;
+            }
+            length += sprintf(fen + length, length ? " %s" : "%s", token);
+        }
+        fen[length] = '\0';
+    }
+    else
+    {
+        UciPrint(state, "info string expected startpos or fen\n");
+        return;
+    }
+
+    if (strcmp(fen, state->rootFen) != 0)
+    {
+        // A refused FEN leaves the board at the initial position, the command is dropped with its moves
+        if (!BoardReset(board, fen))
+        {
+            strcpy(state->rootFen, DEFAULT_FEN_STRING);
+            UciPrint(state, "info string invalid fen '%s'\n", fen);
+            return;
+        }
+        strcpy(state->rootFen, fen);
+    }
+
+    u32 ply = 0;
+    if (UciIsToken(token, "moves"))
+    {
+        for (token = strtok_r(0, " \t", context); token; token = strtok_r(0, " \t", context), ply++)
+        {
+            if (ply < board->history.count)
+            {
+                std::string played = chess::uci::moveToUci(chess::Move(board->history.entries[ply].move));
+                if (played == token)
+                {
+                    continue;
+                }
+                while (board->history.count > ply)
+                {
+                    BoardMoveUndo(board);
+                }
+            }
+
+            u16 data = chess::uci::uciToMove(*board->position, token).move();
+
+            Move* move = 0;
+            for (u32 i = 0; i < board->info.moveCount && !move; i++)
+            {
+                move = board->info.moves[i].data == data ? &board->info.moves[i] : 0;
+            }
+            if (!move)
+            {
+                UciPrint(state, "info string illegal move '%s'\n", token);
+                break;
+            }
+            BoardMoveDo(board, move);
+        }
+    }
+
+    while (board->history.count > ply)
+    {
+        BoardMoveUndo(board);
+    }
+}
+
+// Board layer walk like the perft tool, bulk counted at depth 1
+chess_internal u64 UciPerftCount(Board* board, u32 depth)
+{
+    if (depth == 1)
+    {
+        return board->info.moveCount;
+    }
+
+    Move moves[MOVE_LIST_MAX];
+    u32  moveCount = board->info.moveCount;
+    memcpy(moves, board->info.moves, sizeof(Move) * moveCount);
+
+    u64 nodes = 0;
+    for (u32 i = 0; i < moveCount; i++)
+    {
+        BoardMoveDo(board, &moves[i]);
+        nodes += UciPerftCount(board, depth - 1);
+        BoardMoveUndo(board);
+    }
+
+    return nodes;
+}
+
+chess_internal void UciPerft(LinuxUciState* state, u32 depth)
+{
+    Board* board = &state->board;
+
+    Move moves[MOVE_LIST_MAX];
+    u32  moveCount = board->info.moveCount;
+    memcpy(moves, board->info.moves, sizeof(Move) * moveCount);
+
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    u64 nodes = 0;
+    for (u32 i = 0; i < moveCount && depth > 0; i++)
+    {
+        BoardMoveDo(board, &moves[i]);
+        u64 moveNodes = depth > 1 ? UciPerftCount(board, depth - 1) : 1;
+        BoardMoveUndo(board);
+
+        std::string uci = chess::uci::moveToUci(chess::Move(moves[i].data));
+        UciPrint(state, "%s: %llu\n", uci.c_str(), (unsigned long long)moveNodes);
+        nodes += moveNodes;
+    }
+
+    timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    f64 seconds = (f64)(end.tv_sec - start.tv_sec) + (f64)(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+
+    UciPrint(state, "\nNodes searched: %llu\ninfo string %.3fs %.2f Mnps\n\n", (unsigned long long)nodes, seconds,
+             seconds > 0.0 ? nodes / seconds / 1000000.0 : 0.0);
+}
+
+// go [perft <depth>] [wtime btime winc binc movestogo <ms>] [movetime <ms>] [depth <plies>] [nodes <n>] [infinite]
+// Without any limit the search runs until stop
+chess_internal void UciGo(LinuxUciState* state, char** context)
+{
+    UciStopSearch(state);
+
+    f64 times[2]      = { 0.0, 0.0 }; // Indexed by chess::Color
+    f64 increments[2] = { 0.0, 0.0 };
+    u32 movesToGo     = 0;
+    f64 moveTime      = 0.0;
+
+    EngineLimits limits = { 0, 0, 0.0 };
+    for (char* token = strtok_r(0, " \t", context); token; token = strtok_r(0, " \t", context))
+    {
+        if (UciIsToken(token, "infinite") || UciIsToken(token, "ponder"))
+        {
+            continue;
+        }
+
+        char* value = strtok_r(0, " \t", context);
+        if (!value)
+        {
+            break;
+        }
+
+        if (UciIsToken(token, "perft"))
+        {
+            UciPerft(state, (u32)atoi(value));
+            return;
+        }
+        else if (UciIsToken(token, "wtime"))
+        {
+            times[0] = atof(value) / 1000.0;
+        }
+        else if (UciIsToken(token, "btime"))
+        {
+            times[1] = atof(value) / 1000.0;
+        }
+        else if (UciIsToken(token, "winc"))
+        {
+            increments[0] = atof(value) / 1000.0;
+        }
+        else if (UciIsToken(token, "binc"))
+        {
+            increments[1] = atof(value) / 1000.0;
+        }
+        else if (UciIsToken(token, "movestogo"))
+        {
+            movesToGo = (u32)atoi(value);
+        }
+        else if (UciIsToken(token, "movetime"))
+        {
+            moveTime = atof(value) / 1000.0;
+        }
+        else if (UciIsToken(token, "depth"))
+        {
+            limits.depth = (u32)atoi(value);
+        }
+        else if (UciIsToken(token, "nodes"))
+        {
+            limits.nodes = (u64)atoll(value);
+        }
+    }
+
+    // The engine stops at the limit and does not start an iteration past half of it
+    s32 side = state->board.position->sideToMove() == chess::Color::WHITE ? 0 : 1;
+    if (moveTime > 0.0)
+    {
+        limits.seconds = moveTime - UCI_MOVE_OVERHEAD;
+    }
+    else if (times[side] > 0.0)
+    {
+        f64 budget     = times[side] / (movesToGo ? movesToGo : UCI_MOVES_TO_GO) + increments[side] * 0.75;
+        f64 maximum    = (times[side] - UCI_MOVE_OVERHEAD) * 0.5;
+        limits.seconds = budget < maximum ? budget : maximum;
+    }
+    if ((moveTime > 0.0 || times[side] > 0.0) && limits.seconds < 0.01)
+    {
+        limits.seconds = 0.01;
+    }
+
+    // A go must always be answered, a search that can not start gives up the move
+    Engine* engine = state->engine;
+    if (!EngineStart(engine, &state->board, limits, state->threadCount))
+    {
+        UciPrint(state, "info string unable to start the search\n");
+        UciPrint(state, "bestmove 0000\n");
+        return;
+    }
+
+    for (u32 i = 0; i < state->threadCount; i++)
+    {
+        pthread_create(&state->searchThreads[i], 0, UciSearchThreadProc, &engine->threads[i]);
+    }
+    pthread_create(&state->reporter, 0, UciReporterProc, state);
+    state->isSearching = true;
+}
+
+// setoption name <name> [value <value>], names may contain spaces
+chess_internal void UciSetOption(LinuxUciState* state, char** context)
+{
+    char  name[64] = "";
+    char* value    = 0;
+
+    char* token = strtok_r(0, " \t", context);
+    if (!UciIsToken(token, "name"))
+    {
+        return;
+    }
+    for (token = strtok_r(0, " \t", context); token && !UciIsToken(token, "value"); token = strtok_r(0, " \t", context))
+    {
+        if (strlen(name) + strlen(token) + 2 < sizeof(name))
+        {
+            strcat(name, name[0] ? " " : "");
+            strcat(name, token);
+        }
+    }
+    if (token)
+    {
+        value = strtok_r(0, "", context);
+    }
+
+    UciStopSearch(state);
+
+    if (strcasecmp(name, "Hash") == 0 && value)
+    {
+        s32 hashMB    = atoi(value);
+        state->hashMB = (u32)(hashMB < 1 ? 1 : (hashMB > UCI_MAX_HASH_MB ? UCI_MAX_HASH_MB : hashMB));
+        UciEngineCreate(state);
+    }
+    else if (strcasecmp(name, "Threads") == 0 && value)
+    {
+        s32 threadCount    = atoi(value);
+        state->threadCount = (u32)(threadCount < 1 ? 1 : (threadCount > ENGINE_MAX_THREADS ? ENGINE_MAX_THREADS
+                                                                                             : threadCount));
+        UciEngineCreate(state);
+    }
+    else if (strcasecmp(name, "Clear Hash") == 0)
+    {
+        EngineClearHash(state->engine);
+    }
+    else if (strcasecmp(name, "EvalFile") == 0 && value)
+    {
+        // An unreadable file falls back to the piece-square tables
+        state->hasNetwork      = UciLoadNetwork(state, value);
+        state->engine->network = state->hasNetwork ? &state->network : 0;
+        UciPrint(state, "info string %s '%s'\n", state->hasNetwork ? "loaded network" : "no valid network at", value);
+    }
+    else
+    {
+        UciPrint(state, "info string unknown option '%s'\n", name);
+    }
+}
+// ----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s, then UCI commands on stdin\n", argv[0]);
+        return 1;
+    }
+
+    // The engine mapping fits the largest hash and every thread, untouched pages are never committed
+    u64 storageSize = MEGABYTES(64);
+    u64 engineSize  = MEGABYTES(UCI_MAX_HASH_MB) + sizeof(Engine) + sizeof(EngineThread) * ENGINE_MAX_THREADS +
+                     KILOBYTES(64);
+
+    void* storage = mmap(0, storageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void* engineStorage =
+        mmap(0, engineSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (storage == MAP_FAILED || engineStorage == MAP_FAILED)
+    {
+        fprintf(stderr, "[LINUX] unable to map %llu bytes\n", (unsigned long long)(storageSize + engineSize));
+        return 1;
+    }
+
+    LinuxUciState* state = (LinuxUciState*)storage;
+    ArenaInit(&state->arena, (u8*)storage + sizeof(LinuxUciState), storageSize - sizeof(LinuxUciState));
+    ArenaInit(&state->engineArena, engineStorage, engineSize);
+    pthread_mutex_init(&state->outputLock, 0);
+
+    BoardInit(&state->board, DEFAULT_FEN_STRING, &state->arena, BOARD_HISTORY_MAX_PLIES);
+    strcpy(state->rootFen, DEFAULT_FEN_STRING);
+    ArenaInit(&state->networkArena, ArenaPushSize(&state->arena, NNUE_MAX_ARENA_SIZE, 64), NNUE_MAX_ARENA_SIZE);
+
+    state->hashMB      = UCI_DEFAULT_HASH_MB;
+    state->threadCount = 1;
+    state->hasNetwork  = UciLoadNetwork(state, NNUE_NETWORK_PATH);
+    UciLoadBitbases(state);
+    UciEngineCreate(state);
+
+    char*  line     = 0;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, stdin) >= 0)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char* context = 0;
+        char* command = strtok_r(line, " \t", &context);
+        if (!command)
+        {
+            continue;
+        }
+
+        if (UciIsToken(command, "uci"))
+        {
+            UciPrint(state,
+                     "id name Chess\n"
+                     "id author elmarsan\n"
+                     "option name Hash type spin default %u min 1 max %u\n"
+                     "option name Threads type spin default 1 min 1 max %u\n"
+                     "option name Clear Hash type button\n"
+                     "option name EvalFile type string default %s\n"
+                     "uciok\n",
+                     UCI_DEFAULT_HASH_MB, UCI_MAX_HASH_MB, ENGINE_MAX_THREADS, NNUE_NETWORK_PATH);
+        }
+        else if (UciIsToken(command, "isready"))
+        {
+            UciPrint(state, "readyok\n");
+        }
+        else if (UciIsToken(command, "ucinewgame"))
+        {
+            UciStopSearch(state);
+            EngineClearHash(state->engine);
+        }
+        else if (UciIsToken(command, "position"))
+        {
+            UciPosition(state, &context);
+        }
+        else if (UciIsToken(command, "go"))
+        {
+            UciGo(state, &context);
+        }
+        else if (UciIsToken(command, "stop"))
+        {
+            UciStopSearch(state);
+        }
+        else if (UciIsToken(command, "setoption"))
+        {
+            UciSetOption(state, &context);
+        }
+        else if (UciIsToken(command, "d"))
+        {
+            char fen[FEN_STR_MAX_LENGTH];
+            BoardGetFen(&state->board, fen);
+            UciPrint(state, "Fen: %s\nKey: %016llx\nPlies: %u\n", fen,
+                     (unsigned long long)state->board.position->hash(), state->board.history.count);
+        }
+        else if (UciIsToken(command, "quit"))
+        {
+            break;
+        }
+    }
+
+    UciStopSearch(state);
+    free(line);
+
+    return 0;
+}
@@ -421,7 +421,26 @@ PLATFORM_FILE_READ_ENTIRE(Win32FileReadEntire)
     else
     {
         CHESS_LOG("[WIN32] unable to open file '%s'", filename);
-        CHESS_ASSERT(0);
+    }
+
+    return result;
+}
+
+PLATFORM_FILE_WRITE_ENTIRE(Win32FileWriteEntire)
+{
+    CHESS_LOG("[WIN32] writing entire file: '%s'", filename);
+
+    bool result = false;
+
+    FILE* file = fopen(filename, "wb");
+    if (file)
+    {
+        result = fwrite(memory, 1, size, file) == size;
+        fclose(file);
+    }
+    if (!result)
+    {
+        CHESS_LOG("[WIN32] unable to write file '%s'", filename);
     }
 
     return result;
@@ -434,6 +453,290 @@ PLATFORM_FILE_FREE_MEMORY(Win32FileFreeMemory)
         delete[] (u8*)memory;
     }
 }
+
+// The view keeps the file open, only the mapping handle is kept for FileUnmap
+PLATFORM_FILE_MAP(Win32FileMap)
+{
+    CHESS_LOG("[WIN32] mapping file: '%s'", filename);
+
+    FileMapResult result = { 0 };
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        CHESS_LOG("[WIN32] unable to open file '%s'", filename);
+        return result;
+    }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping)
+        {
+            result.content = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (result.content)
+            {
+                result.contentSize = (u64)size.QuadPart;
+                result.handle      = mapping;
+            }
+            else
+            {
+                CloseHandle(mapping);
+            }
+        }
+    }
+    if (!result.content)
+    {
+        CHESS_LOG("[WIN32] unable to map file '%s'", filename);
+    }
+    CloseHandle(file);
+
+    return result;
+}
+
+PLATFORM_FILE_UNMAP(Win32FileUnmap)
+{
+    if (file && file->content)
+    {
+        UnmapViewOfFile(file->content);
+        CloseHandle((HANDLE)file->handle);
+        *file = {};
+    }
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Process
+struct PlatformProcess
+{
+    HANDLE process;
+    HANDLE input;  // Write end of the child standard input, PIPE_NOWAIT
+    HANDLE output; // Read end of the child standard output
+};
+
+PLATFORM_PROCESS_START(Win32ProcessStart)
+{
+    CHESS_LOG("[WIN32] starting process: '%s'", commandLine);
+
+    SECURITY_ATTRIBUTES attributes = { sizeof(SECURITY_ATTRIBUTES), 0, TRUE };
+
+    HANDLE childInput, input, output, childOutput;
+    if (!CreatePipe(&childInput, &input, &attributes, KILOBYTES(64)))
+    {
+        Win32HandleError("CreatePipe");
+        return 0;
+    }
+    if (!CreatePipe(&output, &childOutput, &attributes, KILOBYTES(64)))
+    {
+        Win32HandleError("CreatePipe");
+        CloseHandle(childInput);
+        CloseHandle(input);
+        return 0;
+    }
+
+    // Only the child ends are inherited
+    SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+    DWORD mode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+    SetNamedPipeHandleState(input, &mode, 0, 0);
+
+    STARTUPINFOA startup = { sizeof(STARTUPINFOA) };
+    startup.dwFlags      = STARTF_USESTDHANDLES;
+    startup.hStdInput    = childInput;
+    startup.hStdOutput   = childOutput;
+    startup.hStdError    = childOutput;
+
+    // CreateProcessA may write to the command line
+    char command[MAX_PATH * 2];
+    strncpy(command, commandLine, sizeof(command) - 1);
+    command[sizeof(command) - 1] = '\0';
+
+    PROCESS_INFORMATION information;
+    BOOL isCreated = CreateProcessA(0, command, 0, 0, TRUE, CREATE_NO_WINDOW, 0, 0, &startup, &information);
+    CloseHandle(childInput);
+    CloseHandle(childOutput);
+    if (!isCreated)
+    {
+        CHESS_LOG("[WIN32] unable to start process '%s'", commandLine);
+        CloseHandle(input);
+        CloseHandle(output);
+        return 0;
+    }
+    CloseHandle(information.hThread);
+
+    PlatformProcess* result = new PlatformProcess;
+    result->process         = information.hProcess;
+    result->input           = input;
+    result->output          = output;
+
+    return result;
+}
+
+PLATFORM_PROCESS_WRITE(Win32ProcessWrite)
+{
+    DWORD written = 0;
+    return WriteFile(process->input, data, size, &written, 0) && written == size;
+}
+
+// Anonymous pipes can not be waited on, the wait is on the process handle in 1 ms steps
+PLATFORM_PROCESS_READ(Win32ProcessRead)
+{
+    ULONGLONG start = GetTickCount64();
+    for (;;)
+    {
+        DWORD available = 0;
+        if (!PeekNamedPipe(process->output, 0, 0, 0, &available, 0))
+        {
+            return -1;
+        }
+        if (available > 0)
+        {
+            DWORD read = 0;
+            if (!ReadFile(process->output, buffer, available < size ? available : size, &read, 0))
+            {
+                return -1;
+            }
+            return (s32)read;
+        }
+        if (GetTickCount64() - start >= timeoutMilliseconds)
+        {
+            return 0;
+        }
+        WaitForSingleObject(process->process, 1);
+    }
+}
+
+PLATFORM_PROCESS_STOP(Win32ProcessStop)
+{
+    if (!process)
+    {
+        return;
+    }
+
+    CloseHandle(process->input);
+    if (WaitForSingleObject(process->process, 500) != WAIT_OBJECT_0)
+    {
+        CHESS_LOG("[WIN32] process did not exit, terminating it");
+        TerminateProcess(process->process, 1);
+    }
+    CloseHandle(process->output);
+    CloseHandle(process->process);
+    delete process;
+}
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Work queue
+// Entries are added by the game thread only and claimed by the workers with a compare exchange
+struct PlatformWorkQueueEntry
+{
+    PlatformWorkQueueCallback* callback;
+    void*                      data;
+};
+
+struct PlatformWorkQueue
+{
+    u32 volatile           completionGoal;
+    u32 volatile           completionCount;
+    u32 volatile           nextEntryToWrite;
+    u32 volatile           nextEntryToRead;
+    HANDLE                 semaphore;
+    PlatformWorkQueueEntry entries[256];
+};
+
+// Returns true when the queue is empty
+chess_internal bool Win32WorkQueueDoNextEntry(PlatformWorkQueue* queue)
+{
+    bool result = false;
+
+    u32 originalNextEntryToRead = queue->nextEntryToRead;
+    u32 newNextEntryToRead      = (originalNextEntryToRead + 1) % ARRAY_COUNT(queue->entries);
+    if (originalNextEntryToRead != queue->nextEntryToWrite)
+    {
+        u32 index = InterlockedCompareExchange((LONG volatile*)&queue->nextEntryToRead, newNextEntryToRead,
+                                               originalNextEntryToRead);
+        if (index == originalNextEntryToRead)
+        {
+            PlatformWorkQueueEntry entry = queue->entries[index];
+            entry.callback(queue, entry.data);
+            InterlockedIncrement((LONG volatile*)&queue->completionCount);
+        }
+    }
+    else
+    {
+        result = true;
+    }
+
+    return result;
+}
+
+PLATFORM_WORK_QUEUE_ADD_ENTRY(Win32WorkQueueAddEntry)
+{
+    u32 newNextEntryToWrite = (queue->nextEntryToWrite + 1) % ARRAY_COUNT(queue->entries);
+    CHESS_ASSERT(newNextEntryToWrite != queue->nextEntryToRead);
+
+    PlatformWorkQueueEntry* entry = queue->entries + queue->nextEntryToWrite;
+    entry->callback               = callback;
+    entry->data                   = data;
+    queue->completionGoal++;
+
+    // Entry must be visible before the workers can claim it
+    MemoryBarrier();
+    queue->nextEntryToWrite = newNextEntryToWrite;
+    ReleaseSemaphore(queue->semaphore, 1, 0);
+}
+
+// The calling thread helps with the remaining entries
+PLATFORM_WORK_QUEUE_COMPLETE_ALL(Win32WorkQueueCompleteAll)
+{
+    while (queue->completionGoal != queue->completionCount)
+    {
+        Win32WorkQueueDoNextEntry(queue);
+    }
+
+    queue->completionGoal  = 0;
+    queue->completionCount = 0;
+}
+
+DWORD WINAPI Win32WorkQueueThreadProc(LPVOID parameter)
+{
+    PlatformWorkQueue* queue = (PlatformWorkQueue*)parameter;
+
+    for (;;)
+    {
+        if (Win32WorkQueueDoNextEntry(queue))
+        {
+            WaitForSingleObjectEx(queue->semaphore, INFINITE, FALSE);
+        }
+    }
+}
+
+// Workers run below normal priority so the game thread keeps its frame time while they are busy
+chess_internal void Win32WorkQueueInit(PlatformWorkQueue* queue, u32 threadCount)
+{
+    queue->completionGoal   = 0;
+    queue->completionCount  = 0;
+    queue->nextEntryToWrite = 0;
+    queue->nextEntryToRead  = 0;
+    queue->semaphore        = CreateSemaphoreExA(0, 0, threadCount, 0, 0, SEMAPHORE_ALL_ACCESS);
+    if (!queue->semaphore)
+    {
+        Win32HandleError("CreateSemaphoreExA");
+    }
+
+    for (u32 i = 0; i < threadCount; i++)
+    {
+        HANDLE thread = CreateThread(0, 0, Win32WorkQueueThreadProc, queue, 0, 0);
+        if (!thread)
+        {
+            Win32HandleError("CreateThread");
+            continue;
+        }
+        SetThreadPriority(thread, THREAD_PRIORITY_BELOW_NORMAL);
+        CloseHandle(thread);
+    }
+}
 // ----------------------------------------------------------------------------
 
 // ----------------------------------------------------------------------------
@@ -542,6 +845,22 @@ chess_internal void Win32ProcessPendingMessages(Win32State* state, GameInputCont
             {
                 Win32UpdateGameButtonState(&keyboardController->buttonStart, isDown);
             }
+            if (vkCode == VK_BACK)
+            {
+                Win32UpdateGameButtonState(&keyboardController->buttonRewind, isDown);
+            }
+            if (vkCode == VK_F5)
+            {
+                Win32UpdateGameButtonState(&keyboardController->buttonSave, isDown);
+            }
+            if (vkCode == VK_F6)
+            {
+                Win32UpdateGameButtonState(&keyboardController->buttonSolve, isDown);
+            }
+            if (vkCode == VK_F9)
+            {
+                Win32UpdateGameButtonState(&keyboardController->buttonLoad, isDown);
+            }
             if (vkCode == VK_F4 && altKeyWasDown)
             {
                 CHESS_LOG("[WIN32] ALT+F4 pressed, closing chess...");
@@ -726,22 +1045,31 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdline,
     const char*   tempGameDLLFilepath = "CopyChess.dll";
     Win32GameCode game                = Win32LoadGameCode(gameDLLFilepath, tempGameDLLFilepath);
 
-    GameMemory gameMemory                   = {};
-    gameMemory.input                        = &win32State.gameInput;
-    gameMemory.platform.SoundLoad           = Win32SoundLoad;
-    gameMemory.platform.SoundPlay           = Win32SoundPlay;
-    gameMemory.platform.SoundDestroy        = Win32SoundDestroy;
-    gameMemory.platform.ImageLoad           = Win32ImageLoad;
-    gameMemory.platform.ImageDestroy        = Win32ImageDestroy;
-    gameMemory.platform.WindowGetDimension  = Win32WindowGetDimension;
-    gameMemory.platform.WindowSetFullscreen = Win32WindowSetFullscreen;
-    gameMemory.platform.WindowSetWindowed   = Win32WindowSetWindowed;
-    gameMemory.platform.WindowCanResize     = Win32WindowCanResize;
-    gameMemory.platform.TimerGetTicks       = Win32TimerGetTicks;
-    gameMemory.platform.FileReadEntire      = Win32FileReadEntire;
-    gameMemory.platform.FileFreeMemory      = Win32FileFreeMemory;
-    gameMemory.platform.Log                 = Win32Log;
-    gameMemory.draw                         = draw;
+    GameMemory gameMemory                    = {};
+    gameMemory.input                         = &win32State.gameInput;
+    gameMemory.platform.SoundLoad            = Win32SoundLoad;
+    gameMemory.platform.SoundPlay            = Win32SoundPlay;
+    gameMemory.platform.SoundDestroy         = Win32SoundDestroy;
+    gameMemory.platform.ImageLoad            = Win32ImageLoad;
+    gameMemory.platform.ImageDestroy         = Win32ImageDestroy;
+    gameMemory.platform.WindowGetDimension   = Win32WindowGetDimension;
+    gameMemory.platform.WindowSetFullscreen  = Win32WindowSetFullscreen;
+    gameMemory.platform.WindowSetWindowed    = Win32WindowSetWindowed;
+    gameMemory.platform.WindowCanResize      = Win32WindowCanResize;
+    gameMemory.platform.TimerGetTicks        = Win32TimerGetTicks;
+    gameMemory.platform.FileReadEntire       = Win32FileReadEntire;
+    gameMemory.platform.FileWriteEntire      = Win32FileWriteEntire;
+    gameMemory.platform.FileFreeMemory       = Win32FileFreeMemory;
+    gameMemory.platform.FileMap              = Win32FileMap;
+    gameMemory.platform.FileUnmap            = Win32FileUnmap;
+    gameMemory.platform.Log                  = Win32Log;
+    gameMemory.platform.ProcessStart         = Win32ProcessStart;
+    gameMemory.platform.ProcessWrite         = Win32ProcessWrite;
+    gameMemory.platform.ProcessRead          = Win32ProcessRead;
+    gameMemory.platform.ProcessStop          = Win32ProcessStop;
+    gameMemory.platform.WorkQueueAddEntry    = Win32WorkQueueAddEntry;
+    gameMemory.platform.WorkQueueCompleteAll = Win32WorkQueueCompleteAll;
+    gameMemory.draw                          = draw;
 
     gameMemory.permanentStorageSize = MEGABYTES(256);
     gameMemory.permanentStorage =
@@ -751,6 +1079,20 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdline,
         Win32HandleError("VirtualAlloc");
     }
 
+    // One core stays with the game thread
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    u32 workerCount = systemInfo.dwNumberOfProcessors > 1 ? systemInfo.dwNumberOfProcessors - 1 : 1;
+
+    static PlatformWorkQueue workQueue;
+    Win32WorkQueueInit(&workQueue, workerCount);
+    gameMemory.workQueue            = &workQueue;
+    gameMemory.workQueueThreadCount = workerCount;
+
+    static PlatformWorkQueue ioQueue;
+    Win32WorkQueueInit(&ioQueue, 2);
+    gameMemory.ioQueue = &ioQueue;
+
     // Init controllers
     win32State.gameInput.controllers[GAME_INPUT_CONTROLLER_KEYBOARD_0].isEnabled = true;
     for (u32 i = GAME_INPUT_CONTROLLER_GAMEPAD_0; i < ARRAY_COUNT(win32State.gameInput.controllers); i++)
@@ -780,6 +1122,11 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdline,
                       lastDLLWriteTime.wMinute, lastDLLWriteTime.wSecond, lastDLLWriteTime.wMilliseconds);
 #endif
             CHESS_LOG("[WIN32] reloading game code...");
+            // Workers may be running code from the DLL that is about to be released
+            gameMemory.cancelWork = true;
+            Win32WorkQueueCompleteAll(&workQueue);
+            Win32WorkQueueCompleteAll(&ioQueue);
+            gameMemory.cancelWork = false;
             Win32UnloadGameCode(&game);
             game = Win32LoadGameCode(gameDLLFilepath, tempGameDLLFilepath);
             CHESS_ASSERT(game.isValid);